@@ -15,6 +15,7 @@
 # 
 #  OPENSYNC_TRACE               True if tracing is enabled (debugging with env. var. OSYNC_TRACE)
 #  OPENSYNC_DEBUG_MODULES       True if modules shouldn't get unloaded by OpenSync, to keep symbols of plugins
+#  OPENSYNC_DEBUG_ALLOCATIONS   True if object pools should be bypassed, to debug allocations with malloc checkers
 #  OPENSYNC_UNITTESTS           True if unit tests should be build
 #
 # Copyright (c) 2007-2008 Daniel Gollub <dgollub@suse.de>
@@ -51,6 +52,7 @@ ENDIF ( NOT CMAKE_BUILD_TYPE )
 
 SET( OPENSYNC_TRACE TRUE CACHE BOOL "Debugging/Trace output of OpenSync" )
 SET( OPENSYNC_DEBUG_MODULES FALSE CACHE BOOL "Debugging modules. Avhoid unload of modules." )
+SET( OPENSYNC_DEBUG_ALLOCATIONS FALSE CACHE BOOL "Debugging allocations. Allocate every object with malloc." )
 SET( OPENSYNC_UNITTESTS FALSE CACHE BOOL "Build OpenSync unit tests." )
 SET( OPENSYNC_PYTHONBINDINGS TRUE CACHE BOOL "Build OpenSync with Python bindings." )
 
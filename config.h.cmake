@@ -16,9 +16,12 @@
 #define OPENSYNC_PLUGINVERSION ${OPENSYNC_PLUGINVERSION}
 
 #cmakedefine OPENSYNC_DEBUG_MODULES 
+#cmakedefine OPENSYNC_DEBUG_ALLOCATIONS
 #cmakedefine OPENSYNC_TRACE
 
 #cmakedefine HAVE_FLOCK
+#cmakedefine HAVE_INOTIFY
+#cmakedefine HAVE_ZLIB
 #cmakedefine HAVE_SOLARIS
 
 #define OPENSYNC_TESTDATA "${CMAKE_CURRENT_SOURCE_DIR}/tests/data"
@@ -267,7 +267,10 @@ static void sync_done(void *userdata, OSyncPluginInfo *info, OSyncContext *ctx)
 	//Now you get/calculate the current anchor of the device
 	char *lanchor = NULL;
 	char *anchorpath = osync_strdup_printf("%s/anchor.db", osync_plugin_info_get_configdir(info));
-	osync_anchor_update(anchorpath, "lanchor", lanchor);
+	if (!osync_anchor_update_full(anchorpath, "lanchor", lanchor, &error)) {
+		osync_free(anchorpath);
+		goto error;
+	}
 	osync_free(anchorpath);
 	//Save hashtable to database
 	if (!osync_hashtable_save(sinkenv->hashtable, &error))
@@ -97,7 +97,9 @@ static void destroy_file(char *input, unsigned int inpsize)
 {
   OSyncFileFormat *file = (OSyncFileFormat *)input;
 	
-  if (file->data)
+  if (file->map)
+    osync_file_map_unref(file->map);
+  else if (file->data)
     g_free(file->data);
 		
   if (file->path)
@@ -126,7 +128,12 @@ static osync_bool copy_file(const char *input, unsigned int inpsize, char **outp
   if (!outfile)
     return FALSE;
 	
-  if (inpfile->data) {
+  if (inpfile->map) {
+    /* Both copies share the pages of the mapping */
+    outfile->map = osync_file_map_ref(inpfile->map);
+    outfile->data = inpfile->data;
+    outfile->size = inpfile->size;
+  } else if (inpfile->data) {
     outfile->data = g_malloc0(inpfile->size);
     memcpy(outfile->data, inpfile->data, inpfile->size);
     outfile->size = inpfile->size;
@@ -166,15 +173,36 @@ static osync_bool marshal_file(const char *input, unsigned int inpsize, OSyncMes
   osync_trace(TRACE_ENTRY, "%s(%p, %i, %p, %p)", __func__, input, inpsize, message, error);
 	
   osync_message_write_string(message, file->path);
-  osync_message_write_buffer(message, file->data, file->size);
+
+  /* The client runs on the same host. Instead of copying the content
+     into the message, the other side maps the same file. */
+  if (file->map) {
+    /* Don't hand over a file which got rewritten since it got read */
+    if (!osync_file_map_validate(file->map, error))
+      goto error;
+
+    osync_message_write_int(message, 1);
+    osync_message_write_string(message, osync_file_map_get_path(file->map));
+    osync_message_write_string(message, osync_file_map_get_identity(file->map));
+  } else {
+    osync_message_write_int(message, 0);
+    osync_message_write_buffer(message, file->data, file->size);
+  }
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
 }
 
 static osync_bool demarshal_file(OSyncMessage *message, char **output, unsigned int *outpsize, OSyncError **error)
 {
   OSyncFileFormat *file = NULL;
+  char *mappath = NULL;
+  char *identity = NULL;
+  int mapped = 0;
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %p)", __func__, message, output, outpsize, error);
 	
   file = osync_try_malloc0(sizeof(OSyncFileFormat), error);
@@ -182,7 +210,29 @@ static osync_bool demarshal_file(OSyncMessage *message, char **output, unsigned
     goto error;
 	
   osync_message_read_string(message, &(file->path));
-  osync_message_read_buffer(message, (void *)&(file->data), (int *)&(file->size));
+  osync_message_read_int(message, &mapped);
+
+  if (mapped) {
+    osync_message_read_string(message, &mappath);
+    osync_message_read_string(message, &identity);
+
+    file->map = osync_file_map_new(mappath, error);
+    if (!file->map)
+      goto error_free_file;
+
+    if (strcmp(identity, osync_file_map_get_identity(file->map))) {
+      osync_error_set(error, OSYNC_ERROR_IO_ERROR, "File %s changed while being transferred", mappath);
+      goto error_free_file;
+    }
+
+    file->data = (char *)osync_file_map_get_data(file->map);
+    file->size = osync_file_map_get_size(file->map);
+
+    g_free(mappath);
+    g_free(identity);
+  } else {
+    osync_message_read_buffer(message, (void *)&(file->data), (int *)&(file->size));
+  }
 	
   *output = (char *)file;
   *outpsize = sizeof(OSyncFileFormat);
@@ -190,6 +240,10 @@ static osync_bool demarshal_file(OSyncMessage *message, char **output, unsigned
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
 
+ error_free_file:
+  g_free(mappath);
+  g_free(identity);
+  destroy_file((char *)file, sizeof(OSyncFileFormat));
  error:
 	
   osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
@@ -45,6 +45,12 @@ typedef struct OSyncFileFormat {
   char *path;
   char *data;
   unsigned int size;
+  /** If set, data points into this shared, read-only mapping of the file
+      (see osync_file_map_new()) and must neither be modified nor freed.
+      Copies and transfers to the plugin process share the mapping.
+      The mapping is no snapshot: the file has to be replaced, not
+      truncated or rewritten in place, while it is referenced. */
+  OSyncFileMap *map;
 } OSyncFileFormat;
 
 #endif //_FILE_H
@@ -121,24 +121,91 @@ osync_bool demarshal_xmlformat(OSyncMessage *message, char **output, unsigned in
 }
 
 
+static char *keys_content[] =  {"Content", NULL};
+static char *keys_name[] = {"FirstName", "LastName", NULL};
+
+static OSyncXMLPoints contact_points[] = {
+  {"EMail",           10, keys_content},
+  {"FormattedName",   -1, keys_content},
+  {"Name",            90, keys_name},
+  {"Revision",        -1, keys_content},
+  {"Telephone",       10, keys_content},
+  {"Uid",             -1, keys_content},
+  {NULL}
+};
+
+static OSyncXMLPoints event_points[] = {
+  {"Alarm",               -1, keys_content}, // Not implemented
+  {"Created",             -1, keys_content}, // It changes ... weird . Digg further 
+  {"DateCalendarCreated", -1, keys_content},
+  {"DateEnd",             10, keys_content},
+  {"DateStarted",         10, keys_content},
+  {"LastModified",        -1, keys_content},// fixme
+  {"Method",              -1, keys_content},// fixme
+  {"ProductID",           -1, keys_content},
+  {"Status",              -1, keys_content},
+  {"Summary",             90, keys_content},
+  {"Uid",                 -1, keys_content},
+  {NULL}
+};
+
+static OSyncXMLPoints todo_points[] = {
+  {"DateCalendarCreated",     -1,  keys_content},// Not in vtodo10
+  {"DateStarted",             10,  keys_content},
+  {"Due",                     10,  keys_content},
+  {"Method",                  -1,  keys_content}, // Not in vtodo10
+  {"PercentComplete",         -1,  keys_content}, // Not in vtodo10
+  {"ProductID",               -1,  keys_content},
+  {"Summary",                 90,  keys_content},
+  {"Timezone",                -1,  keys_content}, // Not in vtodo10
+  {"TimezoneComponent",       -1,  keys_content}, // Not in vtodo10
+  {"TimezoneRule",            -1,  keys_content}, // Not in vtodo10
+  {"Uid",                     -1,  keys_content},
+  {NULL}
+};
+
+static OSyncXMLPoints note_points[] = {
+  {"Class",                 -1, keys_content},// fixme
+  {"Created",               -1, keys_content},// fixme
+  {"DateCalendarCreated",   -1, keys_content},
+  {"Description",           90, keys_content},
+  {"LastModified",          -1, keys_content},// fixme
+  {"Method",                -1, keys_content},
+  {"ProductID",             -1, keys_content},
+  {"Summary",               90, keys_content},
+  {"Uid",                   -1, keys_content},
+  {NULL}
+};
+
+/* The points tables get compiled on the first compare of the objtype and
+ * are kept as long as the format plugin is loaded */
+static GStaticMutex points_tables_mutex = G_STATIC_MUTEX_INIT;
+static OSyncXMLPointsTable *contact_table = NULL;
+static OSyncXMLPointsTable *event_table = NULL;
+static OSyncXMLPointsTable *todo_table = NULL;
+static OSyncXMLPointsTable *note_table = NULL;
+
+static OSyncXMLPointsTable *get_points_table(OSyncXMLPointsTable **table, OSyncXMLPoints points[])
+{
+  OSyncXMLPointsTable *ret;
+
+  g_static_mutex_lock(&points_tables_mutex);
+  if (!*table)
+    *table = xmlformat_points_table_new(points);
+  ret = *table;
+  g_static_mutex_unlock(&points_tables_mutex);
+
+  return ret;
+}
+
 static OSyncConvCmpResult compare_contact(const char *leftdata, unsigned int leftsize, const char *rightdata, unsigned int rightsize)
 {
-  char* keys_content[] =  {"Content", NULL};
-  char* keys_name[] = {"FirstName", "LastName", NULL};
-  OSyncXMLPoints points[] = {
-    {"EMail",           10, keys_content},
-    {"FormattedName",   -1, keys_content},
-    {"Name",            90, keys_name},
-    {"Revision",        -1, keys_content},
-    {"Telephone",       10, keys_content},
-    {"Uid",             -1, keys_content},
-    {NULL}
-  };
+  OSyncXMLPointsTable *table = get_points_table(&contact_table, contact_points);
   OSyncConvCmpResult ret;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %i, %p, %i)", __func__, leftdata, leftsize, rightdata, rightsize);
 
-  ret = xmlformat_compare((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, points, 0, 100);
+  ret = xmlformat_compare_table((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, table, 0, 100);
 
   osync_trace(TRACE_EXIT, "%s: %i", __func__, ret);
   return ret;
@@ -154,26 +221,12 @@ static void create_contact(char **data, unsigned int *size)
 
 static OSyncConvCmpResult compare_event(const char *leftdata, unsigned int leftsize, const char *rightdata, unsigned int rightsize)
 {
-  char* keys_content[] =  {"Content", NULL};
-  OSyncXMLPoints points[] = {
-    {"Alarm",               -1, keys_content}, // Not implemented
-    {"Created",             -1, keys_content}, // It changes ... weird . Digg further 
-    {"DateCalendarCreated", -1, keys_content},
-    {"DateEnd",             10, keys_content},
-    {"DateStarted",         10, keys_content},
-    {"LastModified",        -1, keys_content},// fixme
-    {"Method",              -1, keys_content},// fixme
-    {"ProductID",           -1, keys_content},
-    {"Status",              -1, keys_content},
-    {"Summary",             90, keys_content},
-    {"Uid",                 -1, keys_content},
-    {NULL}
-  };
+  OSyncXMLPointsTable *table = get_points_table(&event_table, event_points);
   OSyncConvCmpResult ret;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, leftdata, rightdata);
 
-  ret = xmlformat_compare((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, points, 0, 100);
+  ret = xmlformat_compare_table((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, table, 0, 100);
 
   osync_trace(TRACE_EXIT, "%s: %i", __func__, ret);
   return ret;
@@ -189,26 +242,12 @@ void create_event(char **data, unsigned int *size)
 
 static OSyncConvCmpResult compare_todo(const char *leftdata, unsigned int leftsize, const char *rightdata, unsigned int rightsize)
 {
-  char* keys_content[] =  {"Content", NULL};
-  OSyncXMLPoints points[] = {
-    {"DateCalendarCreated",     -1,  keys_content},// Not in vtodo10
-    {"DateStarted",             10,  keys_content},
-    {"Due",                     10,  keys_content},
-    {"Method",                  -1,  keys_content}, // Not in vtodo10
-    {"PercentComplete",         -1,  keys_content}, // Not in vtodo10
-    {"ProductID",               -1,  keys_content},
-    {"Summary",                 90,  keys_content},
-    {"Timezone",                -1,  keys_content}, // Not in vtodo10
-    {"TimezoneComponent",       -1,  keys_content}, // Not in vtodo10
-    {"TimezoneRule",            -1,  keys_content}, // Not in vtodo10
-    {"Uid",                     -1,  keys_content},
-    {NULL}
-  };
+  OSyncXMLPointsTable *table = get_points_table(&todo_table, todo_points);
   OSyncConvCmpResult ret;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, leftdata, rightdata);
 
-  ret = xmlformat_compare((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, points, 0, 100);
+  ret = xmlformat_compare_table((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, table, 0, 100);
 
   osync_trace(TRACE_EXIT, "%s: %i", __func__, ret);
   return ret;
@@ -224,24 +263,12 @@ static void create_todo(char **data, unsigned int *size)
 
 static OSyncConvCmpResult compare_note(const char *leftdata, unsigned int leftsize, const char *rightdata, unsigned int rightsize)
 {
-  char* keys_content[] =  {"Content", NULL};
-  OSyncXMLPoints points[] = {
-    {"Class",                 -1, keys_content},// fixme
-    {"Created",               -1, keys_content},// fixme
-    {"DateCalendarCreated",   -1, keys_content},
-    {"Description",           90, keys_content},
-    {"LastModified",          -1, keys_content},// fixme
-    {"Method",                -1, keys_content},
-    {"ProductID",             -1, keys_content},
-    {"Summary",               90, keys_content},
-    {"Uid",                   -1, keys_content},
-    {NULL}
-  };
+  OSyncXMLPointsTable *table = get_points_table(&note_table, note_points);
   OSyncConvCmpResult ret;
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, leftdata, rightdata);
 
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, leftdata, rightdata);
 
-  ret = xmlformat_compare((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, points, 0, 100);
+  ret = xmlformat_compare_table((OSyncXMLFormat *)leftdata, (OSyncXMLFormat *)rightdata, table, 0, 100);
 
   osync_trace(TRACE_EXIT, "%s: %i", __func__, ret);
   return ret;
@@ -56,9 +56,17 @@ char *print_xmlformat(const char *data, unsigned int size);
 osync_bool marshal_xmlformat(const char *input, unsigned int inpsize, OSyncMessage *message, OSyncError **error);
 osync_bool demarshal_xmlformat(OSyncMessage *message, char **output, unsigned int *outpsize, OSyncError **error);
 
-int xmlformat_get_points(OSyncXMLPoints points[], int* cur_pos, int basic_points, const char* fieldname);
+/**
+ * @brief A OSyncXMLPoints array compiled for lookups by fieldname
+ * @ingroup OSyncXMLFormatAPI
+ */
+typedef struct OSyncXMLPointsTable OSyncXMLPointsTable;
+
+OSyncXMLPointsTable *xmlformat_points_table_new(OSyncXMLPoints points[]);
+void xmlformat_points_table_free(OSyncXMLPointsTable *table);
 
 OSyncConvCmpResult xmlformat_compare(OSyncXMLFormat *xmlformat1, OSyncXMLFormat *xmlformat2, OSyncXMLPoints points[], int basic_points, int treshold);
+OSyncConvCmpResult xmlformat_compare_table(OSyncXMLFormat *xmlformat1, OSyncXMLFormat *xmlformat2, OSyncXMLPointsTable *table, int basic_points, int treshold);
 
 #endif /* XMLFORMAT_H_ */
 
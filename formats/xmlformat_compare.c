@@ -31,30 +31,70 @@
 
 
 /**
- * @brief Search for the points in the sorted OSyncXMLPoints array for a given fieldname.
- * @param points The sorted points array
- * @param cur_pos Pointer to the actual line in the points array
- * @param basic_points Points which should be returned if fieldname will not found in the points array 
- * @param fieldname The name of the field for which the points should be returned
- * @returns The points for the fieldname
+ * @brief A compiled OSyncXMLPoints array
+ */
+struct OSyncXMLPointsTable {
+  /** Maps the fieldname to its OSyncXMLPoints entry */
+  GHashTable *fields;
+};
+
+/**
+ * @brief The key nodes of a xmlfield, collected once per compare
+ */
+typedef struct XMLFieldKeys {
+  OSyncXMLField *xmlfield;
+  /** Number of key nodes */
+  unsigned int count;
+  /** The children of the xmlfield node in document order */
+  xmlNodePtr *nodes;
+} XMLFieldKeys;
+
+/* Names of nodes of the same document are mostly interned by the
+ * dictionary of the document, so comparing the pointers first saves
+ * most of the string compares. */
+#define XMLFORMAT_NAME_EQUAL(name1, name2) ((name1) == (name2) || !strcmp((const char *)(name1), (const char *)(name2)))
+
+/**
+ * @brief Compiles a points array into a table which can be searched in constant time
+ * @param points The points array. It must stay valid as long as the table is used.
+ * @returns The compiled table
  */
-int xmlformat_get_points(OSyncXMLPoints *points, int* cur_pos, int basic_points, const char* fieldname)
+OSyncXMLPointsTable *xmlformat_points_table_new(OSyncXMLPoints points[])
 {
-  for(; points[(*cur_pos)].fieldname; (*cur_pos)++) {
-    int res = strcmp(points[(*cur_pos)].fieldname, fieldname);
-    if(res == 0) 
-      return points[(*cur_pos)].points;
-    if(res > 0)
-      return basic_points;
-  }
+  OSyncXMLPointsTable *table = g_malloc0(sizeof(OSyncXMLPointsTable));
+  int i;
+
+  table->fields = g_hash_table_new(g_str_hash, g_str_equal);
+  for (i = 0; points[i].fieldname; i++)
+    g_hash_table_insert(table->fields, points[i].fieldname, &points[i]);
 
-  return basic_points;
+  return table;
 }
 
 /**
- * @brief Search for the points in the sorted OSyncXMLPoints array for the fieldname of xmlfield and handle ignored fields.
+ * @brief Frees a compiled points table
+ * @param table The table to free
+ */
+void xmlformat_points_table_free(OSyncXMLPointsTable *table)
+{
+  g_hash_table_destroy(table->fields);
+  g_free(table);
+}
+
+/**
+ * @brief Search for the points entry of a fieldname in the compiled points table
+ * @param table The compiled points table
+ * @param fieldname The name of the field for which the points should be returned
+ * @returns The points entry or NULL if the fieldname is not in the table
+ */
+static OSyncXMLPoints *xmlformat_points_table_lookup(OSyncXMLPointsTable *table, const char *fieldname)
+{
+  return g_hash_table_lookup(table->fields, fieldname);
+}
+
+/**
+ * @brief Search for the points of a fieldname and handle ignored fields.
  * 
- *  This uses xmlformat_get_points() but handle the case if the field needs to be ignored.
  *  Ignored fields doesn't have influence on the compare result. This is needed to keep the compare 
  *  result SAME if an ignored fields are the only differences between the entries.
  *
@@ -64,16 +104,18 @@ int xmlformat_get_points(OSyncXMLPoints *points, int* cur_pos, int basic_points,
  *  is the greather equal as the thresold value.
  *
  * @param xmlfield Pointer to xmlfield
- * @param points The sorted points array
- * @param cur_pos Pointer to the actual line in the points array. Gets incremented if the xmlfield requires this! 
- * @param basic_points Points which should be returned if fieldname will not found in the points array 
+ * @param table The compiled points table
+ * @param basic_points Points which should be returned if fieldname will not found in the points table 
  * @param same Pointer ot the compare result flag SAME, which got not set to FALSE if the fields should be ignored.
  * @returns The points for the fieldname. If the field should be ignored 0 points got retunred.
  */
-static int xmlformat_subtract_points(OSyncXMLField *xmlfield, OSyncXMLPoints *points, int *cur_pos, int basic_points, int *same) {
+static int xmlformat_subtract_points(OSyncXMLField *xmlfield, OSyncXMLPointsTable *table, int basic_points, int *same) {
+  OSyncXMLPoints *entry = NULL;
   int p = 0;
-  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %i, %p)", __func__, xmlfield, points, cur_pos, basic_points, same);
-  p = xmlformat_get_points(points, cur_pos, basic_points, osync_xmlfield_get_name(xmlfield));
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %i, %p)", __func__, xmlfield, table, basic_points, same);
+
+  entry = xmlformat_points_table_lookup(table, osync_xmlfield_get_name(xmlfield));
+  p = entry ? entry->points : basic_points;
 
   /* Stay with SAME as compare result and don't substract any points - if fields should be ignored */
   if (p != -1) {
@@ -102,127 +144,200 @@ static xmlChar *xml_node_get_content(xmlNodePtr node)
 }
 
 /**
- * @brief Compares two xmlfield objects with each other
- * @param xmlfield1 The pointer to a xmlformat object
- * @param xmlfield2 The pointer to a xmlformat object
- * @return TRUE if both xmlfield objects are the same otherwise FALSE
+ * @brief Collects the key nodes of a xmlfield
+ * @param keys The key cache to fill
+ * @param xmlfield The pointer to a xmlfield object
  */
-osync_bool xmlfield_compare(OSyncXMLField *xmlfield1, OSyncXMLField *xmlfield2)
+static void xmlfield_keys_init(XMLFieldKeys *keys, OSyncXMLField *xmlfield)
 {
-  int i;	
-  osync_bool same;
-  xmlNodePtr key1 = NULL;
-  xmlNodePtr key2 = NULL;
+  xmlNodePtr cur = NULL;
+  unsigned int i = 0;
+
+  keys->xmlfield = xmlfield;
+  keys->count = 0;
+  for (cur = xmlfield->node->children; cur; cur = cur->next)
+    keys->count++;
+
+  keys->nodes = g_malloc(sizeof(xmlNodePtr) * (keys->count + 1));
+  for (cur = xmlfield->node->children; cur; cur = cur->next)
+    keys->nodes[i++] = cur;
+  keys->nodes[i] = NULL;
+}
 
+static void xmlfield_keys_clear(XMLFieldKeys *keys)
+{
+  g_free(keys->nodes);
+  keys->nodes = NULL;
+}
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, xmlfield1, xmlfield2);
-  osync_assert(xmlfield1);
-  osync_assert(xmlfield2);
-	
-  if(strcmp(osync_xmlfield_get_name(xmlfield1), osync_xmlfield_get_name(xmlfield2))) {
-    osync_trace(TRACE_EXIT, "%s: %i", __func__, FALSE);
+/**
+ * @brief Checks if two arrays of key nodes hold the same contents, in any order
+ * @param nodes1 The first array
+ * @param count1 The length of the first array
+ * @param nodes2 The second array
+ * @param count2 The length of the second array
+ * @return TRUE if every content of nodes1 has an own counterpart in nodes2
+ */
+static osync_bool xml_nodes_same_contents(xmlNodePtr *nodes1, unsigned int count1, xmlNodePtr *nodes2, unsigned int count2)
+{
+  gboolean used_static[16];
+  gboolean *used = used_static;
+  osync_bool same = TRUE;
+  unsigned int i, j;
+
+  if (count1 != count2)
     return FALSE;
-  }
 
-  same = TRUE;
-  key1 = xmlfield1->node->children;
-  key2 = xmlfield2->node->children;
-	
-  while(same)
-    {
-      GSList *keylist1 = NULL;
-      GSList *keylist2 = NULL;
-      const char *curkeyname = NULL;
+  /* Most keys only exist once */
+  if (count1 == 1)
+    return !xmlStrcmp(xml_node_get_content(nodes1[0]), xml_node_get_content(nodes2[0]));
+
+  if (count2 > G_N_ELEMENTS(used_static))
+    used = g_malloc0(sizeof(gboolean) * count2);
+  else
+    memset(used_static, 0, sizeof(used_static));
 
-      if(key1 == NULL && key2 == NULL) {
+  for (i = 0; i < count1 && same; i++) {
+    xmlChar *content = xml_node_get_content(nodes1[i]);
+
+    for (j = 0; j < count2; j++) {
+      if (!used[j] && !xmlStrcmp(content, xml_node_get_content(nodes2[j])))
         break;
-      }
-			
-      if(key1 == NULL || key2 == NULL) {
-        same = FALSE;
-        break;	
-      }
-		
-      curkeyname = (const char *)key1->name;
-      do {
-        keylist1 = g_slist_prepend(keylist1, key1);
-        key1 = key1->next;
-        if(key1 == NULL)
-          break;
-        i = strcmp((const char *)key1->name, curkeyname);
-      } while(i == 0);
-		
-      do {
-        keylist2 = g_slist_prepend(keylist2, key2);
-        key2 = key2->next;
-        if(key2 == NULL)
-          break;
-        i = strcmp((const char *)key2->name, curkeyname);
-      } while(i == 0);	
-
-      do{
-        GSList *cur_list1 = NULL;
-        GSList *cur_list2 = NULL;
+    }
 
-        /* both lists must have the same length */
-        if(g_slist_length(keylist1) != g_slist_length(keylist2)) {
-          osync_trace(TRACE_INTERNAL, "It's not the same anymore...");
-          same = FALSE;
-          break;
-        }
+    if (j == count2)
+      same = FALSE;
+    else
+      used[j] = TRUE;
+  }
 
-        do {
-          cur_list1 = keylist1;
-          cur_list2 = keylist2;
+  if (used != used_static)
+    g_free(used);
 
-          do {
-            if(!xmlStrcmp(xml_node_get_content(cur_list1->data), xml_node_get_content(cur_list2->data)))
-              break;
-            cur_list2 = g_slist_next(cur_list2);
-            if(cur_list2 == NULL) {
-              same = FALSE;
-              break;
-            }
-          }while(1);
+  return same;
+}
 
-          if(same) {
-            keylist1 = g_slist_delete_link(keylist1, cur_list1);
-            keylist2 = g_slist_delete_link(keylist2, cur_list2);
-          }else
-            break;
+/**
+ * @brief Compares two xmlfield objects with each other by their cached key nodes
+ * @param keys1 The key cache of the first xmlfield
+ * @param keys2 The key cache of the second xmlfield
+ * @return TRUE if both xmlfield objects are the same otherwise FALSE
+ */
+static osync_bool xmlfield_keys_compare(XMLFieldKeys *keys1, XMLFieldKeys *keys2)
+{
+  unsigned int i1 = 0, i2 = 0;
+  int i, attrcount;
 
-        }while(keylist1 != NULL);
-      }while(0);
+  if (!XMLFORMAT_NAME_EQUAL(keys1->xmlfield->node->name, keys2->xmlfield->node->name))
+    return FALSE;
 
-      if(keylist1)
-        g_slist_free(keylist1);
-      if(keylist2)
-        g_slist_free(keylist2);
-    }
+  /* Compare the runs of equally named keys. The run of the second
+   * xmlfield always starts with its next key, whatever its name is. */
+  while (i1 < keys1->count || i2 < keys2->count) {
+    const xmlChar *curkeyname = NULL;
+    unsigned int start1 = i1, start2 = i2;
+
+    if (i1 == keys1->count || i2 == keys2->count)
+      return FALSE;
+
+    curkeyname = keys1->nodes[i1]->name;
+
+    for (i1++; i1 < keys1->count && XMLFORMAT_NAME_EQUAL(keys1->nodes[i1]->name, curkeyname); i1++)
+      ;
+    for (i2++; i2 < keys2->count && XMLFORMAT_NAME_EQUAL(keys2->nodes[i2]->name, curkeyname); i2++)
+      ;
+
+    if (!xml_nodes_same_contents(keys1->nodes + start1, i1 - start1, keys2->nodes + start2, i2 - start2))
+      return FALSE;
+  }
 
   /* now we check if the attributes are equal */
-  do {
-    int i1 = 0, i2 = 0;
-    if(!same)
-      break;
+  attrcount = osync_xmlfield_get_attr_count(keys1->xmlfield);
+  if (attrcount != osync_xmlfield_get_attr_count(keys2->xmlfield))
+    return FALSE;
 
-    i1 =osync_xmlfield_get_attr_count(xmlfield1);
-    i2 =osync_xmlfield_get_attr_count(xmlfield2);
+  for (i = 0; i < attrcount; i++) {
+    const char *attrvalue = osync_xmlfield_get_attr(keys2->xmlfield, osync_xmlfield_get_nth_attr_name(keys1->xmlfield, i));
+    if (attrvalue == NULL ||
+        strcmp(attrvalue, osync_xmlfield_get_nth_attr_value(keys1->xmlfield, i)))
+      return FALSE;
+  }
 
-    if(i1 != i2) {
-      same = FALSE;
-      break;
+  return TRUE;
+}
+
+/**
+ * @brief Compares two xmlfield objects with each other of similarity by their cached key nodes
+ * @param keys1 The key cache of the first xmlfield
+ * @param keys2 The key cache of the second xmlfield
+ * @param keys OSyncXMLPoints::keys
+ * @return TRUE if both xmlfield objects are the similar otherwise FALSE
+ */
+static osync_bool xmlfield_keys_compare_similar(XMLFieldKeys *keys1, XMLFieldKeys *keys2, char *keys[])
+{
+  xmlNodePtr *list1 = NULL;
+  xmlNodePtr *list2 = NULL;
+  unsigned int count1, count2, i, k;
+  osync_bool res = TRUE;
+
+  if (!XMLFORMAT_NAME_EQUAL(keys1->xmlfield->node->name, keys2->xmlfield->node->name))
+    res = FALSE;
+
+  if (!keys || !keys[0])
+    return res;
+
+  list1 = g_malloc(sizeof(xmlNodePtr) * (keys1->count + 1));
+  list2 = g_malloc(sizeof(xmlNodePtr) * (keys2->count + 1));
+
+  /* Every key has to match, a key missing on both sides matches */
+  for (k = 0; res && keys[k]; k++) {
+    count1 = count2 = 0;
+
+    for (i = 0; i < keys1->count; i++) {
+      if (!strcmp(keys[k], (const char *)keys1->nodes[i]->name))
+        list1[count1++] = keys1->nodes[i];
     }
 
-    for(i=0; i < i1; i++) {
-      const char *attrvalue = osync_xmlfield_get_attr(xmlfield2, osync_xmlfield_get_nth_attr_name(xmlfield1, i));
-      if( attrvalue == NULL ||
-          strcmp(attrvalue, osync_xmlfield_get_nth_attr_value(xmlfield1, i))) {
-        same = FALSE;
-        break;
-      }
+    for (i = 0; i < keys2->count; i++) {
+      if (!strcmp(keys[k], (const char *)keys2->nodes[i]->name))
+        list2[count2++] = keys2->nodes[i];
+    }
+
+    if (count1 || count2) {
+      if (!xml_nodes_same_contents(list1, count1, list2, count2))
+        res = FALSE;
     }
-  } while(0);
+  }
+
+  g_free(list1);
+  g_free(list2);
+
+  return res;
+}
+
+/**
+ * @brief Compares two xmlfield objects with each other
+ * @param xmlfield1 The pointer to a xmlformat object
+ * @param xmlfield2 The pointer to a xmlformat object
+ * @return TRUE if both xmlfield objects are the same otherwise FALSE
+ */
+osync_bool xmlfield_compare(OSyncXMLField *xmlfield1, OSyncXMLField *xmlfield2)
+{
+  XMLFieldKeys keys1, keys2;
+  osync_bool same;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, xmlfield1, xmlfield2);
+  osync_assert(xmlfield1);
+  osync_assert(xmlfield2);
+
+  xmlfield_keys_init(&keys1, xmlfield1);
+  xmlfield_keys_init(&keys2, xmlfield2);
+
+  same = xmlfield_keys_compare(&keys1, &keys2);
+
+  xmlfield_keys_clear(&keys1);
+  xmlfield_keys_clear(&keys2);
+
   osync_trace(TRACE_EXIT, "%s: %i", __func__, same);
   return same;
 }
@@ -236,80 +351,61 @@ osync_bool xmlfield_compare(OSyncXMLField *xmlfield1, OSyncXMLField *xmlfield2)
  */
 osync_bool xmlfield_compare_similar(OSyncXMLField *xmlfield1, OSyncXMLField *xmlfield2, char* keys[])
 {
-  osync_bool res = TRUE;
-  xmlNodePtr node1, node2;
-  int i;
+  XMLFieldKeys keys1, keys2;
+  osync_bool res;
+
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, xmlfield1, xmlfield2, keys);
   osync_assert(xmlfield1);
   osync_assert(xmlfield2);
 
-  if(strcmp((const char *) osync_xmlfield_get_name(xmlfield1), (const char *) osync_xmlfield_get_name(xmlfield2)) != 0)
-    res = FALSE;
-
-  node1 = xmlfield1->node->children;
-  node2 = xmlfield2->node->children;
-
-  for(i=0; keys[i]; i++) {
-    GSList *list1;
-    GSList *list2;
-    GSList *cur_list1;
-    GSList *cur_list2;
+  xmlfield_keys_init(&keys1, xmlfield1);
+  xmlfield_keys_init(&keys2, xmlfield2);
 
-    list1 = NULL;
-    list2 = NULL;
+  res = xmlfield_keys_compare_similar(&keys1, &keys2, keys);
 
-    while(node1 != NULL) {
-      if(strcmp(keys[i], (const char *)node1->name) == 0)
-        list1 = g_slist_prepend(list1, node1);
-      node1 = node1->next;
-    };
+  xmlfield_keys_clear(&keys1);
+  xmlfield_keys_clear(&keys2);
 
-    while(node2 != NULL) {
-      if(strcmp(keys[i], (const char *)node2->name) == 0)
-        list2 = g_slist_prepend(list2, node2);
-      node2 = node2->next;
-    };
+  osync_trace(TRACE_EXIT, "%s: %i", __func__, res);
+  return res;
+}
 
-    while(list1 != NULL)
-      {
-        cur_list1 = list1;
-        cur_list2 = list2;
+/**
+ * @brief Collects the run of xmlfields with the same name
+ * @param xmlfield The first xmlfield of the run, gets set to the first xmlfield after the run
+ * @param count Gets set to the length of the run
+ * @return Array of key caches of the xmlfields of the run, in reverse order
+ */
+static XMLFieldKeys *xmlformat_collect_run(OSyncXMLField **xmlfield, unsigned int *count)
+{
+  const xmlChar *curfieldname = (*xmlfield)->node->name;
+  OSyncXMLField *cur = NULL;
+  XMLFieldKeys *run = NULL;
+  unsigned int i = 0;
+
+  *count = 0;
+  for (cur = *xmlfield; cur && XMLFORMAT_NAME_EQUAL(cur->node->name, curfieldname); cur = osync_xmlfield_get_next(cur))
+    (*count)++;
+
+  /* Last xmlfield first, the order the fields always got matched in */
+  run = g_malloc(sizeof(XMLFieldKeys) * (*count));
+  for (cur = *xmlfield; i < *count; cur = osync_xmlfield_get_next(cur))
+    xmlfield_keys_init(&run[*count - ++i], cur);
+
+  *xmlfield = cur;
+  return run;
+}
 
-        if(cur_list2 == NULL) {
-          res = FALSE;
-          break;
-        }
+static void xmlformat_free_run(XMLFieldKeys *run, unsigned int count)
+{
+  unsigned int i;
 
-        while(xmlStrcmp(xml_node_get_content((xmlNodePtr)cur_list1->data),
-                        xml_node_get_content((xmlNodePtr)cur_list2->data))) {
-          cur_list2 = g_slist_next(cur_list2);
-          if(cur_list2 == NULL) {
-            res = FALSE;
-            break;
-          }
-        }
+  for (i = 0; i < count; i++)
+    xmlfield_keys_clear(&run[i]);
 
-        if(res) {
-          list1 = g_slist_delete_link(list1, cur_list1);
-          list2 = g_slist_delete_link(list2, cur_list2);
-        }else
-          break;
-      }
-    if(list2 != NULL)
-      res = FALSE;
-
-    if(!res) {
-      if(list1 != NULL)
-        g_slist_free(list1);
-      if(list2 != NULL)
-        g_slist_free(list2);
-    }
-  }
-  osync_trace(TRACE_EXIT, "%s: %i", __func__, res);
-  return res;
+  g_free(run);
 }
 
-
 /**
  * @brief Compares two xmlformat objects with each other
  * @param xmlformat1 The pointer to a xmlformat object
@@ -321,203 +417,177 @@ osync_bool xmlfield_compare_similar(OSyncXMLField *xmlfield1, OSyncXMLField *xml
  */
 OSyncConvCmpResult xmlformat_compare(OSyncXMLFormat *xmlformat1, OSyncXMLFormat *xmlformat2, OSyncXMLPoints points[], int basic_points, int threshold)
 {
-  int res, collected_points, cur_pos;
+  OSyncXMLPointsTable *table = xmlformat_points_table_new(points);
+  OSyncConvCmpResult ret;
+
+  ret = xmlformat_compare_table(xmlformat1, xmlformat2, table, basic_points, threshold);
+
+  xmlformat_points_table_free(table);
+  return ret;
+}
+
+/**
+ * @brief Compares two xmlformat objects with each other
+ * @param xmlformat1 The pointer to a xmlformat object
+ * @param xmlformat2 The pointer to a xmlformat object
+ * @param table The compiled points table, see xmlformat_points_table_new()
+ * @param basic_points Points which should be used if a xmlfield name is not found in the points table
+ * @param threshold If the two xmlformats are not the same, then this value will decide if the two xmlformats are similar 
+ * @return One of the values of the OSyncConvCmpResult enumeration
+ */
+OSyncConvCmpResult xmlformat_compare_table(OSyncXMLFormat *xmlformat1, OSyncXMLFormat *xmlformat2, OSyncXMLPointsTable *table, int basic_points, int threshold)
+{
+  int res, collected_points;
   OSyncXMLField *xmlfield1 = NULL;
   OSyncXMLField *xmlfield2 = NULL;
   osync_bool same = TRUE;
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %i, %i)", __func__, xmlformat1, xmlformat2, points, basic_points, threshold);
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %i, %i)", __func__, xmlformat1, xmlformat2, table, basic_points, threshold);
 
   xmlfield1 = osync_xmlformat_get_first_field(xmlformat1);
   xmlfield2 = osync_xmlformat_get_first_field(xmlformat2);
 
-  cur_pos = 0;
   collected_points = 0;
 
   while(xmlfield1 != NULL || xmlfield2 != NULL)
     {
+      OSyncXMLPoints *entry = NULL;
+      XMLFieldKeys *run1 = NULL;
+      XMLFieldKeys *run2 = NULL;
+      unsigned int count1, count2, i, j;
+      osync_bool *matched1 = NULL;
+      osync_bool *matched2 = NULL;
+      const char *curfieldname = NULL;
+      int p;
 
       /* subtract points for xmlfield2*/
       if(xmlfield1 == NULL) {
-        collected_points -= xmlformat_subtract_points(xmlfield2, points, &cur_pos, basic_points, &same);
+        collected_points -= xmlformat_subtract_points(xmlfield2, table, basic_points, &same);
         xmlfield2 = osync_xmlfield_get_next(xmlfield2);
         continue;
       }
 
       /* subtract points for xmlfield1*/
       if(xmlfield2 == NULL) {
-        collected_points -= xmlformat_subtract_points(xmlfield1, points, &cur_pos, basic_points, &same);
+        collected_points -= xmlformat_subtract_points(xmlfield1, table, basic_points, &same);
         xmlfield1 = osync_xmlfield_get_next(xmlfield1);
         continue;
       }
 
-      res = strcmp(osync_xmlfield_get_name(xmlfield1), osync_xmlfield_get_name(xmlfield2));
+      if (xmlfield1->node->name == xmlfield2->node->name)
+        res = 0;
+      else
+        res = strcmp(osync_xmlfield_get_name(xmlfield1), osync_xmlfield_get_name(xmlfield2));
       osync_trace(TRACE_INTERNAL, "result of strcmp(): %i (%s || %s)", res, osync_xmlfield_get_name(xmlfield1), osync_xmlfield_get_name(xmlfield2));
 
       /* subtract points for xmlfield1*/
       if(res < 0) {
-        collected_points -= xmlformat_subtract_points(xmlfield1, points, &cur_pos, basic_points, &same);
+        collected_points -= xmlformat_subtract_points(xmlfield1, table, basic_points, &same);
         xmlfield1 = osync_xmlfield_get_next(xmlfield1);
         continue;
       }
 
       /* subtract points for xmlfield2*/
       if(res > 0) {
-        collected_points -= xmlformat_subtract_points(xmlfield2, points, &cur_pos, basic_points, &same);
+        collected_points -= xmlformat_subtract_points(xmlfield2, table, basic_points, &same);
         xmlfield2 = osync_xmlfield_get_next(xmlfield2);
         continue;
       }
 
       /* make lists and compare */
-      if(res == 0)
-        {
-          GSList *fieldlist1 = NULL;
-          GSList *fieldlist2 = NULL;
+      curfieldname = osync_xmlfield_get_name(xmlfield1);
 
-          const char *curfieldname = osync_xmlfield_get_name(xmlfield1);
+      /* get the points*/
+      entry = xmlformat_points_table_lookup(table, curfieldname);
+      p = entry ? entry->points : basic_points;
 
-          /* get the points*/
-          int p = xmlformat_get_points(points, &cur_pos, basic_points, curfieldname);
+      /* don't compare both fields if they should be ignore to avoid influence of the compare result */
+      if (p == -1) {
+        xmlfield1 = osync_xmlfield_get_next(xmlfield1);
+        xmlfield2 = osync_xmlfield_get_next(xmlfield2);
+        continue;
+      }
 
-          /* don't compare both fields if they should be ignore to avoid influence of the compare result */
-          if (p == -1) {
-            xmlfield1 = osync_xmlfield_get_next(xmlfield1);
-            xmlfield2 = osync_xmlfield_get_next(xmlfield2);
-            continue;
-          }
+      /* The key nodes of every field get collected once and are reused
+       * for all the pairwise compares of the run */
+      run1 = xmlformat_collect_run(&xmlfield1, &count1);
+      run2 = xmlformat_collect_run(&xmlfield2, &count2);
+      matched1 = g_malloc0(sizeof(osync_bool) * count1);
+      matched2 = g_malloc0(sizeof(osync_bool) * count2);
+
+      /* if same then compare and give points*/
+      if (same) {
+        /* both lists must have the same length */
+        if (count1 != count2) {
+          same = FALSE;
+          osync_trace(TRACE_INTERNAL, "both list don't have the same length");
+        }
 
-          do {
-            fieldlist1 = g_slist_prepend(fieldlist1, xmlfield1);
-            xmlfield1 = osync_xmlfield_get_next(xmlfield1);
-            if(xmlfield1 == NULL)
+        for (i = 0; same && i < count1; i++) {
+          for (j = 0; j < count2; j++) {
+            if (!matched2[j] && xmlfield_keys_compare(&run1[i], &run2[j]))
               break;
-            res = strcmp(osync_xmlfield_get_name(xmlfield1), curfieldname);
-          } while(res == 0);
+          }
+
+          if (j == count2) {
+            same = FALSE;
+            osync_trace(TRACE_INTERNAL, "one field is alone: %s", curfieldname);
+            break;
+          }
+
+          /* add the points */
+          osync_trace(TRACE_INTERNAL, "add %i point(s) for same fields: %s", p, curfieldname);
+          collected_points += p;
+          matched1[i] = TRUE;
+          matched2[j] = TRUE;
+        }
+      }
+
+      /* if similar then compare and give points*/
+      /* if no points to add or to subtract we need no compair of similarity */
+      if (!same && p) {
+        char **keys = entry ? entry->keys : NULL;
+        int subtracted_count = 0;
+
+        for (i = 0; i < count1; i++) {
+          if (matched1[i])
+            continue;
 
-          do {
-            fieldlist2 = g_slist_prepend(fieldlist2, xmlfield2);
-            xmlfield2 = osync_xmlfield_get_next(xmlfield2);
-            if(xmlfield2 == NULL)
+          for (j = 0; j < count2; j++) {
+            if (!matched2[j] && xmlfield_keys_compare_similar(&run1[i], &run2[j], keys))
               break;
-            res = strcmp(osync_xmlfield_get_name(xmlfield2), curfieldname);
-          } while(res == 0);
-
-          do {
-
-            /* if same then compare and give points*/
-            do {
-              GSList *cur_list1;
-              GSList *cur_list2;
-
-              if(!same)
-                break;
-
-              /* both lists must have the same length */
-              if(g_slist_length(fieldlist1) != g_slist_length(fieldlist2)) {
-                same = FALSE;
-                osync_trace(TRACE_INTERNAL, "both list don't have the same length");
-                break;
-              }
-
-              do {
-                cur_list1 = fieldlist1;
-                cur_list2 = fieldlist2;
-
-                do {
-                  if(xmlfield_compare((OSyncXMLField *)cur_list1->data, (OSyncXMLField *)cur_list2->data) == TRUE)
-                    break;
-                  cur_list2 = g_slist_next(cur_list2);
-                  if(cur_list2 == NULL) {
-                    same = FALSE;
-                    osync_trace(TRACE_INTERNAL, "one field is alone: %s", osync_xmlfield_get_name(cur_list1->data));
-                    break;
-                  }
-                }while(1);
-
-                if(same) {
-                  /* add the points */
-                  osync_trace(TRACE_INTERNAL, "add %i point(s) for same fields: %s", p, curfieldname);
-                  collected_points += p;
-                  fieldlist1 = g_slist_delete_link(fieldlist1, cur_list1);
-                  fieldlist2 = g_slist_delete_link(fieldlist2, cur_list2);
-                }else
-                  break;
-
-              }while(fieldlist1 != NULL);
-            } while(0);
-
-            /* if similar then compare and give points*/
-            do {
-              GSList *cur_list1;
-              GSList *cur_list2;
-              osync_bool found;
-              int subtracted_count;
-
-              if(same)
-                break;
-              /* if no points to add or to subtract we need no compair of similarity */
-              if(!p) {
-                g_slist_free(fieldlist1);
-                g_slist_free(fieldlist2);
-                fieldlist1 = NULL;
-                fieldlist2 = NULL;
-                break;
-              }
-
-              subtracted_count = 0;
-              do {
-                found = FALSE;
-                cur_list1 = fieldlist1;
-                cur_list2 = fieldlist2;
-
-                while(cur_list2) {
-
-                  if(xmlfield_compare_similar((OSyncXMLField *)cur_list1->data,
-                                                (OSyncXMLField *)cur_list2->data,
-                                                points[cur_pos].keys) == TRUE) {
-                    found = TRUE;
-                    break;
-                  }
-
-                  cur_list2 = g_slist_next(cur_list2);
-                }
-
-                /* add or subtract the points */
-                if(found) {
-                  /* add the points */
-                  osync_trace(TRACE_INTERNAL, "add %i point(s) for similiar field: %s", p, curfieldname);
-                  collected_points += p;
-                  fieldlist1 = g_slist_delete_link(fieldlist1, cur_list1);
-                  fieldlist2 = g_slist_delete_link(fieldlist2, cur_list2);
-                }else{
-                  /* subtract the points */
-                  osync_trace(TRACE_INTERNAL, "subtracting %i point(s) for missing field: %s", p, curfieldname);
-                  collected_points -= p;
-                  subtracted_count++;
-                  fieldlist1 = g_slist_delete_link(fieldlist1, cur_list1);
-                }
-              }while(fieldlist1 != NULL);
-
-              /* subtract the points for the remaining elements in the list2 */
-              while(fieldlist2) {
-                /* subtract the points */
-                if(subtracted_count > 0) {
-                  subtracted_count--;
-                } else {
-                  osync_trace(TRACE_INTERNAL, "subtracting %i point(s) for remaining field: %s", p, curfieldname);
-                  collected_points -= p;
-                }
-                fieldlist2 = g_slist_delete_link(fieldlist2, fieldlist2);
-              }
-
-            }while(0);
-
-          }while(0);
-
-          /* the lists should not exist */
-          g_assert(!fieldlist1);
-          g_assert(!fieldlist2);
+          }
+
+          /* add or subtract the points */
+          if (j < count2) {
+            osync_trace(TRACE_INTERNAL, "add %i point(s) for similiar field: %s", p, curfieldname);
+            collected_points += p;
+            matched2[j] = TRUE;
+          } else {
+            osync_trace(TRACE_INTERNAL, "subtracting %i point(s) for missing field: %s", p, curfieldname);
+            collected_points -= p;
+            subtracted_count++;
+          }
         }
+
+        /* subtract the points for the remaining elements in the list2 */
+        for (j = 0; j < count2; j++) {
+          if (matched2[j])
+            continue;
+
+          if (subtracted_count > 0) {
+            subtracted_count--;
+          } else {
+            osync_trace(TRACE_INTERNAL, "subtracting %i point(s) for remaining field: %s", p, curfieldname);
+            collected_points -= p;
+          }
+        }
+      }
+
+      g_free(matched1);
+      g_free(matched2);
+      xmlformat_free_run(run1, count1);
+      xmlformat_free_run(run2, count2);
     };
 
   osync_trace(TRACE_INTERNAL, "Result is: %i, Treshold is: %i", collected_points, threshold);
@@ -532,4 +602,3 @@ OSyncConvCmpResult xmlformat_compare(OSyncXMLFormat *xmlformat1, OSyncXMLFormat
   osync_trace(TRACE_EXIT, "%s: MISMATCH", __func__);
   return OSYNC_CONV_DATA_MISMATCH;
 }
-
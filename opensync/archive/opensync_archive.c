@@ -31,6 +31,12 @@
 #include "opensync_archive_internals.h"
 #include "opensync-db.h"
 
+#include <libxml/parser.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 static osync_bool osync_archive_create_changes(OSyncDB *db, const char *objtype, OSyncError **error)
 {
   int ret = 0;
@@ -140,6 +146,273 @@ static osync_bool osync_archive_create(OSyncDB *db, const char *objtype, OSyncEr
   return FALSE;
 }
 
+static void _osync_archive_free_dictionary(GByteArray *dictionary)
+{
+  g_byte_array_free(dictionary, TRUE);
+}
+
+#if !GLIB_CHECK_VERSION(2,12,0)
+/*! \brief g_hash_table_foreach_remove foreach function
+ */
+static gboolean remove_entry(gpointer key, gpointer val, gpointer data)
+{
+  return TRUE;
+}
+#endif
+
+static void _osync_archive_clear_dictionaries(OSyncArchive *archive)
+{
+#if GLIB_CHECK_VERSION(2,12,0)
+  g_hash_table_remove_all(archive->dictionaries);
+#else
+  g_hash_table_foreach_remove(archive->dictionaries, remove_entry, NULL);
+#endif
+}
+
+static osync_bool osync_archive_create_dictionaries(OSyncDB *db, OSyncError **error)
+{
+  int ret = osync_db_table_exists(db, "tbl_archive_dict", error);
+  if (ret < 0)
+    return FALSE;
+  else if (ret)
+    return TRUE;
+
+  return osync_db_query(db, "CREATE TABLE tbl_archive_dict (objtype VARCHAR(64) PRIMARY KEY, data BLOB)", error);
+}
+
+/* Returns the cached compression dictionary of the objtype, empty if there is none */
+static GByteArray *_osync_archive_get_dictionary(OSyncArchive *archive, const char *objtype, OSyncError **error)
+{
+  GByteArray *dictionary = NULL;
+  char *escaped_objtype = NULL;
+  char *query = NULL;
+  char *data = NULL;
+  unsigned int size = 0;
+  int ret;
+
+  dictionary = g_hash_table_lookup(archive->dictionaries, objtype);
+  if (dictionary)
+    return dictionary;
+
+  if (!osync_archive_create_dictionaries(archive->db, error))
+    return NULL;
+
+  escaped_objtype = osync_db_sql_escape(objtype);
+  query = g_strdup_printf("SELECT data FROM tbl_archive_dict WHERE objtype='%s'", escaped_objtype);
+  g_free(escaped_objtype);
+
+  ret = osync_db_get_blob(archive->db, query, &data, &size, error);
+  g_free(query);
+  if (ret < 0)
+    return NULL;
+
+  dictionary = g_byte_array_new();
+  if (ret > 0) {
+    g_byte_array_append(dictionary, (guint8 *) data, size);
+    g_free(data);
+  }
+
+  g_hash_table_insert(archive->dictionaries, g_strdup(objtype), dictionary);
+  return dictionary;
+}
+
+/*! @brief Encodes data in the compact archive encoding
+ *
+ * @param archive The group archive
+ * @param objtype The objtype of the data, selects the dictionary
+ * @param dictionary The dictionary to use instead of the stored one of objtype or NULL
+ * @param data The data
+ * @param size The size of data
+ * @param output Pointer to store the encoded data, free with g_free()
+ * @param outsize Pointer to store the size of the encoded data
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+static osync_bool _osync_archive_encode(OSyncArchive *archive, const char *objtype, GByteArray *dictionary, const char *data, unsigned int size, char **output, unsigned int *outsize, OSyncError **error)
+{
+  OSyncArchiveMethod method = OSYNC_ARCHIVE_METHOD_STORED;
+  unsigned int payload_size = size;
+  unsigned int buffer_size = size;
+  unsigned char *buffer = NULL;
+
+#ifdef HAVE_ZLIB
+  z_stream stream;
+
+  if (!archive->compress || size < OSYNC_ARCHIVE_COMPRESS_MIN_SIZE)
+    dictionary = NULL;
+  else if (!dictionary && !(dictionary = _osync_archive_get_dictionary(archive, objtype, error)))
+    return FALSE;
+
+  if (dictionary)
+    buffer_size = compressBound(size);
+#endif
+
+  buffer = osync_try_malloc0(OSYNC_ARCHIVE_HEADER_SIZE + buffer_size, error);
+  if (!buffer)
+    return FALSE;
+
+#ifdef HAVE_ZLIB
+  if (dictionary) {
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, Z_BEST_COMPRESSION) != Z_OK) {
+      osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to initialize compression: %s", __NULLSTR(stream.msg));
+      g_free(buffer);
+      return FALSE;
+    }
+
+    if (dictionary->len)
+      deflateSetDictionary(&stream, dictionary->data, dictionary->len);
+
+    stream.next_in = (Bytef *) data;
+    stream.avail_in = size;
+    stream.next_out = buffer + OSYNC_ARCHIVE_HEADER_SIZE;
+    stream.avail_out = buffer_size;
+
+    /* Incompressible data gets stored as is */
+    if (deflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out < size) {
+      method = dictionary->len ? OSYNC_ARCHIVE_METHOD_DEFLATE_DICT : OSYNC_ARCHIVE_METHOD_DEFLATE;
+      payload_size = stream.total_out;
+    }
+
+    deflateEnd(&stream);
+  }
+#endif
+
+  if (method == OSYNC_ARCHIVE_METHOD_STORED)
+    memcpy(buffer + OSYNC_ARCHIVE_HEADER_SIZE, data, size);
+
+  memcpy(buffer, OSYNC_ARCHIVE_MAGIC, OSYNC_ARCHIVE_MAGIC_SIZE);
+  buffer[4] = OSYNC_ARCHIVE_VERSION;
+  buffer[5] = method;
+  buffer[6] = (size >> 24) & 0xff;
+  buffer[7] = (size >> 16) & 0xff;
+  buffer[8] = (size >> 8) & 0xff;
+  buffer[9] = size & 0xff;
+
+  *output = (char *) buffer;
+  *outsize = OSYNC_ARCHIVE_HEADER_SIZE + payload_size;
+  return TRUE;
+}
+
+/*! @brief Decodes stored data in place
+ *
+ * Data without the magic got written by an older version and is
+ * returned as is.
+ *
+ * @param archive The group archive
+ * @param objtype The objtype of the data, selects the dictionary
+ * @param data Pointer to the stored data, gets replaced with the decoded data
+ * @param size Pointer to the size of data
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+static osync_bool _osync_archive_decode(OSyncArchive *archive, const char *objtype, char **data, unsigned int *size, OSyncError **error)
+{
+  const unsigned char *header = (const unsigned char *) *data;
+  unsigned int decoded_size;
+  char *decoded = NULL;
+
+  if (*size < OSYNC_ARCHIVE_HEADER_SIZE || memcmp(header, OSYNC_ARCHIVE_MAGIC, OSYNC_ARCHIVE_MAGIC_SIZE))
+    return TRUE;
+
+  if (header[4] != OSYNC_ARCHIVE_VERSION) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Archive entry got stored with the unsupported encoding version %i", header[4]);
+    return FALSE;
+  }
+
+  decoded_size = (header[6] << 24) | (header[7] << 16) | (header[8] << 8) | header[9];
+
+  /* One more byte, to be able to handle the data as string */
+  decoded = osync_try_malloc0(decoded_size + 1, error);
+  if (!decoded)
+    return FALSE;
+
+  switch (header[5]) {
+  case OSYNC_ARCHIVE_METHOD_STORED:
+    if (*size - OSYNC_ARCHIVE_HEADER_SIZE != decoded_size)
+      goto error_corrupt;
+    memcpy(decoded, *data + OSYNC_ARCHIVE_HEADER_SIZE, decoded_size);
+    break;
+#ifdef HAVE_ZLIB
+  case OSYNC_ARCHIVE_METHOD_DEFLATE:
+  case OSYNC_ARCHIVE_METHOD_DEFLATE_DICT:
+    {
+      GByteArray *dictionary = NULL;
+      z_stream stream;
+      int ret;
+
+      memset(&stream, 0, sizeof(stream));
+      if (inflateInit(&stream) != Z_OK)
+        goto error_corrupt;
+
+      stream.next_in = (Bytef *) *data + OSYNC_ARCHIVE_HEADER_SIZE;
+      stream.avail_in = *size - OSYNC_ARCHIVE_HEADER_SIZE;
+      stream.next_out = (Bytef *) decoded;
+      stream.avail_out = decoded_size;
+
+      ret = inflate(&stream, Z_FINISH);
+      if (ret == Z_NEED_DICT) {
+        dictionary = _osync_archive_get_dictionary(archive, objtype, error);
+        if (!dictionary) {
+          inflateEnd(&stream);
+          g_free(decoded);
+          return FALSE;
+        }
+
+        /* Fails if the dictionary got replaced meanwhile */
+        if (inflateSetDictionary(&stream, dictionary->data, dictionary->len) == Z_OK)
+          ret = inflate(&stream, Z_FINISH);
+      }
+
+      inflateEnd(&stream);
+      if (ret != Z_STREAM_END || stream.total_out != decoded_size)
+        goto error_corrupt;
+    }
+    break;
+#endif
+  default:
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Archive entry got stored with the unsupported method %i", header[5]);
+    g_free(decoded);
+    return FALSE;
+  }
+
+  g_free(*data);
+  *data = decoded;
+  *size = decoded_size;
+  return TRUE;
+
+ error_corrupt:
+  osync_error_set(error, OSYNC_ERROR_GENERIC, "Archive entry of objtype %s is corrupt", objtype);
+  g_free(decoded);
+  return FALSE;
+}
+
+/*! @brief Removes the indentation of XML written by older versions */
+static void _osync_archive_compact_xml(char **data, unsigned int *size)
+{
+  xmlChar *compact = NULL;
+  xmlDocPtr doc = NULL;
+  int compact_size = 0;
+
+  if (*size < 5 || strncmp(*data, "<?xml", 5))
+    return;
+
+  doc = xmlReadMemory(*data, *size, NULL, NULL, XML_PARSE_NOBLANKS);
+  if (!doc)
+    return;
+
+  xmlDocDumpFormatMemoryEnc(doc, &compact, &compact_size, NULL, 0);
+  xmlFreeDoc(doc);
+
+  if (compact && compact_size > 0) {
+    g_free(*data);
+    *data = g_memdup(compact, compact_size);
+    *size = compact_size;
+  }
+
+  xmlFree(compact);
+}
+
 OSyncArchive *osync_archive_new(const char *filename, OSyncError **error)
 {
   OSyncArchive *archive = NULL;
@@ -151,6 +424,10 @@ OSyncArchive *osync_archive_new(const char *filename, OSyncError **error)
     goto error;
 
   archive->ref_count = 1;
+#ifdef HAVE_ZLIB
+  archive->compress = TRUE;
+#endif
+  archive->dictionaries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _osync_archive_free_dictionary);
 	
   archive->db = osync_db_new(error);
   if (!archive->db)
@@ -165,6 +442,7 @@ OSyncArchive *osync_archive_new(const char *filename, OSyncError **error)
   return archive;
 
  error_and_free:	
+  g_hash_table_destroy(archive->dictionaries);
   g_free(archive);
 
  error:
@@ -193,6 +471,7 @@ void osync_archive_unref(OSyncArchive *archive)
         osync_trace(TRACE_INTERNAL, "Can't close database");
     }
 		
+    g_hash_table_destroy(archive->dictionaries);
     g_free(archive->db);
     g_free(archive);
 
@@ -204,6 +483,8 @@ osync_bool osync_archive_save_data(OSyncArchive *archive, long long int id, cons
 {
   char *query = NULL;
   char *escaped_objtype = NULL;
+  char *encoded = NULL;
+  unsigned int encoded_size = 0;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %lli, %s, %p, %u, %p)", __func__, archive, id, objtype, data, size, error);
   osync_assert(archive);
@@ -213,17 +494,22 @@ osync_bool osync_archive_save_data(OSyncArchive *archive, long long int id, cons
   if (!osync_archive_create(archive->db, objtype, error))
     goto error;
 
+  if (!_osync_archive_encode(archive, objtype, NULL, data, size, &encoded, &encoded_size, error))
+    goto error;
+
   // FIXME: Avoid subselect - this query needs up to 0.5s
   escaped_objtype = osync_db_sql_escape(objtype);
   query = g_strdup_printf("REPLACE INTO tbl_archive (objtype, mappingid, data) VALUES('%s', %lli, ?)", escaped_objtype, id);
   g_free(escaped_objtype);
   escaped_objtype = NULL;
 	
-  if (!osync_db_bind_blob(archive->db, query, data, size, error)) {
+  if (!osync_db_queue_blob(archive->db, query, encoded, encoded_size, error)) {
+    g_free(encoded);
     g_free(query);
     goto error;
   }
 
+  g_free(encoded);
   g_free(query);
 
   osync_trace(TRACE_EXIT, "%s", __func__);
@@ -269,6 +555,12 @@ int osync_archive_load_data(OSyncArchive *archive, const char *uid, const char *
     return 0;
   }
 
+  if (!_osync_archive_decode(archive, objtype, data, size, error)) {
+    g_free(*data);
+    *data = NULL;
+    goto error;
+  }
+
   osync_trace(TRACE_EXIT, "%s", __func__);
   return 1;
 	
@@ -277,8 +569,31 @@ int osync_archive_load_data(OSyncArchive *archive, const char *uid, const char *
   return -1;
 }
 
+static long long int _osync_archive_next_change_rowid(OSyncArchive *archive, OSyncError **error)
+{
+  OSyncDBCursor *cursor = NULL;
+  int ret = 0;
+
+  if (!archive->change_rowid) {
+    cursor = osync_db_cursor_new(archive->db, "SELECT MAX(ROWID) FROM tbl_changes", error);
+    if (!cursor)
+      return 0;
+
+    ret = osync_db_cursor_next(cursor, error);
+    if (ret == 1)
+      archive->change_rowid = osync_db_cursor_get_int64(cursor, 0);
+    osync_db_cursor_free(cursor);
+
+    if (ret < 0)
+      return 0;
+  }
+
+  return ++archive->change_rowid;
+}
+
 long long int osync_archive_save_change(OSyncArchive *archive, long long int id, const char *uid, const char *objtype, long long int mappingid, long long int memberid, OSyncError **error)
 {
+  long long int rowid = 0;
   char *query = NULL;
   char *escaped_uid = NULL;
   char *escaped_objtype = NULL;
@@ -295,7 +610,15 @@ long long int osync_archive_save_change(OSyncArchive *archive, long long int id,
   escaped_objtype = osync_db_sql_escape(objtype);
 
   if (!id) {
-    query = g_strdup_printf("INSERT INTO tbl_changes (objtype, uid, mappingid, memberid) VALUES('%s', '%s', '%lli', '%lli')", escaped_objtype, escaped_uid, mappingid, memberid);
+    /* The insert might get queued, so the ROWID can't be taken from SQLite */
+    rowid = _osync_archive_next_change_rowid(archive, error);
+    if (!rowid) {
+      g_free(escaped_objtype);
+      g_free(escaped_uid);
+      goto error;
+    }
+
+    query = g_strdup_printf("INSERT INTO tbl_changes (ROWID, objtype, uid, mappingid, memberid) VALUES('%lli', '%s', '%s', '%lli', '%lli')", rowid, escaped_objtype, escaped_uid, mappingid, memberid);
   } else {
     query = g_strdup_printf("UPDATE tbl_changes SET uid='%s', mappingid='%lli', memberid='%lli' WHERE objtype='%s' AND id=%lli", escaped_uid, mappingid, memberid, escaped_objtype, id);
   }
@@ -304,7 +627,7 @@ long long int osync_archive_save_change(OSyncArchive *archive, long long int id,
   escaped_objtype = NULL;
   escaped_uid = NULL;
 	
-  if (!osync_db_query(archive->db, query, error)) {
+  if (!osync_db_queue(archive->db, query, error)) {
     g_free(query);
     goto error;
   }
@@ -312,7 +635,7 @@ long long int osync_archive_save_change(OSyncArchive *archive, long long int id,
   g_free(query);
 	
   if (!id)
-    id = osync_db_last_rowid(archive->db);
+    id = rowid;
 	
   osync_trace(TRACE_EXIT, "%s: %lli", __func__, id);
   return id;
@@ -337,7 +660,7 @@ osync_bool osync_archive_delete_change(OSyncArchive *archive, long long int id,
   query = g_strdup_printf("DELETE FROM tbl_changes WHERE objtype='%s' AND id=%lli", escaped_objtype, id);
   g_free(escaped_objtype);
   escaped_objtype = NULL;
-  if (!osync_db_query(archive->db, query, error)) {
+  if (!osync_db_queue(archive->db, query, error)) {
     g_free(query);
     goto error;
   }
@@ -352,22 +675,20 @@ osync_bool osync_archive_delete_change(OSyncArchive *archive, long long int id,
   return FALSE;
 }
 
-osync_bool osync_archive_load_changes(OSyncArchive *archive, const char *objtype, OSyncList **ids, OSyncList **uids, OSyncList **mappingids, OSyncList **memberids, OSyncError **error)
+osync_bool osync_archive_foreach_change(OSyncArchive *archive, const char *objtype, OSyncArchiveChangeFn func, void *userdata, OSyncError **error)
 {
   char *query = NULL;
   char *escaped_objtype = NULL;
-  OSyncList *result = NULL, *row = NULL, *column = NULL;
+  OSyncDBCursor *cursor = NULL;
   long long int id = 0, mappingid = 0, memberid = 0;
   const char *uid = NULL;
+  int ret = 0;
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, %p, %p, %p, %p)", __func__, archive, objtype, ids, uids, mappingids, memberids, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, %p, %p)", __func__, archive, objtype, func, userdata, error);
 
   osync_assert(archive);
   osync_assert(objtype);
-  osync_assert(ids);
-  osync_assert(uids);
-  osync_assert(mappingids);
-  osync_assert(memberids);
+  osync_assert(func);
 
   if (!osync_archive_create_changes(archive->db, objtype, error))
     goto error;
@@ -376,31 +697,92 @@ osync_bool osync_archive_load_changes(OSyncArchive *archive, const char *objtype
   query = g_strdup_printf("SELECT id, uid, mappingid, memberid FROM tbl_changes WHERE objtype='%s' ORDER BY mappingid", escaped_objtype);
   g_free(escaped_objtype);
   escaped_objtype = NULL;
-  result = osync_db_query_table(archive->db, query, error);
+  cursor = osync_db_cursor_new(archive->db, query, error);
 
   g_free(query);
-	
-  /* Check for error of osync_db_query_table() call. */
-  if (osync_error_is_set(error))
+
+  if (!cursor)
     goto error;
 
-  for (row = result; row; row = row->next) { 
-    column = row->data;
+  while ((ret = osync_db_cursor_next(cursor, error)) > 0) {
+    id = osync_db_cursor_get_int64(cursor, 0);
+    uid = osync_db_cursor_get_string(cursor, 1);
+    mappingid = osync_db_cursor_get_int64(cursor, 2);
+    memberid = osync_db_cursor_get_int64(cursor, 3);
+
+    if (!func(id, uid, mappingid, memberid, userdata, error))
+      goto error_free_cursor;
 
-    id = g_ascii_strtoull(osync_list_nth_data(column, 0), NULL, 0);
-    uid = osync_list_nth_data(column, 1); 
-    mappingid = g_ascii_strtoull(osync_list_nth_data(column, 2), NULL, 0);
-    memberid = g_ascii_strtoull(osync_list_nth_data(column, 3), NULL, 0);
-		
-    *ids = osync_list_append((*ids), GINT_TO_POINTER((int)id));
-    *uids = osync_list_append((*uids), g_strdup(uid));
-    *mappingids = osync_list_append((*mappingids), GINT_TO_POINTER((int)mappingid));
-    *memberids = osync_list_append((*memberids), GINT_TO_POINTER((int)memberid));
-		
     osync_trace(TRACE_INTERNAL, "Loaded change with uid %s, mappingid %lli from member %lli", uid, mappingid, memberid);
   }
 
-  osync_db_free_list(result);	
+  if (ret < 0)
+    goto error_free_cursor;
+
+  osync_db_cursor_free(cursor);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_free_cursor:
+  osync_db_cursor_free(cursor);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+typedef struct {
+  OSyncList **ids;
+  OSyncList **uids;
+  OSyncList **mappingids;
+  OSyncList **memberids;
+} OSyncArchiveChangeLists;
+
+static osync_bool _osync_archive_append_change(long long int id, const char *uid, long long int mappingid, long long int memberid, void *userdata, OSyncError **error)
+{
+  OSyncArchiveChangeLists *lists = userdata;
+
+  *lists->ids = osync_list_prepend(*lists->ids, GINT_TO_POINTER((int)id));
+  *lists->uids = osync_list_prepend(*lists->uids, g_strdup(uid));
+  *lists->mappingids = osync_list_prepend(*lists->mappingids, GINT_TO_POINTER((int)mappingid));
+  *lists->memberids = osync_list_prepend(*lists->memberids, GINT_TO_POINTER((int)memberid));
+
+  return TRUE;
+}
+
+osync_bool osync_archive_load_changes(OSyncArchive *archive, const char *objtype, OSyncList **ids, OSyncList **uids, OSyncList **mappingids, OSyncList **memberids, OSyncError **error)
+{
+  OSyncArchiveChangeLists lists;
+  OSyncList *new_ids = NULL, *new_uids = NULL, *new_mappingids = NULL, *new_memberids = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, %p, %p, %p, %p)", __func__, archive, objtype, ids, uids, mappingids, memberids, error);
+
+  osync_assert(archive);
+  osync_assert(objtype);
+  osync_assert(ids);
+  osync_assert(uids);
+  osync_assert(mappingids);
+  osync_assert(memberids);
+
+  lists.ids = &new_ids;
+  lists.uids = &new_uids;
+  lists.mappingids = &new_mappingids;
+  lists.memberids = &new_memberids;
+
+  /* Prepend and reverse once instead of appending to keep this linear */
+  if (!osync_archive_foreach_change(archive, objtype, _osync_archive_append_change, &lists, error)) {
+    osync_list_foreach(new_uids, (OSyncFunc)g_free, NULL);
+    osync_list_free(new_ids);
+    osync_list_free(new_uids);
+    osync_list_free(new_mappingids);
+    osync_list_free(new_memberids);
+    goto error;
+  }
+
+  *ids = osync_list_concat(*ids, osync_list_reverse(new_ids));
+  *uids = osync_list_concat(*uids, osync_list_reverse(new_uids));
+  *mappingids = osync_list_concat(*mappingids, osync_list_reverse(new_mappingids));
+  *memberids = osync_list_concat(*memberids, osync_list_reverse(new_memberids));
 
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -555,3 +937,409 @@ osync_bool osync_archive_flush_ignored_conflict(OSyncArchive *archive, const cha
   return FALSE;
 }
 
+
+static osync_bool osync_archive_create_checkpoint(OSyncDB *db, OSyncError **error)
+{
+  int ret = 0;
+
+  ret = osync_db_table_exists(db, "tbl_checkpoint", error);
+  if (ret < 0)
+    return FALSE;
+  else if (ret)
+    return TRUE;
+
+  /* Both tables or none */
+  if (!osync_db_query(db, "BEGIN TRANSACTION; "
+                      "CREATE TABLE tbl_checkpoint_session (objtype VARCHAR(64) PRIMARY KEY, slowsync INTEGER); "
+                      "CREATE TABLE tbl_checkpoint (objtype VARCHAR(64), mappingid INTEGER, memberid INTEGER, signature VARCHAR, PRIMARY KEY (objtype, mappingid, memberid) ); "
+                      "COMMIT TRANSACTION", error)) {
+    osync_db_query(db, "ROLLBACK TRANSACTION", NULL);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+osync_bool osync_archive_begin_checkpoint(OSyncArchive *archive, const char *objtype, osync_bool slowsync, OSyncError **error)
+{
+  char *query = NULL;
+  char *escaped_objtype = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %i, %p)", __func__, archive, objtype, slowsync, error);
+  osync_assert(archive);
+  osync_assert(objtype);
+
+  if (!osync_archive_create_checkpoint(archive->db, error))
+    goto error;
+
+  /* Entries of an interrupted synchronization are kept, they are still written */
+  escaped_objtype = osync_db_sql_escape(objtype);
+  query = g_strdup_printf("REPLACE INTO tbl_checkpoint_session (objtype, slowsync) VALUES('%s', '%i')", escaped_objtype, slowsync ? 1 : 0);
+  g_free(escaped_objtype);
+
+  if (!osync_db_query(archive->db, query, error)) {
+    g_free(query);
+    goto error;
+  }
+
+  g_free(query);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+osync_bool osync_archive_save_checkpoint_entry(OSyncArchive *archive, const char *objtype, long long int mappingid, long long int memberid, const char *signature, OSyncError **error)
+{
+  char *query = NULL;
+  char *escaped_objtype = NULL;
+  char *escaped_signature = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %lli, %lli, %s, %p)", __func__, archive, objtype, mappingid, memberid, __NULLSTR(signature), error);
+  osync_assert(archive);
+  osync_assert(objtype);
+
+  if (!osync_archive_create_checkpoint(archive->db, error))
+    goto error;
+
+  escaped_objtype = osync_db_sql_escape(objtype);
+  if (signature) {
+    escaped_signature = osync_db_sql_escape(signature);
+    query = g_strdup_printf("REPLACE INTO tbl_checkpoint (objtype, mappingid, memberid, signature) VALUES('%s', '%lli', '%lli', '%s')", escaped_objtype, mappingid, memberid, escaped_signature);
+    g_free(escaped_signature);
+  } else {
+    query = g_strdup_printf("REPLACE INTO tbl_checkpoint (objtype, mappingid, memberid, signature) VALUES('%s', '%lli', '%lli', NULL)", escaped_objtype, mappingid, memberid);
+  }
+  g_free(escaped_objtype);
+
+  if (!osync_db_queue(archive->db, query, error)) {
+    g_free(query);
+    goto error;
+  }
+
+  g_free(query);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+int osync_archive_load_checkpoint(OSyncArchive *archive, const char *objtype, osync_bool *slowsync, OSyncArchiveCheckpointFn func, void *userdata, OSyncError **error)
+{
+  OSyncDBCursor *cursor = NULL;
+  char *query = NULL;
+  char *escaped_objtype = NULL;
+  int ret = 0;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, %p, %p, %p)", __func__, archive, objtype, slowsync, func, userdata, error);
+  osync_assert(archive);
+  osync_assert(objtype);
+  osync_assert(slowsync);
+
+  ret = osync_db_table_exists(archive->db, "tbl_checkpoint", error);
+  if (ret < 0)
+    goto error;
+  else if (ret == 0) {
+    osync_trace(TRACE_EXIT, "%s: no checkpoint", __func__);
+    return 0;
+  }
+
+  escaped_objtype = osync_db_sql_escape(objtype);
+  query = g_strdup_printf("SELECT slowsync FROM tbl_checkpoint_session WHERE objtype='%s'", escaped_objtype);
+  cursor = osync_db_cursor_new(archive->db, query, error);
+  g_free(query);
+  if (!cursor)
+    goto error_free_objtype;
+
+  ret = osync_db_cursor_next(cursor, error);
+  if (ret == 1)
+    *slowsync = osync_db_cursor_get_int64(cursor, 0) ? TRUE : FALSE;
+  osync_db_cursor_free(cursor);
+
+  if (ret < 0)
+    goto error_free_objtype;
+  else if (ret == 0) {
+    g_free(escaped_objtype);
+    osync_trace(TRACE_EXIT, "%s: no checkpoint", __func__);
+    return 0;
+  }
+
+  query = g_strdup_printf("SELECT mappingid, memberid, signature FROM tbl_checkpoint WHERE objtype='%s'", escaped_objtype);
+  cursor = osync_db_cursor_new(archive->db, query, error);
+  g_free(query);
+  if (!cursor)
+    goto error_free_objtype;
+
+  while ((ret = osync_db_cursor_next(cursor, error)) == 1) {
+    long long int mappingid = osync_db_cursor_get_int64(cursor, 0);
+    long long int memberid = osync_db_cursor_get_int64(cursor, 1);
+    const char *signature = osync_db_cursor_get_string(cursor, 2);
+
+    if (!func(mappingid, memberid, signature, userdata, error)) {
+      ret = -1;
+      break;
+    }
+  }
+  osync_db_cursor_free(cursor);
+
+  if (ret < 0)
+    goto error_free_objtype;
+
+  g_free(escaped_objtype);
+
+  osync_trace(TRACE_EXIT, "%s: slowsync %i", __func__, *slowsync);
+  return 1;
+
+ error_free_objtype:
+  g_free(escaped_objtype);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return -1;
+}
+
+osync_bool osync_archive_flush_checkpoint(OSyncArchive *archive, const char *objtype, OSyncError **error)
+{
+  char *query = NULL;
+  char *escaped_objtype = NULL;
+  int ret = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, archive, objtype, error);
+  osync_assert(archive);
+  osync_assert(objtype);
+
+  ret = osync_db_table_exists(archive->db, "tbl_checkpoint", error);
+  if (ret < 0)
+    goto error;
+  else if (ret == 0) {
+    osync_trace(TRACE_EXIT, "%s: no checkpoint", __func__);
+    return TRUE;
+  }
+
+  escaped_objtype = osync_db_sql_escape(objtype);
+  query = g_strdup_printf("DELETE FROM tbl_checkpoint WHERE objtype='%s'; DELETE FROM tbl_checkpoint_session WHERE objtype='%s'", escaped_objtype, escaped_objtype);
+  g_free(escaped_objtype);
+
+  if (!osync_db_query(archive->db, query, error)) {
+    g_free(query);
+    goto error;
+  }
+
+  g_free(query);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+void osync_archive_set_compression(OSyncArchive *archive, osync_bool compress)
+{
+  osync_assert(archive);
+#ifdef HAVE_ZLIB
+  archive->compress = compress;
+#else
+  if (compress)
+    osync_trace(TRACE_INTERNAL, "Built without zlib, archive data doesn't get compressed");
+#endif
+}
+
+osync_bool osync_archive_start_writer(OSyncArchive *archive, osync_bool wal, OSyncError **error)
+{
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p)", __func__, archive, wal, error);
+  osync_assert(archive);
+
+  if (wal && !osync_db_set_wal(archive->db, TRUE, error))
+    goto error;
+
+  if (!osync_db_start_writer(archive->db, error))
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+osync_bool osync_archive_sync(OSyncArchive *archive, OSyncError **error)
+{
+  osync_assert(archive);
+  return osync_db_sync(archive->db, error);
+}
+
+/* Loads, decodes and compacts the data of a mapping */
+static int _osync_archive_load_compact(OSyncArchive *archive, const char *escaped_objtype, const char *objtype, long long int mappingid, char **data, unsigned int *size, OSyncError **error)
+{
+  char *query = g_strdup_printf("SELECT data FROM tbl_archive WHERE objtype='%s' AND mappingid=%lli", escaped_objtype, mappingid);
+  int ret = osync_db_get_blob(archive->db, query, data, size, error);
+  g_free(query);
+
+  if (ret <= 0)
+    return ret;
+
+  if (!_osync_archive_decode(archive, objtype, data, size, error)) {
+    g_free(*data);
+    return -1;
+  }
+
+  _osync_archive_compact_xml(data, size);
+  return 1;
+}
+
+static osync_bool _osync_archive_recompact_objtype(OSyncArchive *archive, const char *objtype, OSyncError **error)
+{
+  OSyncList *result = NULL, *row = NULL;
+  GByteArray *sample = NULL;
+  char *escaped_objtype = NULL;
+  char *query = NULL;
+  char *data = NULL;
+  unsigned int size = 0;
+  int ret;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, archive, objtype, error);
+
+  escaped_objtype = osync_db_sql_escape(objtype);
+  query = g_strdup_printf("SELECT mappingid FROM tbl_archive WHERE objtype='%s' ORDER BY mappingid", escaped_objtype);
+  result = osync_db_query_table(archive->db, query, error);
+  g_free(query);
+  if (osync_error_is_set(error))
+    goto error;
+
+  /* The dictionary is a sample of the stored entries. zlib prefers the
+     most common strings at the end, the sample is cut at its beginning. */
+  sample = g_byte_array_new();
+  for (row = result; row && archive->compress && sample->len < OSYNC_ARCHIVE_DICT_SIZE; row = row->next) {
+    long long int mappingid = g_ascii_strtoll(osync_list_nth_data(row->data, 0), NULL, 0);
+
+    ret = _osync_archive_load_compact(archive, escaped_objtype, objtype, mappingid, &data, &size, error);
+    if (ret < 0)
+      goto error_free_sample;
+    else if (ret == 0)
+      continue;
+
+    g_byte_array_append(sample, (guint8 *) data, size);
+    g_free(data);
+  }
+
+  if (sample->len > OSYNC_ARCHIVE_DICT_SIZE)
+    g_byte_array_remove_range(sample, 0, sample->len - OSYNC_ARCHIVE_DICT_SIZE);
+
+  /* Entries get decoded with the cached old dictionary until they got rewritten */
+  if (!_osync_archive_get_dictionary(archive, objtype, error))
+    goto error_free_sample;
+
+  query = g_strdup_printf("DELETE FROM tbl_archive_dict WHERE objtype='%s'", escaped_objtype);
+  ret = osync_db_query(archive->db, query, error);
+  g_free(query);
+  if (!ret)
+    goto error_free_sample;
+
+  if (sample->len) {
+    query = g_strdup_printf("INSERT INTO tbl_archive_dict (objtype, data) VALUES('%s', ?)", escaped_objtype);
+    ret = osync_db_bind_blob(archive->db, query, (char *) sample->data, sample->len, error);
+    g_free(query);
+    if (!ret)
+      goto error_free_sample;
+  }
+
+  for (row = result; row; row = row->next) {
+    long long int mappingid = g_ascii_strtoll(osync_list_nth_data(row->data, 0), NULL, 0);
+    char *encoded = NULL;
+    unsigned int encoded_size = 0;
+
+    ret = _osync_archive_load_compact(archive, escaped_objtype, objtype, mappingid, &data, &size, error);
+    if (ret < 0)
+      goto error_free_sample;
+    else if (ret == 0)
+      continue;
+
+    ret = _osync_archive_encode(archive, objtype, sample, data, size, &encoded, &encoded_size, error);
+    g_free(data);
+    if (!ret)
+      goto error_free_sample;
+
+    query = g_strdup_printf("UPDATE tbl_archive SET data=? WHERE objtype='%s' AND mappingid=%lli", escaped_objtype, mappingid);
+    ret = osync_db_bind_blob(archive->db, query, encoded, encoded_size, error);
+    g_free(query);
+    g_free(encoded);
+    if (!ret)
+      goto error_free_sample;
+  }
+
+  g_byte_array_free(sample, TRUE);
+  osync_db_free_list(result);
+  g_free(escaped_objtype);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_free_sample:
+  g_byte_array_free(sample, TRUE);
+ error:
+  osync_db_free_list(result);
+  g_free(escaped_objtype);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+osync_bool osync_archive_recompact(OSyncArchive *archive, OSyncError **error)
+{
+  OSyncList *result = NULL, *row = NULL;
+  int ret;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, archive, error);
+  osync_assert(archive);
+
+  ret = osync_db_table_exists(archive->db, "tbl_archive", error);
+  if (ret < 0)
+    goto error;
+  else if (ret == 0) {
+    osync_trace(TRACE_EXIT, "%s: no data stored in archive.", __func__);
+    return TRUE;
+  }
+
+  if (!osync_archive_create_dictionaries(archive->db, error))
+    goto error;
+
+  result = osync_db_query_table(archive->db, "SELECT DISTINCT objtype FROM tbl_archive", error);
+  if (osync_error_is_set(error))
+    goto error;
+
+  if (!osync_db_query(archive->db, "BEGIN TRANSACTION", error))
+    goto error_free_result;
+
+  for (row = result; row; row = row->next) {
+    if (!_osync_archive_recompact_objtype(archive, osync_list_nth_data(row->data, 0), error)) {
+      osync_db_query(archive->db, "ROLLBACK TRANSACTION", NULL);
+      _osync_archive_clear_dictionaries(archive);
+      goto error_free_result;
+    }
+  }
+
+  /* Reloaded with the next access */
+  _osync_archive_clear_dictionaries(archive);
+
+  if (!osync_db_query(archive->db, "COMMIT TRANSACTION", error))
+    goto error_free_result;
+
+  osync_db_free_list(result);
+
+  /* Give the space of the old entries back */
+  if (!osync_db_query(archive->db, "VACUUM", error))
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_free_result:
+  osync_db_free_list(result);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
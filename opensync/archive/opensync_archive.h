@@ -73,6 +73,58 @@ OSYNC_EXPORT void osync_archive_unref(OSyncArchive *archive);
  * @return TRUE on when all changes successfully loaded otherwise FALSE
  */
 OSYNC_EXPORT osync_bool osync_archive_load_changes(OSyncArchive *archive, const char *objtype, OSyncList **ids, OSyncList **uids, OSyncList **mappingids, OSyncList **memberids, OSyncError **error);
+
+/**
+ * @brief Callback for each change entry streamed by osync_archive_foreach_change().
+ *
+ * The uid is only valid during the call.
+ * Return FALSE and set error to abort loading.
+ */
+typedef osync_bool (* OSyncArchiveChangeFn) (long long int id, const char *uid, long long int mappingid, long long int memberid, void *userdata, OSyncError **error);
+
+/**
+ * @brief Streams all changes from group archive for a certain object type,
+ *        ordered by mappingid.
+ *
+ * Other than osync_archive_load_changes() the rows are not copied into lists,
+ * each row is passed to the callback as soon as it got read.
+ *
+ * @param archive The group archive
+ * @param objtype Requested object type 
+ * @param func Callback which gets called for each change entry
+ * @param userdata Userdata passed to the callback
+ * @param error Pointer to an error struct
+ * @return TRUE on when all changes successfully loaded otherwise FALSE
+ */
+OSYNC_EXPORT osync_bool osync_archive_foreach_change(OSyncArchive *archive, const char *objtype, OSyncArchiveChangeFn func, void *userdata, OSyncError **error);
+
+/**
+ * @brief Enables or disables compression of newly stored data.
+ *
+ * Compression is enabled by default, if OpenSync got built with zlib.
+ * Stored data gets read in any case, also entries written by older
+ * versions of OpenSync.
+ *
+ * @param archive The group archive
+ * @param compress TRUE to compress data
+ */
+OSYNC_EXPORT void osync_archive_set_compression(OSyncArchive *archive, osync_bool compress);
+
+/**
+ * @brief Rewrites all stored data in the compact encoding.
+ *
+ * Indented XML of older versions gets compacted, a compression dictionary
+ * gets built for every objtype from the stored entries and all entries get
+ * compressed with it. The database file gets shrunk afterwards.
+ *
+ * This takes a while for large archives and must not run while the group
+ * gets synchronized.
+ *
+ * @param archive The group archive
+ * @param error Pointer to an error struct
+ * @return TRUE on success, FALSE otherwise
+ */
+OSYNC_EXPORT osync_bool osync_archive_recompact(OSyncArchive *archive, OSyncError **error);
 /*@}*/
 
 #endif /*OPENSYNC_ARCHIVE_H_*/
@@ -130,6 +130,81 @@ osync_bool osync_archive_save_ignored_conflict(OSyncArchive *archive, const char
  * @return Returns TRUE on success, FALSE otherwise 
  */
 osync_bool osync_archive_flush_ignored_conflict(OSyncArchive *archive, const char *objtype, OSyncError **error);
+
+typedef osync_bool (*OSyncArchiveCheckpointFn) (long long int mappingid, long long int memberid, const char *signature, void *userdata, OSyncError **error);
+
+/**
+ * @brief Starts or continues the checkpoint of the write phase of an objtype
+ *
+ * The checkpoint stays in the archive until osync_archive_flush_checkpoint()
+ * gets called after the synchronization finished. A checkpoint which is still
+ * there on the next synchronization belongs to an interrupted one.
+ *
+ * @param archive The group archive
+ * @param objtype The object type which gets written
+ * @param slowsync TRUE if the synchronization is a slow-sync
+ * @param error Pointer to an error struct
+ * @return Returns TRUE on success, FALSE otherwise 
+ */
+OSYNC_TEST_EXPORT osync_bool osync_archive_begin_checkpoint(OSyncArchive *archive, const char *objtype, osync_bool slowsync, OSyncError **error);
+
+/**
+ * @brief Records that an entry got written durably by its member
+ *
+ * @param archive The group archive
+ * @param objtype Reported object type of entry
+ * @param mappingid Mapping ID of the entry
+ * @param memberid Member ID of the entry
+ * @param signature Identifies the written change, NULL if it can't be identified
+ * @param error Pointer to an error struct
+ * @return Returns TRUE on success, FALSE otherwise 
+ */
+OSYNC_TEST_EXPORT osync_bool osync_archive_save_checkpoint_entry(OSyncArchive *archive, const char *objtype, long long int mappingid, long long int memberid, const char *signature, OSyncError **error);
+
+/**
+ * @brief Loads the checkpoint of an interrupted synchronization
+ *
+ * @param archive The group archive
+ * @param objtype Requested object type
+ * @param slowsync Pointer to store if the interrupted synchronization was a slow-sync
+ * @param func Gets called for every entry written before the interruption
+ * @param userdata Gets passed to func
+ * @param error Pointer to an error struct
+ * @return 1 if a checkpoint got loaded, 0 if there is none, -1 on error
+ */
+OSYNC_TEST_EXPORT int osync_archive_load_checkpoint(OSyncArchive *archive, const char *objtype, osync_bool *slowsync, OSyncArchiveCheckpointFn func, void *userdata, OSyncError **error);
+
+/**
+ * @brief Deletes the checkpoint of the objtype after a finished synchronization
+ *
+ * @param archive The group archive
+ * @param objtype Reported object type of entry
+ * @param error Pointer to an error struct
+ * @return Returns TRUE on success, FALSE otherwise 
+ */
+OSYNC_TEST_EXPORT osync_bool osync_archive_flush_checkpoint(OSyncArchive *archive, const char *objtype, OSyncError **error);
+
+/**
+ * @brief Moves the writes of the archive to a database writer thread
+ *
+ * Changes, data and checkpoint entries get queued and committed in groups
+ * from then on. Everything else waits for the queued writes.
+ *
+ * @param archive The group archive
+ * @param wal TRUE to switch the database to write-ahead logging
+ * @param error Pointer to an error struct
+ * @return Returns TRUE on success, FALSE otherwise 
+ */
+OSYNC_TEST_EXPORT osync_bool osync_archive_start_writer(OSyncArchive *archive, osync_bool wal, OSyncError **error);
+
+/**
+ * @brief Waits until all queued writes of the archive are on disk
+ *
+ * @param archive The group archive
+ * @param error Pointer to an error struct
+ * @return FALSE if a queued write failed, TRUE otherwise 
+ */
+OSYNC_TEST_EXPORT osync_bool osync_archive_sync(OSyncArchive *archive, OSyncError **error);
 /*@}*/
 
 #endif /*OPENSYNC_ARCHIVE_INTERNALS_H_*/
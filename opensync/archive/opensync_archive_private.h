@@ -36,6 +36,29 @@
  */
 /*@{*/
 
+/** Compact encoding of archive data: magic, version, method and the
+ *  size of the decoded data (big endian), followed by the payload.
+ *  Legacy entries are plain XML and never start with the magic. */
+#define OSYNC_ARCHIVE_MAGIC		"\0OSA"
+#define OSYNC_ARCHIVE_MAGIC_SIZE	4
+#define OSYNC_ARCHIVE_VERSION		1
+#define OSYNC_ARCHIVE_HEADER_SIZE	10
+
+/** Smaller entries are stored uncompressed */
+#define OSYNC_ARCHIVE_COMPRESS_MIN_SIZE	128
+
+/** Size of the compression dictionary of an objtype */
+#define OSYNC_ARCHIVE_DICT_SIZE		32768
+
+typedef enum {
+	/** The payload is the data as is */
+	OSYNC_ARCHIVE_METHOD_STORED = 0,
+	/** zlib stream */
+	OSYNC_ARCHIVE_METHOD_DEFLATE = 1,
+	/** zlib stream, preset with the dictionary of the objtype */
+	OSYNC_ARCHIVE_METHOD_DEFLATE_DICT = 2
+} OSyncArchiveMethod;
+
 /**
  * @brief Represent a Archive object
  */
@@ -44,7 +67,12 @@ struct OSyncArchive {
 	int ref_count;
 	/**  */
 	OSyncDB *db;
-	/**  */
+	/** TRUE if data gets compressed before it gets stored */
+	osync_bool compress;
+	/** Cache of the dictionaries, objtype -> GByteArray (empty if the objtype has none) */
+	GHashTable *dictionaries;
+	/** Last ROWID of tbl_changes handed out, 0 if not loaded yet */
+	long long int change_rowid;
 };
 
 #endif /* OPENSYNC_ARCHIVE_PRIVATE_H_ */
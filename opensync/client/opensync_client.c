@@ -74,6 +74,7 @@ static OSyncContext *_create_context(OSyncClient *client, OSyncMessage *message,
     osync_change_ref(baton->change);
 		
   osync_context_set_callback(context, callback, baton);
+  osync_context_set_cancel_flag(context, &client->cancelled);
   return context;
 	
  error_free_context:
@@ -592,6 +593,7 @@ static osync_bool _osync_client_handle_initialize(OSyncClient *client, OSyncMess
   osync_plugin_info_set_loop(client->plugin_info, client->context);
   osync_plugin_info_set_format_env(client->plugin_info, client->format_env);
   osync_plugin_info_set_groupname(client->plugin_info, groupname);
+  osync_plugin_info_set_cancel_flag(client->plugin_info, &client->cancelled);
 
   if (config)
     osync_plugin_info_set_config(client->plugin_info, config);
@@ -736,6 +738,57 @@ static osync_bool _osync_client_handle_finalize(OSyncClient *client, OSyncMessag
   return FALSE;
 }
 
+/* Brings an initialized plugin back into the state it had right after
+ * initialize, so the client can be reused for another session. Replying
+ * to the reset also tells the engine that the client is still healthy. */
+static osync_bool _osync_client_handle_reset(OSyncClient *client, OSyncMessage *message, OSyncError **error)
+{
+  OSyncMessage *reply = NULL;
+  OSyncObjTypeSink *sink = NULL;
+  unsigned int i = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, client, message, error);
+	
+  if (!client->plugin || !client->plugin_data || !client->plugin_info) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "No initialized plugin to reset");
+    goto error;
+  }
+	
+  if (!client->outgoing) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "No outgoing queue yet");
+    goto error;
+  }
+	
+  sink = osync_plugin_info_get_main_sink(client->plugin_info);
+  if (sink)
+    osync_objtype_sink_set_slowsync(sink, FALSE);
+	
+  for (i = 0; i < osync_plugin_info_num_objtypes(client->plugin_info); i++) {
+    sink = osync_plugin_info_nth_objtype(client->plugin_info, i);
+    osync_objtype_sink_set_slowsync(sink, FALSE);
+  }
+
+  /* The next engine starts without the cancellation of the last one */
+  g_atomic_int_set(&client->cancelled, 0);
+	
+  reply = osync_message_new_reply(message, error);
+  if (!reply)
+    goto error;
+
+  if (!osync_queue_send_message(client->outgoing, NULL, reply, error))
+    goto error_free_message;
+	
+  osync_message_unref(reply);
+		
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+	
+ error_free_message:
+  osync_message_unref(reply);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
 static osync_bool _osync_client_handle_discover(OSyncClient *client, OSyncMessage *message, OSyncError **error)
 {
   OSyncMessage *reply = NULL;
@@ -1266,6 +1319,8 @@ static void _osync_client_message_handler(OSyncMessage *message, void *user_data
   case OSYNC_MESSAGE_ENGINE_CHANGED:
   case OSYNC_MESSAGE_MAPPING_CHANGED:
   case OSYNC_MESSAGE_MAPPINGENTRY_CHANGED:
+  case OSYNC_MESSAGE_QUEUE_CREDIT:
+  case OSYNC_MESSAGE_CANCEL:
     //Ignore these. They dont have any meaning to the client
     break;
   case OSYNC_MESSAGE_QUEUE_ERROR:
@@ -1284,6 +1339,11 @@ static void _osync_client_message_handler(OSyncMessage *message, void *user_data
       goto error;
     break;
 			
+  case OSYNC_MESSAGE_RESET:
+    if (!_osync_client_handle_reset(client, message, &error))
+      goto error;
+    break;
+			
   case OSYNC_MESSAGE_DISCOVER:
     if (!_osync_client_handle_discover(client, message, &error))
       goto error;
@@ -1485,6 +1545,13 @@ void osync_client_set_incoming_queue(OSyncClient *client, OSyncQueue *incoming)
   osync_queue_set_message_handler(incoming, _osync_client_message_handler, client);
   osync_queue_setup_with_gmainloop(incoming, client->context);
   client->incoming = incoming;
+
+  /* Cancellation has to reach plugin functions which are still running */
+  osync_queue_set_cancel_flag(incoming, &client->cancelled);
+
+  /* The engine returns the credits for our changes on the incoming queue */
+  if (client->outgoing)
+    osync_queue_set_credit_target(incoming, client->outgoing);
 }
 
 void osync_client_set_outgoing_queue(OSyncClient *client, OSyncQueue *outgoing)
@@ -1492,6 +1559,9 @@ void osync_client_set_outgoing_queue(OSyncClient *client, OSyncQueue *outgoing)
   osync_queue_set_message_handler(outgoing, _osync_client_hup_handler, client);
   osync_queue_setup_with_gmainloop(outgoing, client->context);
   client->outgoing = outgoing;
+
+  if (client->incoming)
+    osync_queue_set_credit_target(client->incoming, outgoing);
 }
 
 void osync_client_run_and_block(OSyncClient *client)
@@ -0,0 +1,439 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#include "opensync.h"
+#include "opensync_internals.h"
+
+#include "opensync-ipc.h"
+#include "ipc/opensync_serializer_internals.h"
+#include "ipc/opensync_queue_internals.h"
+
+#include "opensync-plugin.h"
+
+#include "opensync-client.h"
+#include "opensync_client_internals.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#endif /* _WIN32 */
+
+#ifdef _WIN32
+typedef int pid_t;
+#endif //_WIN32
+
+#include "opensync_client_proxy_internals.h"
+#include "opensync_client_proxy_private.h"
+#include "opensync_client_pool_internals.h"
+#include "opensync_client_pool_private.h"
+
+static void _osync_client_worker_message_handler(OSyncMessage *message, void *user_data)
+{
+  OSyncClientWorker *worker = user_data;
+  osync_trace(TRACE_INTERNAL, "idle worker %p received command %i", user_data, osync_message_get_command(message));
+
+  /* The client went away while we wait for the reply of the finalize request */
+  if (osync_message_get_command(message) == OSYNC_MESSAGE_QUEUE_HUP || osync_message_get_command(message) == OSYNC_MESSAGE_QUEUE_ERROR) {
+    if (g_atomic_int_get(&worker->busy)) {
+      g_atomic_int_set(&worker->busy, FALSE);
+      g_main_context_wakeup(worker->context);
+    }
+  }
+}
+
+/* Gets called with the reply of the client, or from the thread of the queue
+ * with an error reply once the finalize timeout passed. */
+static void _osync_client_worker_fin_handler(OSyncMessage *message, void *user_data)
+{
+  OSyncClientWorker *worker = user_data;
+  OSyncError *error = NULL;
+
+  if (message && osync_message_get_cmd(message) == OSYNC_MESSAGE_REPLY) {
+    worker->finalized = TRUE;
+  } else if (message && osync_message_get_cmd(message) == OSYNC_MESSAGE_ERRORREPLY) {
+    osync_demarshal_error(message, &error);
+    osync_trace(TRACE_ERROR, "Unable to finalize idle worker: %s", osync_error_print(&error));
+    osync_error_unref(&error);
+  }
+
+  g_atomic_int_set(&worker->busy, FALSE);
+  g_main_context_wakeup(worker->context);
+}
+
+/* Checks if the client behind the worker is still there. The reset request
+ * sent by the proxy after leasing the worker verifies that it also still
+ * answers. */
+static osync_bool _osync_client_worker_is_alive(OSyncClientWorker *worker)
+{
+#ifndef _WIN32
+  int status = 0;
+#endif
+
+  if (!osync_queue_is_connected(worker->incoming) || !osync_queue_is_connected(worker->outgoing))
+    return FALSE;
+
+  if (worker->type == OSYNC_START_TYPE_THREAD)
+    return worker->client ? TRUE : FALSE;
+
+#ifndef _WIN32
+  if (worker->child_pid && waitpid(worker->child_pid, &status, WNOHANG) != 0) {
+    osync_trace(TRACE_INTERNAL, "osplugin process %ld of idle worker is gone", (long)worker->child_pid);
+    worker->child_pid = 0;
+    return FALSE;
+  }
+#endif //_WIN32
+
+  return TRUE;
+}
+
+void osync_client_worker_shutdown(OSyncClientWorker *worker)
+{
+  OSyncMessage *message = NULL;
+  OSyncError *error = NULL;
+  osync_bool hung = FALSE;
+#ifndef _WIN32
+  int status = 0;
+#endif
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, worker);
+
+  if (_osync_client_worker_is_alive(worker)) {
+    worker->context = g_main_context_new();
+    osync_queue_set_message_handler(worker->incoming, _osync_client_worker_message_handler, worker);
+    osync_queue_setup_with_gmainloop(worker->incoming, worker->context);
+
+    message = osync_message_new(OSYNC_MESSAGE_FINALIZE, 0, &error);
+    if (message) {
+      osync_message_set_handler(message, _osync_client_worker_fin_handler, worker);
+      g_atomic_int_set(&worker->busy, TRUE);
+
+      if (osync_queue_send_message_with_timeout(worker->outgoing, worker->incoming, message, worker->finalize_timeout, &error)) {
+        /* The timeout of the queue makes sure this doesn't block forever */
+        while (g_atomic_int_get(&worker->busy))
+          g_main_context_iteration(worker->context, TRUE);
+      }
+      osync_message_unref(message);
+    }
+
+    if (error) {
+      osync_trace(TRACE_ERROR, "Unable to finalize idle worker: %s", osync_error_print(&error));
+      osync_error_unref(&error);
+    }
+
+    hung = !worker->finalized;
+  }
+
+  /* Disconnecting our reading queue generates a HUP on the remote side */
+  if (osync_queue_is_connected(worker->incoming) && !osync_queue_disconnect(worker->incoming, &error))
+    goto error;
+
+  if (osync_queue_is_connected(worker->outgoing)) {
+    /* A client which didn't answer won't hang up either */
+    if (!hung) {
+      message = osync_queue_get_message(worker->outgoing);
+      if (osync_message_get_command(message) != OSYNC_MESSAGE_QUEUE_HUP)
+        osync_trace(TRACE_INTERNAL, "Disconnected, but received no HUP");
+      osync_message_unref(message);
+    }
+
+    if (!osync_queue_disconnect(worker->outgoing, &error))
+      goto error;
+  }
+
+  if (worker->type == OSYNC_START_TYPE_THREAD && worker->client) {
+    if (hung) {
+      /* The thread can't be joined. Leave it behind, together with the
+       * client it still uses. */
+      osync_trace(TRACE_ERROR, "Leaving unresponsive client thread of idle worker behind");
+    } else {
+      osync_client_shutdown(worker->client);
+      osync_client_unref(worker->client);
+    }
+    worker->client = NULL;
+  }
+#ifndef _WIN32
+  else if (worker->child_pid) {
+    if (hung && kill(worker->child_pid, SIGKILL) == -1)
+      osync_trace(TRACE_INTERNAL, "Unable to kill osplugin process: %s", g_strerror(errno));
+
+    if (waitpid(worker->child_pid, &status, 0) == -1)
+      osync_trace(TRACE_INTERNAL, "Error waiting for osplugin process: %s", g_strerror(errno));
+    worker->child_pid = 0;
+  }
+#endif //_WIN32
+
+  osync_client_worker_free(worker);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return;
+
+ error:
+  osync_client_worker_free(worker);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&error));
+  osync_error_unref(&error);
+}
+
+OSyncClientWorker *osync_client_worker_new(OSyncStartType type, const char *key, unsigned int keysize, OSyncError **error)
+{
+  OSyncClientWorker *worker = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%i, %p, %u, %p)", __func__, type, key, keysize, error);
+
+  osync_assert(type == OSYNC_START_TYPE_PROCESS || type == OSYNC_START_TYPE_THREAD);
+  osync_assert(key);
+
+  worker = osync_try_malloc0(sizeof(OSyncClientWorker), error);
+  if (!worker)
+    goto error;
+
+  worker->key = osync_try_malloc0(keysize, error);
+  if (!worker->key)
+    goto error_free_worker;
+
+  memcpy(worker->key, key, keysize);
+  worker->keysize = keysize;
+  worker->type = type;
+  worker->finalize_timeout = OSYNC_CLIENT_PROXY_TIMEOUT_FINALIZE;
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, worker);
+  return worker;
+
+ error_free_worker:
+  g_free(worker);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+void osync_client_worker_free(OSyncClientWorker *worker)
+{
+  osync_assert(worker);
+
+  if (worker->incoming)
+    osync_queue_free(worker->incoming);
+
+  if (worker->outgoing)
+    osync_queue_free(worker->outgoing);
+
+  if (worker->client)
+    osync_client_unref(worker->client);
+
+  if (worker->context)
+    g_main_context_unref(worker->context);
+
+  g_free(worker->key);
+  g_free(worker);
+}
+
+void osync_client_worker_set_connection(OSyncClientWorker *worker, OSyncQueue *incoming, OSyncQueue *outgoing, pid_t child_pid, OSyncClient *client)
+{
+  osync_assert(worker);
+  worker->incoming = incoming;
+  worker->outgoing = outgoing;
+  worker->child_pid = child_pid;
+  worker->client = client;
+}
+
+void osync_client_worker_set_finalize_timeout(OSyncClientWorker *worker, unsigned int timeout)
+{
+  osync_assert(worker);
+  worker->finalize_timeout = timeout ? timeout : OSYNC_CLIENT_PROXY_TIMEOUT_FINALIZE;
+}
+
+void osync_client_worker_get_connection(OSyncClientWorker *worker, OSyncQueue **incoming, OSyncQueue **outgoing, pid_t *child_pid, OSyncClient **client)
+{
+  osync_assert(worker);
+  *incoming = worker->incoming;
+  *outgoing = worker->outgoing;
+  *child_pid = worker->child_pid;
+  *client = worker->client;
+
+  worker->incoming = NULL;
+  worker->outgoing = NULL;
+  worker->child_pid = 0;
+  worker->client = NULL;
+}
+
+OSyncClientPool *osync_client_pool_new(OSyncError **error)
+{
+  OSyncClientPool *pool = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, error);
+
+  pool = osync_try_malloc0(sizeof(OSyncClientPool), error);
+  if (!pool)
+    goto error;
+
+  pool->ref_count = 1;
+  pool->max_idle = OSYNC_CLIENT_POOL_MAX_IDLE_DEFAULT;
+  pool->lock = g_mutex_new();
+  pool->context = g_main_context_new();
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, pool);
+  return pool;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+OSyncClientPool *osync_client_pool_ref(OSyncClientPool *pool)
+{
+  osync_assert(pool);
+
+  g_atomic_int_inc(&(pool->ref_count));
+
+  return pool;
+}
+
+void osync_client_pool_unref(OSyncClientPool *pool)
+{
+  osync_assert(pool);
+
+  if (g_atomic_int_dec_and_test(&(pool->ref_count))) {
+    osync_trace(TRACE_ENTRY, "%s(%p)", __func__, pool);
+
+    osync_client_pool_flush(pool);
+
+    g_mutex_free(pool->lock);
+    g_main_context_unref(pool->context);
+    g_free(pool);
+
+    osync_trace(TRACE_EXIT, "%s", __func__);
+  }
+}
+
+void osync_client_pool_set_max_idle(OSyncClientPool *pool, unsigned int max_idle)
+{
+  GList *evicted = NULL;
+  GList *w = NULL;
+  osync_assert(pool);
+
+  g_mutex_lock(pool->lock);
+  pool->max_idle = max_idle;
+  while (g_list_length(pool->idle) > pool->max_idle) {
+    w = g_list_last(pool->idle);
+    evicted = g_list_prepend(evicted, w->data);
+    pool->idle = g_list_delete_link(pool->idle, w);
+  }
+  g_mutex_unlock(pool->lock);
+
+  for (w = evicted; w; w = w->next)
+    osync_client_worker_shutdown(w->data);
+  g_list_free(evicted);
+}
+
+unsigned int osync_client_pool_num_idle(OSyncClientPool *pool)
+{
+  unsigned int num = 0;
+  osync_assert(pool);
+
+  g_mutex_lock(pool->lock);
+  num = g_list_length(pool->idle);
+  g_mutex_unlock(pool->lock);
+
+  return num;
+}
+
+void osync_client_pool_flush(OSyncClientPool *pool)
+{
+  GList *idle = NULL;
+  GList *w = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, pool);
+  osync_assert(pool);
+
+  g_mutex_lock(pool->lock);
+  idle = pool->idle;
+  pool->idle = NULL;
+  g_mutex_unlock(pool->lock);
+
+  for (w = idle; w; w = w->next)
+    osync_client_worker_shutdown(w->data);
+  g_list_free(idle);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+OSyncClientWorker *osync_client_pool_lease(OSyncClientPool *pool, OSyncStartType type, const char *key, unsigned int keysize)
+{
+  OSyncClientWorker *worker = NULL;
+  OSyncClientWorker *candidate = NULL;
+  GList *dead = NULL;
+  GList *w = NULL;
+  GList *next = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p, %u)", __func__, pool, type, key, keysize);
+  osync_assert(pool);
+
+  g_mutex_lock(pool->lock);
+  for (w = pool->idle; w; w = next) {
+    next = w->next;
+    candidate = w->data;
+
+    if (candidate->type != type || candidate->keysize != keysize || memcmp(candidate->key, key, keysize))
+      continue;
+
+    pool->idle = g_list_delete_link(pool->idle, w);
+
+    if (!_osync_client_worker_is_alive(candidate)) {
+      dead = g_list_prepend(dead, candidate);
+      continue;
+    }
+
+    worker = candidate;
+    break;
+  }
+  g_mutex_unlock(pool->lock);
+
+  for (w = dead; w; w = w->next)
+    osync_client_worker_shutdown(w->data);
+  g_list_free(dead);
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, worker);
+  return worker;
+}
+
+void osync_client_pool_release(OSyncClientPool *pool, OSyncClientWorker *worker)
+{
+  OSyncClientWorker *evicted = NULL;
+  GList *last = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, pool, worker);
+  osync_assert(pool);
+  osync_assert(worker);
+
+  /* Detach the queues from the context of the engine, which might go away
+   * before the worker gets leased again. */
+  osync_queue_set_message_handler(worker->incoming, _osync_client_worker_message_handler, worker);
+  osync_queue_setup_with_gmainloop(worker->incoming, pool->context);
+
+  osync_queue_set_message_handler(worker->outgoing, _osync_client_worker_message_handler, worker);
+  osync_queue_setup_with_gmainloop(worker->outgoing, pool->context);
+
+  g_mutex_lock(pool->lock);
+  pool->idle = g_list_prepend(pool->idle, worker);
+  if (g_list_length(pool->idle) > pool->max_idle) {
+    last = g_list_last(pool->idle);
+    evicted = last->data;
+    pool->idle = g_list_delete_link(pool->idle, last);
+  }
+  g_mutex_unlock(pool->lock);
+
+  if (evicted)
+    osync_client_worker_shutdown(evicted);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+}
@@ -0,0 +1,90 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_CLIENT_POOL_H_
+#define OPENSYNC_CLIENT_POOL_H_
+
+/**
+ * @defgroup OSyncClientPoolAPI OpenSync Client Pool
+ * @ingroup OSyncPublic
+ * @brief Keeps initialized plugin clients alive between synchronizations
+ *
+ * An engine which got a client pool assigned doesn't finalize and stop
+ * its plugin clients (osplugin processes or threads) at the end of a
+ * session. The clients get reset and are kept idle in the pool instead.
+ * The next engine which initializes a member with the same plugin and
+ * configuration leases the idle client and skips process start-up,
+ * plugin loading and plugin initialization.
+ *
+ */
+/*@{*/
+
+/*! @brief Create a new, empty client pool
+ *
+ * @param error Pointer to an error struct
+ * @returns the new client pool or NULL on error
+ */
+OSYNC_EXPORT OSyncClientPool *osync_client_pool_new(OSyncError **error);
+
+/*! @brief Increase the reference count on a client pool
+ *
+ * @param pool Pointer to the client pool
+ *
+ */
+OSYNC_EXPORT OSyncClientPool *osync_client_pool_ref(OSyncClientPool *pool);
+
+/*! @brief Decrease the reference count on a client pool
+ *
+ * All idle clients get finalized and stopped once the last reference
+ * is gone.
+ *
+ * @param pool Pointer to the client pool
+ *
+ */
+OSYNC_EXPORT void osync_client_pool_unref(OSyncClientPool *pool);
+
+/*! @brief Set the maximum number of idle clients kept in the pool
+ *
+ * If more clients get returned, the least recently used ones get stopped.
+ *
+ * @param pool Pointer to the client pool
+ * @param max_idle Maximum number of idle clients
+ *
+ */
+OSYNC_EXPORT void osync_client_pool_set_max_idle(OSyncClientPool *pool, unsigned int max_idle);
+
+/*! @brief Get the number of idle clients in the pool
+ *
+ * @param pool Pointer to the client pool
+ * @returns the number of idle clients
+ *
+ */
+OSYNC_EXPORT unsigned int osync_client_pool_num_idle(OSyncClientPool *pool);
+
+/*! @brief Finalize and stop all idle clients of the pool
+ *
+ * @param pool Pointer to the client pool
+ *
+ */
+OSYNC_EXPORT void osync_client_pool_flush(OSyncClientPool *pool);
+
+/*@}*/
+
+#endif /* OPENSYNC_CLIENT_POOL_H_ */
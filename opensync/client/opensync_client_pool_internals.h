@@ -0,0 +1,81 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_CLIENT_POOL_INTERNALS_H_
+#define OPENSYNC_CLIENT_POOL_INTERNALS_H_
+
+/*! @brief An initialized plugin client which is owned by a client pool */
+typedef struct OSyncClientWorker OSyncClientWorker;
+
+/*! @brief Create a worker for the connection of a client proxy
+ *
+ * The worker takes over the queues, the child process and the client
+ * thread. The proxy must not use them afterwards.
+ *
+ * @param type The start type of the client
+ * @param key The serialized initialize request of the client
+ * @param keysize The size of key
+ * @param error Pointer to an error struct
+ * @returns the new worker or NULL on error
+ */
+OSyncClientWorker *osync_client_worker_new(OSyncStartType type, const char *key, unsigned int keysize, OSyncError **error);
+void osync_client_worker_free(OSyncClientWorker *worker);
+
+/*! @brief Set the timeout of the finalize request sent on shutdown
+ *
+ * @param worker The worker
+ * @param timeout The finalize timeout of the proxy, 0 for the default
+ */
+void osync_client_worker_set_finalize_timeout(OSyncClientWorker *worker, unsigned int timeout);
+
+/*! @brief Finalize the plugin of a worker and stop its client
+ *
+ * A client which doesn't answer the finalize request before its timeout
+ * passes gets killed. A hung client thread can't be joined and is left
+ * behind instead.
+ *
+ * @param worker The worker. It gets freed.
+ */
+void osync_client_worker_shutdown(OSyncClientWorker *worker);
+
+void osync_client_worker_set_connection(OSyncClientWorker *worker, OSyncQueue *incoming, OSyncQueue *outgoing, pid_t child_pid, OSyncClient *client);
+void osync_client_worker_get_connection(OSyncClientWorker *worker, OSyncQueue **incoming, OSyncQueue **outgoing, pid_t *child_pid, OSyncClient **client);
+
+/*! @brief Lease an idle worker which got initialized with the same request
+ *
+ * Workers whose process died or whose queues got disconnected are
+ * stopped and dropped from the pool while searching.
+ *
+ * @param pool The client pool
+ * @param type The start type of the client
+ * @param key The serialized initialize request
+ * @param keysize The size of key
+ * @returns a healthy worker, owned by the caller, or NULL
+ */
+OSyncClientWorker *osync_client_pool_lease(OSyncClientPool *pool, OSyncStartType type, const char *key, unsigned int keysize);
+
+/*! @brief Return a reset worker to the pool
+ *
+ * @param pool The client pool
+ * @param worker The worker. The pool takes ownership.
+ */
+void osync_client_pool_release(OSyncClientPool *pool, OSyncClientWorker *worker);
+
+#endif /* OPENSYNC_CLIENT_POOL_INTERNALS_H_ */
@@ -0,0 +1,64 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_CLIENT_POOL_PRIVATE_H_
+#define OPENSYNC_CLIENT_POOL_PRIVATE_H_
+
+#define OSYNC_CLIENT_POOL_MAX_IDLE_DEFAULT	8
+
+struct OSyncClientWorker {
+	/** The serialized initialize request the client got initialized with */
+	char *key;
+	unsigned int keysize;
+
+	/** Start type of the client, either process or thread */
+	OSyncStartType type;
+
+	OSyncQueue *incoming;
+	OSyncQueue *outgoing;
+	pid_t child_pid;
+
+	/** Only set with start type thread */
+	OSyncClient *client;
+
+	/** Timeout of the finalize request, taken over from the proxy */
+	unsigned int finalize_timeout;
+
+	/** Private context, iterated while waiting for the finalize reply */
+	GMainContext *context;
+	/** TRUE while waiting for the reply of the finalize request */
+	osync_bool busy;
+	/** TRUE if the client replied to the finalize request */
+	osync_bool finalized;
+};
+
+struct OSyncClientPool {
+	int ref_count;
+	GMutex *lock;
+
+	/** List of idle OSyncClientWorker, most recently returned first */
+	GList *idle;
+	unsigned int max_idle;
+
+	/** Idle workers are attached to this context, which never gets iterated */
+	GMainContext *context;
+};
+
+#endif /* OPENSYNC_CLIENT_POOL_PRIVATE_H_ */
@@ -34,6 +34,8 @@ struct OSyncClient {
 	OSyncFormatEnv *format_env;
 	void *plugin_data;
 	OSyncThread *thread;
+	/** Set by the thread reading the incoming queue once the engine cancelled the sync */
+	int cancelled;
 };
 
 #endif /*OPENSYNC_CLIENT_PRIVATE_H_*/
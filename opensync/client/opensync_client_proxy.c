@@ -54,12 +54,15 @@ typedef int pid_t;
 
 #include "opensync_client_proxy_internals.h"
 #include "opensync_client_proxy_private.h"
+#include "opensync_client_pool_internals.h"
 
 typedef struct callContext {
   OSyncClientProxy *proxy;
 	
   initialize_cb init_callback;
   void *init_callback_data;
+  /** Initialize request for a fresh client, if a leased one fails its reset */
+  OSyncMessage *init_message;
 	
   finalize_cb fin_callback;
   void *fin_callback_data;
@@ -243,16 +246,102 @@ static void _osync_client_proxy_hup_handler(OSyncMessage *message, void *user_da
   return;
 }
 
+static void _osync_client_proxy_init_handler(OSyncMessage *message, void *user_data);
+static osync_bool _osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type, const char *path, OSyncError **error);
+
+/* Replaces a leased client which failed its reset by a fresh one, which
+ * gets the initialize request the leased client was picked by. */
+static gboolean _osync_client_proxy_respawn(gpointer user_data)
+{
+  callContext *ctx = user_data;
+  OSyncClientProxy *proxy = ctx->proxy;
+  OSyncClientWorker *worker = NULL;
+  OSyncMessage *message = ctx->init_message;
+  OSyncError *error = NULL;
+	
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, user_data);
+	
+  ctx->init_message = NULL;
+	
+  worker = osync_client_worker_new(proxy->type, proxy->pool_key, proxy->pool_keysize, &error);
+  if (!worker)
+    goto error;
+	
+  osync_client_worker_set_connection(worker, proxy->incoming, proxy->outgoing, proxy->child_pid, proxy->client);
+  osync_client_worker_set_finalize_timeout(worker, proxy->timeout.finalize);
+  proxy->incoming = NULL;
+  proxy->outgoing = NULL;
+  proxy->child_pid = 0;
+  proxy->client = NULL;
+	
+  osync_client_worker_shutdown(worker);
+	
+  /* Nothing to shut down if the new client can't be started */
+  proxy->spawn_deferred = TRUE;
+  if (!_osync_client_proxy_spawn(proxy, proxy->type, NULL, &error))
+    goto error;
+  proxy->spawn_deferred = FALSE;
+	
+  osync_message_set_handler(message, _osync_client_proxy_init_handler, ctx);
+	
+  if (!osync_queue_send_message_with_timeout(proxy->outgoing, proxy->incoming, message, proxy->timeout.initialize, &error))
+    goto error;
+	
+  osync_message_unref(message);
+	
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return FALSE;
+	
+ error:
+  osync_message_unref(message);
+  ctx->init_callback(proxy, ctx->init_callback_data, error);
+  g_free(ctx);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&error));
+  osync_error_unref(&error);
+  return FALSE;
+}
+
 static void _osync_client_proxy_init_handler(OSyncMessage *message, void *user_data)
 {
   callContext *ctx = user_data;
   OSyncClientProxy *proxy = ctx->proxy;
   OSyncError *error = NULL;
   OSyncError *locerror = NULL;
+  GSource *source = NULL;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, message, user_data);
 	
+  /* An aborted initialize must not start another client */
+  if (ctx->init_message && !proxy->aborted && osync_message_get_cmd(message) != OSYNC_MESSAGE_REPLY) {
+    if (osync_message_get_cmd(message) == OSYNC_MESSAGE_ERRORREPLY) {
+      osync_demarshal_error(message, &error);
+      osync_trace(TRACE_INTERNAL, "Unable to reset leased client, starting a new one: %s", osync_error_print(&error));
+      osync_error_unref(&error);
+    }
+		
+    /* The queue of the leased client is still dispatching this reply */
+    source = g_idle_source_new();
+    g_source_set_callback(source, _osync_client_proxy_respawn, ctx, NULL);
+    g_source_attach(source, proxy->context);
+    g_source_unref(source);
+		
+    osync_trace(TRACE_EXIT, "%s: respawning", __func__);
+    return;
+  }
+	
+  if (ctx->init_message) {
+    osync_message_unref(ctx->init_message);
+    ctx->init_message = NULL;
+  }
+	
   if (osync_message_get_cmd(message) == OSYNC_MESSAGE_REPLY) {
+    /* Grant the client its window of changes. This also resets the
+       credits left over by a client which got leased from a pool. */
+    if (!osync_queue_set_change_window(proxy->incoming, proxy->outgoing, proxy->change_window, &locerror))
+      goto error;
+
+    if (proxy->pool)
+      proxy->reusable = TRUE;
     ctx->init_callback(proxy, ctx->init_callback_data, NULL);
   } else if (osync_message_get_cmd(message) == OSYNC_MESSAGE_ERRORREPLY) {
     osync_demarshal_error(message, &error);
@@ -309,6 +398,58 @@ static void _osync_client_proxy_fin_handler(OSyncMessage *message, void *user_da
   return;
 }
 
+/* Reply to the reset which replaces the finalize request of a pooled client.
+ * If the client can't be reset, it gets finalized the regular way and won't
+ * be returned to the pool. */
+static void _osync_client_proxy_reset_handler(OSyncMessage *message, void *user_data)
+{
+  callContext *ctx = user_data;
+  OSyncClientProxy *proxy = ctx->proxy;
+  OSyncMessage *finalize = NULL;
+  OSyncError *error = NULL;
+  OSyncError *locerror = NULL;
+	
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, message, user_data);
+	
+  if (osync_message_get_cmd(message) == OSYNC_MESSAGE_REPLY) {
+    ctx->fin_callback(proxy, ctx->fin_callback_data, NULL);
+    g_free(ctx);
+    osync_trace(TRACE_EXIT, "%s", __func__);
+    return;
+  }
+	
+  proxy->reusable = FALSE;
+	
+  if (osync_message_get_cmd(message) == OSYNC_MESSAGE_ERRORREPLY) {
+    osync_demarshal_error(message, &error);
+    osync_trace(TRACE_INTERNAL, "Unable to reset client, finalizing it: %s", osync_error_print(&error));
+    osync_error_unref(&error);
+  }
+	
+  finalize = osync_message_new(OSYNC_MESSAGE_FINALIZE, 0, &locerror);
+  if (!finalize)
+    goto error;
+	
+  osync_message_set_handler(finalize, _osync_client_proxy_fin_handler, ctx);
+	
+  if (!osync_queue_send_message_with_timeout(proxy->outgoing, proxy->incoming, finalize, proxy->timeout.finalize, &locerror)) {
+    osync_message_unref(finalize);
+    goto error;
+  }
+	
+  osync_message_unref(finalize);
+	
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return;
+	
+ error:
+  ctx->fin_callback(proxy, ctx->fin_callback_data, locerror);
+  g_free(ctx);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&locerror));
+  osync_error_unref(&locerror);
+  return;
+}
+
 static void _osync_client_proxy_discover_handler(OSyncMessage *message, void *user_data)
 {
   callContext *ctx = user_data;
@@ -758,6 +899,7 @@ OSyncClientProxy *osync_client_proxy_new(OSyncFormatEnv *formatenv, OSyncMember
   proxy->ref_count = 1;
   proxy->type = OSYNC_START_TYPE_UNKNOWN;
   proxy->formatenv = formatenv;
+  proxy->change_window = OSYNC_CLIENT_PROXY_CHANGE_WINDOW_DEFAULT;
 	
   /* TODO: Is member optional parameter? */
   if (member) {
@@ -803,6 +945,12 @@ void osync_client_proxy_unref(OSyncClientProxy *proxy)
     if (proxy->context)
       g_main_context_unref(proxy->context);
 		
+    if (proxy->pool)
+      osync_client_pool_unref(proxy->pool);
+		
+    if (proxy->pool_key)
+      g_free(proxy->pool_key);
+		
     g_free(proxy);
   }
 }
@@ -830,7 +978,29 @@ OSyncMember *osync_client_proxy_get_member(OSyncClientProxy *proxy)
   return proxy->member;
 }
 
-osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type, const char *path, OSyncError **error)
+void osync_client_proxy_set_pool(OSyncClientProxy *proxy, OSyncClientPool *pool)
+{
+  osync_assert(proxy);
+	
+  if (pool)
+    osync_client_pool_ref(pool);
+	
+  if (proxy->pool)
+    osync_client_pool_unref(proxy->pool);
+	
+  proxy->pool = pool;
+}
+
+static void _osync_client_proxy_attach_queues(OSyncClientProxy *proxy)
+{
+  osync_queue_set_message_handler(proxy->incoming, _osync_client_proxy_message_handler, proxy);
+  osync_queue_setup_with_gmainloop(proxy->incoming, proxy->context);
+	
+  osync_queue_set_message_handler(proxy->outgoing, _osync_client_proxy_hup_handler, proxy);
+  osync_queue_setup_with_gmainloop(proxy->outgoing, proxy->context);
+}
+
+static osync_bool _osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type, const char *path, OSyncError **error)
 {
   OSyncQueue *read1 = NULL;
   OSyncQueue *read2 = NULL;
@@ -842,10 +1012,6 @@ osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type
   char *name = NULL;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %i, %s, %p)", __func__, proxy, type, path, error);
-  osync_assert(proxy);
-  osync_assert(type != OSYNC_START_TYPE_UNKNOWN);
-		
-  proxy->type = type;
 	
   if (type != OSYNC_START_TYPE_EXTERNAL) {
     // First, create the pipe from the engine to the client
@@ -965,11 +1131,7 @@ osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type
       goto error;
   }
 	
-  osync_queue_set_message_handler(proxy->incoming, _osync_client_proxy_message_handler, proxy);
-  osync_queue_setup_with_gmainloop(proxy->incoming, proxy->context);
-	
-  osync_queue_set_message_handler(proxy->outgoing, _osync_client_proxy_hup_handler, proxy);
-  osync_queue_setup_with_gmainloop(proxy->outgoing, proxy->context);
+  _osync_client_proxy_attach_queues(proxy);
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -985,12 +1147,180 @@ osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type
   return FALSE;
 }
 
+osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type, const char *path, OSyncError **error)
+{
+  osync_assert(proxy);
+  osync_assert(type != OSYNC_START_TYPE_UNKNOWN);
+		
+  proxy->type = type;
+	
+  /* Which pooled client fits can only be told from the initialize request */
+  if (proxy->pool && type != OSYNC_START_TYPE_EXTERNAL) {
+    osync_trace(TRACE_INTERNAL, "Deferring start of client until initialize");
+    proxy->spawn_deferred = TRUE;
+    return TRUE;
+  }
+	
+  return _osync_client_proxy_spawn(proxy, type, path, error);
+}
+
+/* Leases an idle client which got initialized with the same request from the
+ * pool, or starts a new one. Returns the message which has to be sent to the
+ * client: a reset for a leased client, otherwise the initialize request.
+ * *leased gets set if a reset got returned. */
+static OSyncMessage *_osync_client_proxy_lease(OSyncClientProxy *proxy, OSyncMessage *message, osync_bool *leased, OSyncError **error)
+{
+  OSyncClientWorker *worker = NULL;
+  OSyncMessage *reset = NULL;
+  char *data = NULL;
+  unsigned int size = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %p)", __func__, proxy, message, leased, error);
+	
+  *leased = FALSE;
+  osync_message_get_buffer(message, &data, &size);
+	
+  proxy->pool_key = osync_try_malloc0(size, error);
+  if (!proxy->pool_key)
+    goto error;
+  memcpy(proxy->pool_key, data, size);
+  proxy->pool_keysize = size;
+	
+  worker = osync_client_pool_lease(proxy->pool, proxy->type, proxy->pool_key, proxy->pool_keysize);
+  if (worker) {
+    reset = osync_message_new(OSYNC_MESSAGE_RESET, 0, error);
+    if (!reset) {
+      osync_client_pool_release(proxy->pool, worker);
+      goto error;
+    }
+		
+    osync_client_worker_get_connection(worker, &proxy->incoming, &proxy->outgoing, &proxy->child_pid, &proxy->client);
+    osync_client_worker_free(worker);
+		
+    _osync_client_proxy_attach_queues(proxy);
+    proxy->spawn_deferred = FALSE;
+    *leased = TRUE;
+		
+    osync_trace(TRACE_EXIT, "%s: leased %p", __func__, reset);
+    return reset;
+  }
+	
+  if (!_osync_client_proxy_spawn(proxy, proxy->type, NULL, error))
+    goto error;
+  proxy->spawn_deferred = FALSE;
+	
+  osync_message_ref(message);
+	
+  osync_trace(TRACE_EXIT, "%s: spawned %p", __func__, message);
+  return message;
+	
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+/* Hands the connection to a reset client over to the pool */
+static osync_bool _osync_client_proxy_release(OSyncClientProxy *proxy, OSyncError **error)
+{
+  OSyncClientWorker *worker = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, proxy, error);
+	
+  worker = osync_client_worker_new(proxy->type, proxy->pool_key, proxy->pool_keysize, error);
+  if (!worker)
+    goto error;
+	
+  osync_client_worker_set_connection(worker, proxy->incoming, proxy->outgoing, proxy->child_pid, proxy->client);
+  osync_client_worker_set_finalize_timeout(worker, proxy->timeout.finalize);
+  proxy->incoming = NULL;
+  proxy->outgoing = NULL;
+  proxy->child_pid = 0;
+  proxy->client = NULL;
+  proxy->reusable = FALSE;
+	
+  osync_client_pool_release(proxy->pool, worker);
+	
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+	
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+/* Stops a client which didn't answer its requests after an abort. It won't
+ * answer the HUP either, so nothing gets waited for. */
+static osync_bool _osync_client_proxy_kill(OSyncClientProxy *proxy, OSyncError **error)
+{
+  int status = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, proxy, error);
+	
+  if (osync_queue_is_connected(proxy->incoming) && !osync_queue_disconnect(proxy->incoming, error))
+    goto error;
+	
+  if (osync_queue_is_connected(proxy->outgoing) && !osync_queue_disconnect(proxy->outgoing, error))
+    goto error;
+	
+  if (proxy->type == OSYNC_START_TYPE_THREAD && proxy->client) {
+    /* The thread can't be joined while the plugin hangs. Leave it behind,
+       together with the client it still uses. */
+    osync_trace(TRACE_ERROR, "Leaving unresponsive client thread behind");
+    proxy->client = NULL;
+  } else if (proxy->type == OSYNC_START_TYPE_PROCESS && proxy->child_pid) {
+#ifndef _WIN32
+    if (kill(proxy->child_pid, SIGKILL) == -1)
+      osync_trace(TRACE_INTERNAL, "Unable to kill osplugin process: %s", g_strerror(errno));
+		
+    if (waitpid(proxy->child_pid, &status, 0) == -1) {
+      osync_error_set(error, OSYNC_ERROR_GENERIC, "Error waiting for osplugin process: %s", g_strerror(errno));
+      goto error;
+    }
+#endif //_WIN32
+    proxy->child_pid = 0;
+  }
+	
+  osync_queue_free(proxy->incoming);
+  osync_queue_free(proxy->outgoing);
+  proxy->incoming = NULL;
+  proxy->outgoing = NULL;
+	
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+	
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
 osync_bool osync_client_proxy_shutdown(OSyncClientProxy *proxy, OSyncError **error)
 {
   OSyncMessage *message = NULL;
   int status = 0;
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, proxy, error);
 	
+  /* The client never got started */
+  if (proxy->spawn_deferred) {
+    proxy->spawn_deferred = FALSE;
+    osync_trace(TRACE_EXIT, "%s: nothing to shut down", __func__);
+    return TRUE;
+  }
+	
+  if (proxy->pool && proxy->reusable && osync_queue_is_connected(proxy->incoming) && osync_queue_is_connected(proxy->outgoing)) {
+    if (_osync_client_proxy_release(proxy, error)) {
+      osync_trace(TRACE_EXIT, "%s: returned to pool", __func__);
+      return TRUE;
+    }
+		
+    osync_trace(TRACE_INTERNAL, "Unable to return client to pool: %s", osync_error_print(error));
+    osync_error_unref(error);
+  }
+	
+  if (proxy->aborted) {
+    if (!_osync_client_proxy_kill(proxy, error))
+      goto error;
+		
+    osync_trace(TRACE_EXIT, "%s: killed", __func__);
+    return TRUE;
+  }
+	
   /* We first disconnect our reading queue. This will generate a HUP
    * on the remote side */
   if (!osync_queue_disconnect(proxy->incoming, error))
@@ -1084,6 +1414,8 @@ osync_bool osync_client_proxy_initialize(OSyncClientProxy *proxy, initialize_cb
   callContext *ctx = NULL;
   int haspluginconfig = config ? TRUE : FALSE;
   OSyncMessage *message = NULL;
+  OSyncMessage *request = NULL;
+  osync_bool leased = FALSE;
   long long int memberid = 0; 
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %s, %s, %s, %s, %p, %p)", __func__, proxy, callback, userdata, formatdir, plugindir, plugin, groupname, configdir, config, error);
@@ -1102,7 +1434,8 @@ osync_bool osync_client_proxy_initialize(OSyncClientProxy *proxy, initialize_cb
   if (!message)
     goto error;
 	
-  osync_message_write_string(message, osync_queue_get_path(proxy->incoming));
+  /* A deferred client gets connected by anonymous pipes, which have no path */
+  osync_message_write_string(message, proxy->incoming ? osync_queue_get_path(proxy->incoming) : NULL);
   osync_message_write_string(message, formatdir);
   osync_message_write_string(message, plugindir);
   osync_message_write_string(message, plugin);
@@ -1146,6 +1479,19 @@ osync_bool osync_client_proxy_initialize(OSyncClientProxy *proxy, initialize_cb
   osync_message_write_long_long_int(message, memberid);
 #endif	
 	
+  if (proxy->spawn_deferred) {
+    request = _osync_client_proxy_lease(proxy, message, &leased, error);
+    if (!request)
+      goto error_free_message;
+		
+    /* Kept for a fresh client in case the leased one can't be reset */
+    if (leased)
+      ctx->init_message = message;
+    else
+      osync_message_unref(message);
+    message = request;
+  }
+	
   osync_message_set_handler(message, _osync_client_proxy_init_handler, ctx);
 	
   if (!osync_queue_send_message_with_timeout(proxy->outgoing, proxy->incoming, message, proxy->timeout.initialize, error))
@@ -1164,11 +1510,25 @@ osync_bool osync_client_proxy_initialize(OSyncClientProxy *proxy, initialize_cb
 
  error_free_message:
   osync_message_unref(message);
+  if (ctx->init_message)
+    osync_message_unref(ctx->init_message);
  error:
   osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
   return FALSE;
 }
 
+void osync_client_proxy_set_change_window(OSyncClientProxy *proxy, unsigned int window)
+{
+  osync_assert(proxy);
+  proxy->change_window = window;
+}
+
+unsigned int osync_client_proxy_get_change_window(OSyncClientProxy *proxy)
+{
+  osync_assert(proxy);
+  return proxy->change_window;
+}
+
 unsigned int osync_client_proxy_get_initialize_timeout(OSyncClientProxy *proxy)
 {
   osync_assert(proxy);
@@ -1188,6 +1548,14 @@ osync_bool osync_client_proxy_finalize(OSyncClientProxy *proxy, finalize_cb call
 
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %p)", __func__, proxy, callback, userdata, error);
 	
+  /* A client which didn't answer after an abort won't answer this either.
+     It gets stopped by osync_client_proxy_shutdown(). */
+  if (proxy->aborted) {
+    callback(proxy, userdata, NULL);
+    osync_trace(TRACE_EXIT, "%s: client got aborted", __func__);
+    return TRUE;
+  }
+	
   ctx = osync_try_malloc0(sizeof(callContext), error);
   if (!ctx)
     goto error;
@@ -1196,11 +1564,20 @@ osync_bool osync_client_proxy_finalize(OSyncClientProxy *proxy, finalize_cb call
   ctx->fin_callback = callback;
   ctx->fin_callback_data = userdata;
 	
-  message = osync_message_new(OSYNC_MESSAGE_FINALIZE, 0, error);
-  if (!message)
-    goto error;
+  /* A pooled client keeps its plugin initialized for the next session */
+  if (proxy->reusable) {
+    message = osync_message_new(OSYNC_MESSAGE_RESET, 0, error);
+    if (!message)
+      goto error;
+		
+    osync_message_set_handler(message, _osync_client_proxy_reset_handler, ctx);
+  } else {
+    message = osync_message_new(OSYNC_MESSAGE_FINALIZE, 0, error);
+    if (!message)
+      goto error;
 
-  osync_message_set_handler(message, _osync_client_proxy_fin_handler, ctx);
+    osync_message_set_handler(message, _osync_client_proxy_fin_handler, ctx);
+  }
 	
   if (!osync_queue_send_message_with_timeout(proxy->outgoing, proxy->incoming, message, proxy->timeout.finalize, error))
     goto error_free_message;
@@ -1313,6 +1690,67 @@ OSyncObjTypeSink *osync_client_proxy_find_objtype_sink(OSyncClientProxy *proxy,
   return NULL;
 }
 
+static osync_bool _osync_client_proxy_send_cancel(OSyncClientProxy *proxy, osync_bool cancel, OSyncError **error)
+{
+  OSyncMessage *message = NULL;
+
+  message = osync_message_new(OSYNC_MESSAGE_CANCEL, 0, error);
+  if (!message)
+    return FALSE;
+
+  osync_message_write_int(message, cancel);
+
+  /* No reply, the flag gets set by the reading thread of the client */
+  if (!osync_queue_send_message(proxy->outgoing, NULL, message, error)) {
+    osync_message_unref(message);
+    return FALSE;
+  }
+
+  osync_message_unref(message);
+  proxy->cancelled = cancel;
+  return TRUE;
+}
+
+osync_bool osync_client_proxy_cancel(OSyncClientProxy *proxy, OSyncError **error)
+{
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, proxy, error);
+  osync_assert(proxy);
+
+  if (!proxy->outgoing || !osync_queue_is_connected(proxy->outgoing)) {
+    osync_trace(TRACE_EXIT, "%s: client not running", __func__);
+    return TRUE;
+  }
+
+  if (!_osync_client_proxy_send_cancel(proxy, TRUE, error))
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+unsigned int osync_client_proxy_abort(OSyncClientProxy *proxy, OSyncError *error)
+{
+  unsigned int failed = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, proxy, error);
+  osync_assert(proxy);
+
+  proxy->reusable = FALSE;
+
+  if (proxy->incoming)
+    failed = osync_queue_fail_pending(proxy->incoming, error);
+
+  /* The client didn't answer within the abort timeout */
+  if (failed)
+    proxy->aborted = TRUE;
+
+  osync_trace(TRACE_EXIT, "%s: %u", __func__, failed);
+  return failed;
+}
+
 osync_bool osync_client_proxy_connect(OSyncClientProxy *proxy, connect_cb callback, void *userdata, const char *objtype, osync_bool slowsync, OSyncError **error)
 {
   int timeout = 0;
@@ -1324,6 +1762,10 @@ osync_bool osync_client_proxy_connect(OSyncClientProxy *proxy, connect_cb callba
 	
   timeout = OSYNC_CLIENT_PROXY_TIMEOUT_CONNECT;
 
+  /* A new synchronization starts, the last one might have got cancelled */
+  if (proxy->cancelled && !_osync_client_proxy_send_cancel(proxy, FALSE, error))
+    goto error;
+
   ctx = osync_try_malloc0(sizeof(callContext), error);
   if (!ctx)
     goto error;
@@ -21,6 +21,9 @@
 #ifndef OSYNC_CLIENT_PROXY_INTERNALS_H_
 #define OSYNC_CLIENT_PROXY_INTERNALS_H_
 
+/** Number of changes a client may report ahead of the engine by default */
+#define OSYNC_CLIENT_PROXY_CHANGE_WINDOW_DEFAULT	256
+
 typedef void (* proxy_init_cb) (OSyncClientProxy *proxy, void *userdata);
 
 typedef void (* initialize_cb) (OSyncClientProxy *proxy, void *userdata, OSyncError *error);
@@ -43,6 +46,19 @@ void osync_client_proxy_set_context(OSyncClientProxy *proxy, GMainContext *ctx);
 void osync_client_proxy_set_change_callback(OSyncClientProxy *proxy, change_cb cb, void *userdata);
 OSyncMember *osync_client_proxy_get_member(OSyncClientProxy *proxy);
 
+/*! @brief Lease the client from a pool and return it to the pool on shutdown
+ *
+ * Must be set before osync_client_proxy_spawn(). With a pool set, starting
+ * a process or thread client gets deferred to osync_client_proxy_initialize(),
+ * which leases an idle client initialized with the same request if there is
+ * one. osync_client_proxy_finalize() then only resets the client and
+ * osync_client_proxy_shutdown() returns it to the pool.
+ *
+ * @param proxy The client proxy
+ * @param pool The client pool or NULL
+ */
+OSYNC_TEST_EXPORT void osync_client_proxy_set_pool(OSyncClientProxy *proxy, OSyncClientPool *pool);
+
 OSYNC_TEST_EXPORT osync_bool osync_client_proxy_spawn(OSyncClientProxy *proxy, OSyncStartType type, const char *path, OSyncError **error);
 OSYNC_TEST_EXPORT osync_bool osync_client_proxy_shutdown(OSyncClientProxy *proxy, OSyncError **error);
 
@@ -58,6 +74,17 @@ OSYNC_TEST_EXPORT osync_bool osync_client_proxy_discover(OSyncClientProxy *proxy
 void osync_client_proxy_set_discover_timeout(OSyncClientProxy *proxy, unsigned int timeout);
 unsigned int osync_client_proxy_get_discover_timeout(OSyncClientProxy *proxy);
 
+/*! @brief Set the number of changes the client may send ahead during get_changes
+ *
+ * The client blocks reporting further changes until the engine processed
+ * some of them. Takes effect on the next initialize.
+ *
+ * @param proxy The client proxy
+ * @param window Number of changes in flight, 0 for unlimited
+ */
+void osync_client_proxy_set_change_window(OSyncClientProxy *proxy, unsigned int window);
+unsigned int osync_client_proxy_get_change_window(OSyncClientProxy *proxy);
+
 OSYNC_TEST_EXPORT int osync_client_proxy_num_objtypes(OSyncClientProxy *proxy);
 OSYNC_TEST_EXPORT OSyncObjTypeSink *osync_client_proxy_nth_objtype(OSyncClientProxy *proxy, int nth);
 OSyncObjTypeSink *osync_client_proxy_find_objtype_sink(OSyncClientProxy *proxy, const char *objtype);
@@ -72,5 +99,33 @@ osync_bool osync_client_proxy_committed_all(OSyncClientProxy *proxy, committed_a
 
 osync_bool osync_client_proxy_sync_done(OSyncClientProxy *proxy, sync_done_cb callback, void *userdata, const char *objtype, OSyncError **error);
 
+/*! @brief Ask the client to cancel the requests of the current synchronization
+ *
+ * The client sets its cancellation flag as soon as the message arrives,
+ * plugins see it through osync_plugin_info_is_cancelled() and
+ * osync_context_is_cancelled(). The flag gets cleared again with the
+ * next connect.
+ *
+ * @param proxy The client proxy
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+OSYNC_TEST_EXPORT osync_bool osync_client_proxy_cancel(OSyncClientProxy *proxy, OSyncError **error);
+
+/*! @brief Stop waiting for the replies of the client
+ *
+ * All requests which are still in flight fail right away with error.
+ * The client doesn't get returned to a client pool afterwards, since
+ * it might still be busy with one of them. If any request failed, the
+ * client is considered hung: osync_client_proxy_finalize() doesn't
+ * wait for it anymore and osync_client_proxy_shutdown() kills the
+ * process or leaves the thread behind instead of blocking on it.
+ *
+ * @param proxy The client proxy
+ * @param error The error to report for the requests
+ * @returns the number of failed requests
+ */
+OSYNC_TEST_EXPORT unsigned int osync_client_proxy_abort(OSyncClientProxy *proxy, OSyncError *error);
+
 #endif /* OSYNC_CLIENT_PROXY_INTERNALS_H_ */
 
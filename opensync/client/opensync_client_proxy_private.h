@@ -71,6 +71,25 @@
 		
 		change_cb change_callback;
 		void *change_callback_data;
+
+		/** Optional pool the client gets leased from and returned to */
+		OSyncClientPool *pool;
+		/** Start of the client is deferred until the initialize request is known */
+		osync_bool spawn_deferred;
+		/** Serialized initialize request, used to find a matching idle client */
+		char *pool_key;
+		unsigned int pool_keysize;
+		/** TRUE if the client can be returned to the pool on shutdown */
+		osync_bool reusable;
+
+		/** Number of changes the client may send ahead, 0 for unlimited */
+		unsigned int change_window;
+
+		/** TRUE once the client got asked to cancel, cleared on the next connect */
+		osync_bool cancelled;
+
+		/** TRUE once the pending requests got failed by an abort */
+		osync_bool aborted;
 	};
 
 #endif /*OSYNC_CLIENT_PROXY_PRIVATE_H_*/
@@ -33,7 +33,7 @@
 
 OSyncChange *osync_change_new(OSyncError **error)
 {
-  OSyncChange *change = osync_try_malloc0(sizeof(OSyncChange), error);
+  OSyncChange *change = osync_try_slice_alloc0(sizeof(OSyncChange), error);
   if (!change)
     return NULL;
 		
@@ -65,7 +65,7 @@ void osync_change_unref(OSyncChange *change)
     if (change->hash)
       g_free(change->hash);
 		
-    g_free(change);
+    osync_slice_free(sizeof(OSyncChange), change);
   }
 }
 
@@ -30,7 +30,7 @@
 
 OSyncData *osync_data_new(char *buffer, unsigned int size, OSyncObjFormat *format, OSyncError **error)
 {
-  OSyncData *data = osync_try_malloc0(sizeof(OSyncData), error);
+  OSyncData *data = osync_try_slice_alloc0(sizeof(OSyncData), error);
   if (!data)
     return NULL;
 	
@@ -68,7 +68,7 @@ void osync_data_unref(OSyncData *data)
     if (data->objtype)
       g_free(data->objtype);
 		
-    g_free(data);
+    osync_slice_free(sizeof(OSyncData), data);
   }
 }
 
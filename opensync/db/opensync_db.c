@@ -24,6 +24,21 @@
 #include "opensync_db.h"
 #include "opensync_db_private.h"
 
+static void _osync_db_stop_writer(OSyncDB *db);
+
+/* Waits until the writer committed all queued operations. The caller
+   is the only one queueing, the writer stays idle until it returns. */
+static void _osync_db_wait(OSyncDB *db)
+{
+  if (!db->writer)
+    return;
+
+  g_mutex_lock(db->mutex);
+  while (g_atomic_int_get(&db->pending))
+    g_cond_wait(db->idle, db->mutex);
+  g_mutex_unlock(db->mutex);
+}
+
 /*
   static void _osync_db_trace(void *data, const char *query)
   {
@@ -42,6 +57,8 @@ OSyncDB *osync_db_new(OSyncError **error)
     return NULL;
   }
 
+  db->tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
   osync_trace(TRACE_EXIT, "%s: %p", __func__, db);
   return db;
 }
@@ -69,6 +86,13 @@ osync_bool osync_db_close(OSyncDB *db, OSyncError **error)
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, db, error);
 
   osync_assert(db);
+
+  _osync_db_stop_writer(db);
+
+  if (db->tables) {
+    g_hash_table_destroy(db->tables);
+    db->tables = NULL;
+  }
 	
   rc = sqlite3_close(db->sqlite3db);
   if (rc) {
@@ -90,6 +114,8 @@ int osync_db_count(OSyncDB *db, const char *query, OSyncError **error)
   osync_assert(db);
   osync_assert(query);
 
+  _osync_db_wait(db);
+
   if (sqlite3_get_table(db->sqlite3db, query, &result, &num, NULL, &errmsg) != SQLITE_OK) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable count result of query: %s", errmsg);
     sqlite3_free_table(result);
@@ -103,7 +129,7 @@ int osync_db_count(OSyncDB *db, const char *query, OSyncError **error)
   return num;
 }
 
-osync_bool osync_db_query(OSyncDB *db, const char *query, OSyncError **error)
+static osync_bool _osync_db_query(OSyncDB *db, const char *query, OSyncError **error)
 {
   char *errmsg = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, db, query, error);
@@ -122,6 +148,15 @@ osync_bool osync_db_query(OSyncDB *db, const char *query, OSyncError **error)
   return TRUE;
 }
 
+osync_bool osync_db_query(OSyncDB *db, const char *query, OSyncError **error)
+{
+  osync_assert(db);
+
+  _osync_db_wait(db);
+
+  return _osync_db_query(db, query, error);
+}
+
 OSyncList *osync_db_query_table(OSyncDB *db, const char *query, OSyncError **error)
 {
   OSyncList *table = NULL;
@@ -134,6 +169,8 @@ OSyncList *osync_db_query_table(OSyncDB *db, const char *query, OSyncError **err
   osync_assert(db);
   osync_assert(query);
 
+  _osync_db_wait(db);
+
   if (sqlite3_get_table(db->sqlite3db, query, &result, &numrows, &numcolumns, &errmsg) != SQLITE_OK) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to query table: %s", errmsg);
     sqlite3_free(errmsg);
@@ -191,6 +228,8 @@ char *osync_db_query_single_string(OSyncDB *db, const char *query, OSyncError **
   osync_assert(db);
   osync_assert(query);
 
+  _osync_db_wait(db);
+
   if (sqlite3_prepare(db->sqlite3db, query, -1, &ppStmt, NULL) != SQLITE_OK) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "Query Error: %s", sqlite3_errmsg(db->sqlite3db));
     goto error;
@@ -231,6 +270,8 @@ int osync_db_query_single_int(OSyncDB *db, const char *query, OSyncError **error
   osync_assert(db);
   osync_assert(query);
 
+  _osync_db_wait(db);
+
   if (sqlite3_prepare(db->sqlite3db, query, -1, &ppStmt, NULL) != SQLITE_OK) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "Query Error: %s", sqlite3_errmsg(db->sqlite3db));
     goto error;
@@ -291,6 +332,8 @@ osync_bool osync_db_reset_full(OSyncDB *db, OSyncError **error)
 
   osync_assert(db);
 
+  _osync_db_wait(db);
+
   query = g_strdup("SELECT name FROM (SELECT * FROM sqlite_master) WHERE type='table'");
 
   if (sqlite3_prepare(db->sqlite3db, query, -1, &ppStmt, NULL) != SQLITE_OK) {
@@ -346,6 +389,14 @@ int osync_db_table_exists(OSyncDB *db, const char *tablename, OSyncError **error
   osync_assert(db);
   osync_assert(tablename);
 
+  /* Tables never get dropped, a known table needs no query */
+  if (g_hash_table_lookup(db->tables, tablename)) {
+    osync_trace(TRACE_EXIT, "%s: table \"%s\" exists.", __func__, tablename);
+    return 1;
+  }
+
+  _osync_db_wait(db);
+
   query = g_strdup_printf("SELECT name FROM (SELECT * FROM sqlite_master UNION ALL SELECT * FROM sqlite_temp_master) WHERE type='table' AND name='%s'",
                           tablename);
 
@@ -369,12 +420,14 @@ int osync_db_table_exists(OSyncDB *db, const char *tablename, OSyncError **error
 
   sqlite3_finalize(ppStmt);
   g_free(query);
+
+  g_hash_table_insert(db->tables, g_strdup(tablename), GINT_TO_POINTER(1));
 	
   osync_trace(TRACE_EXIT, "%s: table \"%s\" exists.", __func__, tablename);
   return 1;
 }
 
-osync_bool osync_db_bind_blob(OSyncDB *db, const char *query, const char *data, unsigned int size, OSyncError **error)
+static osync_bool _osync_db_bind_blob(OSyncDB *db, const char *query, const char *data, unsigned int size, OSyncError **error)
 {
   sqlite3_stmt *sqlite_stmt = NULL;
   int rc = 0;
@@ -423,6 +476,15 @@ osync_bool osync_db_bind_blob(OSyncDB *db, const char *query, const char *data,
   return FALSE;
 }
 
+osync_bool osync_db_bind_blob(OSyncDB *db, const char *query, const char *data, unsigned int size, OSyncError **error)
+{
+  osync_assert(db);
+
+  _osync_db_wait(db);
+
+  return _osync_db_bind_blob(db, query, data, size, error);
+}
+
 int osync_db_get_blob(OSyncDB *db, const char *query, char **data, unsigned int *size, OSyncError **error)
 {
   sqlite3_stmt *sqlite_stmt = NULL;
@@ -436,6 +498,8 @@ int osync_db_get_blob(OSyncDB *db, const char *query, char **data, unsigned int
   osync_assert(data);
   osync_assert(size);
 
+  _osync_db_wait(db);
+
   rc = sqlite3_prepare(db->sqlite3db, query, -1, &sqlite_stmt, NULL);
   if(rc != SQLITE_OK)
     goto error_msg;
@@ -486,12 +550,391 @@ int osync_db_get_blob(OSyncDB *db, const char *query, char **data, unsigned int
   return -1;
 }
 
+OSyncDBCursor *osync_db_cursor_new(OSyncDB *db, const char *query, OSyncError **error)
+{
+  OSyncDBCursor *cursor = NULL;
+  int rc = 0;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, db, query, error);
+
+  osync_assert(db);
+  osync_assert(query);
+
+  cursor = osync_try_malloc0(sizeof(OSyncDBCursor), error);
+  if (!cursor)
+    goto error;
+
+  cursor->db = db;
+
+  _osync_db_wait(db);
+
+  /* Cursors can be kept as prepared statements, _v2 prepares them
+   * again if the schema got changed meanwhile */
+  rc = sqlite3_prepare_v2(db->sqlite3db, query, -1, &cursor->stmt, NULL);
+  if (rc != SQLITE_OK) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to prepare query: %s", sqlite3_errmsg(db->sqlite3db));
+    goto error_free_cursor;
+  }
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, cursor);
+  return cursor;
+
+ error_free_cursor:
+  osync_db_cursor_free(cursor);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+int osync_db_cursor_next(OSyncDBCursor *cursor, OSyncError **error)
+{
+  int rc = 0;
+
+  osync_assert(cursor);
+
+  rc = sqlite3_step(cursor->stmt);
+  if (rc == SQLITE_ROW)
+    return 1;
+
+  if (rc == SQLITE_DONE)
+    return 0;
+
+  osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to step over result: %s", sqlite3_errmsg(cursor->db->sqlite3db));
+  osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return -1;
+}
+
+osync_bool osync_db_cursor_bind_string(OSyncDBCursor *cursor, unsigned int param, const char *value, OSyncError **error)
+{
+  int rc = 0;
+
+  osync_assert(cursor);
+
+  if (value)
+    rc = sqlite3_bind_text(cursor->stmt, param, value, -1, SQLITE_TRANSIENT);
+  else
+    rc = sqlite3_bind_null(cursor->stmt, param);
+
+  if (rc != SQLITE_OK) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to bind parameter %u: %s", param, sqlite3_errmsg(cursor->db->sqlite3db));
+    osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(error));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void osync_db_cursor_reset(OSyncDBCursor *cursor)
+{
+  osync_assert(cursor);
+
+  _osync_db_wait(cursor->db);
+
+  sqlite3_reset(cursor->stmt);
+  sqlite3_clear_bindings(cursor->stmt);
+}
+
+long long int osync_db_cursor_get_int64(OSyncDBCursor *cursor, unsigned int column)
+{
+  osync_assert(cursor);
+
+  return sqlite3_column_int64(cursor->stmt, column);
+}
+
+const char *osync_db_cursor_get_string(OSyncDBCursor *cursor, unsigned int column)
+{
+  osync_assert(cursor);
+
+  return (const char *)sqlite3_column_text(cursor->stmt, column);
+}
+
+void osync_db_cursor_free(OSyncDBCursor *cursor)
+{
+  osync_assert(cursor);
+
+  if (cursor->stmt)
+    sqlite3_finalize(cursor->stmt);
+
+  g_free(cursor);
+}
+
 long long int osync_db_last_rowid(OSyncDB *db) {
   osync_assert(db);
 
+  _osync_db_wait(db);
+
   return sqlite3_last_insert_rowid(db->sqlite3db);
 }	
 
+static void _osync_db_operation_free(OSyncDBOperation *op)
+{
+  g_free(op->query);
+  g_free(op->data);
+  g_free(op);
+}
+
+/* Keeps the first error, osync_db_sync() reports it */
+static void _osync_db_writer_error(OSyncDB *db, OSyncError **error)
+{
+  osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(error));
+
+  if (!db->writer_error)
+    osync_error_set_from_error(&db->writer_error, error);
+
+  osync_error_unref(error);
+}
+
+static gpointer _osync_db_writer(gpointer userdata)
+{
+  OSyncDB *db = userdata;
+  OSyncDBOperation *op = NULL;
+  osync_bool stop = FALSE;
+
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, db);
+
+  while (!stop) {
+    OSyncError *locerror = NULL;
+    osync_bool transaction = TRUE;
+    int num = 0;
+
+    op = g_async_queue_pop(db->queue);
+
+    g_mutex_lock(db->mutex);
+
+    if (!_osync_db_query(db, "BEGIN TRANSACTION", &locerror)) {
+      _osync_db_writer_error(db, &locerror);
+      transaction = FALSE;
+    }
+
+    /* Group commit: what got queued meanwhile goes into the same transaction */
+    while (op) {
+      num++;
+
+      if (!op->query) {
+        stop = TRUE;
+      } else if (op->data) {
+        if (!_osync_db_bind_blob(db, op->query, op->data, op->size, &locerror))
+          _osync_db_writer_error(db, &locerror);
+      } else {
+        if (!_osync_db_query(db, op->query, &locerror))
+          _osync_db_writer_error(db, &locerror);
+      }
+
+      _osync_db_operation_free(op);
+
+      if (stop || num >= OSYNC_DB_GROUP_COMMIT)
+        break;
+
+      op = g_async_queue_try_pop(db->queue);
+    }
+
+    if (transaction && !_osync_db_query(db, "COMMIT TRANSACTION", &locerror)) {
+      _osync_db_writer_error(db, &locerror);
+      _osync_db_query(db, "ROLLBACK TRANSACTION", NULL);
+    }
+
+    g_atomic_int_add(&db->pending, -num);
+    g_cond_broadcast(db->idle);
+    g_mutex_unlock(db->mutex);
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return NULL;
+}
+
+static void _osync_db_push(OSyncDB *db, OSyncDBOperation *op)
+{
+  g_atomic_int_inc(&db->pending);
+  g_async_queue_push(db->queue, op);
+}
+
+static void _osync_db_stop_writer(OSyncDB *db)
+{
+  OSyncDBOperation *op = NULL;
+
+  if (!db->writer)
+    return;
+
+  /* Everything queued before gets written first */
+  op = g_malloc0(sizeof(OSyncDBOperation));
+  _osync_db_push(db, op);
+  g_thread_join(db->writer);
+  db->writer = NULL;
+
+  if (db->writer_error) {
+    osync_trace(TRACE_ERROR, "Unreported error of the database writer: %s", osync_error_print(&db->writer_error));
+    osync_error_unref(&db->writer_error);
+  }
+
+  g_async_queue_unref(db->queue);
+  g_mutex_free(db->mutex);
+  g_cond_free(db->idle);
+  db->queue = NULL;
+  db->mutex = NULL;
+  db->idle = NULL;
+}
+
+osync_bool osync_db_start_writer(OSyncDB *db, OSyncError **error)
+{
+  GError *gerror = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, db, error);
+  osync_assert(db);
+
+  if (db->writer) {
+    osync_trace(TRACE_EXIT, "%s: already started", __func__);
+    return TRUE;
+  }
+
+  /* The writer and the caller share the connection */
+  if (!sqlite3_threadsafe()) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "SQLite got built without thread support, unable to start the database writer");
+    goto error;
+  }
+
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
+  db->queue = g_async_queue_new();
+  db->mutex = g_mutex_new();
+  db->idle = g_cond_new();
+  db->pending = 0;
+
+  db->writer = g_thread_create(_osync_db_writer, db, TRUE, &gerror);
+  if (!db->writer) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to start the database writer: %s", gerror->message);
+    g_error_free(gerror);
+    g_async_queue_unref(db->queue);
+    g_mutex_free(db->mutex);
+    g_cond_free(db->idle);
+    db->queue = NULL;
+    db->mutex = NULL;
+    db->idle = NULL;
+    goto error;
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+osync_bool osync_db_queue(OSyncDB *db, const char *query, OSyncError **error)
+{
+  OSyncDBOperation *op = NULL;
+
+  osync_assert(db);
+  osync_assert(query);
+
+  if (!db->writer)
+    return osync_db_query(db, query, error);
+
+  op = osync_try_malloc0(sizeof(OSyncDBOperation), error);
+  if (!op)
+    return FALSE;
+
+  op->query = g_strdup(query);
+  _osync_db_push(db, op);
+  return TRUE;
+}
+
+osync_bool osync_db_queue_blob(OSyncDB *db, const char *query, const char *data, unsigned int size, OSyncError **error)
+{
+  OSyncDBOperation *op = NULL;
+
+  osync_assert(db);
+  osync_assert(query);
+  osync_assert(data);
+  osync_assert(size);
+
+  if (!db->writer)
+    return osync_db_bind_blob(db, query, data, size, error);
+
+  op = osync_try_malloc0(sizeof(OSyncDBOperation), error);
+  if (!op)
+    return FALSE;
+
+  op->data = g_try_malloc(size);
+  if (!op->data) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "No memory left");
+    g_free(op);
+    return FALSE;
+  }
+
+  memcpy(op->data, data, size);
+  op->size = size;
+  op->query = g_strdup(query);
+  _osync_db_push(db, op);
+  return TRUE;
+}
+
+osync_bool osync_db_sync(OSyncDB *db, OSyncError **error)
+{
+  osync_bool ret = TRUE;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, db, error);
+  osync_assert(db);
+
+  if (!db->writer) {
+    osync_trace(TRACE_EXIT, "%s: no writer", __func__);
+    return TRUE;
+  }
+
+  g_mutex_lock(db->mutex);
+  while (g_atomic_int_get(&db->pending))
+    g_cond_wait(db->idle, db->mutex);
+
+  if (db->writer_error) {
+    osync_error_set_from_error(error, &db->writer_error);
+    osync_error_unref(&db->writer_error);
+    ret = FALSE;
+  }
+  g_mutex_unlock(db->mutex);
+
+  if (!ret) {
+    osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+    return FALSE;
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+}
+
+osync_bool osync_db_set_wal(OSyncDB *db, osync_bool wal, OSyncError **error)
+{
+  const char *mode = wal ? "wal" : "delete";
+  char *query = NULL;
+  char *result = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p)", __func__, db, wal, error);
+  osync_assert(db);
+
+  /* Returns the journal mode which is active afterwards */
+  query = g_strdup_printf("PRAGMA journal_mode=%s", mode);
+  result = osync_db_query_single_string(db, query, error);
+  g_free(query);
+
+  if (osync_error_is_set(error))
+    goto error;
+
+  if (!result || g_ascii_strcasecmp(result, mode)) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to switch the database to journal mode %s", mode);
+    g_free(result);
+    goto error;
+  }
+
+  g_free(result);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
 char *osync_db_sql_escape(const char *query)
 {
   return osync_strreplace(query, "'", "''");
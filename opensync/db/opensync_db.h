@@ -158,9 +158,144 @@ OSYNC_EXPORT osync_bool osync_db_bind_blob(OSyncDB *db, const char *query, const
  */
 OSYNC_EXPORT int osync_db_get_blob(OSyncDB *db, const char *query, char **data, unsigned int *size, OSyncError **error);
 
+/**
+ * @brief Prepares a SQL query to step over its result row by row.
+ *
+ * Unlike osync_db_query_table() the result doesn't get copied. Only the
+ * current row is accessible, see osync_db_cursor_next().
+ *
+ * @param db Pointer to database struct
+ * @param query SQL database query 
+ * @param error Pointer to a error struct 
+ * @return Pointer to the new cursor or NULL on error. Free with osync_db_cursor_free()
+ */
+OSYNC_EXPORT OSyncDBCursor *osync_db_cursor_new(OSyncDB *db, const char *query, OSyncError **error);
+
+/**
+ * @brief Advances the cursor to the next row of the result.
+ *
+ * @param cursor Pointer to the cursor
+ * @param error Pointer to a error struct 
+ * @return 1 if a row is available, 0 if the result is exhausted, -1 on error.
+ */
+OSYNC_EXPORT int osync_db_cursor_next(OSyncDBCursor *cursor, OSyncError **error);
+
+/**
+ * @brief Binds a string to a parameter of the prepared query.
+ *
+ * Together with osync_db_cursor_reset() a cursor can be kept as prepared
+ * statement and executed again with other parameters.
+ *
+ * @param cursor Pointer to the cursor
+ * @param param Index of the parameter, starting at 1
+ * @param value The string to bind, gets copied. NULL binds SQL NULL
+ * @param error Pointer to a error struct 
+ * @return TRUE on success, FALSE otherwise
+ */
+OSYNC_EXPORT osync_bool osync_db_cursor_bind_string(OSyncDBCursor *cursor, unsigned int param, const char *value, OSyncError **error);
+
+/**
+ * @brief Rewinds the cursor and clears its bound parameters.
+ *
+ * @param cursor Pointer to the cursor
+ */
+OSYNC_EXPORT void osync_db_cursor_reset(OSyncDBCursor *cursor);
+
+/**
+ * @brief Gets a column of the current row as 64-bit integer.
+ *
+ * @param cursor Pointer to the cursor
+ * @param column Index of the column, starting at 0
+ * @return The value of the column
+ */
+OSYNC_EXPORT long long int osync_db_cursor_get_int64(OSyncDBCursor *cursor, unsigned int column);
+
+/**
+ * @brief Gets a column of the current row as string.
+ *
+ * The string is only valid until the next call of osync_db_cursor_next()
+ * or osync_db_cursor_free().
+ *
+ * @param cursor Pointer to the cursor
+ * @param column Index of the column, starting at 0
+ * @return The value of the column or NULL if the value is NULL
+ */
+OSYNC_EXPORT const char *osync_db_cursor_get_string(OSyncDBCursor *cursor, unsigned int column);
+
+/**
+ * @brief Frees a cursor and its prepared statement.
+ *
+ * @param cursor Pointer to the cursor
+ */
+OSYNC_EXPORT void osync_db_cursor_free(OSyncDBCursor *cursor);
+
 OSYNC_EXPORT long long int osync_db_last_rowid(OSyncDB *db);
 OSYNC_EXPORT char *osync_db_sql_escape(const char *query);
 
+/**
+ * @brief Starts a thread which executes the queued statements
+ *
+ * Statements passed to osync_db_queue() and osync_db_queue_blob() get
+ * executed in order by the writer, many of them in one transaction. All
+ * other functions wait until the queued statements got committed. The
+ * database must only be used by one thread besides the writer. The
+ * writer stops with osync_db_close().
+ *
+ * @param db Pointer to database struct
+ * @param error Pointer to a error struct 
+ * @return TRUE on success otherwise FALSE
+ */
+OSYNC_EXPORT osync_bool osync_db_start_writer(OSyncDB *db, OSyncError **error);
+
+/**
+ * @brief Queues a statement without result for the writer
+ *
+ * Without writer the statement gets executed like with osync_db_query().
+ * Errors of queued statements get reported by osync_db_sync().
+ *
+ * @param db Pointer to database struct
+ * @param query SQL statement
+ * @param error Pointer to a error struct 
+ * @return TRUE if the statement got queued otherwise FALSE
+ */
+OSYNC_EXPORT osync_bool osync_db_queue(OSyncDB *db, const char *query, OSyncError **error);
+
+/**
+ * @brief Queues a statement with a blob parameter for the writer
+ *
+ * Like osync_db_bind_blob(), data gets copied.
+ *
+ * @param db Pointer to database struct
+ * @param query SQL statement with one parameter
+ * @param data The blob
+ * @param size Size of data
+ * @param error Pointer to a error struct 
+ * @return TRUE if the statement got queued otherwise FALSE
+ */
+OSYNC_EXPORT osync_bool osync_db_queue_blob(OSyncDB *db, const char *query, const char *data, unsigned int size, OSyncError **error);
+
+/**
+ * @brief Waits until all queued statements are committed
+ *
+ * @param db Pointer to database struct
+ * @param error Pointer to a error struct 
+ * @return FALSE if one of the queued statements failed, TRUE otherwise
+ */
+OSYNC_EXPORT osync_bool osync_db_sync(OSyncDB *db, OSyncError **error);
+
+/**
+ * @brief Switches the database between write-ahead logging and the rollback journal
+ *
+ * Write-ahead logging needs SQLite 3.7.0 or newer and stays enabled for the
+ * database file.
+ *
+ * @param db Pointer to database struct
+ * @param wal TRUE for write-ahead logging
+ * @param error Pointer to a error struct 
+ * @return TRUE on success otherwise FALSE
+ */
+OSYNC_EXPORT osync_bool osync_db_set_wal(OSyncDB *db, osync_bool wal, OSyncError **error);
+
 /*@}*/
 #endif /* _OPENSYNC_DB_H_ */
 
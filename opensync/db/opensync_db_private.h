@@ -23,10 +23,42 @@
 
 #include <sqlite3.h>
 
+/** Maximum number of queued operations the writer commits in one transaction */
+#define OSYNC_DB_GROUP_COMMIT	256
+
+/*! @brief A write operation queued for the writer thread */
+typedef struct OSyncDBOperation {
+	/** The statement, NULL to stop the writer */
+	char *query;
+	/** Blob bound to the parameter of the statement, NULL if there is none */
+	char *data;
+	unsigned int size;
+} OSyncDBOperation;
+
 /*! @ingroup OSyncDBPrivate 
  * @brief A OSyncDB object */
 struct OSyncDB {
 	sqlite3 *sqlite3db;
+
+	/** Names of the tables known to exist */
+	GHashTable *tables;
+
+	/** Writer thread, NULL if statements get executed by the caller */
+	GThread *writer;
+	/** Ordered queue of OSyncDBOperation for the writer */
+	GAsyncQueue *queue;
+	/** Protects writer_error, idle gets signaled with it */
+	GMutex *mutex;
+	GCond *idle;
+	/** Queued operations which are not committed yet */
+	int pending;
+	/** First error of the writer since the last osync_db_sync() */
+	OSyncError *writer_error;
+};
+
+struct OSyncDBCursor {
+	OSyncDB *db;
+	sqlite3_stmt *stmt;
 };
 
 #endif /* _OPENSYNC_DB_PRIVATE_H_ */
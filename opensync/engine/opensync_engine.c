@@ -34,12 +34,16 @@
 
 #include "archive/opensync_archive_internals.h"
 #include "client/opensync_client_proxy_internals.h"
+#include "format/opensync_filter_internals.h"
 
 #include "opensync_status_internals.h"
 
 #include "opensync_engine.h"
 #include "opensync_engine_private.h"
 #include "opensync_engine_internals.h"
+#include "opensync_engine_host_internals.h"
+#include "opensync_obj_engine_internals.h"
+#include "opensync_mapping_engine_internals.h"
 
 #ifdef OPENSYNC_UNITTESTS
 #include "xmlformat/opensync-xmlformat_internals.h"
@@ -115,7 +119,7 @@ static osync_bool _osync_engine_is_proxy_connected(OSyncEngine *engine, OSyncCli
   osync_assert(engine);
   osync_assert(proxy);
 
-  return !!(engine->proxy_connects & (1 << _osync_engine_get_proxy_position(engine, proxy)));
+  return osync_bitset_test(&engine->proxy_connects, _osync_engine_get_proxy_position(engine, proxy));
 }
 
 static int _osync_engine_get_objengine_position(OSyncEngine *engine, OSyncObjEngine *objengine)
@@ -189,6 +193,120 @@ static void _osync_engine_converter_path_unref(gpointer data) {
   osync_converter_path_unref(converter_path);
 }
 
+static void _osync_engine_filter_chain_free(gpointer data)
+{
+  GList *chain = data, *f = NULL;
+  for (f = chain; f; f = f->next)
+    osync_filter_unref(f->data);
+  g_list_free(chain);
+}
+
+static gboolean _osync_engine_filter_chain_remove(gpointer key, gpointer value, gpointer userdata)
+{
+  return TRUE;
+}
+
+static osync_bool _osync_engine_sink_has_objformat(OSyncObjTypeSink *objtype_sink, const char *objformat)
+{
+  unsigned int i, num = osync_objtype_sink_num_objformat_sinks(objtype_sink);
+
+  /* Formats not known yet, the member could report anything */
+  if (!num)
+    return TRUE;
+
+  for (i = 0; i < num; i++) {
+    OSyncObjFormatSink *formatsink = osync_objtype_sink_nth_objformat_sink(objtype_sink, i);
+    if (!strcmp(osync_objformat_sink_get_objformat(formatsink), objformat))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Collects the group filters for each member and objtype of this synchronization.
+ * Filters of other objtypes and custom filters for formats the member
+ * doesn't report are dropped here, so they don't cost anything per change.
+ * Custom filters of loaded groups get bound to the format environment first. */
+static osync_bool _osync_engine_compile_filters(OSyncEngine *engine, OSyncError **error)
+{
+  GList *p = NULL, *o = NULL;
+  int i, num_filters;
+
+  g_hash_table_foreach_remove(engine->filterChains, _osync_engine_filter_chain_remove, NULL);
+
+  num_filters = osync_group_num_filters(engine->group);
+  if (!num_filters)
+    return TRUE;
+
+  for (i = 0; i < num_filters; i++) {
+    if (!osync_filter_bind_custom_filter(osync_group_nth_filter(engine->group, i), engine->formatenv, error))
+      return FALSE;
+  }
+
+  for (p = engine->proxies; p; p = p->next) {
+    OSyncMember *member = osync_client_proxy_get_member(p->data);
+
+    for (o = engine->object_engines; o; o = o->next) {
+      const char *objtype = osync_obj_engine_get_objtype(o->data);
+      OSyncObjTypeSink *objtype_sink = osync_member_find_objtype_sink(member, objtype);
+      GList *chain = NULL;
+
+      for (i = 0; i < num_filters; i++) {
+        OSyncFilter *filter = osync_group_nth_filter(engine->group, i);
+        const char *filter_objtype = osync_filter_get_objtype(filter);
+        const char *filter_objformat = osync_filter_get_objformat(filter);
+
+        if (!filter_objtype || strcmp(filter_objtype, objtype))
+          continue;
+
+        if (filter_objformat && objtype_sink && !_osync_engine_sink_has_objformat(objtype_sink, filter_objformat))
+          continue;
+
+        chain = g_list_append(chain, osync_filter_ref(filter));
+      }
+
+      if (chain) {
+        char *member_objtype = g_strdup_printf("%lli_%s", osync_member_get_id(member), objtype);
+        osync_trace(TRACE_INTERNAL, "%i filter(s) for %s", g_list_length(chain), member_objtype);
+        g_hash_table_insert(engine->filterChains, member_objtype, chain);
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+/* Evaluates the filter chain of the member and objtype on the change in its native format.
+ * The last filter which doesn't ignore the change decides. Returns FALSE if the change got denied. */
+static osync_bool _osync_engine_filter_change(OSyncEngine *engine, OSyncClientProxy *proxy, const char *member_objtype, OSyncChange *change)
+{
+  OSyncFilterAction result = OSYNC_FILTER_ALLOW;
+  GList *f = NULL, *o = NULL;
+
+  f = g_hash_table_lookup(engine->filterChains, member_objtype);
+  if (!f)
+    return TRUE;
+
+  /* Deleted changes don't carry any data to filter on. The deletion only
+     passes if the entry got mapped, otherwise the entry never got through
+     the filters and there is nothing to delete on the other members. */
+  if (osync_change_get_changetype(change) == OSYNC_CHANGE_TYPE_DELETED) {
+    for (o = engine->object_engines; o; o = o->next) {
+      if (!strcmp(osync_change_get_objtype(change), osync_obj_engine_get_objtype(o->data)))
+        return osync_obj_engine_is_mapped(o->data, proxy, change);
+    }
+    return TRUE;
+  }
+
+  for (; f; f = f->next) {
+    OSyncFilterAction action = osync_filter_invoke(f->data, osync_change_get_data(change));
+    if (action != OSYNC_FILTER_IGNORE)
+      result = action;
+  }
+
+  return (result != OSYNC_FILTER_DENY);
+}
+
 static void _osync_engine_receive_change(OSyncClientProxy *proxy, void *userdata, OSyncChange *change)
 {
   OSyncEngine *engine = userdata;
@@ -221,6 +339,15 @@ static void _osync_engine_receive_change(OSyncClientProxy *proxy, void *userdata
 
   data = osync_change_get_data(change);
 
+  /* Filter in the native format of the member. A denied change doesn't
+     reach the object engine, so no mapping entry gets created or updated for it. */
+  if (!_osync_engine_filter_change(engine, proxy, member_objtype, change)) {
+    osync_trace(TRACE_INTERNAL, "Change %s from member %lli got filtered", uid, memberid);
+    g_free(member_objtype);
+    osync_trace(TRACE_EXIT, "%s: Filtered", __func__);
+    return;
+  }
+
   /* Convert the format to the internal format */
   internalFormat = _osync_engine_get_internal_format(engine, osync_change_get_objtype(change));
   osync_trace(TRACE_INTERNAL, "common format %p for objtype %s", internalFormat, osync_change_get_objtype(change));
@@ -326,6 +453,13 @@ static void _osync_engine_receive_change(OSyncClientProxy *proxy, void *userdata
   osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&error));
 }
 
+static void _osync_engine_command_free(OSyncEngineCommand *command)
+{
+  if (command->mapping_engines)
+    g_free(command->mapping_engines);
+  g_free(command);
+}
+
 /* This function is called from the master thread. The function dispatched incoming data from
  * the remote end */
 static gboolean _command_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
@@ -340,7 +474,7 @@ static gboolean _command_dispatch(GSource *source, GSourceFunc callback, gpointe
     osync_trace(TRACE_INTERNAL, "Dispatching %p: %i", command, command->cmd);
 		
     osync_engine_command(engine, command);
-    g_free(command);
+    _osync_engine_command_free(command);
   }
 	
   osync_trace(TRACE_EXIT, "%s: Done dispatching", __func__);
@@ -432,28 +566,210 @@ osync_bool osync_engine_mapping_use_latest(OSyncEngine *engine, OSyncMappingEngi
   return TRUE;
 }
 
-/*! @brief This will create a new engine for the given group
- * 
- * This will create a new engine for the given group
- * 
- * @param group A pointer to the group, for which you want to create a new engine
- * @param error A pointer to a error struct
- * @returns Pointer to a newly allocated OSyncEngine on success, NULL otherwise
- * 
- */
-OSyncEngine *osync_engine_new(OSyncGroup *group, OSyncError **error)
+osync_bool osync_engine_mapping_resolve_bulk(OSyncEngine *engine, OSyncMappingEngine **mapping_engines, unsigned int num, OSyncConflictResolution res, int winner, OSyncError **error)
+{
+  OSyncEngineCommand *cmd = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %u, %i, %i, %p)", __func__, engine, mapping_engines, num, res, winner, error);
+	
+  cmd = osync_try_malloc0(sizeof(OSyncEngineCommand), error);
+  if (!cmd)
+    goto error;
+
+  cmd->mapping_engines = osync_try_malloc0(sizeof(OSyncMappingEngine *) * (num + 1), error);
+  if (!cmd->mapping_engines) {
+    g_free(cmd);
+    goto error;
+  }
+	
+  memcpy(cmd->mapping_engines, mapping_engines, sizeof(OSyncMappingEngine *) * num);
+  cmd->num_mapping_engines = num;
+  cmd->cmd = OSYNC_ENGINE_COMMAND_SOLVE;
+  cmd->solve_type = OSYNC_ENGINE_SOLVE_BULK;
+  cmd->resolution = res;
+  cmd->winner = winner;
+	
+  g_async_queue_push(engine->command_queue, cmd);
+	
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+static osync_bool _osync_engine_resolve_mappings(OSyncEngine *engine, OSyncEngineCommand *command, OSyncError **error)
+{
+  GList *objengines = NULL;
+  GList *o = NULL;
+  unsigned int i;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, engine, command, error);
+
+  for (i = 0; i < command->num_mapping_engines; i++) {
+    OSyncMappingEngine *mapping_engine = command->mapping_engines[i];
+    OSyncObjEngine *objengine = mapping_engine->parent;
+
+    if (!g_list_find(objengine->conflicts, mapping_engine)) {
+      osync_trace(TRACE_INTERNAL, "mapping_engine %p is not in conflict", mapping_engine);
+      continue;
+    }
+
+    if (!osync_mapping_engine_resolve(mapping_engine, command->resolution, command->winner, error))
+      goto error;
+
+    if (!g_list_find(objengines, objengine))
+      objengines = g_list_prepend(objengines, objengine);
+  }
+
+  /* Only now the object engines may start to write */
+  for (o = objengines; o; o = o->next) {
+    OSyncObjEngine *objengine = o->data;
+
+    if (!osync_obj_engine_check_get_changes(objengine))
+      continue;
+
+    if (!osync_obj_engine_command(objengine, OSYNC_ENGINE_COMMAND_WRITE, error))
+      goto error;
+  }
+
+  g_list_free(objengines);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  g_list_free(objengines);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+static void _osync_engine_stop_timeouts(OSyncEngine *engine)
+{
+  if (engine->deadline_source) {
+    g_source_destroy(engine->deadline_source);
+    g_source_unref(engine->deadline_source);
+    engine->deadline_source = NULL;
+  }
+
+  if (engine->abort_source) {
+    g_source_destroy(engine->abort_source);
+    g_source_unref(engine->abort_source);
+    engine->abort_source = NULL;
+  }
+}
+
+static GSource *_osync_engine_add_timeout(OSyncEngine *engine, unsigned int timeout, GSourceFunc function)
+{
+  GSource *source = g_timeout_source_new(timeout * 1000);
+  g_source_set_callback(source, function, engine, NULL);
+  g_source_attach(source, engine->context);
+  return source;
+}
+
+/* The clients didn't answer in time. Fail their requests in flight, the
+ * callbacks move the engine on to the disconnect. The disconnect requests
+ * which get sent meanwhile can't be answered either, so repeat this
+ * until nothing is pending anymore. */
+static gboolean _osync_engine_abort_timeout(gpointer userdata)
+{
+  OSyncEngine *engine = userdata;
+  OSyncError *locerror = NULL;
+  unsigned int failed = 0;
+  unsigned int rounds = 0;
+  GList *p = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, userdata);
+
+  osync_error_set(&locerror, OSYNC_ERROR_TIMEOUT, "Clients didn't finish within %u seconds after the abort", engine->abort_timeout);
+
+  do {
+    failed = 0;
+    for (p = engine->proxies; p; p = p->next)
+      failed += osync_client_proxy_abort(p->data, locerror);
+  } while (failed && engine->abort_source && ++rounds < 4);
+
+  osync_error_unref(&locerror);
+
+  /* Still not disconnected, since some object engine waits for something
+   * which never comes. End the synchronization anyway. */
+  if (engine->abort_source) {
+    osync_trace(TRACE_INTERNAL, "Forcing the end of the synchronization");
+    osync_engine_event(engine, OSYNC_ENGINE_EVENT_DISCONNECTED);
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return FALSE;
+}
+
+/* Cancels the requests in flight and disconnects. Has to be called from
+ * the thread of the engine */
+static void _osync_engine_abort_synchronization(OSyncEngine *engine, OSyncError *error)
+{
+  OSyncError *locerror = NULL;
+  GList *p = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
+
+  if (engine->abort_source) {
+    osync_trace(TRACE_EXIT, "%s: already aborting", __func__);
+    return;
+  }
+
+  for (p = engine->proxies; p; p = p->next) {
+    if (!osync_client_proxy_cancel(p->data, &locerror)) {
+      osync_trace(TRACE_ERROR, "Unable to cancel client: %s", osync_error_print(&locerror));
+      osync_error_unref(&locerror);
+    }
+  }
+
+  /* Armed before emitting the error. The disconnect might finish right
+   * away and has to find the timeout to remove it. */
+  if (engine->abort_timeout)
+    engine->abort_source = _osync_engine_add_timeout(engine, engine->abort_timeout, _osync_engine_abort_timeout);
+
+  osync_engine_set_error(engine, error);
+  osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_ERROR, error);
+  osync_engine_event(engine, OSYNC_ENGINE_EVENT_ERROR);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+static gboolean _osync_engine_deadline_timeout(gpointer userdata)
+{
+  OSyncEngine *engine = userdata;
+  OSyncError *locerror = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, userdata);
+
+  /* This source is done, don't let the abort destroy it */
+  g_source_unref(engine->deadline_source);
+  engine->deadline_source = NULL;
+
+  osync_error_set(&locerror, OSYNC_ERROR_TIMEOUT, "Synchronization exceeded its deadline of %u seconds", engine->deadline);
+  _osync_engine_abort_synchronization(engine, locerror);
+  osync_error_unref(&locerror);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return FALSE;
+}
+
+static OSyncEngine *_osync_engine_new(OSyncGroup *group, OSyncEngineHost *host, OSyncError **error)
 {
   OSyncEngine *engine = NULL;
   OSyncEngine **engineptr = NULL;
   char *enginesdir = NULL;
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, group, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, group, host, error);
   g_assert(group);
 	
   engine = osync_try_malloc0(sizeof(OSyncEngine), error);
   if (!engine)
     goto error;
   engine->ref_count = 1;
+  engine->change_window = OSYNC_CLIENT_PROXY_CHANGE_WINDOW_DEFAULT;
+  engine->abort_timeout = OSYNC_ENGINE_ABORT_TIMEOUT_DEFAULT;
+  engine->archive_writer = TRUE;
 
   if (!g_thread_supported ())
     g_thread_init (NULL);
@@ -461,11 +777,18 @@ OSyncEngine *osync_engine_new(OSyncGroup *group, OSyncError **error)
   engine->internalFormats = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
   engine->internalSchemas = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   engine->converterPathes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _osync_engine_converter_path_unref);
+  engine->filterChains = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _osync_engine_filter_chain_free);
 	
-  engine->context = g_main_context_new();
-  engine->thread = osync_thread_new(engine->context, error);
-  if (!engine->thread)
-    goto error_free_engine;
+  if (host) {
+    /* The thread of the host dispatches the context */
+    engine->host = osync_engine_host_ref(host);
+    engine->context = osync_engine_host_attach(host);
+  } else {
+    engine->context = g_main_context_new();
+    engine->thread = osync_thread_new(engine->context, error);
+    if (!engine->thread)
+      goto error_free_engine;
+  }
 	
   engine->group = group;
   osync_group_ref(group);
@@ -498,7 +821,8 @@ OSyncEngine *osync_engine_new(OSyncGroup *group, OSyncError **error)
 
   g_source_set_callback(engine->command_source, NULL, engine, NULL);
   g_source_attach(engine->command_source, engine->context);
-  g_main_context_ref(engine->context);
+  if (!host)
+    g_main_context_ref(engine->context);
 
   enginesdir = g_strdup_printf("%s%cengines", osync_group_get_configdir(group), G_DIR_SEPARATOR);
   engine->engine_path = g_strdup_printf("%s%cenginepipe", enginesdir, G_DIR_SEPARATOR);
@@ -526,6 +850,26 @@ OSyncEngine *osync_engine_new(OSyncGroup *group, OSyncError **error)
   return NULL;
 }
 
+/*! @brief This will create a new engine for the given group
+ * 
+ * This will create a new engine for the given group
+ * 
+ * @param group A pointer to the group, for which you want to create a new engine
+ * @param error A pointer to a error struct
+ * @returns Pointer to a newly allocated OSyncEngine on success, NULL otherwise
+ * 
+ */
+OSyncEngine *osync_engine_new(OSyncGroup *group, OSyncError **error)
+{
+  return _osync_engine_new(group, NULL, error);
+}
+
+OSyncEngine *osync_engine_new_with_host(OSyncGroup *group, OSyncEngineHost *host, OSyncError **error)
+{
+  osync_assert(host);
+  return _osync_engine_new(group, host, error);
+}
+
 OSyncEngine *osync_engine_ref(OSyncEngine *engine)
 {
   osync_assert(engine);
@@ -547,12 +891,30 @@ void osync_engine_unref(OSyncEngine *engine)
       osync_obj_engine_unref(objengine);
       engine->object_engines = g_list_remove(engine->object_engines, engine->object_engines->data);
     }
+    engine->num_object_engines = 0;
+
+    osync_bitset_clear(&engine->proxy_connects);
+    osync_bitset_clear(&engine->proxy_disconnects);
+    osync_bitset_clear(&engine->proxy_get_changes);
+    osync_bitset_clear(&engine->proxy_written);
+    osync_bitset_clear(&engine->proxy_sync_done);
+    osync_bitset_clear(&engine->proxy_errors);
+
+    osync_bitset_clear(&engine->obj_errors);
+    osync_bitset_clear(&engine->obj_connects);
+    osync_bitset_clear(&engine->obj_disconnects);
+    osync_bitset_clear(&engine->obj_get_changes);
+    osync_bitset_clear(&engine->obj_written);
+    osync_bitset_clear(&engine->obj_sync_done);
 
     if (engine->internalFormats)
       g_hash_table_destroy(engine->internalFormats);
 
     if (engine->converterPathes)
       g_hash_table_destroy(engine->converterPathes);
+
+    if (engine->filterChains)
+      g_hash_table_destroy(engine->filterChains);
 		
     if (engine->group)
       osync_group_unref(engine->group);
@@ -566,11 +928,25 @@ void osync_engine_unref(OSyncEngine *engine)
     if (engine->format_dir)
       g_free(engine->format_dir);
 		
+    if (engine->client_pool)
+      osync_client_pool_unref(engine->client_pool);
+		
+    _osync_engine_stop_timeouts(engine);
+
     if (engine->thread)
       osync_thread_free(engine->thread);
+
+    /* The context may be shared with other engines, which keep it running */
+    if (engine->command_source)
+      g_source_destroy(engine->command_source);
 			
-    if (engine->context)
+    if (engine->host) {
+      if (engine->context)
+        osync_engine_host_detach(engine->host, engine->context);
+      osync_engine_host_unref(engine->host);
+    } else if (engine->context) {
       g_main_context_unref(engine->context);
+    }
 			
     if (engine->syncing)
       g_cond_free(engine->syncing);
@@ -640,12 +1016,70 @@ void osync_engine_set_formatdir(OSyncEngine *engine, const char *dir)
   engine->format_dir = g_strdup(dir);
 }
 
+void osync_engine_set_client_pool(OSyncEngine *engine, OSyncClientPool *pool)
+{
+  osync_assert(engine);
+	
+  if (pool)
+    osync_client_pool_ref(pool);
+	
+  if (engine->client_pool)
+    osync_client_pool_unref(engine->client_pool);
+	
+  engine->client_pool = pool;
+}
+
+void osync_engine_set_change_window(OSyncEngine *engine, unsigned int window)
+{
+  osync_assert(engine);
+  engine->change_window = window;
+}
+
+void osync_engine_set_pipelined(OSyncEngine *engine, osync_bool pipelined)
+{
+  osync_assert(engine);
+  engine->pipelined = pipelined;
+}
+
+osync_bool osync_engine_is_pipelined(OSyncEngine *engine)
+{
+  osync_assert(engine);
+  return engine->pipelined;
+}
+
+osync_bool osync_engine_prev_sync_unclean(OSyncEngine *engine)
+{
+  osync_assert(engine);
+  return engine->prev_sync_unclean;
+}
+
+void osync_engine_set_deadline(OSyncEngine *engine, unsigned int timeout)
+{
+  osync_assert(engine);
+  engine->deadline = timeout;
+}
+
+void osync_engine_set_abort_timeout(OSyncEngine *engine, unsigned int timeout)
+{
+  osync_assert(engine);
+  engine->abort_timeout = timeout;
+}
+
+void osync_engine_set_archive_writer(OSyncEngine *engine, osync_bool writer, osync_bool wal)
+{
+  osync_assert(engine);
+  engine->archive_writer = writer;
+  engine->archive_wal = wal;
+}
+
 static osync_bool _osync_engine_start(OSyncEngine *engine, OSyncError **error)
 {
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
 	
   /* For testing purpose, it's possible to preload a instrumented plugin_env */
-  if (!engine->pluginenv) {
+  if (!engine->pluginenv && engine->host) {
+    engine->pluginenv = osync_engine_host_get_plugin_env(engine->host);
+  } else if (!engine->pluginenv) {
     engine->pluginenv = osync_plugin_env_new(error);
     if (!engine->pluginenv)
       goto error;
@@ -654,7 +1088,8 @@ static osync_bool _osync_engine_start(OSyncEngine *engine, OSyncError **error)
       goto error;
   }
 	
-  osync_thread_start(engine->thread);
+  if (engine->thread)
+    osync_thread_start(engine->thread);
 
   osync_engine_ref(engine);
 	
@@ -696,6 +1131,7 @@ static osync_bool _osync_engine_finalize_member(OSyncEngine *engine, OSyncClient
     goto error;
 	
   engine->proxies = g_list_remove(engine->proxies, proxy);
+  engine->num_proxies--;
 	
   osync_client_proxy_unref(proxy);
 	
@@ -750,6 +1186,10 @@ static OSyncClientProxy *_osync_engine_initialize_member(OSyncEngine *engine, OS
 		
   osync_client_proxy_set_context(proxy, engine->context);
   osync_client_proxy_set_change_callback(proxy, _osync_engine_receive_change, engine);
+  osync_client_proxy_set_change_window(proxy, engine->change_window);
+	
+  if (engine->client_pool)
+    osync_client_proxy_set_pool(proxy, engine->client_pool);
 
   if (!osync_client_proxy_spawn(proxy, osync_plugin_get_start_type(plugin), osync_member_get_configdir(member), error))
     goto error_free_proxy;
@@ -763,6 +1203,7 @@ static OSyncClientProxy *_osync_engine_initialize_member(OSyncEngine *engine, OS
   while (engine->busy) { g_usleep(100); }
 	
   engine->proxies = g_list_append(engine->proxies, proxy);
+  engine->num_proxies++;
 	
   if (engine->error) {
     _osync_engine_finalize_member(engine, proxy, NULL);
@@ -785,22 +1226,24 @@ static OSyncClientProxy *_osync_engine_initialize_member(OSyncEngine *engine, OS
   return NULL;
 }
 
+static void _osync_engine_pipeline_step(OSyncEngine *engine);
+
 static osync_bool _osync_engine_generate_connected_event(OSyncEngine *engine)
 {
   OSyncError *locerror = NULL;
 
-  if (osync_bitcount(engine->proxy_errors | engine->proxy_connects) != g_list_length(engine->proxies))
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_connects) != engine->num_proxies)
     return FALSE;
 	
-  if (osync_bitcount(engine->obj_errors | engine->obj_connects) == g_list_length(engine->object_engines)) {
-    if (osync_bitcount(engine->obj_errors) == g_list_length(engine->object_engines)) {
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_connects) == engine->num_object_engines) {
+    if (osync_bitset_count(&engine->obj_errors) == engine->num_object_engines) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "No objtypes left without error. Aborting");
       osync_trace(TRACE_ERROR, "%s", osync_error_print(&locerror));
       osync_engine_set_error(engine, locerror);
       osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_ERROR, locerror);
       osync_engine_event(engine, OSYNC_ENGINE_EVENT_ERROR);
       osync_error_unref(&locerror);
-    } else if (osync_bitcount(engine->proxy_errors) || osync_bitcount(engine->obj_errors)) {
+    } else if (osync_bitset_count(&engine->proxy_errors) || osync_bitset_count(&engine->obj_errors)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one object engine failed while connecting. Aborting");
       osync_trace(TRACE_ERROR, "%s", osync_error_print(&locerror));
       osync_engine_set_error(engine, locerror);
@@ -818,26 +1261,39 @@ static osync_bool _osync_engine_generate_connected_event(OSyncEngine *engine)
   return FALSE;
 }
 
-osync_bool osync_engine_check_get_changes(OSyncEngine *engine)
+osync_bool osync_engine_check_main_get_changes(OSyncEngine *engine)
 {
-  if (osync_bitcount(engine->proxy_errors | engine->proxy_get_changes) != g_list_length(engine->proxies)) {
-    osync_trace(TRACE_INTERNAL, "Not yet. main sinks still need to read: %i", osync_bitcount(engine->proxy_errors | engine->proxy_get_changes), g_list_length(engine->proxies));
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_get_changes) != engine->num_proxies) {
+    osync_trace(TRACE_INTERNAL, "Not yet. main sinks still need to read: %u of %u", osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_get_changes), engine->num_proxies);
     return FALSE;
   }
+
+  return TRUE;
+}
+
+osync_bool osync_engine_check_get_changes(OSyncEngine *engine)
+{
+  if (!osync_engine_check_main_get_changes(engine))
+    return FALSE;
 	
-  if (osync_bitcount(engine->obj_errors | engine->obj_get_changes) == g_list_length(engine->object_engines))
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_get_changes) == engine->num_object_engines)
     return TRUE;
 		
-  osync_trace(TRACE_INTERNAL, "Not yet. Obj Engines still need to read: %i", osync_bitcount(engine->obj_errors | engine->obj_get_changes));
+  osync_trace(TRACE_INTERNAL, "Not yet. Obj Engines still need to read: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_get_changes));
   return FALSE;
 }
 
 static void _osync_engine_generate_get_changes_event(OSyncEngine *engine)
 {
+  if (engine->pipelined) {
+    _osync_engine_pipeline_step(engine);
+    return;
+  }
+
   if (!osync_engine_check_get_changes(engine))
     return;
 		
-  if (osync_bitcount(engine->obj_errors)) {
+  if (osync_bitset_count(&engine->obj_errors)) {
     OSyncError *locerror = NULL;
     osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one object engine failed while getting changes. Aborting");
     osync_trace(TRACE_ERROR, "%s", osync_error_print(&locerror));
@@ -854,11 +1310,16 @@ static void _osync_engine_generate_get_changes_event(OSyncEngine *engine)
 
 static void _osync_engine_generate_written_event(OSyncEngine *engine)
 {
-  if (osync_bitcount(engine->proxy_errors | engine->proxy_written) != g_list_length(engine->proxies))
+  if (engine->pipelined) {
+    _osync_engine_pipeline_step(engine);
+    return;
+  }
+
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_written) != engine->num_proxies)
     return;
 	
-  if (osync_bitcount(engine->obj_errors | engine->obj_written) == g_list_length(engine->object_engines)) {
-    if (osync_bitcount(engine->obj_errors)) {
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_written) == engine->num_object_engines) {
+    if (osync_bitset_count(&engine->obj_errors)) {
       OSyncError *locerror = NULL;
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one object engine failed while writting changes. Aborting");
       osync_trace(TRACE_ERROR, "%s", osync_error_print(&locerror));
@@ -871,17 +1332,22 @@ static void _osync_engine_generate_written_event(OSyncEngine *engine)
       osync_engine_event(engine, OSYNC_ENGINE_EVENT_WRITTEN);
     }
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->obj_errors | engine->obj_written));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_written));
 
 }
 
 static void _osync_engine_generate_sync_done_event(OSyncEngine *engine)
 {
-  if (osync_bitcount(engine->proxy_errors | engine->proxy_sync_done) != g_list_length(engine->proxies))
+  if (engine->pipelined) {
+    _osync_engine_pipeline_step(engine);
+    return;
+  }
+
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_sync_done) != engine->num_proxies)
     return;
 	
-  if (osync_bitcount(engine->obj_errors | engine->obj_sync_done) == g_list_length(engine->object_engines)) {
-    if (osync_bitcount(engine->obj_errors)) {
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_sync_done) == engine->num_object_engines) {
+    if (osync_bitset_count(&engine->obj_errors)) {
       OSyncError *locerror = NULL;
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one object engine failed within sync_done. Aborting");
       osync_engine_set_error(engine, locerror);
@@ -893,26 +1359,26 @@ static void _osync_engine_generate_sync_done_event(OSyncEngine *engine)
       osync_engine_event(engine, OSYNC_ENGINE_EVENT_SYNC_DONE);
     }
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->obj_errors | engine->obj_sync_done));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_sync_done));
 }
 
 static osync_bool _osync_engine_generate_disconnected_event(OSyncEngine *engine)
 {
-  if (osync_bitcount(engine->proxy_errors | engine->proxy_disconnects) != g_list_length(engine->proxies))
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_disconnects) != engine->num_proxies)
     return FALSE;
 	
-  if (osync_bitcount(engine->obj_errors | engine->obj_disconnects) == g_list_length(engine->object_engines)) {
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_disconnects) == engine->num_object_engines) {
 
     /* Error handling in this case is quite special. We have to call OSYNC_ENGINE_EVENT_DISCONNECTED,
        even on errors. Since OSYNC_ENGINE_EVENT_ERROR would emit this DISCONNECTED event again - deadlock! */
-    if (!osync_bitcount(engine->obj_errors))
+    if (!osync_bitset_count(&engine->obj_errors))
       osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_DISCONNECTED, NULL);
 
     osync_engine_event(engine, OSYNC_ENGINE_EVENT_DISCONNECTED);
     return TRUE;
   }
 	
-  osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->obj_errors | engine->obj_disconnects));
+  osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_disconnects));
   return FALSE;
 }
 
@@ -929,10 +1395,10 @@ static void _osync_engine_connect_callback(OSyncClientProxy *proxy, void *userda
 	
   if (error) {
     osync_engine_set_error(engine, error);
-    engine->proxy_errors = engine->proxy_errors | (0x1 << position);
+    osync_bitset_set(&engine->proxy_errors, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, NULL, error);
   } else {
-    engine->proxy_connects = engine->proxy_connects | (0x1 << position);
+    osync_bitset_set(&engine->proxy_connects, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_CONNECTED, NULL, NULL);
   }
 
@@ -959,10 +1425,10 @@ static void _osync_engine_disconnect_callback(OSyncClientProxy *proxy, void *use
 	
   if (error) {
     osync_engine_set_error(engine, error);
-    engine->proxy_errors = engine->proxy_errors | (0x1 << position);
+    osync_bitset_set(&engine->proxy_errors, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, NULL, error);
   } else {
-    engine->proxy_disconnects = engine->proxy_disconnects | (0x1 << position);
+    osync_bitset_set(&engine->proxy_disconnects, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_DISCONNECTED, NULL, NULL);
   }
 	
@@ -981,10 +1447,10 @@ static void _osync_engine_get_changes_callback(OSyncClientProxy *proxy, void *us
 	
   if (error) {
     osync_engine_set_error(engine, error);
-    engine->proxy_errors = engine->proxy_errors | (0x1 << position);
+    osync_bitset_set(&engine->proxy_errors, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, NULL, error);
   } else {
-    engine->proxy_get_changes = engine->proxy_get_changes | (0x1 << position);
+    osync_bitset_set(&engine->proxy_get_changes, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_READ, NULL, NULL);
   }
 	
@@ -1003,10 +1469,10 @@ static void _osync_engine_written_callback(OSyncClientProxy *proxy, void *userda
 	
   if (error) {
     osync_engine_set_error(engine, error);
-    engine->proxy_errors = engine->proxy_errors | (0x1 << position);
+    osync_bitset_set(&engine->proxy_errors, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, NULL, error);
   } else {
-    engine->proxy_written = engine->proxy_written | (0x1 << position);
+    osync_bitset_set(&engine->proxy_written, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_WRITTEN, NULL, NULL);
   }
 	
@@ -1025,10 +1491,10 @@ static void _osync_engine_sync_done_callback(OSyncClientProxy *proxy, void *user
 	
   if (error) {
     osync_engine_set_error(engine, error);
-    engine->proxy_errors = engine->proxy_errors | (0x1 << position);
+    osync_bitset_set(&engine->proxy_errors, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, NULL, error);
   } else {
-    engine->proxy_sync_done = engine->proxy_sync_done | (0x1 << position);
+    osync_bitset_set(&engine->proxy_sync_done, position);
     osync_status_update_member(engine, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_SYNC_DONE, NULL, NULL);
   }
 	
@@ -1039,7 +1505,7 @@ static void _osync_engine_sync_done_callback(OSyncClientProxy *proxy, void *user
 
 static void _osync_engine_get_objengine_error(OSyncEngine *engine, OSyncObjEngine *objengine, int position, OSyncError *error)
 {
-  engine->obj_errors = engine->obj_errors | (0x1 << position);
+  osync_bitset_set(&engine->obj_errors, position);
   osync_engine_set_error(engine, error);
 }
 
@@ -1047,7 +1513,7 @@ static void _osync_engine_get_objengine_event(OSyncEngine *engine, OSyncObjEngin
 {
   switch (event) {
   case OSYNC_ENGINE_EVENT_CONNECTED:
-    engine->obj_connects = engine->obj_connects | (0x1 << position);
+    osync_bitset_set(&engine->obj_connects, position);
     break;
   case OSYNC_ENGINE_EVENT_ERROR:
     /* ObjEngine don't emit this signal. To determine which actual event fail,
@@ -1055,16 +1521,16 @@ static void _osync_engine_get_objengine_event(OSyncEngine *engine, OSyncObjEngin
        See _osync_engine_generate_event() and _osync_engine_get_obj_engine_error(). */
     break;
   case OSYNC_ENGINE_EVENT_READ:
-    engine->obj_get_changes = engine->obj_get_changes | (0x1 << position);
+    osync_bitset_set(&engine->obj_get_changes, position);
     break;
   case OSYNC_ENGINE_EVENT_WRITTEN:
-    engine->obj_written = engine->obj_written | (0x1 << position);
+    osync_bitset_set(&engine->obj_written, position);
     break;
   case OSYNC_ENGINE_EVENT_SYNC_DONE:
-    engine->obj_sync_done = engine->obj_sync_done | (0x1 << position);
+    osync_bitset_set(&engine->obj_sync_done, position);
     break;
   case OSYNC_ENGINE_EVENT_DISCONNECTED:
-    engine->obj_disconnects = engine->obj_disconnects | (0x1 << position);
+    osync_bitset_set(&engine->obj_disconnects, position);
     break;
   case OSYNC_ENGINE_EVENT_SUCCESSFUL:
   case OSYNC_ENGINE_EVENT_END_CONFLICTS:
@@ -1073,6 +1539,129 @@ static void _osync_engine_get_objengine_event(OSyncEngine *engine, OSyncObjEngin
   }
 }
 
+/* Drives the main sinks and the end of the synchronization in pipelined mode.
+   The object engines advance on their own, see _osync_engine_pipeline_advance(). */
+static void _osync_engine_pipeline_step(OSyncEngine *engine)
+{
+  GList *o = NULL;
+  OSyncError *locerror = NULL;
+  int position = 0;
+
+  if (!osync_engine_check_main_get_changes(engine))
+    return;
+
+  /* The object engines which got read while the main sinks were still
+     reading held back their write, see _osync_engine_pipeline_advance() */
+  if (!engine->proxy_write_released) {
+    engine->proxy_write_released = TRUE;
+
+    for (o = engine->object_engines, position = 0; o; o = o->next, position++) {
+      OSyncObjEngine *objengine = o->data;
+
+      if (!osync_bitset_test(&engine->obj_get_changes, position))
+        continue;
+
+      if (!osync_obj_engine_command(objengine, OSYNC_ENGINE_COMMAND_WRITE, &locerror)) {
+        _osync_engine_get_objengine_error(engine, objengine, position, locerror);
+        osync_error_unref(&locerror);
+      }
+    }
+  }
+
+  /* committed_all tells the main sinks that every object type got written */
+  if (!engine->proxy_commit_requested) {
+    if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_written) != engine->num_object_engines) {
+      osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_written));
+      return;
+    }
+
+    engine->proxy_commit_requested = TRUE;
+    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_READ, NULL);
+    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_END_CONFLICTS, NULL);
+
+    for (o = engine->proxies; o; o = o->next) {
+      OSyncClientProxy *proxy = o->data;
+      if (!osync_client_proxy_committed_all(proxy, _osync_engine_written_callback, engine, NULL, &locerror))
+        goto error;
+    }
+    return;
+  }
+
+  if (!engine->proxy_sync_done_requested) {
+    if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_written) != engine->num_proxies)
+      return;
+
+    engine->proxy_sync_done_requested = TRUE;
+    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_WRITTEN, NULL);
+
+    for (o = engine->proxies; o; o = o->next) {
+      OSyncClientProxy *proxy = o->data;
+      if (!osync_client_proxy_sync_done(proxy, _osync_engine_sync_done_callback, engine, NULL, &locerror))
+        goto error;
+    }
+    return;
+  }
+
+  if (osync_bitset_count_union(&engine->proxy_errors, &engine->proxy_sync_done) != engine->num_proxies)
+    return;
+
+  if (osync_bitset_count_union(&engine->obj_errors, &engine->obj_sync_done) != engine->num_object_engines) {
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->obj_errors, &engine->obj_sync_done));
+    return;
+  }
+
+  if (osync_bitset_count(&engine->obj_errors)) {
+    osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one object engine failed. Aborting");
+    osync_trace(TRACE_ERROR, "%s", osync_error_print(&locerror));
+    osync_engine_set_error(engine, locerror);
+    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_ERROR, locerror);
+    osync_engine_event(engine, OSYNC_ENGINE_EVENT_ERROR);
+    osync_error_unref(&locerror);
+  } else {
+    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_SYNC_DONE, NULL);
+    osync_engine_event(engine, OSYNC_ENGINE_EVENT_SYNC_DONE);
+  }
+  return;
+
+ error:
+  osync_engine_set_error(engine, locerror);
+
+  g_mutex_lock(engine->syncing_mutex);
+  g_cond_signal(engine->syncing);
+  g_mutex_unlock(engine->syncing_mutex);
+
+  osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(&locerror));
+  osync_error_unref(&locerror);
+}
+
+/* In pipelined mode an object engine gets its next command as soon as it
+   finished the previous one, without waiting for the other object engines. */
+static void _osync_engine_pipeline_advance(OSyncEngine *engine, OSyncObjEngine *objengine, int position, OSyncEngineEvent event)
+{
+  OSyncError *locerror = NULL;
+  OSyncEngineCmd cmd;
+
+  switch (event) {
+  case OSYNC_ENGINE_EVENT_READ:
+    /* A main sink could still change the state of the member, the write
+       waits for _osync_engine_pipeline_step() then */
+    if (!osync_engine_check_main_get_changes(engine))
+      return;
+    cmd = OSYNC_ENGINE_COMMAND_WRITE;
+    break;
+  case OSYNC_ENGINE_EVENT_WRITTEN:
+    cmd = OSYNC_ENGINE_COMMAND_SYNC_DONE;
+    break;
+  default:
+    return;
+  }
+
+  if (!osync_obj_engine_command(objengine, cmd, &locerror)) {
+    _osync_engine_get_objengine_error(engine, objengine, position, locerror);
+    osync_error_unref(&locerror);
+  }
+}
+
 static void _osync_engine_generate_event(OSyncEngine *engine, OSyncEngineEvent event)
 {
   switch (event) {
@@ -1107,11 +1696,15 @@ static void _osync_engine_event_callback(OSyncObjEngine *objengine, OSyncEngineE
 
   position = _osync_engine_get_objengine_position(engine, objengine);
 	
-  if (error)
+  if (error) {
     _osync_engine_get_objengine_error(engine, objengine, position, error);
-  else
+  } else {
     _osync_engine_get_objengine_event(engine, objengine, position, event);
 
+    if (engine->pipelined)
+      _osync_engine_pipeline_advance(engine, objengine, position, event);
+  }
+
   _osync_engine_generate_event(engine, event);
 
   osync_trace(TRACE_EXIT, "%s", __func__);
@@ -1148,12 +1741,16 @@ static void _osync_engine_discover_callback(OSyncClientProxy *proxy, void *userd
  */
 static osync_bool _osync_engine_initialize_formats(OSyncEngine *engine, OSyncError **error)
 {
-  engine->formatenv = osync_format_env_new(error);
-  if (!engine->formatenv)
-    goto error;
+  if (engine->host) {
+    engine->formatenv = osync_engine_host_get_format_env(engine->host);
+  } else {
+    engine->formatenv = osync_format_env_new(error);
+    if (!engine->formatenv)
+      goto error;
 	
-  if (!osync_format_env_load_plugins(engine->formatenv, engine->format_dir, error))
-    goto error_free;
+    if (!osync_format_env_load_plugins(engine->formatenv, engine->format_dir, error))
+      goto error_free;
+  }
 	
   /* XXX The internal formats XXX */
   _osync_engine_set_internal_format(engine, "contact", osync_format_env_find_objformat(engine->formatenv, "xmlformat-contact"));
@@ -1179,7 +1776,6 @@ static osync_bool _osync_engine_initialize_formats(OSyncEngine *engine, OSyncErr
 
 osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
 {
-  osync_bool prev_sync_unclean = FALSE;
   OSyncGroup *group = NULL;
   int i = 0, num = 0;
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
@@ -1202,6 +1798,7 @@ osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
     goto error;
   }
 	
+  engine->prev_sync_unclean = FALSE;
   switch (osync_group_lock(group)) {
   case OSYNC_LOCKED:
     osync_error_set(error, OSYNC_ERROR_LOCKED, "Group is locked");
@@ -1209,7 +1806,7 @@ osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
   case OSYNC_LOCK_STALE:
     osync_trace(TRACE_INTERNAL, "Detected stale lock file. Slow-syncing");
     osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_PREV_UNCLEAN, NULL);
-    prev_sync_unclean = TRUE;
+    engine->prev_sync_unclean = TRUE;
     break;
   case OSYNC_LOCK_OK:
     break;
@@ -1221,6 +1818,12 @@ osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
   osync_trace(TRACE_INTERNAL, "Running the main loop");
   if (!_osync_engine_start(engine, error))
     goto error_finalize;
+
+  /* Keeps the engine thread from waiting for the disk while writing */
+  if (engine->archive && engine->archive_writer) {
+    if (!osync_archive_start_writer(engine->archive, engine->archive_wal, error))
+      goto error_finalize;
+  }
 		
   osync_trace(TRACE_INTERNAL, "Spawning clients");
   for (i = 0; i < osync_group_num_members(group); i++) {
@@ -1250,9 +1853,10 @@ osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
 
     osync_obj_engine_set_callback(objengine, _osync_engine_event_callback, engine);
     engine->object_engines = g_list_append(engine->object_engines, objengine);
+    engine->num_object_engines++;
 
     /* If previous sync was unclean, then trigger SlowSync for all ObjEngines */
-    if (prev_sync_unclean)
+    if (engine->prev_sync_unclean)
       osync_obj_engine_set_slowsync(objengine, TRUE);
   }
 
@@ -1272,6 +1876,7 @@ osync_bool osync_engine_initialize(OSyncEngine *engine, OSyncError **error)
 osync_bool osync_engine_finalize(OSyncEngine *engine, OSyncError **error)
 {
   OSyncClientProxy *proxy = NULL;
+  OSyncError *locerror = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
 	
   if (engine->state != OSYNC_ENGINE_STATE_INITIALIZED) {
@@ -1280,12 +1885,22 @@ osync_bool osync_engine_finalize(OSyncEngine *engine, OSyncError **error)
   }
 	
   engine->state = OSYNC_ENGINE_STATE_UNINITIALIZED;
+  engine->prev_sync_unclean = FALSE;
+
+  _osync_engine_stop_timeouts(engine);
 
   while (engine->object_engines) {
     OSyncObjEngine *objengine = engine->object_engines->data;
     osync_obj_engine_unref(objengine);
     engine->object_engines = g_list_remove(engine->object_engines, engine->object_engines->data);
   }
+  engine->num_object_engines = 0;
+
+  /* Queued archive writes of a failed synchronization */
+  if (engine->archive && !osync_archive_sync(engine->archive, &locerror)) {
+    osync_trace(TRACE_ERROR, "Unable to write the archive: %s", osync_error_print(&locerror));
+    osync_error_unref(&locerror);
+  }
 	
   while (engine->proxies) {
     proxy = engine->proxies->data;
@@ -1295,15 +1910,14 @@ osync_bool osync_engine_finalize(OSyncEngine *engine, OSyncError **error)
 	
   _osync_engine_stop(engine);
 	
-  if (engine->formatenv) {
+  /* The environments of the host stay loaded for the other engines */
+  if (engine->formatenv && !engine->host)
     osync_format_env_free(engine->formatenv);
-    engine->formatenv = NULL;
-  }
+  engine->formatenv = NULL;
 	
-  if (engine->pluginenv) {
+  if (engine->pluginenv && (!engine->host || engine->pluginenv != osync_engine_host_get_plugin_env(engine->host)))
     osync_plugin_env_free(engine->pluginenv);
-    engine->pluginenv = NULL;
-  }
+  engine->pluginenv = NULL;
 	
   /* free internal schemas */
   _osync_engine_finalize_internal_schemas(engine);
@@ -1334,6 +1948,13 @@ void osync_engine_command(OSyncEngine *engine, OSyncEngineCommand *command)
   switch (command->cmd) {
   case OSYNC_ENGINE_COMMAND_CONNECT:
 
+    /* The filters of the group might have changed since the last synchronization */
+    if (!_osync_engine_compile_filters(engine, &locerror))
+      goto error;
+
+    if (engine->deadline)
+      engine->deadline_source = _osync_engine_add_timeout(engine, engine->deadline, _osync_engine_deadline_timeout);
+
     /* We first tell all object engines to connect */
     for (o = engine->object_engines; o; o = o->next) {
       OSyncObjEngine *objengine = o->data;
@@ -1375,6 +1996,10 @@ void osync_engine_command(OSyncEngine *engine, OSyncEngineCommand *command)
       if (!osync_mapping_engine_use_latest(command->mapping_engine, &locerror))
         goto error;
       break;
+    case OSYNC_ENGINE_SOLVE_BULK:
+      if (!_osync_engine_resolve_mappings(engine, command, &locerror))
+        goto error;
+      break;
     }
     break;
   case OSYNC_ENGINE_COMMAND_DISCOVER:
@@ -1395,17 +2020,12 @@ void osync_engine_command(OSyncEngine *engine, OSyncEngineCommand *command)
 		
     break;
   case OSYNC_ENGINE_COMMAND_ABORT:
-    /* For nwo Command Aborting is just trigger ENGINE_EVENT_ERROR.
-       Which is basically just calling the disconnect functions and not setting
-       the synchrnoization as a successful one. */
+    /* The clients get asked to cancel what they are doing. Then
+       ENGINE_EVENT_ERROR calls the disconnect functions and doesn't set
+       the synchronization as a successful one. */
     osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "Synchronization got aborted by user!");
-
-    osync_engine_set_error(engine, locerror);
-    osync_status_update_engine(engine, OSYNC_ENGINE_EVENT_ERROR, locerror);
-
+    _osync_engine_abort_synchronization(engine, locerror);
     osync_error_unref(&locerror);
-
-    osync_engine_event(engine, OSYNC_ENGINE_EVENT_ERROR);
     break;
 
   }
@@ -1415,6 +2035,7 @@ void osync_engine_command(OSyncEngine *engine, OSyncEngineCommand *command)
 	
  error:
   osync_engine_set_error(engine, locerror);
+  _osync_engine_stop_timeouts(engine);
 
   g_mutex_lock(engine->syncing_mutex);
   g_cond_signal(engine->syncing);
@@ -1516,19 +2137,25 @@ void osync_engine_event(OSyncEngine *engine, OSyncEngineEvent event)
       osync_obj_engine_finalize(objengine);
     }
 
-    engine->proxy_connects = 0;
-    engine->proxy_disconnects = 0;
-    engine->proxy_get_changes = 0;
-    engine->proxy_written = 0;
-    engine->proxy_errors = 0;
-    engine->proxy_sync_done = 0;
+    osync_bitset_reset(&engine->proxy_connects);
+    osync_bitset_reset(&engine->proxy_disconnects);
+    osync_bitset_reset(&engine->proxy_get_changes);
+    osync_bitset_reset(&engine->proxy_written);
+    osync_bitset_reset(&engine->proxy_errors);
+    osync_bitset_reset(&engine->proxy_sync_done);
 			
-    engine->obj_errors = 0;
-    engine->obj_connects = 0;
-    engine->obj_disconnects = 0;
-    engine->obj_get_changes = 0;
-    engine->obj_written = 0;
-    engine->obj_sync_done = 0;
+    osync_bitset_reset(&engine->obj_errors);
+    osync_bitset_reset(&engine->obj_connects);
+    osync_bitset_reset(&engine->obj_disconnects);
+    osync_bitset_reset(&engine->obj_get_changes);
+    osync_bitset_reset(&engine->obj_written);
+    osync_bitset_reset(&engine->obj_sync_done);
+
+    engine->proxy_write_released = FALSE;
+    engine->proxy_commit_requested = FALSE;
+    engine->proxy_sync_done_requested = FALSE;
+
+    _osync_engine_stop_timeouts(engine);
 			
     g_mutex_lock(engine->syncing_mutex);
     g_cond_signal(engine->syncing);
@@ -1545,6 +2172,7 @@ void osync_engine_event(OSyncEngine *engine, OSyncEngineEvent event)
 	
  error:
   osync_engine_set_error(engine, locerror);
+  _osync_engine_stop_timeouts(engine);
 
   g_mutex_lock(engine->syncing_mutex);
   g_cond_signal(engine->syncing);
@@ -1766,7 +2394,7 @@ osync_bool osync_engine_discover_and_block(OSyncEngine *engine, OSyncMember *mem
 int osync_engine_num_proxies(OSyncEngine *engine)
 {
   osync_assert(engine);
-  return g_list_length(engine->proxies);
+  return engine->num_proxies;
 }
 
 OSyncClientProxy *osync_engine_nth_proxy(OSyncEngine *engine, int nth)
@@ -1794,7 +2422,7 @@ OSyncClientProxy *osync_engine_find_proxy(OSyncEngine *engine, OSyncMember *memb
 int osync_engine_num_objengine(OSyncEngine *engine)
 {
   osync_assert(engine);
-  return g_list_length(engine->object_engines);
+  return engine->num_object_engines;
 }
 
 OSyncObjEngine *osync_engine_nth_objengine(OSyncEngine *engine, int nth)
@@ -1957,7 +2585,7 @@ osync_bool osync_engine_abort(OSyncEngine *engine, OSyncError **error)
   /* ...and flush all pending commands.
      To make sure the abort command will be the next and last command. */
   while ((pending_command = g_async_queue_try_pop_unlocked(engine->command_queue)))
-    g_free(pending_command);
+    _osync_engine_command_free(pending_command);
 
   /* Push the abort command on the empty queue. */
   g_async_queue_push_unlocked(engine->command_queue, cmd);
@@ -147,6 +147,46 @@ OSYNC_EXPORT osync_bool osync_engine_discover_and_block(OSyncEngine *engine, OSy
 
 OSYNC_EXPORT osync_bool osync_engine_abort(OSyncEngine *engine, OSyncError **error);
 
+/*! @brief Abort synchronizations which take longer than a deadline
+ *
+ * The deadline starts with osync_engine_synchronize(). Once it passed,
+ * the synchronization gets aborted like with osync_engine_abort() and
+ * ends with an error.
+ *
+ * @param engine Pointer to the engine
+ * @param timeout Seconds a synchronization may take, 0 for no deadline
+ */
+OSYNC_EXPORT void osync_engine_set_deadline(OSyncEngine *engine, unsigned int timeout);
+
+/*! @brief Bound the time an aborted synchronization takes to end
+ *
+ * On abort the plugin clients get asked to cancel their requests and
+ * get disconnected. Clients which don't answer within the abort timeout
+ * get torn down: their requests in flight fail and the synchronization
+ * ends without waiting for the per request timeouts.
+ *
+ * @param engine Pointer to the engine
+ * @param timeout Seconds to wait for the clients, 0 to wait for the per request timeouts
+ */
+OSYNC_EXPORT void osync_engine_set_abort_timeout(OSyncEngine *engine, unsigned int timeout);
+
+/*! @brief Configure how the archive of the group gets written
+ *
+ * By default the archive updates of the write phase get queued for a
+ * database writer thread, which commits them in groups. The engine only
+ * waits for them before sync_done and when it gets finalized. Without
+ * writer every update gets committed on its own by the engine thread.
+ * Write-ahead logging lowers the cost of each commit further, but needs
+ * SQLite 3.7.0 and stays enabled for the archive file.
+ *
+ * Has to be set before osync_engine_initialize().
+ *
+ * @param engine Pointer to the engine
+ * @param writer TRUE to write the archive from a writer thread
+ * @param wal TRUE to switch the archive to write-ahead logging
+ */
+OSYNC_EXPORT void osync_engine_set_archive_writer(OSyncEngine *engine, osync_bool writer, osync_bool wal);
+
 
 typedef void (* osync_conflict_cb) (OSyncEngine *, OSyncMappingEngine *, void *);
 typedef void (* osync_status_change_cb) (OSyncChangeUpdate *, void *);
@@ -160,6 +200,50 @@ OSYNC_EXPORT void osync_engine_set_mappingstatus_callback(OSyncEngine *engine, o
 OSYNC_EXPORT void osync_engine_set_enginestatus_callback(OSyncEngine *engine, osync_status_engine_cb callback, void *user_data);
 OSYNC_EXPORT void osync_engine_set_memberstatus_callback(OSyncEngine *engine, osync_status_member_cb callback, void *user_data);
 
+/*! @brief Keep the plugin clients of this engine in a pool between sessions
+ *
+ * Instead of finalizing and stopping its plugin clients, the engine
+ * returns them to the pool. Members with the same plugin and configuration
+ * lease them from there on the next initialize. Has to be set before
+ * osync_engine_initialize().
+ *
+ * @param engine Pointer to the engine
+ * @param pool The client pool or NULL to start fresh clients every time
+ */
+OSYNC_EXPORT void osync_engine_set_client_pool(OSyncEngine *engine, OSyncClientPool *pool);
+
+/*! @brief Limit the number of changes a member may report ahead of the engine
+ *
+ * While reading changes, a client stops reporting further changes once
+ * this many changes are queued up and not yet processed by the engine.
+ * This bounds the memory used for huge slow syncs. Has to be set before
+ * osync_engine_initialize().
+ *
+ * @param engine Pointer to the engine
+ * @param window Number of changes in flight per member, 0 for unlimited
+ */
+OSYNC_EXPORT void osync_engine_set_change_window(OSyncEngine *engine, unsigned int window);
+
+/*! @brief Let every object type advance through the sync on its own
+ *
+ * By default all object engines move through reading, writing and
+ * sync_done together, so the slowest object type holds back the others
+ * in every phase. In pipelined mode an object engine starts writing as
+ * soon as its own changes are read and its conflicts are solved, and
+ * calls sync_done as soon as its own changes are written. Connect and
+ * disconnect stay barriers for the whole group. The main sinks get
+ * committed_all once every object type got written.
+ *
+ * An object type which fails no longer stops the other object types
+ * from writing. The synchronization still ends with an error.
+ *
+ * Has to be set before osync_engine_synchronize().
+ *
+ * @param engine Pointer to the engine
+ * @param pipelined TRUE to enable the pipelined mode
+ */
+OSYNC_EXPORT void osync_engine_set_pipelined(OSyncEngine *engine, osync_bool pipelined);
+
 OSYNC_EXPORT OSyncObjEngine *osync_engine_find_objengine(OSyncEngine *engine, const char *objtype);
 
 OSYNC_EXPORT osync_bool osync_engine_mapping_solve(OSyncEngine *engine, OSyncMappingEngine *mapping_engine, OSyncChange *change, OSyncError **error);
@@ -167,4 +251,20 @@ OSYNC_EXPORT osync_bool osync_engine_mapping_duplicate(OSyncEngine *engine, OSyn
 OSYNC_EXPORT osync_bool osync_engine_mapping_ignore_conflict(OSyncEngine *engine, OSyncMappingEngine *mapping_engine, OSyncError **error);
 OSYNC_EXPORT osync_bool osync_engine_mapping_use_latest(OSyncEngine *engine, OSyncMappingEngine *mapping_engine, OSyncError **error);
 
+/*! @brief Solve the conflicts of many mappings with one resolution
+ *
+ * All mappings get solved in a single step of the engine, and the
+ * changes get written once the last of them is solved. Mappings which
+ * are not in conflict anymore get skipped.
+ *
+ * @param engine Pointer to the engine
+ * @param mapping_engines Array of the conflicting mappings
+ * @param num Number of mappings in the array
+ * @param res The conflict resolution
+ * @param winner The member id which wins with OSYNC_CONFLICT_RESOLUTION_SELECT
+ * @param error Pointer to an error struct
+ * @returns TRUE if the request got queued, FALSE otherwise
+ */
+OSYNC_EXPORT osync_bool osync_engine_mapping_resolve_bulk(OSyncEngine *engine, OSyncMappingEngine **mapping_engines, unsigned int num, OSyncConflictResolution res, int winner, OSyncError **error);
+
 #endif /*OPENSYNC_ENGINE_H_*/
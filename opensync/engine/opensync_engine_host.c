@@ -0,0 +1,193 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#include "opensync.h"
+#include "opensync_internals.h"
+
+#include "opensync-engine.h"
+#include "opensync-format.h"
+#include "opensync-plugin.h"
+
+#include "format/opensync_format_env_internals.h"
+
+#include "opensync_engine_host_private.h"
+#include "opensync_engine_host_internals.h"
+
+OSyncEngineHost *osync_engine_host_new(const char *plugin_dir, const char *format_dir, unsigned int num_threads, OSyncError **error)
+{
+  OSyncEngineHost *host = NULL;
+  unsigned int i;
+  osync_trace(TRACE_ENTRY, "%s(%s, %s, %u, %p)", __func__, __NULLSTR(plugin_dir), __NULLSTR(format_dir), num_threads, error);
+  osync_assert(num_threads > 0);
+
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
+  host = osync_try_malloc0(sizeof(OSyncEngineHost), error);
+  if (!host)
+    goto error;
+
+  host->ref_count = 1;
+  host->lock = g_mutex_new();
+
+  host->formatenv = osync_format_env_new(error);
+  if (!host->formatenv)
+    goto error_free_host;
+
+  if (!osync_format_env_load_plugins(host->formatenv, format_dir, error))
+    goto error_free_host;
+
+  /* Placeholders from the format cache would load their plugin on first
+     use, from whichever engine thread gets there first */
+  osync_format_env_resolve_modules(host->formatenv);
+
+  host->pluginenv = osync_plugin_env_new(error);
+  if (!host->pluginenv)
+    goto error_free_host;
+
+  if (!osync_plugin_env_load(host->pluginenv, plugin_dir, error))
+    goto error_free_host;
+
+  host->threads = osync_try_malloc0(sizeof(OSyncEngineHostThread) * num_threads, error);
+  if (!host->threads)
+    goto error_free_host;
+
+  for (i = 0; i < num_threads; i++) {
+    OSyncEngineHostThread *thread = &host->threads[i];
+
+    thread->context = g_main_context_new();
+    thread->thread = osync_thread_new(thread->context, error);
+    if (!thread->thread) {
+      g_main_context_unref(thread->context);
+      goto error_free_host;
+    }
+
+    osync_thread_start(thread->thread);
+    host->num_threads++;
+  }
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, host);
+  return host;
+
+ error_free_host:
+  osync_engine_host_unref(host);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+OSyncEngineHost *osync_engine_host_ref(OSyncEngineHost *host)
+{
+  osync_assert(host);
+
+  g_atomic_int_inc(&(host->ref_count));
+
+  return host;
+}
+
+void osync_engine_host_unref(OSyncEngineHost *host)
+{
+  unsigned int i;
+  osync_assert(host);
+
+  if (g_atomic_int_dec_and_test(&(host->ref_count))) {
+    osync_trace(TRACE_ENTRY, "%s(%p)", __func__, host);
+
+    for (i = 0; i < host->num_threads; i++) {
+      osync_thread_stop(host->threads[i].thread);
+      osync_thread_free(host->threads[i].thread);
+      g_main_context_unref(host->threads[i].context);
+    }
+    g_free(host->threads);
+
+    if (host->pluginenv)
+      osync_plugin_env_free(host->pluginenv);
+
+    if (host->formatenv)
+      osync_format_env_free(host->formatenv);
+
+    g_mutex_free(host->lock);
+    g_free(host);
+
+    osync_trace(TRACE_EXIT, "%s", __func__);
+  }
+}
+
+unsigned int osync_engine_host_num_engines(OSyncEngineHost *host)
+{
+  unsigned int i, num = 0;
+  osync_assert(host);
+
+  g_mutex_lock(host->lock);
+  for (i = 0; i < host->num_threads; i++)
+    num += host->threads[i].num_engines;
+  g_mutex_unlock(host->lock);
+
+  return num;
+}
+
+OSyncFormatEnv *osync_engine_host_get_format_env(OSyncEngineHost *host)
+{
+  osync_assert(host);
+  return host->formatenv;
+}
+
+OSyncPluginEnv *osync_engine_host_get_plugin_env(OSyncEngineHost *host)
+{
+  osync_assert(host);
+  return host->pluginenv;
+}
+
+GMainContext *osync_engine_host_attach(OSyncEngineHost *host)
+{
+  OSyncEngineHostThread *least = NULL;
+  unsigned int i;
+  osync_assert(host);
+
+  g_mutex_lock(host->lock);
+  for (i = 0; i < host->num_threads; i++) {
+    if (!least || host->threads[i].num_engines < least->num_engines)
+      least = &host->threads[i];
+  }
+  least->num_engines++;
+  g_main_context_ref(least->context);
+  g_mutex_unlock(host->lock);
+
+  osync_trace(TRACE_INTERNAL, "Attached engine to context %p of host %p", least->context, host);
+  return least->context;
+}
+
+void osync_engine_host_detach(OSyncEngineHost *host, GMainContext *context)
+{
+  unsigned int i;
+  osync_assert(host);
+  osync_assert(context);
+
+  g_mutex_lock(host->lock);
+  for (i = 0; i < host->num_threads; i++) {
+    if (host->threads[i].context == context) {
+      host->threads[i].num_engines--;
+      break;
+    }
+  }
+  g_mutex_unlock(host->lock);
+
+  g_main_context_unref(context);
+}
@@ -0,0 +1,89 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_ENGINE_HOST_H_
+#define OPENSYNC_ENGINE_HOST_H_
+
+/**
+ * @defgroup OSyncEngineHostAPI OpenSync Engine Host
+ * @ingroup OSyncPublic
+ * @brief Shares environments and event loop threads between engines
+ *
+ * Every engine normally loads all format and plugin modules and runs its
+ * own event loop thread. A process which synchronizes many groups can
+ * create the engines on a host instead. The host loads the format and
+ * plugin modules once and dispatches the engines on a fixed number of
+ * threads, so the cost per engine only depends on the state of its group.
+ *
+ * The environments of a host don't change after creation. Engines on a
+ * host ignore osync_engine_set_plugindir() and osync_engine_set_formatdir().
+ *
+ */
+/*@{*/
+
+/*! @brief Create a new engine host
+ *
+ * Loads the plugin and format modules and starts the event loop threads.
+ *
+ * @param plugin_dir The plugin directory or NULL for the default one
+ * @param format_dir The format plugin directory or NULL for the default one
+ * @param num_threads Number of event loop threads, at least 1
+ * @param error Pointer to an error struct
+ * @returns the new engine host or NULL on error
+ */
+OSYNC_EXPORT OSyncEngineHost *osync_engine_host_new(const char *plugin_dir, const char *format_dir, unsigned int num_threads, OSyncError **error);
+
+/*! @brief Increase the reference count on an engine host
+ *
+ * @param host Pointer to the engine host
+ *
+ */
+OSYNC_EXPORT OSyncEngineHost *osync_engine_host_ref(OSyncEngineHost *host);
+
+/*! @brief Decrease the reference count on an engine host
+ *
+ * Engines keep a reference on their host. The threads get stopped and
+ * the modules unloaded once the host and all its engines are gone.
+ *
+ * @param host Pointer to the engine host
+ *
+ */
+OSYNC_EXPORT void osync_engine_host_unref(OSyncEngineHost *host);
+
+/*! @brief Get the number of engines dispatched by the host
+ *
+ * @param host Pointer to the engine host
+ * @returns the number of engines
+ *
+ */
+OSYNC_EXPORT unsigned int osync_engine_host_num_engines(OSyncEngineHost *host);
+
+/*! @brief Create a new engine which runs on a host
+ *
+ * @param group The group to synchronize
+ * @param host The engine host
+ * @param error Pointer to an error struct
+ * @returns the new engine or NULL on error
+ */
+OSYNC_EXPORT OSyncEngine *osync_engine_new_with_host(OSyncGroup *group, OSyncEngineHost *host, OSyncError **error);
+
+/*@}*/
+
+#endif /* OPENSYNC_ENGINE_HOST_H_ */
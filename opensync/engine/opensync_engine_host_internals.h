@@ -0,0 +1,41 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_ENGINE_HOST_INTERNALS_H_
+#define OPENSYNC_ENGINE_HOST_INTERNALS_H_
+
+OSYNC_TEST_EXPORT OSyncFormatEnv *osync_engine_host_get_format_env(OSyncEngineHost *host);
+OSyncPluginEnv *osync_engine_host_get_plugin_env(OSyncEngineHost *host);
+
+/*! @brief Attach an engine to the least busy thread of the host
+ *
+ * @param host The engine host
+ * @returns the referenced main context of the thread
+ */
+GMainContext *osync_engine_host_attach(OSyncEngineHost *host);
+
+/*! @brief Detach an engine from the thread of its context
+ *
+ * @param host The engine host
+ * @param context The context returned by osync_engine_host_attach()
+ */
+void osync_engine_host_detach(OSyncEngineHost *host, GMainContext *context);
+
+#endif /* OPENSYNC_ENGINE_HOST_INTERNALS_H_ */
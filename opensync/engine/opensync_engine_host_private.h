@@ -0,0 +1,42 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_ENGINE_HOST_PRIVATE_H_
+#define OPENSYNC_ENGINE_HOST_PRIVATE_H_
+
+typedef struct OSyncEngineHostThread {
+	GMainContext *context;
+	OSyncThread *thread;
+	/** Number of engines attached to the context */
+	unsigned int num_engines;
+} OSyncEngineHostThread;
+
+struct OSyncEngineHost {
+	int ref_count;
+	GMutex *lock;
+
+	OSyncFormatEnv *formatenv;
+	OSyncPluginEnv *pluginenv;
+
+	OSyncEngineHostThread *threads;
+	unsigned int num_threads;
+};
+
+#endif /* OPENSYNC_ENGINE_HOST_PRIVATE_H_ */
@@ -21,7 +21,10 @@
 #ifndef OPENSYNC_ENGINE_INTERNALS_H_
 #define OPENSYNC_ENGINE_INTERNALS_H_
 
+osync_bool osync_engine_check_main_get_changes(OSyncEngine *engine);
 osync_bool osync_engine_check_get_changes(OSyncEngine *engine);
+osync_bool osync_engine_is_pipelined(OSyncEngine *engine);
+osync_bool osync_engine_prev_sync_unclean(OSyncEngine *engine);
 
 void osync_engine_event(OSyncEngine *engine, OSyncEngineEvent event);
 
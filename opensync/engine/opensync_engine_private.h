@@ -21,11 +21,15 @@
 #ifndef OPENSYNC_ENGINE_PRIVATE_H_
 #define OPENSYNC_ENGINE_PRIVATE_H_
 
+/** Seconds an aborted synchronization may take before the requests in flight get dropped **/
+#define OSYNC_ENGINE_ABORT_TIMEOUT_DEFAULT	10
+
 typedef enum {
 	OSYNC_ENGINE_SOLVE_DUPLICATE,
 	OSYNC_ENGINE_SOLVE_CHOOSE,
 	OSYNC_ENGINE_SOLVE_IGNORE,
-	OSYNC_ENGINE_SOLVE_USE_LATEST
+	OSYNC_ENGINE_SOLVE_USE_LATEST,
+	OSYNC_ENGINE_SOLVE_BULK
 } OSyncEngineSolveType;
 
 typedef struct OSyncEngineCommand {
@@ -34,6 +38,11 @@ typedef struct OSyncEngineCommand {
 	OSyncChange *master;
 	OSyncEngineSolveType solve_type;
 	OSyncMember *member;
+	/** OSYNC_ENGINE_SOLVE_BULK: the mappings and the resolution for all of them **/
+	OSyncMappingEngine **mapping_engines;
+	unsigned int num_mapping_engines;
+	OSyncConflictResolution resolution;
+	int winner;
 } OSyncEngineCommand;
 
 struct OSyncEngine {
@@ -41,6 +50,9 @@ struct OSyncEngine {
 	/** The opensync group **/
 	OSyncGroup *group;
 	OSyncArchive *archive;
+	/** Writes of the archive go through a writer thread, optionally with write-ahead logging **/
+	osync_bool archive_writer;
+	osync_bool archive_wal;
 	
 	char *engine_path;
 	char *plugin_dir;
@@ -74,6 +86,8 @@ struct OSyncEngine {
 	/** The g_main_loop of this engine **/
 	OSyncThread *thread;
 	GMainContext *context;
+	/** Optional host which provides the environments and the thread dispatching the context **/
+	OSyncEngineHost *host;
 	
 	GAsyncQueue *command_queue;
 	GSourceFuncs *command_functions;
@@ -87,28 +101,55 @@ struct OSyncEngine {
 	
 	/** proxies contains a list of all OSyncClientProxy objects **/
 	GList *proxies;
+	/** Optional pool the clients of the proxies get leased from **/
+	OSyncClientPool *client_pool;
+	/** Number of changes each client may report ahead of the engine **/
+	unsigned int change_window;
+
+	/** Seconds a synchronization may take before it gets aborted, 0 for unlimited **/
+	unsigned int deadline;
+	GSource *deadline_source;
+	/** Seconds an aborted synchronization may take before the proxies get torn down, 0 for unlimited **/
+	unsigned int abort_timeout;
+	GSource *abort_source;
 
 	/** object_engines contains a list of all OSyncObjEngine objects **/
 	GList *object_engines;
 
 	osync_bool man_dispatch;
 	osync_bool allow_sync_alert;
+
+	/** Every object engine advances through the phases on its own, see osync_engine_set_pipelined() **/
+	osync_bool pipelined;
+	/** Pipelined mode only: the main sinks got read and the object engines may write **/
+	osync_bool proxy_write_released;
+	/** Pipelined mode only: the main sinks got asked to commit, respectively to finish the sync **/
+	osync_bool proxy_commit_requested;
+	osync_bool proxy_sync_done_requested;
 	
 	OSyncError *error;
+	/** The previous synchronization left a stale lock behind, the object engines slow-sync **/
+	osync_bool prev_sync_unclean;
 	
-	int proxy_connects;
-	int proxy_disconnects;
-	int proxy_get_changes;
-	int proxy_written;
-	int proxy_sync_done;
-	int proxy_errors;
-	
-	int obj_errors;
-	int obj_connects;
-	int obj_disconnects;
-	int obj_get_changes;
-	int obj_written;
-	int obj_sync_done;
+	/** Length of proxies and object_engines, compared against the bitsets below **/
+	unsigned int num_proxies;
+	unsigned int num_object_engines;
+
+	/** Positions in proxies which reached a state, indexed like the list **/
+	OSyncBitset proxy_connects;
+	OSyncBitset proxy_disconnects;
+	OSyncBitset proxy_get_changes;
+	OSyncBitset proxy_written;
+	OSyncBitset proxy_sync_done;
+	OSyncBitset proxy_errors;
+	
+	/** Positions in object_engines which reached a state **/
+	OSyncBitset obj_errors;
+	OSyncBitset obj_connects;
+	OSyncBitset obj_disconnects;
+	OSyncBitset obj_get_changes;
+	OSyncBitset obj_written;
+	OSyncBitset obj_sync_done;
 	
 	osync_bool busy;
 	
@@ -116,6 +157,9 @@ struct OSyncEngine {
 	GHashTable *internalSchemas;
 	/** converter_paths contains a hash of all OSyncFormatConverterPath objects **/
 	GHashTable *converterPathes;
+	/** The filters of the group which apply to the changes of a member and objtype,
+	 * compiled for each synchronization. Key is "<memberid>_<objtype>", value a GList of OSyncFilter **/
+	GHashTable *filterChains;
 };
 
 #endif /* OPENSYNC_ENGINE_PRIVATE_H_ */
@@ -403,6 +403,29 @@ static unsigned int prod(unsigned int n)
   return x;
 }
 
+/* Solves the conflict with the resolution configured in the group for the
+ * objtype. Returns FALSE if the conflict is left for the conflict callback */
+static osync_bool _osync_mapping_engine_apply_policy(OSyncMappingEngine *engine)
+{
+  OSyncGroup *group = osync_engine_get_group(engine->parent->parent);
+  OSyncConflictResolution res = OSYNC_CONFLICT_RESOLUTION_UNKNOWN;
+  OSyncError *locerror = NULL;
+  int winner = 0;
+
+  osync_group_get_objtype_conflict_resolution(group, engine->parent->objtype, &res, &winner);
+  if (res == OSYNC_CONFLICT_RESOLUTION_UNKNOWN)
+    return FALSE;
+
+  /* The write gets triggered by the read event of the object engine */
+  if (!osync_mapping_engine_resolve(engine, res, winner, &locerror)) {
+    osync_trace(TRACE_INTERNAL, "Conflict resolution %i doesn't cover mapping_engine %p: %s", res, engine, osync_error_print(&locerror));
+    osync_error_unref(&locerror);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 void osync_mapping_engine_check_conflict(OSyncMappingEngine *engine)
 {
   int is_same = 0;
@@ -459,6 +482,12 @@ void osync_mapping_engine_check_conflict(OSyncMappingEngine *engine)
     //conflict, solve conflict
     osync_trace(TRACE_INTERNAL, "Got conflict for mapping_engine %p", engine);
     engine->parent->conflicts = g_list_append(engine->parent->conflicts, engine);
+
+    if (_osync_mapping_engine_apply_policy(engine)) {
+      osync_trace(TRACE_EXIT, "%s: Conflict solved by the group policy", __func__);
+      return;
+    }
+
     osync_status_conflict(engine->parent->parent, engine);
     osync_trace(TRACE_EXIT, "%s: Got conflict", __func__);
     return;
@@ -553,22 +582,35 @@ OSyncChange *osync_mapping_engine_member_change(OSyncMappingEngine *engine, int
   return NULL;
 }
 
-osync_bool osync_mapping_engine_solve(OSyncMappingEngine *engine, OSyncChange *change, OSyncError **error)
+/* Marks the conflict as solved. The write starts once all changes got
+ * read and no conflict is left, unless the caller solves several conflicts
+ * at once and triggers the write itself. */
+static osync_bool _osync_mapping_engine_solved(OSyncMappingEngine *engine, osync_bool trigger_write, OSyncError **error)
 {
-  OSyncMappingEntryEngine *entry = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, change);
-	
-  entry = _osync_mapping_engine_find_entry(engine, change);
-  engine->conflict = FALSE;
-  osync_mapping_engine_set_master(engine, entry);
   osync_status_update_mapping(engine->parent->parent, engine, OSYNC_MAPPING_EVENT_SOLVED, NULL);
   engine->parent->conflicts = g_list_remove(engine->parent->conflicts, engine);
+
+  if (!trigger_write)
+    return TRUE;
 	
-  if (osync_engine_check_get_changes(engine->parent->parent) && osync_bitcount(engine->parent->sink_errors | engine->parent->sink_get_changes) == g_list_length(engine->parent->sink_engines)) {
+  if (osync_obj_engine_check_get_changes(engine->parent)) {
     if (!osync_obj_engine_command(engine->parent, OSYNC_ENGINE_COMMAND_WRITE, error))
-      goto error;
+      return FALSE;
   } else
     osync_trace(TRACE_INTERNAL, "Not triggering write. didnt receive all reads yet");
+
+  return TRUE;
+}
+
+static osync_bool _osync_mapping_engine_solve(OSyncMappingEngine *engine, OSyncMappingEntryEngine *entry, osync_bool trigger_write, OSyncError **error)
+{
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %i)", __func__, engine, entry, trigger_write);
+	
+  engine->conflict = FALSE;
+  osync_mapping_engine_set_master(engine, entry);
+
+  if (!_osync_mapping_engine_solved(engine, trigger_write, error))
+    goto error;
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -578,14 +620,20 @@ osync_bool osync_mapping_engine_solve(OSyncMappingEngine *engine, OSyncChange *c
   return FALSE;
 }
 
-osync_bool osync_mapping_engine_ignore(OSyncMappingEngine *engine, OSyncError **error)
+osync_bool osync_mapping_engine_solve(OSyncMappingEngine *engine, OSyncChange *change, OSyncError **error)
+{
+  OSyncMappingEntryEngine *entry = _osync_mapping_engine_find_entry(engine, change);
+  return _osync_mapping_engine_solve(engine, entry, TRUE, error);
+}
+
+static osync_bool _osync_mapping_engine_ignore(OSyncMappingEngine *engine, osync_bool trigger_write, OSyncError **error)
 {
   OSyncObjEngine *objengine = NULL;
   OSyncArchive *archive = NULL;
   char *objtype = NULL;
   long long int id = 0;
   GList *c = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p)", __func__, engine, trigger_write, error);
 	
   engine->conflict = FALSE;
   engine->synced = TRUE;
@@ -600,14 +648,8 @@ osync_bool osync_mapping_engine_ignore(OSyncMappingEngine *engine, OSyncError **
     osync_archive_save_ignored_conflict(archive, objtype, id, osync_change_get_changetype(entry->change), error);
   }
 
-  osync_status_update_mapping(engine->parent->parent, engine, OSYNC_MAPPING_EVENT_SOLVED, NULL);
-  engine->parent->conflicts = g_list_remove(engine->parent->conflicts, engine);
-	
-  if (osync_engine_check_get_changes(engine->parent->parent) && osync_bitcount(engine->parent->sink_errors | engine->parent->sink_get_changes) == g_list_length(engine->parent->sink_engines)) {
-    if (!osync_obj_engine_command(engine->parent, OSYNC_ENGINE_COMMAND_WRITE, error))
-      goto error;
-  } else
-    osync_trace(TRACE_INTERNAL, "Not triggering write. didnt receive all reads yet");
+  if (!_osync_mapping_engine_solved(engine, trigger_write, error))
+    goto error;
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -617,28 +659,29 @@ osync_bool osync_mapping_engine_ignore(OSyncMappingEngine *engine, OSyncError **
   return FALSE;
 }
 
-osync_bool osync_mapping_engine_use_latest(OSyncMappingEngine *engine, OSyncError **error)
+osync_bool osync_mapping_engine_ignore(OSyncMappingEngine *engine, OSyncError **error)
+{
+  return _osync_mapping_engine_ignore(engine, TRUE, error);
+}
+
+static osync_bool _osync_mapping_engine_use_latest(OSyncMappingEngine *engine, osync_bool trigger_write, OSyncError **error)
 {
   OSyncMappingEntryEngine *latest_entry = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, engine, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p)", __func__, engine, trigger_write, error);
 	
   latest_entry = _osync_mapping_engine_get_latest_entry(engine, error);
 
-  if (!latest_entry)
+  if (!latest_entry) {
+    if (!osync_error_is_set(error))
+      osync_error_set(error, OSYNC_ERROR_GENERIC, "Unable to find a change with the latest revision");
     goto error;
+  }
 
   osync_mapping_engine_set_master(engine, latest_entry);
 
   engine->conflict = FALSE;
-  osync_status_update_mapping(engine->parent->parent, engine, OSYNC_MAPPING_EVENT_SOLVED, NULL);
-  engine->parent->conflicts = g_list_remove(engine->parent->conflicts, engine);
-	
-  if (osync_engine_check_get_changes(engine->parent->parent) && osync_bitcount(engine->parent->sink_errors | engine->parent->sink_get_changes) == g_list_length(engine->parent->sink_engines)) {
-    OSyncError *error = NULL;
-    if (!osync_obj_engine_command(engine->parent, OSYNC_ENGINE_COMMAND_WRITE, &error))
-      goto error;
-  } else
-    osync_trace(TRACE_INTERNAL, "Not triggering write. didnt receive all reads yet");
+  if (!_osync_mapping_engine_solved(engine, trigger_write, error))
+    goto error;
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -648,6 +691,11 @@ osync_bool osync_mapping_engine_use_latest(OSyncMappingEngine *engine, OSyncErro
   return FALSE;
 }
 
+osync_bool osync_mapping_engine_use_latest(OSyncMappingEngine *engine, OSyncError **error)
+{
+  return _osync_mapping_engine_use_latest(engine, TRUE, error);
+}
+
 static osync_bool _osync_change_elevate(OSyncChange *change, int level, osync_bool *dirty, OSyncError **error)
 {
   int i = 0;
@@ -664,13 +712,13 @@ static osync_bool _osync_change_elevate(OSyncChange *change, int level, osync_bo
  * @param dupe_mapping The conflicting mapping to duplicate
  * 
  */
-osync_bool osync_mapping_engine_duplicate(OSyncMappingEngine *existingMapping, OSyncError **error)
+static osync_bool _osync_mapping_engine_duplicate(OSyncMappingEngine *existingMapping, osync_bool trigger_write, OSyncError **error)
 {
   int elevation = 0;
   OSyncObjEngine *objengine = NULL;
   GList *entries = NULL, *e = NULL, *mappings = NULL;
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, existingMapping, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %p)", __func__, existingMapping, trigger_write, error);
   g_assert(existingMapping);
 	
   objengine = existingMapping->parent;
@@ -778,14 +826,8 @@ osync_bool osync_mapping_engine_duplicate(OSyncMappingEngine *existingMapping, O
     mappings = g_list_remove(mappings, mapping);
   }
 	
-  objengine->conflicts = g_list_remove(objengine->conflicts, existingMapping);
-  osync_status_update_mapping(objengine->parent, existingMapping, OSYNC_MAPPING_EVENT_SOLVED, NULL);
-	
-  if (osync_engine_check_get_changes(objengine->parent) && osync_bitcount(objengine->sink_errors | objengine->sink_get_changes) == g_list_length(objengine->sink_engines)) {
-    if (!osync_obj_engine_command(objengine, OSYNC_ENGINE_COMMAND_WRITE, error))
-      goto error;
-  } else
-    osync_trace(TRACE_INTERNAL, "Not triggering write. didnt receive all reads yet");
+  if (!_osync_mapping_engine_solved(existingMapping, trigger_write, error))
+    goto error;
 
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -800,3 +842,61 @@ osync_bool osync_mapping_engine_duplicate(OSyncMappingEngine *existingMapping, O
   return FALSE;
 }
 
+osync_bool osync_mapping_engine_duplicate(OSyncMappingEngine *existingMapping, OSyncError **error)
+{
+  return _osync_mapping_engine_duplicate(existingMapping, TRUE, error);
+}
+
+osync_bool osync_mapping_engine_resolve(OSyncMappingEngine *engine, OSyncConflictResolution res, int winner, OSyncError **error)
+{
+  GList *e = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %i, %i, %p)", __func__, engine, res, winner, error);
+  osync_assert(engine);
+
+  switch (res) {
+  case OSYNC_CONFLICT_RESOLUTION_DUPLICATE:
+    if (!_osync_mapping_engine_duplicate(engine, FALSE, error))
+      goto error;
+    break;
+  case OSYNC_CONFLICT_RESOLUTION_IGNORE:
+    if (!osync_mapping_engine_supports_ignore(engine)) {
+      osync_error_set(error, OSYNC_ERROR_NOT_SUPPORTED, "Not all members are able to read the ignored changes");
+      goto error;
+    }
+
+    if (!_osync_mapping_engine_ignore(engine, FALSE, error))
+      goto error;
+    break;
+  case OSYNC_CONFLICT_RESOLUTION_NEWER:
+    if (!_osync_mapping_engine_use_latest(engine, FALSE, error))
+      goto error;
+    break;
+  case OSYNC_CONFLICT_RESOLUTION_SELECT:
+    for (e = engine->entries; e; e = e->next) {
+      OSyncMappingEntryEngine *entry = e->data;
+      OSyncMember *member = osync_client_proxy_get_member(entry->sink_engine->proxy);
+      if (entry->change && osync_member_get_id(member) == winner)
+        break;
+    }
+
+    if (!e) {
+      osync_error_set(error, OSYNC_ERROR_GENERIC, "Member %i has no change in this mapping", winner);
+      goto error;
+    }
+
+    if (!_osync_mapping_engine_solve(engine, e->data, FALSE, error))
+      goto error;
+    break;
+  case OSYNC_CONFLICT_RESOLUTION_UNKNOWN:
+    osync_error_set(error, OSYNC_ERROR_PARAMETER, "No conflict resolution given");
+    goto error;
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
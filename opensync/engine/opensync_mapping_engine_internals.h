@@ -42,4 +42,17 @@ osync_bool osync_mapping_engine_multiply(OSyncMappingEngine *engine, OSyncError
 void osync_mapping_engine_check_conflict(OSyncMappingEngine *engine);
 OSyncMappingEntryEngine *osync_mapping_engine_get_entry(OSyncMappingEngine *engine, OSyncSinkEngine *sinkengine);
 
+/*! @brief Solve the conflict of a mapping with a fixed resolution
+ *
+ * Unlike the single solve functions, this doesn't start the write of the
+ * object engine. The caller has to trigger it after solving a batch.
+ *
+ * @param engine The conflicting mapping engine
+ * @param res The conflict resolution
+ * @param winner The member id which wins with OSYNC_CONFLICT_RESOLUTION_SELECT
+ * @param error Pointer to an error struct
+ * @returns TRUE if the conflict got solved, FALSE if the resolution doesn't apply
+ */
+osync_bool osync_mapping_engine_resolve(OSyncMappingEngine *engine, OSyncConflictResolution res, int winner, OSyncError **error);
+
 #endif /*OPENSYNC_MAPPING_ENGINE_INTERNALS_H_*/
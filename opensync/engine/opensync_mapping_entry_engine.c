@@ -43,7 +43,7 @@ OSyncMappingEntryEngine *osync_entry_engine_new(OSyncMappingEntry *entry, OSyncM
   osync_assert(sink_engine);
   osync_assert(entry);
 	
-  engine = osync_try_malloc0(sizeof(OSyncMappingEntryEngine), error);
+  engine = osync_try_slice_alloc0(sizeof(OSyncMappingEntryEngine), error);
   if (!engine)
     goto error;
   engine->ref_count = 1;
@@ -90,7 +90,7 @@ void osync_entry_engine_unref(OSyncMappingEntryEngine *engine)
     if (engine->entry)
       osync_mapping_entry_unref(engine->entry);
 		
-    g_free(engine);
+    osync_slice_free(sizeof(OSyncMappingEntryEngine), engine);
   }
 }
 
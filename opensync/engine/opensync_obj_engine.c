@@ -44,6 +44,7 @@
 #include "opensync_obj_engine_internals.h"
 
 #include "archive/opensync_archive_internals.h"
+#include "xmlformat/opensync_xmlformat_internals.h"
 #include "data/opensync_change_internals.h"
 #include "client/opensync_client_proxy_internals.h"
 
@@ -94,10 +95,10 @@ static void _osync_obj_engine_connect_callback(OSyncClientProxy *proxy, void *us
   if (error) {
     osync_trace(TRACE_INTERNAL, "Obj Engine received connect error: %s", osync_error_print(&error));
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, engine->objtype, error);
   } else {
-    engine->sink_connects = engine->sink_connects | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_connects, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_CONNECTED, engine->objtype, NULL);
   }
 
@@ -106,15 +107,15 @@ static void _osync_obj_engine_connect_callback(OSyncClientProxy *proxy, void *us
     osync_trace(TRACE_INTERNAL, "SlowSync requested during connect.");
   }
 			
-  if (osync_bitcount(engine->sink_errors | engine->sink_connects) == g_list_length(engine->sink_engines)) {
-    if (osync_bitcount(engine->sink_errors)) {
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_connects) == engine->num_sink_engines) {
+    if (osync_bitset_count(&engine->sink_errors)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one sink_engine failed while connecting");
       osync_obj_engine_set_error(engine, locerror);
     }
 
     osync_obj_engine_event(engine, OSYNC_ENGINE_EVENT_CONNECTED, locerror ? locerror : error);
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->sink_errors | engine->sink_connects));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->sink_errors, &engine->sink_connects));
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
@@ -124,8 +125,8 @@ static void _osync_obj_engine_generate_event_disconnected(OSyncObjEngine *engine
   OSyncError *locerror = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p)", __func__, engine);
 
-  if (osync_bitcount(engine->sink_errors | engine->sink_disconnects) == g_list_length(engine->sink_engines)) {
-    if (osync_bitcount(engine->sink_disconnects) < osync_bitcount(engine->sink_connects)) {
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_disconnects) == engine->num_sink_engines) {
+    if (osync_bitset_count(&engine->sink_disconnects) < osync_bitset_count(&engine->sink_connects)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "Fewer sink_engines disconnected than connected");
       osync_obj_engine_set_error(engine, locerror);
       osync_error_unref(&locerror);
@@ -136,7 +137,7 @@ static void _osync_obj_engine_generate_event_disconnected(OSyncObjEngine *engine
        just keep this ObjEngine disconnect errors at this engine. */
     osync_obj_engine_event(engine, OSYNC_ENGINE_EVENT_DISCONNECTED, NULL);
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->sink_errors | engine->sink_disconnects));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->sink_errors, &engine->sink_disconnects));
 
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
@@ -150,10 +151,10 @@ static void _osync_obj_engine_disconnect_callback(OSyncClientProxy *proxy, void
 	
   if (error) {
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, engine->objtype, error);
   } else {
-    engine->sink_disconnects = engine->sink_disconnects | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_disconnects, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_DISCONNECTED, engine->objtype, NULL);
   }
 	
@@ -220,6 +221,12 @@ osync_bool osync_obj_engine_map_changes(OSyncObjEngine *engine, OSyncError **err
   /* Go through all sink engines that are available */
   for (v = engine->sink_engines; v; v = v->next) {
     OSyncSinkEngine *sinkengine = v->data;
+
+    /* Mapping adds entries, the uids collected while reading get stale */
+    if (sinkengine->mapped_uids) {
+      g_hash_table_destroy(sinkengine->mapped_uids);
+      sinkengine->mapped_uids = NULL;
+    }
 		
     /* We use a temp list to speed things up. We dont have to compare with newly created mappings for
      * the current sinkengine, since there will be only one entry (for the current sinkengine) so there
@@ -288,16 +295,16 @@ static void _osync_obj_engine_read_callback(OSyncClientProxy *proxy, void *userd
 	
   if (error) {
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, engine->objtype, error);
   } else {
-    engine->sink_get_changes = engine->sink_get_changes | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_get_changes, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_READ, engine->objtype, NULL);
   }
 	
-  if (osync_bitcount(engine->sink_errors | engine->sink_get_changes) == g_list_length(engine->sink_engines)) {
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_get_changes) == engine->num_sink_engines) {
 		
-    if (osync_bitcount(engine->sink_get_changes) < osync_bitcount(engine->sink_connects)) {
+    if (osync_bitset_count(&engine->sink_get_changes) < osync_bitset_count(&engine->sink_connects)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "Fewer sink_engines reported get_changes than connected");
       osync_obj_engine_set_error(engine, locerror);
     } else {
@@ -317,11 +324,25 @@ static void _osync_obj_engine_read_callback(OSyncClientProxy *proxy, void *userd
 
     osync_obj_engine_event(engine, OSYNC_ENGINE_EVENT_READ, locerror ? locerror : error);
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->sink_errors | engine->sink_get_changes));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->sink_errors, &engine->sink_get_changes));
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
+osync_bool osync_obj_engine_check_get_changes(OSyncObjEngine *engine)
+{
+  osync_assert(engine);
+
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_get_changes) != engine->num_sink_engines)
+    return FALSE;
+
+  /* Pipelined, the other object engines don't matter. The main sinks do */
+  if (osync_engine_is_pipelined(engine->parent))
+    return osync_engine_check_main_get_changes(engine->parent);
+
+  return osync_engine_check_get_changes(engine->parent);
+}
+
 osync_bool osync_obj_engine_receive_change(OSyncObjEngine *objengine, OSyncClientProxy *proxy, OSyncChange *change, OSyncError **error)
 {
   OSyncSinkEngine *sinkengine = NULL;
@@ -370,6 +391,36 @@ osync_bool osync_obj_engine_receive_change(OSyncObjEngine *objengine, OSyncClien
   return TRUE;
 }
 
+osync_bool osync_obj_engine_is_mapped(OSyncObjEngine *engine, OSyncClientProxy *proxy, OSyncChange *change)
+{
+  OSyncSinkEngine *sinkengine = NULL;
+  GList *s = NULL, *e = NULL;
+  osync_assert(engine);
+  osync_assert(change);
+	
+  for (s = engine->sink_engines; s; s = s->next) {
+    sinkengine = s->data;
+    if (sinkengine->proxy != proxy)
+      continue;
+
+    /* The entries don't change until the changes get mapped, so the uids
+       get collected once instead of scanning the entries for every change */
+    if (!sinkengine->mapped_uids) {
+      sinkengine->mapped_uids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+      for (e = sinkengine->entries; e; e = e->next) {
+        OSyncMappingEntryEngine *entry_engine = e->data;
+        const char *uid = osync_mapping_entry_get_uid(entry_engine->entry);
+        g_hash_table_insert(sinkengine->mapped_uids, g_strdup(uid), GINT_TO_POINTER(1));
+      }
+    }
+
+    if (g_hash_table_lookup(sinkengine->mapped_uids, osync_change_get_uid(change)))
+      return TRUE;
+  }
+	
+  return FALSE;
+}
+
 /* Note: This function got shared between _osync_obj_engine_commit_change_callback() and
    osync_obj_engine_written_callback(). Those function call _osync_obj_engine_generate_written_event()
    with the most recent error and pass it to this function as last argument "error". If no error
@@ -419,11 +470,11 @@ static void _osync_obj_engine_generate_written_event(OSyncObjEngine *engine, OSy
   osync_trace(TRACE_INTERNAL, "%s: Not dirty anymore", __func__);
 
   /* And that we received the written replies from all sinks */
-  if (osync_bitcount(engine->sink_errors | engine->sink_written) == g_list_length(engine->sink_engines)) {
-    if (osync_bitcount(engine->sink_written) < osync_bitcount(engine->sink_connects)) {
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_written) == engine->num_sink_engines) {
+    if (osync_bitset_count(&engine->sink_written) < osync_bitset_count(&engine->sink_connects)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "Fewer sink_engines reported committed all than connected");
       osync_obj_engine_set_error(engine, locerror);
-    } else if (osync_bitcount(engine->sink_errors)) {
+    } else if (osync_bitset_count(&engine->sink_errors)) {
       /* Emit engine-wide error if one of the sinks got an error (tests: single_commit_error, ...) */
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "At least one Sink Engine failed while committing");
       osync_obj_engine_set_error(engine, locerror);
@@ -432,21 +483,81 @@ static void _osync_obj_engine_generate_written_event(OSyncObjEngine *engine, OSy
     osync_obj_engine_event(engine, OSYNC_ENGINE_EVENT_WRITTEN, locerror ? locerror : error);
 
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->sink_errors | engine->sink_written));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->sink_errors, &engine->sink_written));
 
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
+/* Identifies the change a mapping got written from: the member and the hash of the master change */
+static char *_osync_obj_engine_checkpoint_signature(OSyncMappingEntryEngine *entry_engine)
+{
+  OSyncMappingEntryEngine *master = entry_engine->mapping_engine->master;
+  OSyncChange *change = NULL;
+  OSyncMember *member = NULL;
+
+  if (!master)
+    return NULL;
+
+  change = osync_entry_engine_get_change(master);
+  if (!change || !osync_change_get_hash(change))
+    return NULL;
+
+  member = osync_client_proxy_get_member(master->sink_engine->proxy);
+  return g_strdup_printf("%lli:%i:%s", osync_member_get_id(member), osync_change_get_changetype(change), osync_change_get_hash(change));
+}
+
+static char *_osync_obj_engine_checkpoint_key(long long int mappingid, long long int memberid)
+{
+  return g_strdup_printf("%lli:%lli", mappingid, memberid);
+}
+
+static osync_bool _osync_obj_engine_load_checkpoint_entry(long long int mappingid, long long int memberid, const char *signature, void *userdata, OSyncError **error)
+{
+  OSyncObjEngine *engine = userdata;
+
+  /* Entries without signature got written, but can't be matched to a change */
+  if (signature)
+    g_hash_table_insert(engine->checkpoint, _osync_obj_engine_checkpoint_key(mappingid, memberid), g_strdup(signature));
+
+  return TRUE;
+}
+
+/* TRUE if the interrupted synchronization already wrote the change of the entry */
+static osync_bool _osync_obj_engine_checkpoint_written(OSyncObjEngine *engine, OSyncMappingEntryEngine *entry_engine)
+{
+  OSyncMember *member = osync_client_proxy_get_member(entry_engine->sink_engine->proxy);
+  const char *written = NULL;
+  char *signature = NULL;
+  char *key = NULL;
+  osync_bool ret = FALSE;
+
+  key = _osync_obj_engine_checkpoint_key(osync_mapping_get_id(entry_engine->mapping_engine->mapping), osync_member_get_id(member));
+  written = g_hash_table_lookup(engine->checkpoint, key);
+  g_free(key);
+
+  if (!written)
+    return FALSE;
+
+  signature = _osync_obj_engine_checkpoint_signature(entry_engine);
+  if (signature && !strcmp(signature, written))
+    ret = TRUE;
+
+  g_free(signature);
+  return ret;
+}
+
 static void _osync_obj_engine_commit_change_callback(OSyncClientProxy *proxy, void *userdata, const char *uid, OSyncError *error)
 {
   OSyncMappingEntryEngine *entry_engine = userdata;
   OSyncObjEngine *engine = entry_engine->objengine;
   OSyncSinkEngine *sinkengine = entry_engine->sink_engine;
   OSyncError *locerror = NULL;
+  OSyncError *checkpoint_error = NULL;
   OSyncMapping *mapping = NULL;
   OSyncMember *member = NULL;
   OSyncMappingEntry *entry = NULL;
   const char *objtype = NULL;
+  char *signature = NULL;
   long long int id = 0;
 
 	
@@ -468,7 +579,7 @@ static void _osync_obj_engine_commit_change_callback(OSyncClientProxy *proxy, vo
     osync_status_update_mapping(engine->parent, entry_engine->mapping_engine, OSYNC_MAPPING_EVENT_ERROR, error);
 
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     goto error;
   }
 	
@@ -484,6 +595,14 @@ static void _osync_obj_engine_commit_change_callback(OSyncClientProxy *proxy, vo
       /* TODO error handling */
       osync_archive_save_change(engine->archive, id, osync_change_get_uid(entry_engine->change), objtype, osync_mapping_get_id(mapping), osync_member_get_id(member), &locerror);
     }
+
+    /* A resumed synchronization doesn't write this entry again */
+    signature = _osync_obj_engine_checkpoint_signature(entry_engine);
+    if (!osync_archive_save_checkpoint_entry(engine->archive, objtype, osync_mapping_get_id(mapping), osync_member_get_id(member), signature, &checkpoint_error)) {
+      osync_trace(TRACE_ERROR, "Unable to save the checkpoint: %s", osync_error_print(&checkpoint_error));
+      osync_error_unref(&checkpoint_error);
+    }
+    g_free(signature);
   }
 
   osync_assert(entry_engine->mapping_engine);
@@ -507,10 +626,10 @@ static void _osync_obj_engine_written_callback(OSyncClientProxy *proxy, void *us
 	
   if (error) {
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, engine->objtype, error);
   } else {
-    engine->sink_written = engine->sink_written | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_written, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_WRITTEN, engine->objtype, NULL);
   }
 			
@@ -529,22 +648,26 @@ static void _osync_obj_engine_sync_done_callback(OSyncClientProxy *proxy, void *
 	
   if (error) {
     osync_obj_engine_set_error(engine, error);
-    engine->sink_errors = engine->sink_errors | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_errors, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_ERROR, engine->objtype, error);
   } else {
-    engine->sink_sync_done = engine->sink_sync_done | (0x1 << sinkengine->position);
+    osync_bitset_set(&engine->sink_sync_done, sinkengine->position);
     osync_status_update_member(engine->parent, osync_client_proxy_get_member(proxy), OSYNC_CLIENT_EVENT_SYNC_DONE, engine->objtype, NULL);
   }
 			
-  if (osync_bitcount(engine->sink_errors | engine->sink_sync_done) == g_list_length(engine->sink_engines)) {
-    if (osync_bitcount(engine->sink_sync_done) < osync_bitcount(engine->sink_connects)) {
+  if (osync_bitset_count_union(&engine->sink_errors, &engine->sink_sync_done) == engine->num_sink_engines) {
+    if (osync_bitset_count(&engine->sink_sync_done) < osync_bitset_count(&engine->sink_connects)) {
       osync_error_set(&locerror, OSYNC_ERROR_GENERIC, "Fewer sink_engines reported sync_done than connected");
       osync_obj_engine_set_error(engine, locerror);
+    } else if (engine->archive && !engine->error && !osync_bitset_count(&engine->sink_errors)) {
+      /* All members committed their state, there is nothing to resume anymore */
+      if (!osync_archive_flush_checkpoint(engine->archive, engine->objtype, &locerror))
+        osync_obj_engine_set_error(engine, locerror);
     }
 
     osync_obj_engine_event(engine, OSYNC_ENGINE_EVENT_SYNC_DONE, locerror ? locerror : error);
   } else
-    osync_trace(TRACE_INTERNAL, "Not yet: %i", osync_bitcount(engine->sink_errors | engine->sink_sync_done));
+    osync_trace(TRACE_INTERNAL, "Not yet: %u", osync_bitset_count_union(&engine->sink_errors, &engine->sink_sync_done));
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
@@ -692,6 +815,14 @@ void osync_obj_engine_unref(OSyncObjEngine *engine)
 			
       engine->sink_engines = g_list_remove(engine->sink_engines, sinkengine);
     }
+    engine->num_sink_engines = 0;
+
+    osync_bitset_clear(&engine->sink_errors);
+    osync_bitset_clear(&engine->sink_connects);
+    osync_bitset_clear(&engine->sink_disconnects);
+    osync_bitset_clear(&engine->sink_get_changes);
+    osync_bitset_clear(&engine->sink_sync_done);
+    osync_bitset_clear(&engine->sink_written);
 		
     while (engine->mapping_engines) {
       OSyncMappingEngine *mapping_engine = engine->mapping_engines->data;
@@ -708,6 +839,9 @@ void osync_obj_engine_unref(OSyncObjEngine *engine)
 		
     if (engine->mapping_table)
       osync_mapping_table_unref(engine->mapping_table);
+
+    if (engine->checkpoint)
+      g_hash_table_destroy(engine->checkpoint);
 		
     g_free(engine);
   }
@@ -759,9 +893,39 @@ osync_bool osync_obj_engine_initialize(OSyncObjEngine *engine, OSyncError **erro
       goto error;
 		
     engine->sink_engines = g_list_append(engine->sink_engines, sinkengine);
+    engine->num_sink_engines++;
   }
 
-  if (engine->archive && engine->slowsync) {
+  if (engine->archive) {
+    osync_bool slowsync = FALSE;
+    int ret;
+
+    engine->checkpoint = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    ret = osync_archive_load_checkpoint(engine->archive, engine->objtype, &slowsync, _osync_obj_engine_load_checkpoint_entry, engine, error);
+    if (ret < 0)
+      goto error;
+
+    if (ret && slowsync) {
+      /* The interrupted slow-sync isn't finished yet. The mappings it
+         wrote are kept, to not match them again. */
+      osync_trace(TRACE_INTERNAL, "Resuming interrupted slow-sync, %u entries got written", g_hash_table_size(engine->checkpoint));
+      engine->slowsync = TRUE;
+    } else if (ret && (!engine->slowsync || osync_engine_prev_sync_unclean(engine->parent))) {
+      /* The interrupted synchronization left the stale lock behind. Its
+         checkpoint tells what got written, no need to slow-sync. */
+      osync_trace(TRACE_INTERNAL, "Resuming interrupted synchronization, %u entries got written", g_hash_table_size(engine->checkpoint));
+      engine->slowsync = FALSE;
+    } else {
+      /* A slow-sync flushes the mappings the checkpoint refers to, it starts over */
+      if (ret && !osync_archive_flush_checkpoint(engine->archive, engine->objtype, error))
+        goto error;
+
+      g_hash_table_destroy(engine->checkpoint);
+      engine->checkpoint = NULL;
+    }
+  }
+
+  if (engine->archive && engine->slowsync && !engine->checkpoint) {
     if (!osync_mapping_table_flush(engine->mapping_table, engine->archive, engine->objtype, error))
       goto error;
   }
@@ -798,12 +962,12 @@ void osync_obj_engine_finalize(OSyncObjEngine *engine)
   engine->slowsync = FALSE;
   engine->written = FALSE;
 
-  engine->sink_errors = 0;
-  engine->sink_connects = 0;
-  engine->sink_disconnects = 0;
-  engine->sink_get_changes = 0;
-  engine->sink_sync_done = 0;
-  engine->sink_written = 0;
+  osync_bitset_reset(&engine->sink_errors);
+  osync_bitset_reset(&engine->sink_connects);
+  osync_bitset_reset(&engine->sink_disconnects);
+  osync_bitset_reset(&engine->sink_get_changes);
+  osync_bitset_reset(&engine->sink_sync_done);
+  osync_bitset_reset(&engine->sink_written);
 
   while (engine->sink_engines) {
     OSyncSinkEngine *sinkengine = engine->sink_engines->data;
@@ -811,6 +975,7 @@ void osync_obj_engine_finalize(OSyncObjEngine *engine)
 		
     engine->sink_engines = g_list_remove(engine->sink_engines, sinkengine);
   }
+  engine->num_sink_engines = 0;
 	
   while (engine->conflicts) {
     mapping_engine = engine->conflicts->data;
@@ -829,6 +994,11 @@ void osync_obj_engine_finalize(OSyncObjEngine *engine)
   if (engine->mapping_table)
     osync_mapping_table_close(engine->mapping_table);
 
+  if (engine->checkpoint) {
+    g_hash_table_destroy(engine->checkpoint);
+    engine->checkpoint = NULL;
+  }
+
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
@@ -929,6 +1099,10 @@ osync_bool osync_obj_engine_command(OSyncObjEngine *engine, OSyncEngineCmd cmd,
     }
 				
     engine->written = TRUE;
+
+    /* Written entries get recorded, an interrupted synchronization resumes from them */
+    if (engine->archive && !osync_archive_begin_checkpoint(engine->archive, engine->objtype, engine->slowsync, error))
+      goto error;
 		
     /* Write the changes. First, we can multiply the winner in the mapping */
     osync_trace(TRACE_INTERNAL, "Preparing write. multiplying %i mappings", g_list_length(engine->mapping_engines));
@@ -983,10 +1157,7 @@ osync_bool osync_obj_engine_command(OSyncObjEngine *engine, OSyncEngineCmd cmd,
             osync_data_get_data(osync_change_get_data(entry_engine->change), (char **) &xmlformat, &xmlformat_size);
             osync_assert(xmlformat_size == osync_xmlformat_size());
 
-            if(!osync_xmlformat_assemble(xmlformat, &buffer, &size)) {
-              osync_error_set(error, OSYNC_ERROR_GENERIC, "Could not assamble the xmlformat");
-              goto error;	
-            }
+            osync_xmlformat_assemble_compact(xmlformat, &buffer, &size);
 
             if(!osync_archive_save_data(engine->archive, osync_mapping_get_id(mapping), objtype, buffer, size, error)) {
               g_free(buffer);	
@@ -1000,6 +1171,12 @@ osync_bool osync_obj_engine_command(OSyncObjEngine *engine, OSyncEngineCmd cmd,
           }
 
 
+        /* Skip the entries the interrupted synchronization already wrote with the same change */
+        if (engine->checkpoint && osync_entry_engine_is_dirty(entry_engine) && _osync_obj_engine_checkpoint_written(engine, entry_engine)) {
+          osync_trace(TRACE_INTERNAL, "Entry %s got written before the interruption", osync_change_get_uid(entry_engine->change));
+          osync_entry_engine_set_dirty(entry_engine, FALSE);
+        }
+
         /* Only commit change if the objtype sink is able/allowed to write. */
         if (objtype_sink && osync_objtype_sink_get_write(objtype_sink) && osync_entry_engine_is_dirty(entry_engine)) {
           OSyncChange *change = entry_engine->change;
@@ -1087,6 +1264,10 @@ osync_bool osync_obj_engine_command(OSyncObjEngine *engine, OSyncEngineCmd cmd,
     }
     break;
   case OSYNC_ENGINE_COMMAND_SYNC_DONE:
+    /* The members commit their state with sync_done, the archive has to be on disk first */
+    if (engine->archive && !osync_archive_sync(engine->archive, error))
+      goto error;
+
     for (p = engine->sink_engines; p; p = p->next) {
       sinkengine = p->data;
       if (!osync_client_proxy_sync_done(sinkengine->proxy, _osync_obj_engine_sync_done_callback, sinkengine, engine->objtype, error))
@@ -40,12 +40,16 @@ struct OSyncObjEngine {
 	OSyncError *error;
 	OSyncFormatEnv *formatenv;
 	
-	int sink_errors;
-	int sink_connects;
-	int sink_disconnects;
-	int sink_get_changes;
-	int sink_sync_done;
-	int sink_written;
+	/** Length of sink_engines, compared against the bitsets below **/
+	unsigned int num_sink_engines;
+
+	/** Sink engine positions which reached a state **/
+	OSyncBitset sink_errors;
+	OSyncBitset sink_connects;
+	OSyncBitset sink_disconnects;
+	OSyncBitset sink_get_changes;
+	OSyncBitset sink_sync_done;
+	OSyncBitset sink_written;
 	
 	OSyncObjEngineEventCallback callback;
 	void *callback_userdata;
@@ -54,8 +58,31 @@ struct OSyncObjEngine {
 
 	/** Written status of Object Engine. - TODO: Is this still needed?! **/
 	osync_bool written;
+
+	/** Entries written by an interrupted synchronization, "mappingid:memberid" -> signature.
+	 * NULL if the previous synchronization finished. **/
+	GHashTable *checkpoint;
 };
 
 OSyncMappingEngine *_osync_obj_engine_create_mapping_engine(OSyncObjEngine *engine, OSyncError **error);
 
+/*! @brief Checks if the changes got read far enough to start writing
+ *
+ * All sinks of the object engine and the main sinks have to be read.
+ * Unless the engine is pipelined, all other object engines as well.
+ *
+ * @param engine Pointer to the object engine
+ * @returns TRUE if the object engine can write
+ */
+osync_bool osync_obj_engine_check_get_changes(OSyncObjEngine *engine);
+
+/*! @brief Checks if a change of a member belongs to an existing mapping
+ *
+ * @param engine Pointer to an OSyncObjEngine
+ * @param proxy The client proxy of the member which reported the change
+ * @param change The change
+ * @returns TRUE if the member already has a mapping entry with the uid of the change
+ */
+osync_bool osync_obj_engine_is_mapped(OSyncObjEngine *engine, OSyncClientProxy *proxy, OSyncChange *change);
+
 #endif /*OPENSYNC_OBJ_ENGINE_INTERNALS_H_*/
@@ -87,6 +87,9 @@ void osync_sink_engine_unref(OSyncSinkEngine *engine)
 			
       engine->entries = g_list_remove(engine->entries, engine->entries->data);
     }
+
+    if (engine->mapped_uids)
+      g_hash_table_destroy(engine->mapped_uids);
 		
     g_free(engine);
   }
@@ -102,6 +105,6 @@ osync_bool osync_sink_engine_is_connected(OSyncSinkEngine *engine)
   if (!objengine)
     return FALSE;
 
-  return !!(objengine->sink_connects & (1 << engine->position));
+  return osync_bitset_test(&objengine->sink_connects, engine->position);
 }
 
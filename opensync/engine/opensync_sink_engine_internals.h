@@ -28,6 +28,8 @@ typedef struct OSyncSinkEngine {
 	OSyncObjEngine *engine;
 	GList *entries;
 	GList *unmapped;
+	/** Uids of the entries, built on the first lookup while reading. NULL until then **/
+	GHashTable *mapped_uids;
 } OSyncSinkEngine;
 
 OSyncSinkEngine *osync_sink_engine_new(int position, OSyncClientProxy *proxy, OSyncObjEngine *objengine, OSyncError **error);
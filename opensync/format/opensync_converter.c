@@ -28,6 +28,7 @@
 #include "format/opensync_objformat_internals.h"
 
 #include "opensync_converter_private.h"
+#include "opensync_format_cache_internals.h"
 
 
 /**
@@ -190,6 +191,7 @@ OSyncObjFormat *osync_converter_detect(OSyncFormatConverter *detector, OSyncData
 	OSyncObjFormat *sourceformat = NULL;
 	char *buffer = NULL;
 	unsigned int size = 0;
+	OSyncError *error = NULL;
 	
 	osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, detector, data);
 	osync_assert(detector);
@@ -215,6 +217,14 @@ OSyncObjFormat *osync_converter_detect(OSyncFormatConverter *detector, OSyncData
 		return NULL;
 	}
 	
+	/* Placeholders from the format cache don't have a detect function yet.
+	 * Without the plugin nothing gets detected. */
+	if (detector->cache_module && !osync_format_cache_module_resolve(detector->cache_module, &error)) {
+		osync_trace(TRACE_EXIT, "%s: %s", __func__, osync_error_print(&error));
+		osync_error_unref(&error);
+		return NULL;
+	}
+
 	osync_data_get_data(data, &buffer, &size);
 	if (!detector->detect_func || detector->detect_func(buffer, size, detector->userdata)) {
 		/* Successfully detected the data */
@@ -250,6 +260,9 @@ osync_bool osync_converter_invoke(OSyncFormatConverter *converter, OSyncData *da
 	osync_trace(TRACE_INTERNAL, "Converter of type %i, from %p(%s) to %p(%s)", converter->type, converter->source_format, osync_objformat_get_name(converter->source_format), converter->target_format, osync_objformat_get_name(converter->target_format));
 	
 	if (converter->type != OSYNC_CONVERTER_DETECTOR) {
+
+		if (converter->cache_module && !osync_format_cache_module_resolve(converter->cache_module, error))
+			goto error;
 		
 		osync_data_steal_data(data, &input_data, &input_size);
 		if (input_data) {
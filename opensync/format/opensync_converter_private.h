@@ -33,6 +33,9 @@ struct OSyncFormatConverter {
 	OSyncConverterType type;
 	int ref_count;
 	void *userdata;
+	/** The format plugin providing the functions, if this converter
+	 * got registered from the format cache and is not loaded yet */
+	struct OSyncFormatCacheModule *cache_module;
 };
 
 struct OSyncFormatConverterPath {
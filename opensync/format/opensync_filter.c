@@ -25,6 +25,7 @@
 #include "opensync-format.h"
 #include "opensync_filter_internals.h"
 #include "opensync_filter_private.h"
+#include "opensync_format_cache_internals.h"
 
 /**
  * @defgroup OSyncFilterAPI OpenSync Filter
@@ -82,6 +83,9 @@ OSyncFilter *osync_filter_new_custom(OSyncCustomFilter *custom_filter, const cha
 	filter->custom_filter = custom_filter;
 	osync_custom_filter_ref(custom_filter);
 	
+	/* The filter handles the objtype of its custom filter */
+	filter->objtype = g_strdup(custom_filter->objtype);
+	
 	filter->config = g_strdup(config);
 	filter->action = action;
 	filter->ref_count = 1;
@@ -124,6 +128,12 @@ void osync_filter_unref(OSyncFilter *filter)
 		if (filter->config)
 			g_free(filter->config);
 		
+		if (filter->custom_filter)
+			osync_custom_filter_unref(filter->custom_filter);
+		
+		if (filter->custom_filter_name)
+			g_free(filter->custom_filter_name);
+		
 		g_free(filter);
 	}
 }
@@ -169,6 +179,120 @@ const char *osync_filter_get_objtype(OSyncFilter *filter)
 	return filter->objtype;
 }
 
+/** @brief Gets the action of a filter
+ * 
+ * @param filter The filter
+ * @returns The action which gets invoked if the filter matches
+ **/
+OSyncFilterAction osync_filter_get_action(OSyncFilter *filter)
+{
+	osync_assert(filter);
+	return filter->action;
+}
+
+/** @brief Gets the object format a filter is restricted to
+ * 
+ * @param filter The filter
+ * @returns The object format of the custom filter or NULL if the filter
+ * doesn't use a custom filter and applies to every format
+ **/
+const char *osync_filter_get_objformat(OSyncFilter *filter)
+{
+	osync_assert(filter);
+	if (!filter->custom_filter)
+		return NULL;
+	return filter->custom_filter->objformat;
+}
+
+/** @brief Gets the name of the custom filter of a filter
+ * 
+ * @param filter The filter
+ * @returns The name of the custom filter, bound or not, or NULL if the
+ * filter doesn't use a custom filter
+ **/
+const char *osync_filter_get_custom_filter_name(OSyncFilter *filter)
+{
+	osync_assert(filter);
+	if (filter->custom_filter)
+		return filter->custom_filter->name;
+	return filter->custom_filter_name;
+}
+
+/** @brief Sets the name of the custom filter a filter should use
+ * 
+ * The custom filters are provided by the format plugins, which are not
+ * available while loading a group. The filter doesn't match anything until
+ * it got bound with osync_filter_bind_custom_filter().
+ * 
+ * @param filter The filter
+ * @param name The name of the custom filter
+ **/
+void osync_filter_set_custom_filter_name(OSyncFilter *filter, const char *name)
+{
+	osync_trace(TRACE_ENTRY, "%s(%p, %s)", __func__, filter, name);
+	osync_assert(filter);
+	
+	if (filter->custom_filter) {
+		osync_custom_filter_unref(filter->custom_filter);
+		filter->custom_filter = NULL;
+	}
+	
+	if (filter->custom_filter_name)
+		g_free(filter->custom_filter_name);
+	filter->custom_filter_name = g_strdup(name);
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+/** @brief Binds a filter to its custom filter
+ * 
+ * Looks up the custom filter set by osync_filter_set_custom_filter_name()
+ * in the format environment. Filters without a custom filter and already
+ * bound ones are left alone.
+ * 
+ * @param filter The filter
+ * @param formatenv The format environment which provides the custom filters
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE if the custom filter can't be found
+ **/
+osync_bool osync_filter_bind_custom_filter(OSyncFilter *filter, OSyncFormatEnv *formatenv, OSyncError **error)
+{
+	OSyncCustomFilter *custom_filter = NULL;
+	int i, num;
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, filter, formatenv, error);
+	osync_assert(filter);
+	osync_assert(formatenv);
+	
+	if (filter->custom_filter || !filter->custom_filter_name) {
+		osync_trace(TRACE_EXIT, "%s: Nothing to bind", __func__);
+		return TRUE;
+	}
+	
+	num = osync_format_env_num_filters(formatenv);
+	for (i = 0; i < num; i++) {
+		custom_filter = osync_format_env_nth_filter(formatenv, i);
+		if (!strcmp(custom_filter->name, filter->custom_filter_name) && !strcmp(custom_filter->objtype, filter->objtype))
+			break;
+		custom_filter = NULL;
+	}
+	
+	if (!custom_filter) {
+		osync_error_set(error, OSYNC_ERROR_MISCONFIGURATION, "Unable to find the custom filter %s for %s", filter->custom_filter_name, filter->objtype);
+		goto error;
+	}
+	
+	filter->custom_filter = osync_custom_filter_ref(custom_filter);
+	g_free(filter->custom_filter_name);
+	filter->custom_filter_name = NULL;
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+	return TRUE;
+
+error:
+	osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+	return FALSE;
+}
+
 /** @brief Invokes a filter on a data object
  * 
  * @param filter The filter
@@ -186,9 +310,13 @@ OSyncFilterAction osync_filter_invoke(OSyncFilter *filter, OSyncData *data)
 	
 	/* If this filter doesn't use a custom filter function, we return
 	 * the action specified */
-	if (!filter->custom_filter)
+	if (!filter->custom_filter && !filter->custom_filter_name)
 		return filter->action;
 	
+	/* A custom filter which didn't get bound can't match */
+	if (!filter->custom_filter)
+		return OSYNC_FILTER_IGNORE;
+	
 	/* If this filter uses a custom filter function, we invoke the
 	 * custom filter */
 	if (osync_custom_filter_invoke(filter->custom_filter, data, filter->config)) {
@@ -278,6 +406,7 @@ void osync_custom_filter_unref(OSyncCustomFilter *filter)
  **/
 osync_bool osync_custom_filter_invoke(OSyncCustomFilter *filter, OSyncData *data, const char *config)
 {
+	OSyncError *error = NULL;
 	osync_assert(filter);
 	osync_assert(data);
 	
@@ -289,6 +418,16 @@ osync_bool osync_custom_filter_invoke(OSyncCustomFilter *filter, OSyncData *data
 	if (strcmp(filter->objformat, osync_objformat_get_name(osync_data_get_objformat(data))))
 		return FALSE;
 	
+	/* Placeholders from the format cache don't have a hook yet */
+	if (filter->cache_module && !osync_format_cache_module_resolve(filter->cache_module, &error)) {
+		osync_trace(TRACE_ERROR, "Filter %s: %s", filter->name, osync_error_print(&error));
+		osync_error_unref(&error);
+		return FALSE;
+	}
+
+	if (!filter->hook)
+		return FALSE;
+
 	/* We now check if the filter matches the data */
 	return filter->hook(data, config);
 }
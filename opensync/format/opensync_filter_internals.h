@@ -42,6 +42,11 @@ OSYNC_TEST_EXPORT void osync_filter_unref(OSyncFilter *filter);
 OSYNC_TEST_EXPORT void osync_filter_set_config(OSyncFilter *filter, const char *config);
 OSYNC_TEST_EXPORT const char *osync_filter_get_config(OSyncFilter *filter);
 OSYNC_TEST_EXPORT const char *osync_filter_get_objtype(OSyncFilter *filter);
+OSYNC_TEST_EXPORT OSyncFilterAction osync_filter_get_action(OSyncFilter *filter);
+const char *osync_filter_get_objformat(OSyncFilter *filter);
+OSYNC_TEST_EXPORT const char *osync_filter_get_custom_filter_name(OSyncFilter *filter);
+OSYNC_TEST_EXPORT void osync_filter_set_custom_filter_name(OSyncFilter *filter, const char *name);
+OSYNC_TEST_EXPORT osync_bool osync_filter_bind_custom_filter(OSyncFilter *filter, OSyncFormatEnv *formatenv, OSyncError **error);
 OSyncFilterAction osync_filter_invoke(OSyncFilter *filter, OSyncData *data);
 
 OSYNC_TEST_EXPORT OSyncCustomFilter *osync_custom_filter_new(const char *objtype, const char *objformat, const char *name, OSyncFilterFunction hook, OSyncError **error);
@@ -28,6 +28,9 @@ struct OSyncFilter {
 	char *objtype;
 	OSyncFilterAction action;
 	OSyncCustomFilter *custom_filter;
+	/** Name of the custom filter to bind, if the filter got loaded
+	 * from the group configuration and is not bound yet */
+	char *custom_filter_name;
 	char *config;
 	int ref_count;
 };
@@ -41,6 +44,9 @@ struct OSyncCustomFilter {
 	char *objformat;
 	OSyncFilterFunction hook;
 	int ref_count;
+	/** The format plugin providing the hook, if this filter got
+	 * registered from the format cache and is not loaded yet */
+	struct OSyncFormatCacheModule *cache_module;
 };
 
 #endif /* _OPENSYNC_FILTER_PRIVATE_H_ */
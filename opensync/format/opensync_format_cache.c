@@ -0,0 +1,1003 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#include "opensync.h"
+#include "opensync_internals.h"
+#include "opensync_xml.h"
+
+#include "opensync-module.h"
+#include "opensync-format.h"
+
+#include "opensync_format_env_internals.h"
+#include "opensync_format_cache_internals.h"
+#include "opensync_objformat_private.h"
+#include "opensync_converter_private.h"
+#include "opensync_filter_internals.h"
+#include "opensync_filter_private.h"
+
+#include <time.h>
+#include <utime.h>
+
+/* Version of the manifest file layout */
+#define OSYNC_FORMAT_CACHE_VERSION "1"
+
+/* Manifests in the OpenSync home directory which didn't get used for
+ * that many seconds are removed when a manifest gets rebuilt */
+#define OSYNC_FORMAT_CACHE_MAX_AGE	(30 * 24 * 60 * 60)
+
+/* A used manifest gets its modification time refreshed at most once
+ * per interval. Unreadable leftovers older than that are removed. */
+#define OSYNC_FORMAT_CACHE_TOUCH_INTERVAL	(24 * 60 * 60)
+
+typedef enum {
+	OSYNC_FORMAT_CACHE_OBJFORMAT,
+	OSYNC_FORMAT_CACHE_CONVERTER,
+	OSYNC_FORMAT_CACHE_FILTER
+} OSyncFormatCacheRecordType;
+
+/* A single registration of a module, recorded during a full load */
+typedef struct OSyncFormatCacheRecord {
+	OSyncFormatCacheRecordType type;
+	OSyncFormatCacheModule *module;
+	void *object;
+} OSyncFormatCacheRecord;
+
+static osync_bool _osync_format_cache_stat(const char *path, long long int *mtime, long long int *size)
+{
+	struct stat st;
+
+	if (g_stat(path, &st) < 0)
+		return FALSE;
+
+	*mtime = (long long int) st.st_mtime;
+	*size = (long long int) st.st_size;
+	return TRUE;
+}
+
+static OSyncFormatCacheModule *_osync_format_cache_find_module(OSyncFormatCache *cache, const char *path)
+{
+	GList *m = NULL;
+	for (m = cache->modules; m; m = m->next) {
+		OSyncFormatCacheModule *module = m->data;
+		if (!strcmp(module->path, path))
+			return module;
+	}
+	return NULL;
+}
+
+static OSyncFormatCacheModule *_osync_format_cache_module_new(OSyncFormatCache *cache, const char *path, OSyncError **error)
+{
+	OSyncFormatCacheModule *module = osync_try_malloc0(sizeof(OSyncFormatCacheModule), error);
+	if (!module)
+		return NULL;
+
+	module->path = g_strdup(path);
+	cache->modules = g_list_append(cache->modules, module);
+	return module;
+}
+
+static void _osync_format_cache_module_free(OSyncFormatCacheModule *module)
+{
+	g_free(module->path);
+	g_free(module);
+}
+
+static void _osync_format_cache_clear_records(OSyncFormatCache *cache)
+{
+	GList *r = NULL;
+	for (r = cache->records; r; r = r->next)
+		g_free(r->data);
+
+	g_list_free(cache->records);
+	cache->records = NULL;
+}
+
+static void _osync_format_cache_clear_modules(OSyncFormatCache *cache)
+{
+	GList *m = NULL;
+	for (m = cache->modules; m; m = m->next)
+		_osync_format_cache_module_free(m->data);
+
+	g_list_free(cache->modules);
+	cache->modules = NULL;
+}
+
+static void _osync_format_cache_record(OSyncFormatCache *cache, OSyncFormatCacheRecordType type, void *object)
+{
+	OSyncFormatCacheRecord *record = NULL;
+
+	if (!cache->current)
+		return;
+
+	record = osync_try_malloc0(sizeof(OSyncFormatCacheRecord), NULL);
+	if (!record)
+		return;
+
+	record->type = type;
+	record->module = cache->current;
+	record->object = object;
+	cache->records = g_list_append(cache->records, record);
+}
+
+/* TRUE if the manifest is unreadable or its format plugin directory is gone */
+static osync_bool _osync_format_cache_is_orphan(const char *filename)
+{
+	xmlDoc *doc = NULL;
+	xmlNode *root = NULL;
+	char *path = NULL;
+	osync_bool orphan = TRUE;
+
+	doc = xmlReadFile(filename, NULL, XML_PARSE_NOBLANKS | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+	if (!doc)
+		return TRUE;
+
+	root = xmlDocGetRootElement(doc);
+	if (root && !xmlStrcmp(root->name, BAD_CAST "formatcache")) {
+		path = osync_xml_find_property(root, "path");
+		if (path && g_file_test(path, G_FILE_TEST_IS_DIR))
+			orphan = FALSE;
+		osync_xml_free(path);
+	}
+
+	osync_xml_free_doc(doc);
+	return orphan;
+}
+
+/* Checks that the format plugin directory still contains exactly the
+ * modules listed in the manifest */
+static osync_bool _osync_format_cache_check_directory(OSyncFormatCache *cache)
+{
+	GDir *dir = NULL;
+	const gchar *de = NULL;
+	unsigned int found = 0;
+	osync_bool valid = TRUE;
+
+	dir = g_dir_open(cache->path, 0, NULL);
+	if (!dir)
+		return FALSE;
+
+	while (valid && (de = g_dir_read_name(dir))) {
+		char *filename = g_strdup_printf("%s%c%s", cache->path, G_DIR_SEPARATOR, de);
+
+		if (g_file_test(filename, G_FILE_TEST_IS_REGULAR) && g_pattern_match_simple("*."G_MODULE_SUFFIX, filename)) {
+			if (_osync_format_cache_find_module(cache, filename))
+				found++;
+			else
+				valid = FALSE;
+		}
+
+		g_free(filename);
+	}
+
+	g_dir_close(dir);
+
+	if (found != g_list_length(cache->modules))
+		valid = FALSE;
+
+	return valid;
+}
+
+static osync_bool _osync_format_cache_parse_modules(OSyncFormatCache *cache, xmlNode *cur)
+{
+	for (; cur; cur = cur->next) {
+		OSyncFormatCacheModule *module = NULL;
+		char *path = NULL, *mtime = NULL, *size = NULL;
+		long long int cur_mtime = 0, cur_size = 0;
+		osync_bool valid = FALSE;
+
+		if (cur->type != XML_ELEMENT_NODE || xmlStrcmp(cur->name, BAD_CAST "module"))
+			continue;
+
+		path = osync_xml_find_property(cur, "path");
+		mtime = osync_xml_find_property(cur, "mtime");
+		size = osync_xml_find_property(cur, "size");
+
+		if (path && mtime && size && _osync_format_cache_stat(path, &cur_mtime, &cur_size)) {
+			module = _osync_format_cache_module_new(cache, path, NULL);
+			if (module) {
+				module->mtime = g_ascii_strtoll(mtime, NULL, 10);
+				module->size = g_ascii_strtoll(size, NULL, 10);
+				valid = (module->mtime == cur_mtime && module->size == cur_size);
+			}
+		}
+
+		if (!valid)
+			osync_trace(TRACE_INTERNAL, "Format cache entry for %s is outdated", __NULLSTR(path));
+
+		osync_xml_free(path);
+		osync_xml_free(mtime);
+		osync_xml_free(size);
+
+		if (!valid)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Makes sure every converter of the manifest can be connected to its formats
+ * before anything gets registered */
+static osync_bool _osync_format_cache_check_formats(OSyncFormatEnv *env, xmlNode *root)
+{
+	xmlNode *cur = NULL, *fmt = NULL;
+	osync_bool valid = TRUE;
+
+	for (cur = root; valid && cur; cur = cur->next) {
+		char *source = NULL, *target = NULL, *name = NULL;
+		osync_bool source_found = FALSE, target_found = FALSE;
+
+		if (cur->type != XML_ELEMENT_NODE || xmlStrcmp(cur->name, BAD_CAST "converter"))
+			continue;
+
+		source = osync_xml_find_property(cur, "source");
+		target = osync_xml_find_property(cur, "target");
+		if (!source || !target) {
+			valid = FALSE;
+			goto next;
+		}
+
+		source_found = osync_format_env_find_objformat(env, source) ? TRUE : FALSE;
+		target_found = osync_format_env_find_objformat(env, target) ? TRUE : FALSE;
+
+		for (fmt = root; fmt && (!source_found || !target_found); fmt = fmt->next) {
+			if (fmt->type != XML_ELEMENT_NODE || xmlStrcmp(fmt->name, BAD_CAST "objformat"))
+				continue;
+
+			name = osync_xml_find_property(fmt, "name");
+			if (name && !strcmp(name, source))
+				source_found = TRUE;
+			if (name && !strcmp(name, target))
+				target_found = TRUE;
+			osync_xml_free(name);
+		}
+
+		valid = source_found && target_found;
+	next:
+		osync_xml_free(source);
+		osync_xml_free(target);
+	}
+
+	return valid;
+}
+
+static OSyncFormatCacheModule *_osync_format_cache_nth_module(OSyncFormatCache *cache, xmlNode *cur)
+{
+	OSyncFormatCacheModule *module = NULL;
+	char *index = osync_xml_find_property(cur, "module");
+	if (index) {
+		module = g_list_nth_data(cache->modules, atoi(index));
+		osync_xml_free(index);
+	}
+	return module;
+}
+
+static osync_bool _osync_format_cache_register_placeholders(OSyncFormatCache *cache, OSyncFormatEnv *env, xmlNode *cur, OSyncError **error)
+{
+	for (; cur; cur = cur->next) {
+		OSyncFormatCacheModule *module = NULL;
+
+		if (cur->type != XML_ELEMENT_NODE || !xmlStrcmp(cur->name, BAD_CAST "module"))
+			continue;
+
+		module = _osync_format_cache_nth_module(cache, cur);
+		if (!module) {
+			osync_error_set(error, OSYNC_ERROR_MISCONFIGURATION, "Format cache %s references an unknown module", cache->filename);
+			return FALSE;
+		}
+
+		if (!xmlStrcmp(cur->name, BAD_CAST "objformat")) {
+			OSyncObjFormat *format = NULL;
+			char *name = osync_xml_find_property(cur, "name");
+			char *objtype = osync_xml_find_property(cur, "objtype");
+
+			format = osync_objformat_new(name, objtype, error);
+			osync_xml_free(name);
+			osync_xml_free(objtype);
+			if (!format)
+				return FALSE;
+
+			format->cache_module = module;
+			osync_format_env_register_objformat(env, format);
+			osync_objformat_unref(format);
+		} else if (!xmlStrcmp(cur->name, BAD_CAST "converter")) {
+			OSyncFormatConverter *converter = NULL;
+			OSyncConverterType type = OSYNC_CONVERTER_CONV;
+			char *source = osync_xml_find_property(cur, "source");
+			char *target = osync_xml_find_property(cur, "target");
+			char *typestr = osync_xml_find_property(cur, "type");
+
+			if (typestr)
+				type = atoi(typestr);
+
+			if (type == OSYNC_CONVERTER_DETECTOR)
+				converter = osync_converter_new_detector(osync_format_env_find_objformat(env, source), osync_format_env_find_objformat(env, target), NULL, error);
+			else
+				converter = osync_converter_new(type, osync_format_env_find_objformat(env, source), osync_format_env_find_objformat(env, target), NULL, error);
+
+			osync_xml_free(source);
+			osync_xml_free(target);
+			osync_xml_free(typestr);
+			if (!converter)
+				return FALSE;
+
+			converter->cache_module = module;
+			osync_format_env_register_converter(env, converter);
+			osync_converter_unref(converter);
+		} else if (!xmlStrcmp(cur->name, BAD_CAST "filter")) {
+			OSyncCustomFilter *filter = NULL;
+			char *name = osync_xml_find_property(cur, "name");
+			char *objtype = osync_xml_find_property(cur, "objtype");
+			char *objformat = osync_xml_find_property(cur, "objformat");
+
+			filter = osync_custom_filter_new(objtype, objformat, name, NULL, error);
+			osync_xml_free(name);
+			osync_xml_free(objtype);
+			osync_xml_free(objformat);
+			if (!filter)
+				return FALSE;
+
+			filter->cache_module = module;
+			osync_format_env_register_filter(env, filter);
+			osync_custom_filter_unref(filter);
+		}
+	}
+
+	return TRUE;
+}
+
+static void _osync_format_cache_assign_objformat(OSyncFormatCacheModule *module, OSyncObjFormat *format)
+{
+	GList *f = NULL;
+
+	for (f = module->env->objformats; f; f = f->next) {
+		OSyncObjFormat *placeholder = f->data;
+		if (placeholder->cache_module != module || strcmp(placeholder->name, format->name))
+			continue;
+
+		placeholder->cmp_func = format->cmp_func;
+		placeholder->duplicate_func = format->duplicate_func;
+		placeholder->copy_func = format->copy_func;
+		placeholder->create_func = format->create_func;
+		placeholder->destroy_func = format->destroy_func;
+		placeholder->print_func = format->print_func;
+		placeholder->revision_func = format->revision_func;
+		placeholder->marshal_func = format->marshal_func;
+		placeholder->demarshal_func = format->demarshal_func;
+		placeholder->validate_func = format->validate_func;
+		placeholder->cache_module = NULL;
+		return;
+	}
+
+	osync_trace(TRACE_ERROR, "Format %s of %s is not listed in the format cache", format->name, module->path);
+}
+
+static void _osync_format_cache_assign_converter(OSyncFormatCacheModule *module, OSyncFormatConverter *converter)
+{
+	GList *c = NULL;
+
+	for (c = module->env->converters; c; c = c->next) {
+		OSyncFormatConverter *placeholder = c->data;
+		if (placeholder->cache_module != module || placeholder->type != converter->type)
+			continue;
+
+		if (!osync_objformat_is_equal(placeholder->source_format, converter->source_format)
+		    || !osync_objformat_is_equal(placeholder->target_format, converter->target_format))
+			continue;
+
+		placeholder->convert_func = converter->convert_func;
+		placeholder->detect_func = converter->detect_func;
+		placeholder->initialize_func = converter->initialize_func;
+		placeholder->finalize_func = converter->finalize_func;
+		placeholder->cache_module = NULL;
+
+		osync_converter_initialize(placeholder, NULL, NULL);
+		return;
+	}
+
+	osync_trace(TRACE_ERROR, "Converter %s -> %s of %s is not listed in the format cache",
+	            osync_objformat_get_name(converter->source_format), osync_objformat_get_name(converter->target_format), module->path);
+}
+
+static void _osync_format_cache_assign_filter(OSyncFormatCacheModule *module, OSyncCustomFilter *filter)
+{
+	GList *f = NULL;
+
+	for (f = module->env->custom_filters; f; f = f->next) {
+		OSyncCustomFilter *placeholder = f->data;
+		if (placeholder->cache_module != module || strcmp(placeholder->name, filter->name))
+			continue;
+
+		placeholder->hook = filter->hook;
+		placeholder->cache_module = NULL;
+		return;
+	}
+
+	osync_trace(TRACE_ERROR, "Filter %s of %s is not listed in the format cache", filter->name, module->path);
+}
+
+/* Detaches all placeholders of the module, they don't load it anymore */
+static void _osync_format_cache_module_detach(OSyncFormatCacheModule *module)
+{
+	GList *l = NULL;
+
+	for (l = module->env->objformats; l; l = l->next) {
+		OSyncObjFormat *format = l->data;
+		if (format->cache_module == module)
+			format->cache_module = NULL;
+	}
+
+	for (l = module->env->converters; l; l = l->next) {
+		OSyncFormatConverter *converter = l->data;
+		if (converter->cache_module == module)
+			converter->cache_module = NULL;
+	}
+
+	for (l = module->env->custom_filters; l; l = l->next) {
+		OSyncCustomFilter *filter = l->data;
+		if (filter->cache_module == module)
+			filter->cache_module = NULL;
+	}
+}
+
+/* TRUE if the placeholder got registered from this cache */
+static osync_bool _osync_format_cache_owns(OSyncFormatCache *cache, OSyncFormatCacheModule *module)
+{
+	return module && g_list_find(cache->modules, module) ? TRUE : FALSE;
+}
+
+/* Removes all placeholders of the cache from the environment again. Only
+ * safe while the plugins get loaded, nothing else uses the environment. */
+static void _osync_format_cache_unregister_placeholders(OSyncFormatCache *cache, OSyncFormatEnv *env)
+{
+	GList *l = NULL, *next = NULL;
+
+	/* The inverse detectors don't know the module, but use its formats */
+	for (l = env->converters; l; l = next) {
+		OSyncFormatConverter *converter = l->data;
+		next = l->next;
+
+		if (!_osync_format_cache_owns(cache, converter->cache_module)
+		    && !(converter->source_format && _osync_format_cache_owns(cache, converter->source_format->cache_module))
+		    && !(converter->target_format && _osync_format_cache_owns(cache, converter->target_format->cache_module)))
+			continue;
+
+		env->converters = g_list_delete_link(env->converters, l);
+		osync_converter_unref(converter);
+	}
+
+	for (l = env->custom_filters; l; l = next) {
+		OSyncCustomFilter *filter = l->data;
+		next = l->next;
+
+		if (!_osync_format_cache_owns(cache, filter->cache_module))
+			continue;
+
+		env->custom_filters = g_list_delete_link(env->custom_filters, l);
+		osync_custom_filter_unref(filter);
+	}
+
+	for (l = env->objformats; l; l = next) {
+		OSyncObjFormat *format = l->data;
+		next = l->next;
+
+		if (!_osync_format_cache_owns(cache, format->cache_module))
+			continue;
+
+		env->objformats = g_list_delete_link(env->objformats, l);
+		osync_objformat_unref(format);
+	}
+}
+
+OSyncFormatCache *osync_format_cache_new(const char *path, const char *filename, OSyncError **error)
+{
+	OSyncFormatCache *cache = NULL;
+	osync_trace(TRACE_ENTRY, "%s(%s, %s, %p)", __func__, path, filename, error);
+
+	cache = osync_try_malloc0(sizeof(OSyncFormatCache), error);
+	if (!cache) {
+		osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+		return NULL;
+	}
+
+	cache->path = g_strdup(path);
+	cache->filename = g_strdup(filename);
+	cache->mutex = g_mutex_new();
+
+	osync_trace(TRACE_EXIT, "%s: %p", __func__, cache);
+	return cache;
+}
+
+void osync_format_cache_free(OSyncFormatCache *cache)
+{
+	GList *m = NULL;
+	osync_assert(cache);
+
+	for (m = cache->modules; m; m = m->next) {
+		OSyncFormatCacheModule *module = m->data;
+		if (module->env)
+			_osync_format_cache_module_detach(module);
+	}
+
+	_osync_format_cache_clear_records(cache);
+	_osync_format_cache_clear_modules(cache);
+
+	g_mutex_free(cache->mutex);
+	g_free(cache->filename);
+	g_free(cache->path);
+	g_free(cache);
+}
+
+char *osync_format_cache_filename(const char *configdir, const char *path)
+{
+	/* FNV-1a, the name must not change with the glib version */
+	guint32 hash = 2166136261U;
+	const unsigned char *c = NULL;
+
+	osync_assert(configdir);
+	osync_assert(path);
+
+	for (c = (const unsigned char *) path; *c; c++) {
+		hash ^= *c;
+		hash *= 16777619U;
+	}
+
+	return g_strdup_printf("%s%c"OSYNC_FORMAT_CACHE_PREFIX"%08x.xml", configdir, G_DIR_SEPARATOR, hash);
+}
+
+void osync_format_cache_prune(OSyncFormatCache *cache)
+{
+	char *dirname = NULL;
+	const gchar *de = NULL;
+	GDir *dir = NULL;
+	long long int now = (long long int) time(NULL);
+
+	osync_trace(TRACE_ENTRY, "%s(%p)", __func__, cache);
+	osync_assert(cache);
+
+	dirname = g_path_get_dirname(cache->filename);
+	dir = g_dir_open(dirname, 0, NULL);
+	if (!dir) {
+		osync_trace(TRACE_EXIT, "%s: Unable to open %s", __func__, dirname);
+		g_free(dirname);
+		return;
+	}
+
+	while ((de = g_dir_read_name(dir))) {
+		char *filename = NULL;
+		long long int mtime = 0, size = 0;
+		long long int age = 0;
+
+		if (!g_str_has_prefix(de, OSYNC_FORMAT_CACHE_PREFIX))
+			continue;
+
+		filename = g_strdup_printf("%s%c%s", dirname, G_DIR_SEPARATOR, de);
+
+		if (strcmp(filename, cache->filename)
+		    && g_file_test(filename, G_FILE_TEST_IS_REGULAR)
+		    && _osync_format_cache_stat(filename, &mtime, &size)) {
+			age = now - mtime;
+
+			/* Fresh files might just get written by another process */
+			if (age > OSYNC_FORMAT_CACHE_MAX_AGE
+			    || (age > OSYNC_FORMAT_CACHE_TOUCH_INTERVAL && _osync_format_cache_is_orphan(filename))) {
+				osync_trace(TRACE_INTERNAL, "Removing stale format cache %s", filename);
+				if (g_unlink(filename) < 0)
+					osync_trace(TRACE_INTERNAL, "Unable to remove %s: %s", filename, g_strerror(errno));
+			}
+		}
+
+		g_free(filename);
+	}
+
+	g_dir_close(dir);
+	g_free(dirname);
+
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+osync_bool osync_format_cache_load(OSyncFormatCache *cache, OSyncFormatEnv *env)
+{
+	xmlDoc *doc = NULL;
+	xmlNode *root = NULL;
+	char *version = NULL, *pluginversion = NULL, *path = NULL;
+	char *expected_pluginversion = NULL;
+	OSyncError *error = NULL;
+	GList *m = NULL;
+	osync_bool valid = FALSE;
+	long long int mtime = 0, size = 0;
+
+	osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, cache, env);
+	osync_assert(cache);
+	osync_assert(env);
+
+	if (!g_file_test(cache->filename, G_FILE_TEST_IS_REGULAR)) {
+		osync_trace(TRACE_EXIT, "%s: No format cache %s", __func__, cache->filename);
+		return FALSE;
+	}
+
+	doc = xmlReadFile(cache->filename, NULL, XML_PARSE_NOBLANKS);
+	if (!doc)
+		goto invalid;
+
+	root = xmlDocGetRootElement(doc);
+	if (!root || xmlStrcmp(root->name, BAD_CAST "formatcache"))
+		goto invalid;
+
+	version = osync_xml_find_property(root, "version");
+	pluginversion = osync_xml_find_property(root, "pluginversion");
+	path = osync_xml_find_property(root, "path");
+	expected_pluginversion = g_strdup_printf("%i", OPENSYNC_PLUGINVERSION);
+
+	valid = (version && !strcmp(version, OSYNC_FORMAT_CACHE_VERSION)
+	         && pluginversion && !strcmp(pluginversion, expected_pluginversion)
+	         && path && !strcmp(path, cache->path));
+
+	osync_xml_free(version);
+	osync_xml_free(pluginversion);
+	osync_xml_free(path);
+	g_free(expected_pluginversion);
+
+	if (!valid)
+		goto invalid;
+
+	if (!_osync_format_cache_parse_modules(cache, root->children)
+	    || !_osync_format_cache_check_directory(cache)
+	    || !_osync_format_cache_check_formats(env, root->children))
+		goto invalid;
+
+	for (m = cache->modules; m; m = m->next) {
+		OSyncFormatCacheModule *module = m->data;
+		module->env = env;
+	}
+
+	if (!_osync_format_cache_register_placeholders(cache, env, root->children, &error)) {
+		/* Only happens on a broken manifest or out of memory. The plugins
+		 * get loaded the regular way, without the placeholders. */
+		osync_trace(TRACE_ERROR, "Unable to register placeholders: %s", osync_error_print(&error));
+		osync_error_unref(&error);
+		_osync_format_cache_unregister_placeholders(cache, env);
+		goto invalid;
+	}
+
+	osync_xml_free_doc(doc);
+
+	/* Keeps the manifest from getting pruned as stale */
+	if (_osync_format_cache_stat(cache->filename, &mtime, &size)
+	    && (long long int) time(NULL) - mtime > OSYNC_FORMAT_CACHE_TOUCH_INTERVAL
+	    && utime(cache->filename, NULL) < 0)
+		osync_trace(TRACE_INTERNAL, "Unable to touch %s: %s", cache->filename, g_strerror(errno));
+
+	osync_trace(TRACE_EXIT, "%s: %i modules", __func__, g_list_length(cache->modules));
+	return TRUE;
+
+ invalid:
+	if (doc)
+		osync_xml_free_doc(doc);
+
+	_osync_format_cache_clear_modules(cache);
+
+	osync_trace(TRACE_EXIT, "%s: Format cache %s is outdated", __func__, cache->filename);
+	return FALSE;
+}
+
+osync_bool osync_format_cache_save(OSyncFormatCache *cache, OSyncError **error)
+{
+	xmlDoc *doc = NULL;
+	xmlNode *root = NULL, *node = NULL;
+	char *tmpfile = NULL, *str = NULL;
+	GList *l = NULL;
+
+	osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, cache, error);
+	osync_assert(cache);
+
+	doc = xmlNewDoc(BAD_CAST "1.0");
+	root = osync_xml_node_add_root(doc, "formatcache");
+
+	osync_xml_node_add_property(root, "version", OSYNC_FORMAT_CACHE_VERSION);
+	str = g_strdup_printf("%i", OPENSYNC_PLUGINVERSION);
+	osync_xml_node_add_property(root, "pluginversion", str);
+	g_free(str);
+	osync_xml_node_add_property(root, "path", cache->path);
+
+	for (l = cache->modules; l; l = l->next) {
+		OSyncFormatCacheModule *module = l->data;
+
+		node = xmlNewChild(root, NULL, BAD_CAST "module", NULL);
+		osync_xml_node_add_property(node, "path", module->path);
+
+		str = g_strdup_printf("%lld", module->mtime);
+		osync_xml_node_add_property(node, "mtime", str);
+		g_free(str);
+
+		str = g_strdup_printf("%lld", module->size);
+		osync_xml_node_add_property(node, "size", str);
+		g_free(str);
+	}
+
+	for (l = cache->records; l; l = l->next) {
+		OSyncFormatCacheRecord *record = l->data;
+
+		switch (record->type) {
+		case OSYNC_FORMAT_CACHE_OBJFORMAT:
+			{
+				OSyncObjFormat *format = record->object;
+				node = xmlNewChild(root, NULL, BAD_CAST "objformat", NULL);
+				osync_xml_node_add_property(node, "name", format->name);
+				if (format->objtype_name)
+					osync_xml_node_add_property(node, "objtype", format->objtype_name);
+			}
+			break;
+		case OSYNC_FORMAT_CACHE_CONVERTER:
+			{
+				OSyncFormatConverter *converter = record->object;
+				node = xmlNewChild(root, NULL, BAD_CAST "converter", NULL);
+				osync_xml_node_add_property(node, "source", osync_objformat_get_name(converter->source_format));
+				osync_xml_node_add_property(node, "target", osync_objformat_get_name(converter->target_format));
+				str = g_strdup_printf("%i", converter->type);
+				osync_xml_node_add_property(node, "type", str);
+				g_free(str);
+			}
+			break;
+		case OSYNC_FORMAT_CACHE_FILTER:
+			{
+				OSyncCustomFilter *filter = record->object;
+				node = xmlNewChild(root, NULL, BAD_CAST "filter", NULL);
+				if (filter->name)
+					osync_xml_node_add_property(node, "name", filter->name);
+				if (filter->objtype)
+					osync_xml_node_add_property(node, "objtype", filter->objtype);
+				if (filter->objformat)
+					osync_xml_node_add_property(node, "objformat", filter->objformat);
+			}
+			break;
+		}
+
+		str = g_strdup_printf("%i", g_list_index(cache->modules, record->module));
+		osync_xml_node_add_property(node, "module", str);
+		g_free(str);
+	}
+
+	_osync_format_cache_clear_records(cache);
+
+	/* Several processes might write the cache at the same time. Only
+	 * complete files get renamed into place. */
+	tmpfile = g_strdup_printf("%s.%i", cache->filename, (int) getpid());
+	if (xmlSaveFormatFile(tmpfile, doc, 0) < 0) {
+		osync_error_set(error, OSYNC_ERROR_IO_ERROR, "Unable to write format cache %s", tmpfile);
+		goto error;
+	}
+
+	if (g_rename(tmpfile, cache->filename) < 0) {
+		osync_error_set(error, OSYNC_ERROR_IO_ERROR, "Unable to write format cache %s: %s", cache->filename, g_strerror(errno));
+		g_unlink(tmpfile);
+		goto error;
+	}
+
+	g_free(tmpfile);
+	osync_xml_free_doc(doc);
+
+	osync_trace(TRACE_EXIT, "%s", __func__);
+	return TRUE;
+
+ error:
+	g_free(tmpfile);
+	osync_xml_free_doc(doc);
+	osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+	return FALSE;
+}
+
+void osync_format_cache_set_current(OSyncFormatCache *cache, const char *path)
+{
+	OSyncFormatCacheModule *module = NULL;
+	osync_assert(cache);
+
+	if (!path) {
+		cache->current = NULL;
+		return;
+	}
+
+	module = _osync_format_cache_find_module(cache, path);
+	if (!module) {
+		module = _osync_format_cache_module_new(cache, path, NULL);
+		if (module && !_osync_format_cache_stat(path, &module->mtime, &module->size))
+			osync_trace(TRACE_INTERNAL, "Unable to stat %s", path);
+	}
+
+	cache->current = module;
+}
+
+osync_bool osync_format_cache_register_objformat(OSyncFormatCache *cache, OSyncObjFormat *format)
+{
+	osync_assert(cache);
+
+	if (cache->resolving) {
+		cache->resolving->objformats = g_list_append(cache->resolving->objformats, osync_objformat_ref(format));
+		return TRUE;
+	}
+
+	_osync_format_cache_record(cache, OSYNC_FORMAT_CACHE_OBJFORMAT, format);
+	return FALSE;
+}
+
+osync_bool osync_format_cache_register_converter(OSyncFormatCache *cache, OSyncFormatConverter *converter)
+{
+	osync_assert(cache);
+
+	if (cache->resolving) {
+		cache->resolving->converters = g_list_append(cache->resolving->converters, osync_converter_ref(converter));
+		return TRUE;
+	}
+
+	_osync_format_cache_record(cache, OSYNC_FORMAT_CACHE_CONVERTER, converter);
+	return FALSE;
+}
+
+osync_bool osync_format_cache_register_filter(OSyncFormatCache *cache, OSyncCustomFilter *filter)
+{
+	osync_assert(cache);
+
+	if (cache->resolving) {
+		cache->resolving->filters = g_list_append(cache->resolving->filters, osync_custom_filter_ref(filter));
+		return TRUE;
+	}
+
+	_osync_format_cache_record(cache, OSYNC_FORMAT_CACHE_FILTER, filter);
+	return FALSE;
+}
+
+/* Loads the module and assigns its functions to the placeholders. Called
+ * with the mutex of the cache held. */
+static void _osync_format_cache_module_load(OSyncFormatCacheModule *module)
+{
+	OSyncFormatEnv *env = module->env;
+	OSyncModule *osmodule = NULL;
+	OSyncError *error = NULL;
+	GList *l = NULL;
+
+	osync_trace(TRACE_ENTRY, "%s(%p): %s", __func__, module, module->path);
+
+	module->resolved = TRUE;
+
+	osmodule = osync_module_new(&error);
+	if (!osmodule)
+		goto error;
+
+	if (!osync_module_load(osmodule, module->path, &error))
+		goto error_free_module;
+
+	if (!osync_module_check(osmodule, &error))
+		goto error_free_module;
+
+	env->cache->resolving = module;
+	osync_module_get_format_info(osmodule, env, &error);
+	if (osync_error_is_set(&error)) {
+		osync_trace(TRACE_ERROR, "Module load format plugin error for %s: %s", module->path, osync_error_print(&error));
+		osync_error_unref(&error);
+	}
+	osync_module_get_conversion_info(osmodule, env, &error);
+	if (osync_error_is_set(&error)) {
+		osync_trace(TRACE_INTERNAL, "Module get conversion error %s", osync_error_print(&error));
+		osync_error_unref(&error);
+	}
+	env->cache->resolving = NULL;
+
+	env->modules = g_list_append(env->modules, osmodule);
+
+	/* Functions might get set after the registration. Assign them only
+	 * after all info functions returned. */
+	for (l = module->objformats; l; l = l->next) {
+		_osync_format_cache_assign_objformat(module, l->data);
+		osync_objformat_unref(l->data);
+	}
+	g_list_free(module->objformats);
+	module->objformats = NULL;
+
+	for (l = module->converters; l; l = l->next) {
+		_osync_format_cache_assign_converter(module, l->data);
+		osync_converter_unref(l->data);
+	}
+	g_list_free(module->converters);
+	module->converters = NULL;
+
+	for (l = module->filters; l; l = l->next) {
+		_osync_format_cache_assign_filter(module, l->data);
+		osync_custom_filter_unref(l->data);
+	}
+	g_list_free(module->filters);
+	module->filters = NULL;
+
+	/* Placeholders which didn't get assigned stay attached and fail */
+	for (l = env->objformats; l; l = l->next) {
+		OSyncObjFormat *format = l->data;
+		if (format->cache_module == module)
+			module->failed = TRUE;
+	}
+
+	for (l = env->converters; l; l = l->next) {
+		OSyncFormatConverter *converter = l->data;
+		if (converter->cache_module == module)
+			module->failed = TRUE;
+	}
+
+	for (l = env->custom_filters; l; l = l->next) {
+		OSyncCustomFilter *filter = l->data;
+		if (filter->cache_module == module)
+			module->failed = TRUE;
+	}
+
+	osync_trace(TRACE_EXIT, "%s: %s", __func__, module->failed ? "incomplete" : "loaded");
+	return;
+
+ error_free_module:
+	osync_module_free(osmodule);
+ error:
+	/* The placeholders stay attached, so they fail instead of
+	 * getting used without their functions */
+	module->failed = TRUE;
+	osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&error));
+	osync_error_unref(&error);
+}
+
+osync_bool osync_format_cache_module_resolve(OSyncFormatCacheModule *module, OSyncError **error)
+{
+	OSyncFormatCache *cache = NULL;
+	osync_bool failed = FALSE;
+
+	osync_assert(module);
+	osync_assert(module->env);
+
+	cache = module->env->cache;
+	osync_assert(cache);
+
+	/* Engines of a host might need the same module at the same time */
+	g_mutex_lock(cache->mutex);
+
+	if (!module->resolved)
+		_osync_format_cache_module_load(module);
+	failed = module->failed;
+
+	g_mutex_unlock(cache->mutex);
+
+	if (failed) {
+		osync_error_set(error, OSYNC_ERROR_PLUGIN_NOT_FOUND, "Unable to load the format plugin %s", module->path);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void osync_format_cache_resolve_all(OSyncFormatCache *cache)
+{
+	GList *m = NULL;
+	osync_assert(cache);
+
+	for (m = cache->modules; m; m = m->next) {
+		OSyncFormatCacheModule *module = m->data;
+		OSyncError *error = NULL;
+
+		if (!module->env || module->resolved)
+			continue;
+
+		if (!osync_format_cache_module_resolve(module, &error)) {
+			osync_trace(TRACE_ERROR, "%s", osync_error_print(&error));
+			osync_error_unref(&error);
+		}
+	}
+}
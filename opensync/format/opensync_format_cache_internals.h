@@ -0,0 +1,157 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef _OPENSYNC_FORMAT_CACHE_INTERNALS_H_
+#define _OPENSYNC_FORMAT_CACHE_INTERNALS_H_
+
+/**
+ * @defgroup OSyncFormatCacheInternalAPI OpenSync Format Cache Internals
+ * @ingroup OSyncFormatPrivate
+ * @brief Persistent manifest of the format plugins of a directory
+ *
+ * The manifest records which object formats, converters and filters
+ * every format plugin registers. As long as the manifest is valid, the
+ * format environment only registers placeholders and a format plugin
+ * gets dlopen()ed the first time one of its functions is needed.
+ */
+/*@{*/
+
+/*! @brief A format plugin listed in the format cache */
+typedef struct OSyncFormatCacheModule {
+	/** Full path of the module */
+	char *path;
+	/** Modification time of the module when it got recorded */
+	long long int mtime;
+	/** Size of the module when it got recorded */
+	long long int size;
+	/** The format environment the placeholders of this module live in */
+	OSyncFormatEnv *env;
+	/** TRUE once loading the module got attempted */
+	osync_bool resolved;
+	/** TRUE if the module couldn't be loaded or didn't register all of its placeholders */
+	osync_bool failed;
+	/** Objects the module registered while getting resolved */
+	GList *objformats;
+	GList *converters;
+	GList *filters;
+} OSyncFormatCacheModule;
+
+/*! @brief The format cache of a format plugin directory */
+typedef struct OSyncFormatCache {
+	/** The file the manifest is stored in */
+	char *filename;
+	/** The format plugin directory */
+	char *path;
+	/** List of OSyncFormatCacheModule */
+	GList *modules;
+	/** Module whose registrations get recorded */
+	OSyncFormatCacheModule *current;
+	/** Module whose placeholders are currently getting resolved */
+	OSyncFormatCacheModule *resolving;
+	/** Serializes resolving the modules, guards resolving */
+	GMutex *mutex;
+	/** Registrations recorded during a full load, in order */
+	GList *records;
+} OSyncFormatCache;
+
+/** Prefix of the manifests in the OpenSync home directory */
+#define OSYNC_FORMAT_CACHE_PREFIX "formatcache-"
+
+/*! @brief Builds the name of the manifest of a format plugin directory
+ *
+ * The name is derived from a hash of the plugin directory which stays
+ * the same across glib versions.
+ *
+ * @param configdir The OpenSync home directory
+ * @param path The format plugin directory
+ * @returns The full path of the manifest. Free with g_free()
+ */
+char *osync_format_cache_filename(const char *configdir, const char *path);
+
+OSyncFormatCache *osync_format_cache_new(const char *path, const char *filename, OSyncError **error);
+void osync_format_cache_free(OSyncFormatCache *cache);
+
+/*! @brief Registers placeholders for all objects listed in the manifest
+ *
+ * @param cache The format cache
+ * @param env The format environment to register the placeholders in
+ * @returns TRUE if the manifest is valid and got used, FALSE if the
+ * format plugins have to be loaded the regular way
+ */
+osync_bool osync_format_cache_load(OSyncFormatCache *cache, OSyncFormatEnv *env);
+
+/*! @brief Writes the registrations recorded during a full load
+ *
+ * @param cache The format cache
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_format_cache_save(OSyncFormatCache *cache, OSyncError **error);
+
+/*! @brief Removes stale manifests next to the manifest of the cache
+ *
+ * A manifest is stale if it didn't get used for a month, or if it is
+ * unreadable or its format plugin directory doesn't exist anymore.
+ *
+ * @param cache The format cache
+ */
+void osync_format_cache_prune(OSyncFormatCache *cache);
+
+/*! @brief Marks the module whose info functions get called next
+ *
+ * Registrations are recorded for this module until another module,
+ * or NULL, gets set.
+ *
+ * @param cache The format cache
+ * @param path Path of the module or NULL
+ */
+void osync_format_cache_set_current(OSyncFormatCache *cache, const char *path);
+
+/* Called by the osync_format_env_register_*() functions. They return TRUE
+ * if the object got consumed to resolve a placeholder and must not be
+ * registered in the environment. */
+osync_bool osync_format_cache_register_objformat(OSyncFormatCache *cache, OSyncObjFormat *format);
+osync_bool osync_format_cache_register_converter(OSyncFormatCache *cache, OSyncFormatConverter *converter);
+osync_bool osync_format_cache_register_filter(OSyncFormatCache *cache, OSyncCustomFilter *filter);
+
+/*! @brief Loads the format plugin behind a placeholder
+ *
+ * The functions of the module get assigned to all of its placeholders
+ * and its converters get initialized. The module is only loaded once,
+ * even if several threads need it at the same time.
+ *
+ * If the module can't be loaded, its placeholders stay attached to it
+ * and every later call fails as well.
+ *
+ * @param module The module to load
+ * @param error Pointer to an error struct
+ * @returns TRUE if the functions of the placeholders are set, FALSE otherwise
+ */
+osync_bool osync_format_cache_module_resolve(OSyncFormatCacheModule *module, OSyncError **error);
+
+/*! @brief Loads the format plugins behind all placeholders of the cache
+ *
+ * @param cache The format cache
+ */
+void osync_format_cache_resolve_all(OSyncFormatCache *cache);
+
+/*@}*/
+
+#endif /* _OPENSYNC_FORMAT_CACHE_INTERNALS_H_ */
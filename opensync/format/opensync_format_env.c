@@ -22,11 +22,13 @@
 #include "opensync_internals.h"
 
 #include "opensync-module.h"
+#include "opensync/module/opensync_module_internals.h"
 #include "opensync-data.h"
 #include "opensync/data/opensync_data_internals.h"
 
 #include "opensync-format.h"
 #include "opensync_format_env_internals.h"
+#include "opensync_format_cache_internals.h"
 #include "opensync_objformat_internals.h"
 
 #include "opensync_filter_internals.h"
@@ -38,11 +40,12 @@
  * @param env Pointer to a OSyncFormatEnv environment
  * @param path The path where to look for plugins, NULL for the default sync module directory
  * @param must_exist If set to TRUE, this function will return an error if the directory does not exist
+ * @param cache The format cache to record the registrations in, or NULL
  * @param error Pointer to a error struct to return an error
  * @returns TRUE on success, FALSE otherwise
  * 
  */
-static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char *path, osync_bool must_exist, OSyncError **error)
+static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char *path, osync_bool must_exist, OSyncFormatCache *cache, OSyncError **error)
 {
   GDir *dir = NULL;
   GError *gerror = NULL;
@@ -51,7 +54,7 @@ static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char
   const gchar *de = NULL;
   GList *m = NULL;
 	
-  osync_trace(TRACE_ENTRY, "%s(%p, %s, %i, %p)", __func__, env, path, must_exist, error);
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %i, %p, %p)", __func__, env, path, must_exist, cache, error);
   osync_assert(env);
   osync_assert(path);
 	
@@ -80,6 +83,11 @@ static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char
       g_free(filename);
       continue;
     }
+
+    /* Also modules which fail to load get listed in the manifest,
+     * otherwise the manifest would never match the directory */
+    if (cache)
+      osync_format_cache_set_current(cache, filename);
 		
     module = osync_module_new(error);
     if (!module)
@@ -122,11 +130,17 @@ static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char
   /* Load the converters, filters, etc */
   for (m = env->modules; m; m = m->next) {
     module = m->data;
+    if (cache)
+      osync_format_cache_set_current(cache, module->path);
+
     if (!osync_module_get_conversion_info(module, env, error)) {
       osync_trace(TRACE_INTERNAL, "Module get conversion error %s", osync_error_print(error));
       osync_error_unref(error);
     }
   }
+
+  if (cache)
+    osync_format_cache_set_current(cache, NULL);
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -139,6 +153,48 @@ static osync_bool _osync_format_env_load_modules(OSyncFormatEnv *env, const char
   return FALSE;
 }
 
+/** @brief Creates the format cache for a format plugin directory
+ *
+ * The manifest is stored in the OpenSync home directory, keyed by a
+ * stable hash of the plugin directory, unless a cache file got set. Setting
+ * OSYNC_NOFORMATCACHE disables the cache.
+ *
+ * @param env Pointer to a OSyncFormatEnv environment
+ * @param path The format plugin directory
+ * @returns The format cache or NULL if no cache should be used
+ */
+static OSyncFormatCache *_osync_format_env_cache_new(OSyncFormatEnv *env, const char *path)
+{
+  OSyncFormatCache *cache = NULL;
+  const char *homedir = NULL;
+  char *configdir = NULL;
+  char *filename = NULL;
+
+  if (g_getenv("OSYNC_NOFORMATCACHE"))
+    return NULL;
+
+  if (env->cache_file) {
+    filename = g_strdup(env->cache_file);
+  } else {
+    homedir = g_getenv("HOME");
+    if (!homedir)
+      homedir = g_get_home_dir();
+
+    /* Don't create the OpenSync home directory just for the cache */
+    configdir = g_strdup_printf("%s%c.opensync", homedir, G_DIR_SEPARATOR);
+    if (g_file_test(configdir, G_FILE_TEST_IS_DIR))
+      filename = osync_format_cache_filename(configdir, path);
+    g_free(configdir);
+  }
+
+  if (filename) {
+    cache = osync_format_cache_new(path, filename, NULL);
+    g_free(filename);
+  }
+
+  return cache;
+}
+
 /** @brief Initialize all converters
  * 
  * Calls the initialize function of all converters
@@ -815,6 +871,13 @@ void osync_format_env_free(OSyncFormatEnv *env)
 {
   osync_trace(TRACE_ENTRY, "%s(%p)", __func__, env);
   osync_assert(env);
+
+  /* Detach the placeholders first, formats might outlive the environment */
+  if (env->cache)
+    osync_format_cache_free(env->cache);
+
+  if (env->cache_file)
+    g_free(env->cache_file);
 	
   /* Free the formats */
   while (env->objformats) {
@@ -863,24 +926,67 @@ void osync_format_env_free(OSyncFormatEnv *env)
 osync_bool osync_format_env_load_plugins(OSyncFormatEnv *env, const char *path, OSyncError **error)
 {
   osync_bool must_exist = TRUE;
+  OSyncFormatCache *cache = NULL;
+  OSyncError *cache_error = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, env, __NULLSTR(path), error);
 	
   if (!path) {
     path = OPENSYNC_FORMATSDIR;
     must_exist = FALSE;
   }
+
+  /* Only a single directory per environment gets cached */
+  if (!env->cache && g_file_test(path, G_FILE_TEST_IS_DIR)) {
+    cache = _osync_format_env_cache_new(env, path);
+    env->cache = cache;
+  }
+
+  /* With an up-to-date manifest only placeholders get registered. The
+   * modules get loaded once one of their functions is needed. */
+  if (cache && osync_format_cache_load(cache, env)) {
+    osync_trace(TRACE_EXIT, "%s: Loaded from format cache", __func__);
+    return TRUE;
+  }
 	
-  if (!_osync_format_env_load_modules(env, path, must_exist, error)) {
+  if (!_osync_format_env_load_modules(env, path, must_exist, cache, error)) {
     osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
     return FALSE;
   }
 	
   _osync_format_env_converter_initialize(env, error);
+
+  /* A format cache which can't be written is not fatal */
+  if (cache && !osync_format_cache_save(cache, &cache_error)) {
+    osync_trace(TRACE_INTERNAL, "Unable to save format cache: %s", osync_error_print(&cache_error));
+    osync_error_unref(&cache_error);
+  }
+
+  /* Only the manifests in the OpenSync home directory are ours to remove */
+  if (cache && !env->cache_file)
+    osync_format_cache_prune(cache);
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
 }
 
+void osync_format_env_set_cache_file(OSyncFormatEnv *env, const char *filename)
+{
+  osync_assert(env);
+
+  if (env->cache_file)
+    g_free(env->cache_file);
+
+  env->cache_file = g_strdup(filename);
+}
+
+void osync_format_env_resolve_modules(OSyncFormatEnv *env)
+{
+  osync_assert(env);
+
+  if (env->cache)
+    osync_format_cache_resolve_all(env->cache);
+}
+
 /*! @brief Register Object Format to the Format Environment 
  * 
  * @param env Pointer to the environment
@@ -891,6 +997,9 @@ void osync_format_env_register_objformat(OSyncFormatEnv *env, OSyncObjFormat *fo
 {
   osync_assert(env);
   osync_assert(format);
+
+  if (env->cache && osync_format_cache_register_objformat(env->cache, format))
+    return;
 	
   env->objformats = g_list_append(env->objformats, format);
   osync_objformat_ref(format);
@@ -954,6 +1063,9 @@ void osync_format_env_register_converter(OSyncFormatEnv *env, OSyncFormatConvert
 {
   osync_assert(env);
   osync_assert(converter);
+
+  if (env->cache && osync_format_cache_register_converter(env->cache, converter))
+    return;
 	
   /* Register the inverse converter if its a detector. The inverse
    * of a detector can always be used */
@@ -1066,6 +1178,9 @@ void osync_format_env_register_filter(OSyncFormatEnv *env, OSyncCustomFilter *fi
 {
   osync_assert(env);
   osync_assert(filter);
+
+  if (env->cache && osync_format_cache_register_filter(env->cache, filter))
+    return;
 	
   env->custom_filters = g_list_append(env->custom_filters, filter);
   osync_custom_filter_ref(filter);
@@ -29,6 +29,25 @@ osync_bool osync_conv_find_path_fmtlist(OSyncFormatEnv *env, OSyncChange *start,
 osync_bool osync_conv_convert_fn(OSyncFormatEnv *env, OSyncChange *change, OSyncPathTargetFn target_fn, const void *fndata, const char *extension_name, OSyncError **error);
 osync_bool osync_conv_convert_fmtlist(OSyncFormatEnv *env, OSyncChange *change, GList/*OSyncObjFormat * */ *targets);
 
+/*! @brief Sets the file to store the format plugin manifest in
+ *
+ * Has to be called before osync_format_env_load_plugins(). Without a
+ * cache file the manifest gets stored in the OpenSync home directory.
+ *
+ * @param env Pointer to the environment
+ * @param filename The manifest file
+ */
+OSYNC_TEST_EXPORT void osync_format_env_set_cache_file(OSyncFormatEnv *env, const char *filename);
+
+/*! @brief Loads all format plugins which are only registered by placeholders
+ *
+ * Loading a format plugin modifies the environment. An environment which
+ * is shared between threads must be resolved before the threads start.
+ *
+ * @param env Pointer to the environment
+ */
+void osync_format_env_resolve_modules(OSyncFormatEnv *env);
+
 /*! @brief The environment used for conversions
  */
 struct OSyncFormatEnv {
@@ -41,6 +60,11 @@ struct OSyncFormatEnv {
 	
 	GList *modules;
 	GModule *current_module;
+
+	/** The manifest of the loaded format plugin directory */
+	struct OSyncFormatCache *cache;
+	/** Location of the manifest, NULL for the default location */
+	char *cache_file;
 };
 
 /**
@@ -24,7 +24,31 @@
 #include "opensync-format.h"
 #include "opensync_objformat_internals.h"
 #include "opensync_objformat_private.h"
+#include "opensync_format_cache_internals.h"
 
+/* Loads the format plugin of a format which got registered from the
+ * format cache, before one of its functions is accessed. Fails if the
+ * plugin couldn't be loaded, the functions are unset then. */
+static osync_bool _osync_objformat_resolve(OSyncObjFormat *format, OSyncError **error)
+{
+  if (!format->cache_module)
+    return TRUE;
+
+  return osync_format_cache_module_resolve(format->cache_module, error);
+}
+
+/* For the functions which can't report an error */
+static osync_bool _osync_objformat_try_resolve(OSyncObjFormat *format)
+{
+  OSyncError *error = NULL;
+
+  if (_osync_objformat_resolve(format, &error))
+    return TRUE;
+
+  osync_trace(TRACE_ERROR, "Format %s: %s", format->name, osync_error_print(&error));
+  osync_error_unref(&error);
+  return FALSE;
+}
 
 OSyncObjFormat *osync_objformat_new(const char *name, const char *objtype_name, OSyncError **error)
 {
@@ -96,6 +120,10 @@ void osync_objformat_set_compare_func(OSyncObjFormat *format, OSyncFormatCompare
 OSyncConvCmpResult osync_objformat_compare(OSyncObjFormat *format, const char *leftdata, unsigned int leftsize, const char *rightdata, unsigned int rightsize)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_try_resolve(format))
+    return OSYNC_CONV_DATA_MISMATCH;
+
   osync_assert(format->cmp_func);
   return format->cmp_func(leftdata, leftsize, rightdata, rightsize);
 }
@@ -109,6 +137,7 @@ void osync_objformat_set_destroy_func(OSyncObjFormat *format, OSyncFormatDestroy
 void osync_objformat_destroy(OSyncObjFormat *format, char *data, unsigned int size)
 {
   osync_assert(format);
+  _osync_objformat_try_resolve(format);
 	
   if (!format->destroy_func) {
     osync_trace(TRACE_INTERNAL, "Format %s don't have a destroy function. Possible memory leak", format->name);
@@ -130,6 +159,9 @@ osync_bool osync_objformat_copy(OSyncObjFormat *format, const char *indata, unsi
   osync_assert(indata);
   osync_assert(outdata);
 
+  if (!_osync_objformat_resolve(format, error))
+    return FALSE;
+
   if (!format->copy_func) {
     osync_trace(TRACE_INTERNAL, "We cannot copy the change, falling back to memcpy");
     *outdata = osync_try_malloc0(sizeof(char) * insize, error);
@@ -157,6 +189,9 @@ osync_bool osync_objformat_duplicate(OSyncObjFormat *format, const char *uid, co
 {
   osync_assert(format);
 
+  if (!_osync_objformat_resolve(format, error))
+    return FALSE;
+
   if (!format->duplicate_func) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "No duplicate function set");
     return FALSE;
@@ -174,6 +209,13 @@ void osync_objformat_set_create_func(OSyncObjFormat *format, OSyncFormatCreateFu
 void osync_objformat_create(OSyncObjFormat *format, char **data, unsigned int *size)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_try_resolve(format)) {
+    *data = NULL;
+    *size = 0;
+    return;
+  }
+
   osync_assert(format->create_func);
 
   format->create_func(data, size);
@@ -188,6 +230,7 @@ void osync_objformat_set_print_func(OSyncObjFormat *format, OSyncFormatPrintFunc
 char *osync_objformat_print(OSyncObjFormat *format, const char *data, unsigned int size)
 {
   osync_assert(format);
+  _osync_objformat_try_resolve(format);
 	
   if (!format->print_func)
     return g_strndup(data, size);
@@ -205,6 +248,9 @@ time_t osync_objformat_get_revision(OSyncObjFormat *format, const char *data, un
 {
   osync_assert(format);
   osync_assert(data);
+
+  if (!_osync_objformat_resolve(format, error))
+    return -1;
 	
   if (!format->revision_func) {
     osync_error_set(error, OSYNC_ERROR_GENERIC, "No revision function set");
@@ -223,12 +269,21 @@ void osync_objformat_set_marshal_func(OSyncObjFormat *format, OSyncFormatMarshal
 osync_bool osync_objformat_must_marshal(OSyncObjFormat *format)
 {
   osync_assert(format);
+
+  /* Let osync_objformat_marshal() report that the plugin is missing */
+  if (!_osync_objformat_try_resolve(format))
+    return TRUE;
+
   return format->marshal_func ? TRUE : FALSE;
 }
 
 osync_bool osync_objformat_marshal(OSyncObjFormat *format, const char *input, unsigned int inpsize, OSyncMessage *message, OSyncError **error)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_resolve(format, error))
+    return FALSE;
+
   osync_assert(format->marshal_func);
   return format->marshal_func(input, inpsize, message, error);
 }
@@ -242,6 +297,10 @@ void osync_objformat_set_demarshal_func(OSyncObjFormat *format, OSyncFormatDemar
 osync_bool osync_objformat_demarshal(OSyncObjFormat *format, OSyncMessage *message, char **output, unsigned int *outpsize, OSyncError **error)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_resolve(format, error))
+    return FALSE;
+
   osync_assert(format->demarshal_func);
   return format->demarshal_func(message, output, outpsize, error);
 }
@@ -255,6 +314,10 @@ void osync_objformat_set_validate_func(OSyncObjFormat *format, OSyncFormatValida
 osync_bool osync_objformat_validate(OSyncObjFormat *format, const char *data, unsigned int size, OSyncError **error)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_resolve(format, error))
+    return FALSE;
+
   osync_assert(format->validate_func);
   return format->validate_func(data, size, error);
 }
@@ -262,6 +325,10 @@ osync_bool osync_objformat_validate(OSyncObjFormat *format, const char *data, un
 osync_bool osync_objformat_must_validate(OSyncObjFormat *format)
 {
   osync_assert(format);
+
+  if (!_osync_objformat_try_resolve(format))
+    return FALSE;
+
   return format->validate_func ? TRUE : FALSE;
 }
 
@@ -51,6 +51,10 @@ struct OSyncObjFormat {
 	OSyncFormatMarshalFunc marshal_func;
 	OSyncFormatDemarshalFunc demarshal_func;
 	OSyncFormatValidateFunc validate_func;
+
+	/** The format plugin providing the functions, if this format
+	 * got registered from the format cache and is not loaded yet */
+	struct OSyncFormatCacheModule *cache_module;
 };
 
 /*@}*/
@@ -66,6 +66,178 @@ inline struct tm* gmtime_r (const time_t *clock, struct tm *result)
 
 /*****************************************************************************/
 
+/* Allocation-free conversion core
+ *
+ * struct tm fields get converted to seconds since the epoch (and back) with
+ * plain calendar arithmetic, so converting UTC never has to go through
+ * mktime() and the TZ environment. Only the UTC offset of the local timezone
+ * needs libc, and those offsets get cached per timezone and time bucket.
+ */
+
+/* Size of the time buckets which share a cached UTC offset. Timezone
+ * transitions all happen at quarter hours in UTC. */
+#define OSYNC_TIME_OFFSET_BUCKET	900
+#define OSYNC_TIME_OFFSET_CACHE_SIZE	256
+
+/* Enough for a vtime with a 64-bit year */
+#define OSYNC_TIME_VTIME_MAX		64
+
+typedef struct {
+  long long bucket;
+  int offset;
+  osync_bool valid;
+} OSyncTimeOffsetCacheEntry;
+
+static GStaticMutex offset_cache_mutex = G_STATIC_MUTEX_INIT;
+static OSyncTimeOffsetCacheEntry offset_cache[OSYNC_TIME_OFFSET_CACHE_SIZE];
+static char *offset_cache_tz = NULL;
+static osync_bool offset_cache_initialized = FALSE;
+
+/* Days since 1970-01-01 of a proleptic gregorian date, month 1-12 */
+static long long _osync_time_days_from_civil(long long year, int month, int day)
+{
+  long long era, yoe, doy, doe;
+
+  year -= month <= 2;
+  era = (year >= 0 ? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + doe - 719468;
+}
+
+/* Seconds since the epoch of the struct tm fields, taken as UTC.
+ * Out of range fields get normalized like mktime() does. */
+static long long _osync_time_tm2sec(const struct tm *tm)
+{
+  long long year = tm->tm_year + 1900LL;
+  long long days;
+  int month = tm->tm_mon;
+
+  year += month / 12;
+  month %= 12;
+  if (month < 0) {
+    month += 12;
+    year--;
+  }
+
+  days = _osync_time_days_from_civil(year, month + 1, 1) + tm->tm_mday - 1;
+
+  return days * 86400 + tm->tm_hour * 3600LL + tm->tm_min * 60LL + tm->tm_sec;
+}
+
+/* Splits seconds since the epoch into struct tm fields in UTC */
+static void _osync_time_sec2tm(long long secs, struct tm *tm)
+{
+  long long days, rem, era, doe, yoe, doy, mp, year;
+
+  days = secs / 86400;
+  rem = secs % 86400;
+  if (rem < 0) {
+    rem += 86400;
+    days--;
+  }
+
+  memset(tm, 0, sizeof(struct tm));
+  tm->tm_hour = rem / 3600;
+  tm->tm_min = (rem % 3600) / 60;
+  tm->tm_sec = rem % 60;
+  tm->tm_wday = ((days + 4) % 7 + 7) % 7;
+
+  days += 719468;
+  era = (days >= 0 ? days : days - 146096) / 146097;
+  doe = days - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  tm->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+  tm->tm_mon = mp < 10 ? mp + 2 : mp - 10;
+  year = yoe + era * 400 + (tm->tm_mon <= 1);
+  tm->tm_year = year - 1900;
+  tm->tm_yday = _osync_time_days_from_civil(year, tm->tm_mon + 1, tm->tm_mday) - _osync_time_days_from_civil(year, 1, 1);
+}
+
+/* UTC offset in seconds of the local timezone at the given UTC instant */
+static int _osync_time_utc_offset(long long secs)
+{
+  OSyncTimeOffsetCacheEntry *entry = NULL;
+  const char *tz = NULL;
+  long long bucket;
+  struct tm local;
+  time_t timestamp;
+  int offset;
+
+  bucket = secs / OSYNC_TIME_OFFSET_BUCKET;
+  if (secs % OSYNC_TIME_OFFSET_BUCKET < 0)
+    bucket--;
+
+  g_static_mutex_lock(&offset_cache_mutex);
+
+  /* The cache is only valid for the timezone it got filled with */
+  tz = g_getenv("TZ");
+  if (!offset_cache_initialized || (tz == NULL) != (offset_cache_tz == NULL) || (tz && strcmp(tz, offset_cache_tz))) {
+    memset(offset_cache, 0, sizeof(offset_cache));
+    g_free(offset_cache_tz);
+    offset_cache_tz = g_strdup(tz);
+    offset_cache_initialized = TRUE;
+    tzset();
+  }
+
+  entry = &offset_cache[(unsigned long long)bucket % OSYNC_TIME_OFFSET_CACHE_SIZE];
+  if (entry->valid && entry->bucket == bucket) {
+    offset = entry->offset;
+    g_static_mutex_unlock(&offset_cache_mutex);
+    return offset;
+  }
+
+  timestamp = (time_t)(bucket * OSYNC_TIME_OFFSET_BUCKET);
+  localtime_r(&timestamp, &local);
+  offset = (int)(_osync_time_tm2sec(&local) - (long long)timestamp);
+
+  entry->bucket = bucket;
+  entry->offset = offset;
+  entry->valid = TRUE;
+
+  g_static_mutex_unlock(&offset_cache_mutex);
+  return offset;
+}
+
+/* UTC offset in seconds of the local timezone at the given local time */
+static int _osync_time_local_offset(const struct tm *local)
+{
+  long long secs = _osync_time_tm2sec(local);
+
+  /* The offset at the local time taken as UTC is off by at most one
+   * transition, looking up again at the corrected instant fixes that. */
+  return _osync_time_utc_offset(secs - _osync_time_utc_offset(secs));
+}
+
+/* Parses a vtime into struct tm fields, without any normalization */
+static void _osync_time_parse_vtime(const char *vtime, struct tm *tm)
+{
+  memset(tm, 0, sizeof(struct tm));
+
+  sscanf(vtime, "%04d%02d%02dT%02d%02d%02d%*01c",
+         &(tm->tm_year), &(tm->tm_mon), &(tm->tm_mday),
+         &(tm->tm_hour), &(tm->tm_min), &(tm->tm_sec));
+
+  tm->tm_year -= 1900;
+  tm->tm_mon -= 1;
+  tm->tm_isdst = -1;
+}
+
+/* Formats struct tm fields as vtime into buf of OSYNC_TIME_VTIME_MAX bytes */
+static void _osync_time_format_vtime(char *buf, const struct tm *tm, osync_bool is_utc)
+{
+  g_snprintf(buf, OSYNC_TIME_VTIME_MAX, "%04d%02d%02dT%02d%02d%02d%s",
+             tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+             tm->tm_hour, tm->tm_min, tm->tm_sec, is_utc ? "Z" : "");
+}
+
+/*****************************************************************************/
+
 /*! @brief Function remove dashes from datestamp and colon
  * 
  * @param timestamp The timestamp which gets cleaned
@@ -205,51 +377,37 @@ struct tm *osync_time_vtime2tm(const char *vtime)
 
 char *osync_time_tm2vtime(const struct tm *time, osync_bool is_utc)
 {
-  GString *vtime = g_string_new("");
+  char vtime[OSYNC_TIME_VTIME_MAX];
   struct tm my_time = *time;
-  const char *tz = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p, %i)", __func__, time, is_utc);
 
-  /* ask C library to clean up any anomalies */
-  if (is_utc) {
-    tz = g_getenv("TZ");
-    putenv("TZ=Etc/UTC");
-  }
-  mktime(&my_time);
-  if(is_utc) {
-    if (tz) {
-      g_setenv("TZ", tz, TRUE);
-    } else {
-      g_unsetenv("TZ");
-    }
-  }
-
-  g_string_printf(vtime, "%04d%02d%02dT%02d%02d%02d",
-                  my_time.tm_year + 1900, my_time.tm_mon + 1, my_time.tm_mday,
-                  my_time.tm_hour, my_time.tm_min, my_time.tm_sec);
-
+  /* clean up any anomalies, UTC doesn't need the C library for that */
   if (is_utc)
-    vtime = g_string_append(vtime, "Z");
+    _osync_time_sec2tm(_osync_time_tm2sec(&my_time), &my_time);
+  else
+    mktime(&my_time);
+
+  _osync_time_format_vtime(vtime, &my_time, is_utc);
 
-  osync_trace(TRACE_EXIT, "%s: %s", __func__, vtime->str);
-  return g_string_free(vtime, FALSE);
+  osync_trace(TRACE_EXIT, "%s: %s", __func__, vtime);
+  return g_strdup(vtime);
 }
 
 /*****************************************************************************/
 
 time_t osync_time_vtime2unix(const char *vtime, int offset)
 {
-  struct tm *utime = NULL; 
+  struct tm utime;
   time_t timestamp;
-  char *utc = NULL;
+  long long secs;
   osync_trace(TRACE_ENTRY, "%s(%s, %i)", __func__, vtime, offset);
 
-  utc = osync_time_vtime2utc(vtime, offset);
-  utime = osync_time_vtime2tm(utc);
-  timestamp = osync_time_utctm2unix(utime);
+  _osync_time_parse_vtime(vtime, &utime);
+  secs = _osync_time_tm2sec(&utime);
+  if (!strstr(vtime, "Z"))
+    secs -= offset;
 
-  g_free(utc);
-  g_free(utime);
+  timestamp = (time_t)secs;
 
   osync_trace(TRACE_EXIT, "%s: %lu", __func__, timestamp);
   return timestamp;
@@ -258,15 +416,15 @@ time_t osync_time_vtime2unix(const char *vtime, int offset)
 
 char *osync_time_unix2vtime(const time_t *timestamp)
 {
-  char *vtime;
+  char vtime[OSYNC_TIME_VTIME_MAX];
   struct tm utc;
   osync_trace(TRACE_ENTRY, "%s(%lu)", __func__, *timestamp);
 
-  gmtime_r(timestamp, &utc);
-  vtime = osync_time_tm2vtime(&utc, TRUE);
+  _osync_time_sec2tm(*timestamp, &utc);
+  _osync_time_format_vtime(vtime, &utc, TRUE);
 
   osync_trace(TRACE_EXIT, "%s: %s", __func__, vtime);
-  return vtime;
+  return g_strdup(vtime);
 }
 
 
@@ -276,86 +434,16 @@ char *osync_time_unix2vtime(const time_t *timestamp)
 
 time_t osync_time_localtm2unix(const struct tm *localtime)
 {
-  time_t timestamp;
-  struct tm *tmp = g_malloc0(sizeof(struct tm));
-
-  memcpy(tmp, localtime, sizeof(struct tm));
-
-  tmp->tm_isdst = -1;
-  timestamp = mktime(tmp);
-
-  g_free(tmp);
+  struct tm tmp = *localtime;
 
-  return timestamp; 
+  tmp.tm_isdst = -1;
+  return mktime(&tmp);
 }
  
 time_t osync_time_utctm2unix(const struct tm *utctime)
 {
-  time_t timestamp;
-
-#if 1
-  struct tm *tmp = g_malloc0(sizeof(struct tm));
-  struct tm localnow;
-  struct tm check;
-  int tzdiff;
-
-  // calculate local timezone difference... this is only used
-  // to reduce the number of loops to find the correct match
-  time(&timestamp);
-  localtime_r(&timestamp, &localnow);
-  tzdiff = osync_time_timezone_diff(&localnow);
-
-  // now loop, converting "local time" to time_t to utctm,
-  // and adjusting until there are no differences... this
-  // automatically takes care of DST issues.
-
-  // do first conversion
-  memcpy(tmp, utctime, sizeof(struct tm));
-  tmp->tm_sec += tzdiff; // mktime will normalize the seconds for us
-  tmp->tm_isdst = -1;
-  timestamp = mktime(tmp);
-  gmtime_r(&timestamp, &check);
-
-  // loop until match
-  while (check.tm_hour != utctime->tm_hour ||
-         check.tm_min != utctime->tm_min)
-    {
-      tmp->tm_min += utctime->tm_min - check.tm_min;
-      tmp->tm_hour += utctime->tm_hour - check.tm_hour;
-      tmp->tm_mday += utctime->tm_mday - check.tm_mday;
-      tmp->tm_year += utctime->tm_year - check.tm_year;
-      tmp->tm_isdst = -1;
-
-      timestamp = mktime(tmp);
-      gmtime_r(&timestamp, &check);
-    }
-
-  g_free(tmp);
-#endif
-
-#if 0
-
-  This method is broken with regard to DST.
-
-    struct tm *local = NULL;
-
-  // calculate local timezone difference...
-  // note.. this does NOT take DST into account
-  time(&timestamp);
-  localtime_r(&timestamp, &localnow);
-  int tzdiff = osync_time_timezone_diff(&localnow);
-
-  local = osync_time_tm2localtime(utctime, tzdiff);
-  if (local == NULL)
-    return -1;
-
-  local->tm_isdst = -1;
-  timestamp = mktime(local);
-
-  g_free(local);
-#endif
-
-  return timestamp; 
+  /* tm_isdst is meaningless for UTC and gets ignored */
+  return (time_t)_osync_time_tm2sec(utctime);
 }
 
 struct tm *osync_time_unix2localtm(const time_t *timestamp)
@@ -380,61 +468,7 @@ struct tm *osync_time_unix2utctm(const time_t *timestamp)
   
 int osync_time_timezone_diff(const struct tm *local)
 {
-  struct tm utime;
-  unsigned int lsecs, usecs;
-  long zonediff, daydiff = 0;
-  time_t timestamp;
-  osync_trace(TRACE_ENTRY, "%s()", __func__);
-
-  /* convert local time to UTC */
-  timestamp = osync_time_localtm2unix(local);
-
-  /* convert UTC to split tm struct in UTC */
-  gmtime_r(&timestamp, &utime);
-
-  /* calculate seconds of difference between local and UTC */
-  lsecs = 3600 * local->tm_hour + 60 * local->tm_min + local->tm_sec;
-  usecs = 3600 * utime.tm_hour + 60 * utime.tm_min + utime.tm_sec;
-  zonediff = lsecs - usecs;
-
-  /* check for different day */
-  if (utime.tm_mday != local->tm_mday) {
-    /* if uday < lday, then local time
-     * is ahead of UTC, and the above difference
-     * will straddle midnight and be 24 hours behind.
-     * Example: U: 23h on Jan 01
-     *          L: 01h on Jan 02
-     *          Real timezone offset is +0200
-     *          Calculated = 01 - 23 = -22
-     *          Corrected = -22 + 24 = +2
-     *
-     * Opposite case needs different correction.
-     */
-    if (utime.tm_mday < local->tm_mday)
-      daydiff = 24 * 3600; 
-    else
-      daydiff = -24 * 3600;
- 
-    /* if months are not the same, then we are
-     * straddling a month, and the above day
-     * comparison is upside down... correct again.
-     *
-     * Example:
-     *    U: 23h on Jan 31
-     *    L: 01h on Feb 01
-     *
-     * Above logic would subtract instead of add.
-     */
-    if (utime.tm_mon != local->tm_mon) {
-      daydiff = -daydiff;
-    }
- 
-    /* perform the correction */
-    zonediff += daydiff;
-  }
-
-  osync_trace(TRACE_EXIT, "%s: %i", __func__, zonediff);
-  return zonediff;
+  return _osync_time_local_offset(local);
 }
  
 struct tm *osync_time_tm2utc(const struct tm *ltime, int offset)
@@ -561,59 +595,85 @@ const char *_time_attr[] = {
   NULL
 };
 
-/*! @brief Function converts a UTC vtime stamp to a localtime vtime stamp
+/*! @brief Function converts a vtime stamp to UTC or localtime
  * 
- * @param entry The whole vcal entry as GString which gets modified. 
- * @param field The field name which should be modified. 
+ * @param stamp The vtime stamp
+ * @param len The length of the vtime stamp
  * @param toUTC The toggle in which direction we convert. TRUE = convert to UTC
+ * @param buf Buffer of OSYNC_TIME_VTIME_MAX bytes for the converted stamp
+ * @returns TRUE if buf got filled, FALSE if the stamp stays unchanged
  */ 
-static void _convert_time_field(GString *entry, const char *field, osync_bool toUTC)
+static osync_bool _convert_time_stamp(const char *stamp, size_t len, osync_bool toUTC, char *buf)
 {
-  int i, tzdiff;
-  char *res = NULL;
-  char *new_stamp = NULL;
-
-  GString *stamp = g_string_new("");
+  struct tm tm_stamp;
+  long long secs;
+  int tzdiff;
+  osync_bool is_utc;
 
-  if ((res = strstr(entry->str, field))) {
-    gssize pos = 0; 
-    struct tm *tm_stamp = NULL;
-    res += strlen(field);
+  if (len >= OSYNC_TIME_VTIME_MAX)
+    return FALSE;
 
-    for (i=0; res[i] != '\n' && res[i] != '\r'; i++)
-      stamp = g_string_append_c(stamp, res[i]);
+  memcpy(buf, stamp, len);
+  buf[len] = 0;
 
-    pos = res - entry->str; 
-    entry = g_string_erase(entry, pos, i);
+  is_utc = strchr(buf, 'Z') != NULL;
+  if (is_utc == toUTC)
+    return FALSE;
 
-    // Get System offset to UTC
-    tm_stamp = osync_time_vtime2tm(stamp->str);
-    tzdiff = osync_time_timezone_diff(tm_stamp);
-    g_free(tm_stamp);
+  // Get System offset to UTC
+  _osync_time_parse_vtime(buf, &tm_stamp);
+  tzdiff = _osync_time_local_offset(&tm_stamp);
 
-    if (toUTC)
-      new_stamp = osync_time_vtime2utc(stamp->str, tzdiff);
-    else
-      new_stamp = osync_time_vtime2localtime(stamp->str, tzdiff); 
+  secs = _osync_time_tm2sec(&tm_stamp);
+  secs += toUTC ? -tzdiff : tzdiff;
 
-    entry = g_string_insert(entry, pos, new_stamp);
-    g_free(new_stamp);
-  }
+  _osync_time_sec2tm(secs, &tm_stamp);
+  _osync_time_format_vtime(buf, &tm_stamp, toUTC);
+  return TRUE;
 }
 
 /*! @brief Functions converts timestamps of vcal in localtime or UTC. 
  * 
+ * The vcal gets rewritten in a single pass, every line starting with
+ * one of the fields in _time_attr gets its value converted.
+ *
  * @param vcal The vcalendar which has to be converted.
  * @param toUTC If TRUE conversion from localtime to UTC.
  * @return timestamp modified vcalendar 
  */ 
 char *_convert_entry(const char *vcal, osync_bool toUTC)
 {
+  char buf[OSYNC_TIME_VTIME_MAX];
+  const char *line = vcal, *value = NULL, *end = NULL;
+  GString *new_entry = g_string_sized_new(strlen(vcal) + 16);
   int i = 0;
-  GString *new_entry = g_string_new(vcal);
 
-  for (i=0; _time_attr[i] != NULL; i++) 
-    _convert_time_field(new_entry, _time_attr[i], toUTC);
+  while (*line) {
+    end = line + strcspn(line, "\r\n");
+
+    value = NULL;
+    for (i=0; _time_attr[i] != NULL; i++) {
+      size_t attrlen = strlen(_time_attr[i]);
+      if (!strncmp(line, _time_attr[i], attrlen)) {
+        value = line + attrlen;
+        break;
+      }
+    }
+
+    if (value && _convert_time_stamp(value, end - value, toUTC, buf)) {
+      g_string_append_len(new_entry, line, value - line);
+      g_string_append(new_entry, buf);
+    } else {
+      g_string_append_len(new_entry, line, end - line);
+    }
+
+    line = end;
+    if (*line == '\r')
+      line++;
+    if (*line == '\n')
+      line++;
+    g_string_append_len(new_entry, end, line - end);
+  }
 
   return g_string_free(new_entry, FALSE);
 }
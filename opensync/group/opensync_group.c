@@ -28,10 +28,10 @@
 #include "opensync-group.h"
 #include "opensync_group_internals.h"
 #include "opensync-db.h"
-
-#ifdef OPENSYNC_UNITTESTS
+#include "opensync-ipc.h"
 #include "opensync_member_internals.h"
-#endif /* OPENSYNC_UNITTESTS */
+
+#include "ipc/opensync_message_internals.h"
 
 #ifndef _WIN32
 #include <sys/file.h>
@@ -173,6 +173,369 @@ static osync_bool _osync_group_load_members(OSyncGroup *group, const char *path,
   return FALSE;
 }
 
+/*! @brief Lists the member directories of a group
+ *
+ * @param path The group configdir
+ * @returns List of directory names which contain a syncmember.conf
+ */
+static GList *_osync_group_list_member_dirs(const char *path)
+{
+  GDir *dir = NULL;
+  GList *names = NULL;
+  char *filename = NULL;
+  const gchar *de = NULL;
+
+  dir = g_dir_open(path, 0, NULL);
+  if (!dir)
+    return NULL;
+
+  while ((de = g_dir_read_name(dir))) {
+    filename = g_strdup_printf("%s%c%s%csyncmember.conf", path, G_DIR_SEPARATOR, de, G_DIR_SEPARATOR);
+    if (g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+      names = g_list_append(names, g_strdup(de));
+    g_free(filename);
+  }
+  g_dir_close(dir);
+
+  return names;
+}
+
+static void _osync_group_free_member_dirs(GList *names)
+{
+  GList *n = NULL;
+  for (n = names; n; n = n->next)
+    g_free(n->data);
+  g_list_free(names);
+}
+
+static void _osync_group_remove_snapshot(OSyncGroup *group)
+{
+  char *filename = g_strdup_printf("%s%csyncgroup.snapshot", group->configdir, G_DIR_SEPARATOR);
+  g_unlink(filename);
+  g_free(filename);
+}
+
+static void _osync_group_flush_filters(OSyncGroup *group)
+{
+  while (group->filters)
+    osync_group_remove_filter(group, group->filters->data);
+}
+
+static void _osync_group_save_filter(xmlNodePtr parent, OSyncFilter *filter)
+{
+  xmlNodePtr node = xmlNewChild(parent, NULL, (xmlChar*)"filter", NULL);
+  const char *custom_filter_name = osync_filter_get_custom_filter_name(filter);
+  const char *config = osync_filter_get_config(filter);
+  char *action = g_strdup_printf("%i", osync_filter_get_action(filter));
+
+  xmlNewTextChild(node, NULL, (xmlChar*)"objtype", (xmlChar*)osync_filter_get_objtype(filter));
+  xmlNewChild(node, NULL, (xmlChar*)"action", (xmlChar*)action);
+  g_free(action);
+
+  if (custom_filter_name)
+    xmlNewTextChild(node, NULL, (xmlChar*)"custom_filter", (xmlChar*)custom_filter_name);
+  if (config)
+    xmlNewTextChild(node, NULL, (xmlChar*)"config", (xmlChar*)config);
+}
+
+/*! @brief Loads a filter of the group configuration
+ *
+ * Custom filters only get stored by name, they get bound when the
+ * engine connects and the format plugins are available.
+ *
+ * @param group The group to add the filter to
+ * @param doc The document of the group configuration
+ * @param node The filter node
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+static osync_bool _osync_group_load_filter(OSyncGroup *group, xmlDocPtr doc, xmlNodePtr node, OSyncError **error)
+{
+  OSyncFilter *filter = NULL;
+  char *objtype = NULL, *custom_filter_name = NULL, *config = NULL;
+  int action = OSYNC_FILTER_IGNORE;
+  xmlNodePtr cur = NULL;
+
+  for (cur = node->xmlChildrenNode; cur; cur = cur->next) {
+    char *str = (char*)xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+    if (!str)
+      continue;
+
+    if (!xmlStrcmp(cur->name, (const xmlChar *)"objtype")) {
+      g_free(objtype);
+      objtype = g_strdup(str);
+    } else if (!xmlStrcmp(cur->name, (const xmlChar *)"action")) {
+      action = atoi(str);
+    } else if (!xmlStrcmp(cur->name, (const xmlChar *)"custom_filter")) {
+      g_free(custom_filter_name);
+      custom_filter_name = g_strdup(str);
+    } else if (!xmlStrcmp(cur->name, (const xmlChar *)"config")) {
+      g_free(config);
+      config = g_strdup(str);
+    }
+
+    osync_xml_free(str);
+  }
+
+  if (!objtype) {
+    osync_error_set(error, OSYNC_ERROR_MISCONFIGURATION, "Filter of group %s without an objtype", group->name);
+    goto error;
+  }
+
+  if (action < OSYNC_FILTER_IGNORE || action > OSYNC_FILTER_DENY) {
+    osync_error_set(error, OSYNC_ERROR_MISCONFIGURATION, "Filter for %s has an invalid action %i", objtype, action);
+    goto error;
+  }
+
+  filter = osync_filter_new(objtype, action, error);
+  if (!filter)
+    goto error;
+
+  if (custom_filter_name)
+    osync_filter_set_custom_filter_name(filter, custom_filter_name);
+  if (config)
+    osync_filter_set_config(filter, config);
+
+  osync_group_add_filter(group, filter);
+  osync_filter_unref(filter);
+
+  g_free(objtype);
+  g_free(custom_filter_name);
+  g_free(config);
+  return TRUE;
+
+ error:
+  g_free(objtype);
+  g_free(custom_filter_name);
+  g_free(config);
+  return FALSE;
+}
+
+/*! @brief Loads the group and its members from the group snapshot
+ *
+ * The snapshot is only used if syncgroup.conf, the set of member
+ * directories and all syncmember.conf files are unchanged since it got
+ * written.
+ *
+ * @param group The group with the configdir set
+ * @param loaded Set to TRUE if the group got loaded from the snapshot
+ * @param error Pointer to an error struct
+ * @returns FALSE if loading an uptodate snapshot failed, TRUE otherwise
+ */
+static osync_bool _osync_group_load_snapshot(OSyncGroup *group, osync_bool *loaded, OSyncError **error)
+{
+  OSyncMessage *message = NULL;
+  OSyncMember *member = NULL;
+  GList *names = NULL, *n = NULL;
+  char *filename = NULL;
+  char *name = NULL;
+  char *member_path = NULL;
+  long long int last_sync = 0;
+  unsigned int i, num = 0;
+  int merger_enabled = 0, converter_enabled = 0;
+  osync_bool uptodate = TRUE;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, group, loaded, error);
+
+  *loaded = FALSE;
+
+  filename = g_strdup_printf("%s%csyncgroup.snapshot", group->configdir, G_DIR_SEPARATOR);
+  message = osync_message_read_file(filename);
+  g_free(filename);
+
+  if (!message) {
+    osync_trace(TRACE_EXIT, "%s: No snapshot", __func__);
+    return TRUE;
+  }
+
+  filename = g_strdup_printf("%s%csyncgroup.conf", group->configdir, G_DIR_SEPARATOR);
+  uptodate = osync_message_check_file_stamp(message, filename);
+  g_free(filename);
+
+  names = _osync_group_list_member_dirs(group->configdir);
+  osync_message_read_uint(message, &num);
+  if (num != g_list_length(names))
+    uptodate = FALSE;
+
+  for (i = 0, n = names; uptodate && i < num; i++, n = n->next) {
+    osync_message_read_string(message, &name);
+    if (!name || strcmp(name, n->data))
+      uptodate = FALSE;
+    g_free(name);
+
+    if (!uptodate)
+      break;
+
+    filename = g_strdup_printf("%s%c%s%csyncmember.conf", group->configdir, G_DIR_SEPARATOR, (char *)n->data, G_DIR_SEPARATOR);
+    uptodate = osync_message_check_file_stamp(message, filename);
+    g_free(filename);
+  }
+
+  if (!uptodate) {
+    _osync_group_free_member_dirs(names);
+    osync_message_unref(message);
+    osync_trace(TRACE_EXIT, "%s: Snapshot is outdated", __func__);
+    return TRUE;
+  }
+
+  osync_message_read_string(message, &name);
+  osync_group_set_name(group, name);
+  g_free(name);
+
+  osync_message_read_long_long_int(message, &last_sync);
+  group->last_sync = (time_t)last_sync;
+  osync_message_read_int(message, &merger_enabled);
+  group->merger_enabled = merger_enabled;
+  osync_message_read_int(message, &converter_enabled);
+  group->converter_enabled = converter_enabled;
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    OSyncFilter *filter = NULL;
+    char *objtype = NULL, *custom_filter_name = NULL, *config = NULL;
+    int action = 0;
+
+    osync_message_read_string(message, &objtype);
+    osync_message_read_int(message, &action);
+    osync_message_read_string(message, &custom_filter_name);
+    osync_message_read_string(message, &config);
+
+    filter = osync_filter_new(objtype, action, error);
+    if (filter) {
+      if (custom_filter_name)
+        osync_filter_set_custom_filter_name(filter, custom_filter_name);
+      osync_filter_set_config(filter, config);
+      osync_group_add_filter(group, filter);
+      osync_filter_unref(filter);
+    }
+
+    g_free(objtype);
+    g_free(custom_filter_name);
+    g_free(config);
+
+    if (!filter)
+      goto error;
+  }
+
+  for (n = names; n; n = n->next) {
+    member = osync_member_new(error);
+    if (!member)
+      goto error;
+
+#ifdef OPENSYNC_UNITTESTS
+    if (group->schemadir)
+      osync_member_set_schemadir(member, group->schemadir);
+#endif /* OPENSYNC_UNITTESTS */
+
+    member_path = g_strdup_printf("%s%c%s", group->configdir, G_DIR_SEPARATOR, (char *)n->data);
+    if (!osync_member_snapshot_read(message, member, member_path, error)) {
+      g_free(member_path);
+      osync_member_unref(member);
+      goto error;
+    }
+    g_free(member_path);
+
+    osync_group_add_member(group, member);
+    osync_member_unref(member);
+  }
+
+  _osync_group_free_member_dirs(names);
+  osync_message_unref(message);
+
+  *loaded = TRUE;
+
+  osync_trace(TRACE_EXIT, "%s: Loaded snapshot", __func__);
+  return TRUE;
+
+ error:
+  _osync_group_free_member_dirs(names);
+  osync_message_unref(message);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+/*! @brief Writes the snapshot of a freshly loaded group
+ *
+ * Files which got modified within the timestamp granularity could change
+ * again without the stamp noticing, the snapshot gets skipped then.
+ * Failures are not fatal, the group just gets parsed again next time.
+ *
+ * @param group The loaded group
+ */
+static void _osync_group_write_snapshot(OSyncGroup *group)
+{
+  OSyncMessage *message = NULL;
+  OSyncError *error = NULL;
+  GList *m = NULL;
+  char *filename = NULL;
+  char *name = NULL;
+  osync_bool stable = TRUE;
+
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, group);
+
+  message = osync_message_new(OSYNC_MESSAGE_NOOP, 0, &error);
+  if (!message)
+    goto error;
+
+  filename = g_strdup_printf("%s%csyncgroup.conf", group->configdir, G_DIR_SEPARATOR);
+  stable = osync_message_write_file_stamp(message, filename) && stable;
+  g_free(filename);
+
+  osync_message_write_uint(message, g_list_length(group->members));
+  for (m = group->members; m; m = m->next) {
+    const char *configdir = osync_member_get_configdir(m->data);
+
+    name = g_path_get_basename(configdir);
+    osync_message_write_string(message, name);
+    g_free(name);
+
+    filename = g_strdup_printf("%s%csyncmember.conf", configdir, G_DIR_SEPARATOR);
+    stable = osync_message_write_file_stamp(message, filename) && stable;
+    g_free(filename);
+  }
+
+  osync_message_write_string(message, group->name);
+  osync_message_write_long_long_int(message, group->last_sync);
+  osync_message_write_int(message, group->merger_enabled);
+  osync_message_write_int(message, group->converter_enabled);
+
+  osync_message_write_uint(message, g_list_length(group->filters));
+  for (m = group->filters; m; m = m->next) {
+    osync_message_write_string(message, osync_filter_get_objtype(m->data));
+    osync_message_write_int(message, osync_filter_get_action(m->data));
+    osync_message_write_string(message, osync_filter_get_custom_filter_name(m->data));
+    osync_message_write_string(message, osync_filter_get_config(m->data));
+  }
+
+  for (m = group->members; m; m = m->next) {
+    if (!osync_member_snapshot_write(message, m->data, &error))
+      goto error;
+  }
+
+  if (!stable) {
+    osync_message_unref(message);
+    osync_trace(TRACE_EXIT, "%s: Configuration too recent for a snapshot", __func__);
+    return;
+  }
+
+  filename = g_strdup_printf("%s%csyncgroup.snapshot", group->configdir, G_DIR_SEPARATOR);
+  if (!osync_message_write_file(message, filename, &error)) {
+    g_free(filename);
+    goto error;
+  }
+  g_free(filename);
+
+  osync_message_unref(message);
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return;
+
+ error:
+  if (message)
+    osync_message_unref(message);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(&error));
+  osync_error_unref(&error);
+}
+
 static void _build_list(gpointer key, gpointer value, gpointer user_data)
 {
   if (GPOINTER_TO_INT(value) >= 2) {
@@ -328,12 +691,21 @@ void osync_group_unref(OSyncGroup *group)
 		
     while (group->members)
       osync_group_remove_member(group, group->members->data);
+
+    _osync_group_flush_filters(group);
 		
     if (group->name)
       g_free(group->name);
 		
     if (group->configdir)
       g_free(group->configdir);
+
+    while (group->conflict_policies) {
+      OSyncGroupConflictPolicy *policy = group->conflict_policies->data;
+      g_free(policy->objtype);
+      g_free(policy);
+      group->conflict_policies = g_list_remove(group->conflict_policies, policy);
+    }
 			
 #ifdef OPENSYNC_UNITTESTS
     if (group->schemadir)
@@ -519,6 +891,7 @@ const char *osync_group_get_name(OSyncGroup *group)
 osync_bool osync_group_save(OSyncGroup *group, OSyncError **error)
 {
   char *filename = NULL;
+  GList *f = NULL;
   int i;
   xmlDocPtr doc;
   char *tmstr = NULL;
@@ -538,6 +911,8 @@ osync_bool osync_group_save(OSyncGroup *group, OSyncError **error)
     }
   }
 	
+  _osync_group_remove_snapshot(group);
+
   filename = g_strdup_printf ("%s%csyncgroup.conf", group->configdir, G_DIR_SEPARATOR);
   osync_trace(TRACE_INTERNAL, "Saving group to file %s", filename);
 	
@@ -548,39 +923,8 @@ osync_bool osync_group_save(OSyncGroup *group, OSyncError **error)
   xmlSetProp(doc->children, (const xmlChar*)"version", (const xmlChar *)version_str);	
   g_free(version_str);
 	
-  // TODO: reimplement the filter!
-  //The filters
-  /*GList *f;
-    for (f = group->filters; f; f = f->next) {
-    OSyncFilter *filter = f->data;
-    xmlNodePtr child = xmlNewChild(doc->children, NULL, (xmlChar*)"filter", NULL);
-		
-    if (filter->sourcememberid) {
-    char *sourcememberid = g_strdup_printf("%lli", filter->sourcememberid);
-    xmlNewChild(child, NULL, (xmlChar*)"sourcemember", (xmlChar*)sourcememberid);
-    g_free(sourcememberid);
-    }
-    if (filter->destmemberid) {
-    char *destmemberid = g_strdup_printf("%lli", filter->destmemberid);
-    xmlNewChild(child, NULL, (xmlChar*)"destmember", (xmlChar*)destmemberid);
-    g_free(destmemberid);
-    }
-    if (filter->sourceobjtype)
-    xmlNewChild(child, NULL, (xmlChar*)"sourceobjtype", (xmlChar*)filter->sourceobjtype);
-    if (filter->destobjtype)
-    xmlNewChild(child, NULL, (xmlChar*)"destobjtype", (xmlChar*)filter->destobjtype);
-    if (filter->detectobjtype)
-    xmlNewChild(child, NULL, (xmlChar*)"detectobjtype", (xmlChar*)filter->detectobjtype);
-    if (filter->action) {
-    char *action = g_strdup_printf("%i", filter->action);
-    xmlNewChild(child, NULL, (xmlChar*)"action", (xmlChar*)action);
-    g_free(action);
-    }
-    if (filter->function_name)
-    xmlNewChild(child, NULL, (xmlChar*)"function_name", (xmlChar*)filter->function_name);
-    if (filter->config)
-    xmlNewChild(child, NULL, (xmlChar*)"config", (xmlChar*)filter->config);
-    }*/
+  for (f = group->filters; f; f = f->next)
+    _osync_group_save_filter(doc->children, f->data);
 
   xmlNewChild(doc->children, NULL, (xmlChar*)"groupname", (xmlChar*)group->name);
 
@@ -721,7 +1065,7 @@ osync_bool osync_group_load(OSyncGroup *group, const char *path, OSyncError **er
   char *real_path = NULL;
   xmlDocPtr doc;
   xmlNodePtr cur;
-  //xmlNodePtr filternode;
+  osync_bool loaded = FALSE;
 	
   osync_assert(group);
   osync_assert(path);
@@ -738,6 +1082,20 @@ osync_bool osync_group_load(OSyncGroup *group, const char *path, OSyncError **er
   osync_group_set_configdir(group, real_path);
   filename = g_strdup_printf("%s%csyncgroup.conf", real_path, G_DIR_SEPARATOR);
   g_free(real_path);
+
+  /* The configuration replaces the filters, loading twice doesn't duplicate them */
+  _osync_group_flush_filters(group);
+
+  if (!_osync_group_load_snapshot(group, &loaded, error)) {
+    g_free(filename);
+    goto error;
+  }
+
+  if (loaded) {
+    g_free(filename);
+    osync_trace(TRACE_EXIT, "%s: %p", __func__, group);
+    return TRUE;
+  }
 	
   if (!osync_xml_open_file(&doc, &cur, filename, "syncgroup", error)) {
     g_free(filename);
@@ -746,7 +1104,18 @@ osync_bool osync_group_load(OSyncGroup *group, const char *path, OSyncError **er
   g_free(filename);
 	
   while (cur != NULL) {
-    char *str = (char*)xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+    char *str = NULL;
+
+    if (!xmlStrcmp(cur->name, (const xmlChar *)"filter")) {
+      if (!_osync_group_load_filter(group, doc, cur, error)) {
+        osync_xml_free_doc(doc);
+        goto error;
+      }
+      cur = cur->next;
+      continue;
+    }
+
+    str = (char*)xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
     if (str) {
       if (!xmlStrcmp(cur->name, (const xmlChar *)"groupname"))
         osync_group_set_name(group, str);
@@ -767,68 +1136,6 @@ osync_bool osync_group_load(OSyncGroup *group, const char *path, OSyncError **er
       if (!xmlStrcmp(cur->name, (const xmlChar *)"converter_enabled"))
         group->converter_enabled = (!g_ascii_strcasecmp("true", str)) ? TRUE : FALSE;
 
-      // TODO: reimplement the filter!
-      /*if (!xmlStrcmp(cur->name, (const xmlChar *)"filter")) {
-        filternode = cur->xmlChildrenNode;
-        OSyncFilter *filter = osync_filter_new();
-        filter->group = group;
-				
-        while (filternode != NULL) {
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"sourceobjtype"))
-        filter->sourceobjtype = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"destobjtype"))
-        filter->destobjtype = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"detectobjtype"))
-        filter->detectobjtype = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"config"))
-        filter->config = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"function_name")) {
-        char *str = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-        if (!str) {
-        filternode = filternode->next;
-        continue;
-        }
-        osync_filter_update_hook(filter, group, str);
-        osync_xml_free(str);
-        }
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"sourcemember")) {
-        char *str = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-        if (!str) {
-        filternode = filternode->next;
-        continue;
-        }
-        filter->sourcememberid = atoll(str);
-        osync_xml_free(str);
-        }
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"destmember")) {
-        char *str = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-        if (!str) {
-        filternode = filternode->next;
-        continue;
-        }
-        filter->destmemberid = atoll(str);
-        osync_xml_free(str);
-        }
-					
-        if (!xmlStrcmp(filternode->name, (const xmlChar *)"action")) {
-        char *str = (char*)xmlNodeListGetString(doc, filternode->xmlChildrenNode, 1);
-        if (!str) {
-        filternode = filternode->next;
-        continue;
-        }
-        filter->action = atoi(str);
-        osync_xml_free(str);
-        }
-        filternode = filternode->next;
-        }
-        osync_filter_register(group, filter);
-        }*/
 		
       osync_xml_free(str);
     }
@@ -844,6 +1151,8 @@ osync_bool osync_group_load(OSyncGroup *group, const char *path, OSyncError **er
 	
   if (!_osync_group_load_members(group, group->configdir, error))
     goto error;
+
+  _osync_group_write_snapshot(group);
 	
   osync_trace(TRACE_EXIT, "%s: %p", __func__, group);
   return TRUE;
@@ -1184,6 +1493,86 @@ void osync_group_get_conflict_resolution(OSyncGroup *group, OSyncConflictResolut
   *num = group->conflict_winner;
 }
 
+static OSyncGroupConflictPolicy *_osync_group_find_conflict_policy(OSyncGroup *group, const char *objtype)
+{
+  GList *p = NULL;
+  for (p = group->conflict_policies; p; p = p->next) {
+    OSyncGroupConflictPolicy *policy = p->data;
+    if (!strcmp(policy->objtype, objtype))
+      return policy;
+  }
+
+  return NULL;
+}
+
+/*! @brief Set fixed conflict resolution for the conflicts of one object type
+ * 
+ * Overrides the conflict resolution of the group for this object type.
+ * The engine solves the conflicts covered by a resolution itself, only
+ * the remaining ones get passed to the conflict callback.
+ * 
+ * @param group The group
+ * @param objtype The object type
+ * @param res The conflict resolution, OSYNC_CONFLICT_RESOLUTION_UNKNOWN to use the one of the group
+ * @param num The Member ID which solves the conflict (winner)
+ * 
+ */
+void osync_group_set_objtype_conflict_resolution(OSyncGroup *group, const char *objtype, OSyncConflictResolution res, int num)
+{
+  OSyncGroupConflictPolicy *policy = NULL;
+  osync_assert(group);
+  osync_assert(objtype);
+
+  policy = _osync_group_find_conflict_policy(group, objtype);
+
+  if (res == OSYNC_CONFLICT_RESOLUTION_UNKNOWN) {
+    if (policy) {
+      group->conflict_policies = g_list_remove(group->conflict_policies, policy);
+      g_free(policy->objtype);
+      g_free(policy);
+    }
+    return;
+  }
+
+  if (!policy) {
+    policy = g_malloc0(sizeof(OSyncGroupConflictPolicy));
+    policy->objtype = g_strdup(objtype);
+    group->conflict_policies = g_list_append(group->conflict_policies, policy);
+  }
+
+  policy->resolution = res;
+  policy->winner = num;
+}
+
+/*! @brief Get the conflict resolution which applies to the conflicts of one object type
+ * 
+ * Falls back to the conflict resolution of the group if the object type
+ * has no resolution of its own.
+ * 
+ * @param group The group
+ * @param objtype The object type
+ * @param res Pointer to set conflict resolution value
+ * @param num Pointer to set Member ID value which solves the conflict (winner)
+ * 
+ */
+void osync_group_get_objtype_conflict_resolution(OSyncGroup *group, const char *objtype, OSyncConflictResolution *res, int *num)
+{
+  OSyncGroupConflictPolicy *policy = NULL;
+  osync_assert(group);
+  osync_assert(objtype);
+  osync_assert(res);
+  osync_assert(num);
+
+  policy = _osync_group_find_conflict_policy(group, objtype);
+  if (!policy) {
+    osync_group_get_conflict_resolution(group, res, num);
+    return;
+  }
+
+  *res = policy->resolution;
+  *num = policy->winner;
+}
+
 /*! @brief Get group configured status of merger use. 
  * 
  * @param group The group
@@ -77,6 +77,8 @@ OSYNC_EXPORT time_t osync_group_get_last_synchronization(OSyncGroup *group);
 
 OSYNC_EXPORT void osync_group_set_conflict_resolution(OSyncGroup *group, OSyncConflictResolution res, int num);
 OSYNC_EXPORT void osync_group_get_conflict_resolution(OSyncGroup *group, OSyncConflictResolution *res, int *num);
+OSYNC_EXPORT void osync_group_set_objtype_conflict_resolution(OSyncGroup *group, const char *objtype, OSyncConflictResolution res, int num);
+OSYNC_EXPORT void osync_group_get_objtype_conflict_resolution(OSyncGroup *group, const char *objtype, OSyncConflictResolution *res, int *num);
 
 OSYNC_EXPORT osync_bool osync_group_get_merger_enabled(OSyncGroup *group);
 OSYNC_EXPORT void osync_group_set_merger_enabled(OSyncGroup *group, osync_bool enable_merger);
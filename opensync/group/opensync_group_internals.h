@@ -23,6 +23,14 @@
 #ifndef _OPENSYNC_GROUP_INTERNALS_H_
 #define _OPENSYNC_GROUP_INTERNALS_H_
 
+/*! @brief Conflict resolution which applies to a single object type */
+typedef struct OSyncGroupConflictPolicy {
+	char *objtype;
+	OSyncConflictResolution resolution;
+	/** The winning member if the select resolution is choosen */
+	int winner;
+} OSyncGroupConflictPolicy;
+
 /*! @brief Represent a group of members that should be synchronized */
 struct OSyncGroup {
 	/** The name of the group */
@@ -41,6 +49,8 @@ struct OSyncGroup {
 	OSyncConflictResolution conflict_resolution;
 	/** The winning side if the select resolution is choosen */
 	int conflict_winner;
+	/** List of OSyncGroupConflictPolicy, overriding the resolution of the group */
+	GList *conflict_policies;
 	/** The configured merger status of this group */
 	osync_bool merger_enabled;
 	/** The configured converter status of this group */
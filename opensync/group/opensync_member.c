@@ -27,9 +27,14 @@
 #include "opensync-group.h"
 #include "opensync-format.h"
 #include "opensync-merger.h"
+#include "opensync-ipc.h"
 #include "opensync_member_internals.h"
 
+#include "ipc/opensync_message_internals.h"
+#include "ipc/opensync_serializer_internals.h"
+
 #include "merger/opensync_capabilities_internals.h"
+#include "plugin/opensync_plugin_config_internals.h"
 
 #include "opensync_xml.h"
 
@@ -361,6 +366,7 @@ void osync_member_set_configdir(OSyncMember *member, const char *configdir)
 OSyncPluginConfig *osync_member_get_config_or_default(OSyncMember *member, OSyncError **error)
 {
   char *filename = NULL;
+  char *snapshot = NULL;
   OSyncPluginConfig *config = NULL;
   const char *schemadir = NULL;
 	
@@ -390,8 +396,12 @@ OSyncPluginConfig *osync_member_get_config_or_default(OSyncMember *member, OSync
     schemadir = member->schemadir;
 #endif
 
-  if (!osync_plugin_config_file_load(config, filename, schemadir, error))
+  snapshot = g_strdup_printf("%s%cconfig.snapshot", member->configdir, G_DIR_SEPARATOR);
+  if (!osync_plugin_config_file_load_snapshot(config, filename, schemadir, snapshot, error)) {
+    g_free(snapshot);
     goto error_free_config;
+  }
+  g_free(snapshot);
 		
   osync_member_set_config(member, config);
 
@@ -438,6 +448,7 @@ osync_bool osync_member_has_config(OSyncMember *member)
 OSyncPluginConfig *osync_member_get_config(OSyncMember *member, OSyncError **error)
 {
   char *filename = NULL;
+  char *snapshot = NULL;
   const char *schemadir = NULL;
   OSyncPluginConfig *config = NULL;
 	
@@ -466,8 +477,12 @@ OSyncPluginConfig *osync_member_get_config(OSyncMember *member, OSyncError **err
     schemadir = member->schemadir;
 #endif
 
-  if (!osync_plugin_config_file_load(config, filename, schemadir, error))
+  snapshot = g_strdup_printf("%s%cconfig.snapshot", member->configdir, G_DIR_SEPARATOR);
+  if (!osync_plugin_config_file_load_snapshot(config, filename, schemadir, snapshot, error)) {
+    g_free(snapshot);
     goto error_free_config;
+  }
+  g_free(snapshot);
 
   g_free(filename);
 
@@ -506,6 +521,34 @@ void osync_member_set_config(OSyncMember *member, OSyncPluginConfig *config)
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
+static osync_bool _osync_member_load_capabilities(OSyncMember *member, OSyncError **error)
+{
+  OSyncCapabilities *capabilities = NULL;
+
+  if (!osync_capabilities_member_has_capabilities(member))
+    return TRUE;
+
+  capabilities = osync_capabilities_member_get_capabilities(member, error);
+  if (!capabilities)
+    return FALSE;
+
+  if (!osync_member_set_capabilities(member, capabilities, error)) {
+    osync_capabilities_unref(capabilities);
+    return FALSE;
+  }
+
+  osync_capabilities_unref(capabilities);
+  return TRUE;
+}
+
+static void _osync_member_set_configdir_and_id(OSyncMember *member, const char *path)
+{
+  char *basename = g_path_get_basename(path);
+  member->id = atoi(basename);
+  g_free(basename);
+  osync_member_set_configdir(member, path);
+}
+
 /** @brief Loads a member from a directory where it has been saved
  * 
  * @param member The Member pointer of the member which gets loaded
@@ -518,16 +561,12 @@ osync_bool osync_member_load(OSyncMember *member, const char *path, OSyncError *
 {	xmlDocPtr doc;
   xmlNodePtr cur;
   char *filename = NULL;
-  char *basename = NULL;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, member, path, error);
 
   filename = g_strdup_printf ("%s%csyncmember.conf", path, G_DIR_SEPARATOR);
 	
-  basename = g_path_get_basename(path);
-  member->id = atoi(basename);
-  g_free(basename);
-  osync_member_set_configdir(member, path);
+  _osync_member_set_configdir_and_id(member, path);
 	
   if (!osync_xml_open_file(&doc, &cur, filename, "syncmember", error)) {
     g_free(filename);
@@ -565,15 +604,8 @@ osync_bool osync_member_load(OSyncMember *member, const char *path, OSyncError *
   }
   osync_xml_free_doc(doc);
 
-  if(osync_capabilities_member_has_capabilities(member))
-    {
-      OSyncCapabilities* capabilities = osync_capabilities_member_get_capabilities(member, error);
-      if(!capabilities)
-        goto error;
-      if(!osync_member_set_capabilities(member, capabilities, error))
-        goto error;
-      osync_capabilities_unref(capabilities);
-    }
+  if (!_osync_member_load_capabilities(member, error))
+    goto error;
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -585,6 +617,88 @@ osync_bool osync_member_load(OSyncMember *member, const char *path, OSyncError *
   return FALSE;
 }
 
+osync_bool osync_member_snapshot_write(OSyncMessage *message, OSyncMember *member, OSyncError **error)
+{
+  GList *o = NULL;
+
+  osync_assert(message);
+  osync_assert(member);
+
+  osync_message_write_string(message, member->pluginname);
+
+  osync_message_write_int(message, member->main_sink != NULL);
+  if (member->main_sink && !osync_marshal_objtype_sink(message, member->main_sink, error))
+    return FALSE;
+
+  osync_message_write_uint(message, g_list_length(member->objtypes));
+  for (o = member->objtypes; o; o = o->next) {
+    if (!osync_marshal_objtype_sink(message, o->data, error))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+osync_bool osync_member_snapshot_read(OSyncMessage *message, OSyncMember *member, const char *path, OSyncError **error)
+{
+  OSyncObjTypeSink *sink = NULL;
+  unsigned int i, num = 0;
+  int has_main_sink = 0;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %s, %p)", __func__, message, member, path, error);
+  osync_assert(message);
+  osync_assert(member);
+
+  _osync_member_set_configdir_and_id(member, path);
+
+  g_free(member->pluginname);
+  osync_message_read_string(message, &member->pluginname);
+
+  osync_message_read_int(message, &has_main_sink);
+  if (has_main_sink) {
+    if (!osync_demarshal_objtype_sink(message, &sink, error))
+      goto error;
+
+    if (member->main_sink)
+      osync_objtype_sink_unref(member->main_sink);
+    member->main_sink = sink;
+  }
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    if (!osync_demarshal_objtype_sink(message, &sink, error))
+      goto error;
+
+    member->objtypes = g_list_append(member->objtypes, sink);
+  }
+
+  if (!_osync_member_load_capabilities(member, error))
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+static void _osync_member_remove_snapshots(OSyncMember *member)
+{
+  char *groupdir = NULL;
+  char *filename = NULL;
+
+  filename = g_strdup_printf("%s%cconfig.snapshot", member->configdir, G_DIR_SEPARATOR);
+  g_unlink(filename);
+  g_free(filename);
+
+  groupdir = g_path_get_dirname(member->configdir);
+  filename = g_strdup_printf("%s%csyncgroup.snapshot", groupdir, G_DIR_SEPARATOR);
+  g_unlink(filename);
+  g_free(filename);
+  g_free(groupdir);
+}
+
 static osync_bool _osync_member_save_sink_add_timeout(xmlNode *cur, const char *timeoutname, unsigned int timeout, OSyncError **error)
 {
   char *str = NULL;
@@ -715,6 +829,8 @@ osync_bool osync_member_save(OSyncMember *member, OSyncError **error)
 	
   /* TODO Validate file before storing! */
 
+  _osync_member_remove_snapshots(member);
+
   //Saving the syncmember.conf
   filename = g_strdup_printf ("%s%csyncmember.conf", member->configdir, G_DIR_SEPARATOR);
   xmlSaveFormatFile(filename, doc, 1);
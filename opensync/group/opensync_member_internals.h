@@ -48,6 +48,27 @@ struct OSyncMember {
 #endif /* OPENSYNC_UNITTESTS */
 };
 
+/*! @brief Appends the loaded syncmember.conf settings of a member to a snapshot
+ *
+ * @param message The snapshot message
+ * @param member The member
+ * @param error Pointer to a error
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_member_snapshot_write(OSyncMessage *message, OSyncMember *member, OSyncError **error);
+
+/*! @brief Loads a member from a snapshot instead of its syncmember.conf
+ *
+ * Behaves like osync_member_load(), the capabilities get loaded as well.
+ *
+ * @param message The snapshot message
+ * @param member The Member pointer of the member which gets loaded
+ * @param path The path of the member
+ * @param error Pointer to a error
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_member_snapshot_read(OSyncMessage *message, OSyncMember *member, const char *path, OSyncError **error);
+
 #ifdef OPENSYNC_UNITTESTS
 OSYNC_TEST_EXPORT void osync_member_set_schemadir(OSyncMember *member, const char *schemadir);
 #endif
@@ -17,9 +17,11 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
  * 
  */
-
+ 
 #include "opensync.h"
 #include "opensync_internals.h"
+#include "opensync_anchor_internals.h"
+#include "opensync_hashtable_internals.h"
 
 #include "opensync-helper.h"
 #include "opensync-db.h"
@@ -50,130 +52,386 @@ static osync_bool _osync_anchor_db_create(OSyncDB *db, OSyncError **error)
   return TRUE;
 }	
 
-/*! @brief Create an anchor database
+/*! @brief Creates the anchor table if needed and prepares the statements of the store
  * 
- * @param filename the full path to the database file to create
+ * @param store Pointer to the anchor store with an open database
  * @param error Pointer to an error struct
- * @returns a pointer to the new database
+ * @returns TRUE on success, FALSE otherwise
  * 
  */
-static OSyncDB *_osync_anchor_db_new(const char *filename, OSyncError **error)
+static osync_bool _osync_anchor_store_prepare(OSyncAnchorStore *store, OSyncError **error)
 {
-  OSyncDB *db = NULL;
   int ret = 0;
-  osync_trace(TRACE_ENTRY, "%s(%s, %p)", __func__, filename, error);
-	
-  db = osync_db_new(error); 
-  if (!db)
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, store, error);
+
+  ret = osync_db_table_exists(store->dbhandle, "tbl_anchor", error);
+  if (ret < 0)
     goto error;
-	
-  if (!osync_db_open(db, filename, error)) {
-    osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
-    goto error_free_db;
+
+  /* ret equal 0 means table does not exist yet. create one. */
+  if (!ret && !_osync_anchor_db_create(store->dbhandle, error))
+    goto error;
+
+  store->select = osync_db_cursor_new(store->dbhandle, "SELECT anchor FROM tbl_anchor WHERE objtype=?", error);
+  if (!store->select)
+    goto error;
+
+  store->replace = osync_db_cursor_new(store->dbhandle, "REPLACE INTO tbl_anchor (objtype, anchor) VALUES(?, ?)", error);
+  if (!store->replace)
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+/*! @brief Frees the anchor store
+ * 
+ * Anchors updated since the last osync_anchor_store_save() are discarded,
+ * like the changes of a hashtable which didn't get saved.
+ * 
+ * @param store Pointer to the anchor store
+ * 
+ */
+static void _osync_anchor_store_free(OSyncAnchorStore *store)
+{
+  OSyncError *error = NULL;
+
+  if (store->select)
+    osync_db_cursor_free(store->select);
+  if (store->replace)
+    osync_db_cursor_free(store->replace);
+
+  if (store->hashtable) {
+    osync_hashtable_unref(store->hashtable);
+  } else if (store->dbhandle) {
+    if (!osync_db_close(store->dbhandle, &error)) {
+      osync_trace(TRACE_ERROR, "Couldn't close database: %s", osync_error_print(&error));
+      osync_error_unref(&error);
+    }
+    g_free(store->dbhandle);
   }
-	
-  ret = osync_db_table_exists(db, "tbl_anchor", error);
-  if (ret > 0) {
-    osync_trace(TRACE_EXIT, "%s: %p", __func__, db);
-    return db;
-    /* error if ret == -1 */	
-  } else if (ret < 0) {
-    goto error_free_db;
-  }	
-  /* ret equal 0 means table does not exist yet. continue and create one. */
-
-  if (!_osync_anchor_db_create(db, error))
-    goto error_free_db;
-
-  osync_trace(TRACE_EXIT, "%s: %p", __func__, db);
-  return db;
-
- error_free_db:
-  g_free(db);
+
+  g_hash_table_destroy(store->pending);
+  g_free(store);
+}
+
+static OSyncAnchorStore *_osync_anchor_store_alloc(OSyncError **error)
+{
+  OSyncAnchorStore *store = osync_try_malloc0(sizeof(OSyncAnchorStore), error);
+  if (!store)
+    return NULL;
+
+  store->ref_count = 1;
+  store->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  return store;
+}
+
+typedef struct OSyncAnchorStoreWrite {
+  OSyncAnchorStore *store;
+  OSyncError **error;
+  osync_bool failed;
+} OSyncAnchorStoreWrite;
+
+/*! \brief g_hash_table_foreach function which writes one updated anchor
+ */
+static void _osync_anchor_store_write(gpointer key, gpointer anchor, gpointer userdata)
+{
+  OSyncAnchorStoreWrite *batch = userdata;
+  OSyncDBCursor *replace = batch->store->replace;
+
+  if (batch->failed)
+    return;
+
+  if (!osync_db_cursor_bind_string(replace, 1, key, batch->error)
+      || !osync_db_cursor_bind_string(replace, 2, anchor, batch->error)
+      || osync_db_cursor_next(replace, batch->error) < 0)
+    batch->failed = TRUE;
+
+  osync_db_cursor_reset(replace);
+}
+
+#if !GLIB_CHECK_VERSION(2,12,0)
+/*! \brief g_hash_table_foreach_remove foreach function
+ */
+static gboolean remove_entry(gpointer key, gpointer val, gpointer data)
+{
+  return TRUE;
+}
+#endif
+
+/**
+ * @defgroup OSyncAnchorAPI OpenSync Anchor
+ * @ingroup OSyncPublic
+ * @brief Functions to deal with anchors
+ * 
+ * The osync_anchor_compare(), osync_anchor_update() and osync_anchor_retrieve()
+ * functions open the anchor database for every call. Plugins which deal with
+ * several anchors per session should open an OSyncAnchorStore in their
+ * initialize function instead, and call osync_anchor_store_save() in sync_done.
+ * 
+ */
+/*@{*/
+
+/*! @brief Opens an anchor database for a whole session
+ * 
+ * @param anchordb the full path to the anchor database file
+ * @param error Pointer to an error struct
+ * @returns A new anchor store, or NULL if an error occurred
+ * 
+ */
+OSyncAnchorStore *osync_anchor_store_new(const char *anchordb, OSyncError **error)
+{
+  OSyncAnchorStore *store = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%s, %p)", __func__, anchordb, error);
+  osync_assert(anchordb);
+
+  store = _osync_anchor_store_alloc(error);
+  if (!store)
+    goto error;
+
+  store->dbhandle = osync_db_new(error);
+  if (!store->dbhandle)
+    goto error_free_store;
+
+  if (!osync_db_open(store->dbhandle, anchordb, error)) {
+    g_free(store->dbhandle);
+    store->dbhandle = NULL;
+    goto error_free_store;
+  }
+
+  if (!_osync_anchor_store_prepare(store, error))
+    goto error_free_store;
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, store);
+  return store;
+
+ error_free_store:
+  _osync_anchor_store_free(store);
  error:
   osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
   return NULL;
 }
 
-/*! @brief Close and free an anchor database handle
+/*! @brief Opens an anchor store in the database of a hashtable
  * 
- * @param db Pointer to the database
+ * The anchors get stored next to the hashtable and share its database
+ * connection. The store keeps a reference on the hashtable.
+ * 
+ * @param hashtable the hashtable to share the database with
+ * @param error Pointer to an error struct
+ * @returns A new anchor store, or NULL if an error occurred
+ * 
+ */
+OSyncAnchorStore *osync_anchor_store_new_from_hashtable(OSyncHashTable *hashtable, OSyncError **error)
+{
+  OSyncAnchorStore *store = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, hashtable, error);
+  osync_assert(hashtable);
+
+  store = _osync_anchor_store_alloc(error);
+  if (!store)
+    goto error;
+
+  store->hashtable = osync_hashtable_ref(hashtable);
+  store->dbhandle = hashtable->dbhandle;
+
+  if (!_osync_anchor_store_prepare(store, error))
+    goto error_free_store;
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, store);
+  return store;
+
+ error_free_store:
+  _osync_anchor_store_free(store);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+/*! @brief Increase the reference count of the anchor store
+ *
+ * @param store The anchor store
+ * @returns Pointer to the anchor store
+ */
+OSyncAnchorStore *osync_anchor_store_ref(OSyncAnchorStore *store)
+{
+  osync_assert(store);
+	
+  g_atomic_int_inc(&(store->ref_count));
+
+  return store;
+}
+
+/*! @brief Decrease the reference count of the anchor store. Anchors
+ *         which are not saved yet get discarded when the store gets freed.
+ * 
+ * A synchronization which failed before sync_done() must not move the
+ * anchors forward, so they only get written by osync_anchor_store_save().
+ * 
+ * @param store The anchor store
  * 
  */
-static void _osync_anchor_db_free(OSyncDB *db)
+void osync_anchor_store_unref(OSyncAnchorStore *store)
 {
-  osync_assert(db);
+  osync_assert(store);
 
-  if (!osync_db_close(db, NULL))
-    osync_trace(TRACE_INTERNAL, "Can't close database");
+  if (g_atomic_int_dec_and_test(&(store->ref_count))) {
+    osync_trace(TRACE_ENTRY, "%s(%p)", __func__, store);
 
-  g_free(db);
+    if (g_hash_table_size(store->pending))
+      osync_trace(TRACE_INTERNAL, "Discarding %u unsaved anchors", g_hash_table_size(store->pending));
+
+    _osync_anchor_store_free(store);
+
+    osync_trace(TRACE_EXIT, "%s", __func__);
+  }
 }
 
 /*! @brief Retrieves the value of an anchor
  * 
- * @param db Pointer to the database
+ * Anchors updated with osync_anchor_store_update() are returned even
+ * if they are not saved yet.
+ * 
+ * @param store The anchor store
  * @param key the key of the anchor to look up
- * @returns the value of the anchor if it was found, otherwise NULL
+ * @param error Pointer to an error struct
+ * @returns the value of the anchor if it was found, otherwise NULL. Free with g_free()
  * 
  */
-static char *_osync_anchor_db_retrieve(OSyncDB *db, const char *key)
+char *osync_anchor_store_retrieve(OSyncAnchorStore *store, const char *key, OSyncError **error)
 {
+  const char *pending = NULL;
   char *retanchor = NULL;
-  char *escaped_key = NULL;
-  char *query = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p, %s)", __func__, db, key);
-  osync_assert(db);
+  int ret = 0;
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, store, key, error);
+  osync_assert(store);
   osync_assert(key);
 
-  escaped_key = osync_db_sql_escape(key);
-  query = g_strdup_printf("SELECT anchor FROM tbl_anchor WHERE objtype='%s'", escaped_key);
-  retanchor = osync_db_query_single_string(db, query, NULL); 
-  g_free(query);
-  g_free(escaped_key);
-	
+  pending = g_hash_table_lookup(store->pending, key);
+  if (pending) {
+    osync_trace(TRACE_EXIT, "%s: %s (not saved)", __func__, pending);
+    return g_strdup(pending);
+  }
+
+  if (!osync_db_cursor_bind_string(store->select, 1, key, error))
+    goto error;
+
+  ret = osync_db_cursor_next(store->select, error);
+  if (ret < 0)
+    goto error;
+  if (ret > 0)
+    retanchor = g_strdup(osync_db_cursor_get_string(store->select, 0));
+
+  osync_db_cursor_reset(store->select);
+
   osync_trace(TRACE_EXIT, "%s: %s", __func__, retanchor);
   return retanchor;
+
+ error:
+  osync_db_cursor_reset(store->select);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
 }
 
-/*! @brief Updates the value of an anchor
+/*! @brief Compares the value of an anchor with the supplied value
  * 
- * @param db Pointer to the database
+ * @param store The anchor store
  * @param key the key of the anchor to look up
- * @param anchor the new value to set
+ * @param new_anchor the value to compare with the stored value
+ * @param error Pointer to an error struct
+ * @returns TRUE if the anchor matches, FALSE if it doesn't or on error
  * 
  */
-static void _osync_anchor_db_update(OSyncDB *db, const char *key, const char *anchor)
+osync_bool osync_anchor_store_compare(OSyncAnchorStore *store, const char *key, const char *new_anchor, OSyncError **error)
 {
-  char *escaped_key = NULL;
-  char *escaped_anchor = NULL;
-  char *query = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p, %, %s)", __func__, db, key, anchor);
-  osync_assert(db);
-  osync_assert(key);
-
-  escaped_key = osync_db_sql_escape(key);
-  escaped_anchor = osync_db_sql_escape(anchor);
-  query = g_strdup_printf("REPLACE INTO tbl_anchor (objtype, anchor) VALUES('%s', '%s')", escaped_key, escaped_anchor);
-  g_free(escaped_key);
-  g_free(escaped_anchor);
+  char *old_anchor = NULL;
+  osync_bool retval = FALSE;
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %s, %p)", __func__, store, key, new_anchor, error);
 
-  /* TODO: Add Error handling in this funciton for osync_db_query() */
-  if (!osync_db_query(db, query, NULL)) {
-    osync_trace(TRACE_INTERNAL, "Unable put anchor!");
+  old_anchor = osync_anchor_store_retrieve(store, key, error);
+  if (old_anchor) {
+    if (new_anchor && !strcmp(old_anchor, new_anchor))
+      retval = TRUE;
+    g_free(old_anchor);
   }
-  g_free(query);
+
+  osync_trace(TRACE_EXIT, "%s: %i", __func__, retval);
+  return retval;
+}
+
+/*! @brief Updates the value of an anchor
+ * 
+ * The update is kept in memory until osync_anchor_store_save() writes
+ * all updated anchors in one transaction. This is usually done in the
+ * sync_done() function.
+ * 
+ * @param store The anchor store
+ * @param key the key of the anchor
+ * @param new_anchor the new value to set
+ * 
+ */
+void osync_anchor_store_update(OSyncAnchorStore *store, const char *key, const char *new_anchor)
+{
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %s)", __func__, store, key, new_anchor);
+  osync_assert(store);
+  osync_assert(key);
+
+  g_hash_table_replace(store->pending, g_strdup(key), g_strdup(new_anchor ? new_anchor : ""));
 
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
-/**
- * @defgroup OSyncAnchorAPI OpenSync Anchor
- * @ingroup OSyncPublic
- * @brief Functions to deal with anchors
+/*! @brief Writes all updated anchors in one transaction
+ * 
+ * @param store The anchor store
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise. The updates are kept on error
  * 
  */
-/*@{*/
+osync_bool osync_anchor_store_save(OSyncAnchorStore *store, OSyncError **error)
+{
+  OSyncAnchorStoreWrite batch;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, store, error);
+  osync_assert(store);
+
+  if (!g_hash_table_size(store->pending)) {
+    osync_trace(TRACE_EXIT, "%s: nothing to save", __func__);
+    return TRUE;
+  }
+
+  if (!osync_db_query(store->dbhandle, "BEGIN TRANSACTION", error))
+    goto error;
+
+  batch.store = store;
+  batch.error = error;
+  batch.failed = FALSE;
+  g_hash_table_foreach(store->pending, _osync_anchor_store_write, &batch);
+  if (batch.failed)
+    goto error_rollback;
+
+  if (!osync_db_query(store->dbhandle, "COMMIT TRANSACTION", error))
+    goto error_rollback;
+
+#if GLIB_CHECK_VERSION(2,12,0)
+  g_hash_table_remove_all(store->pending);
+#else
+  g_hash_table_foreach_remove(store->pending, remove_entry, NULL);
+#endif
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_rollback:
+  osync_db_query(store->dbhandle, "ROLLBACK TRANSACTION", NULL);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
 
 /*! @brief Compares the value of an anchor with the supplied value
  * 
@@ -185,34 +443,28 @@ static void _osync_anchor_db_update(OSyncDB *db, const char *key, const char *an
  */
 osync_bool osync_anchor_compare(const char *anchordb, const char *key, const char *new_anchor)
 {
-  OSyncDB *db = NULL;
-  char *old_anchor = NULL;
+  OSyncAnchorStore *store = NULL;
   osync_bool retval = FALSE;
 
   osync_trace(TRACE_ENTRY, "%s(%s, %s, %s)", __func__, anchordb, key, new_anchor);
   osync_assert(anchordb);
 	
-  db = _osync_anchor_db_new(anchordb, NULL);
-  if (!db)
+  store = osync_anchor_store_new(anchordb, NULL);
+  if (!store)
     return FALSE;
 	
-  old_anchor = _osync_anchor_db_retrieve(db, key);
-  if (old_anchor) {
-    if (!strcmp(old_anchor, new_anchor)) {
-      retval = TRUE;
-    } else {
-      retval = FALSE;
-    }
-    g_free(old_anchor);
-  }
+  retval = osync_anchor_store_compare(store, key, new_anchor, NULL);
 	
-  _osync_anchor_db_free(db);
+  osync_anchor_store_unref(store);
 	
   osync_trace(TRACE_EXIT, "%s: %i", __func__, retval);
   return retval;
 }
 
 /*! @brief Updates the value of an anchor
+ * 
+ * Errors only get traced, use osync_anchor_update_full() to find out
+ * whether the anchor got written.
  * 
  * @param anchordb the full path to the anchor database file
  * @param key the key of the anchor to look up
@@ -221,20 +473,51 @@ osync_bool osync_anchor_compare(const char *anchordb, const char *key, const cha
  */
 void osync_anchor_update(const char *anchordb, const char *key, const char *new_anchor)
 {
-  OSyncDB *db = NULL;
+  OSyncError *error = NULL;
   osync_trace(TRACE_ENTRY, "%s(%s, %s, %s)", __func__, anchordb, key, new_anchor);
+
+  if (!osync_anchor_update_full(anchordb, key, new_anchor, &error)) {
+    osync_trace(TRACE_INTERNAL, "Unable put anchor: %s", osync_error_print(&error));
+    osync_error_unref(&error);
+  }
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+/*! @brief Updates the value of an anchor and reports errors
+ * 
+ * @param anchordb the full path to the anchor database file
+ * @param key the key of the anchor to look up
+ * @param new_anchor the new value to set
+ * @param error Pointer to an error struct
+ * @returns TRUE if the anchor got written, FALSE otherwise
+ * 
+ */
+osync_bool osync_anchor_update_full(const char *anchordb, const char *key, const char *new_anchor, OSyncError **error)
+{
+  OSyncAnchorStore *store = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%s, %s, %s, %p)", __func__, anchordb, key, new_anchor, error);
   osync_assert(anchordb);
 	
-  db = _osync_anchor_db_new(anchordb, NULL);
-  if (!db)
-    return;
+  store = osync_anchor_store_new(anchordb, error);
+  if (!store)
+    goto error;
 	
-  _osync_anchor_db_update(db, key, new_anchor);
+  osync_anchor_store_update(store, key, new_anchor);
+
+  if (!osync_anchor_store_save(store, error))
+    goto error_unref_store;
 	
-  _osync_anchor_db_free(db);
+  osync_anchor_store_unref(store);
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
-  return;
+  return TRUE;
+
+ error_unref_store:
+  osync_anchor_store_unref(store);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
 }
 
 /*! @brief Retrieves the value of an anchor
@@ -246,19 +529,19 @@ void osync_anchor_update(const char *anchordb, const char *key, const char *new_
  */
 char *osync_anchor_retrieve(const char *anchordb, const char *key)
 {
-  OSyncDB *db = NULL;
+  OSyncAnchorStore *store = NULL;
   char *retval = NULL;
 
   osync_trace(TRACE_ENTRY, "%s(%s, %s)", __func__, anchordb, key);
   osync_assert(anchordb);
 	
-  db = _osync_anchor_db_new(anchordb, NULL);
-  if (!db)
+  store = osync_anchor_store_new(anchordb, NULL);
+  if (!store)
     return NULL;
 	
-  retval = _osync_anchor_db_retrieve(db, key);
+  retval = osync_anchor_store_retrieve(store, key, NULL);
 	
-  _osync_anchor_db_free(db);
+  osync_anchor_store_unref(store);
 	
   osync_trace(TRACE_EXIT, "%s: %s", __func__, retval);
   return retval;
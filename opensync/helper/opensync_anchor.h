@@ -23,6 +23,18 @@
 
 OSYNC_EXPORT osync_bool osync_anchor_compare(const char *anchordb, const char *key, const char *new_anchor);
 OSYNC_EXPORT void osync_anchor_update(const char *anchordb, const char *key, const char *new_anchor);
+OSYNC_EXPORT osync_bool osync_anchor_update_full(const char *anchordb, const char *key, const char *new_anchor, OSyncError **error);
 OSYNC_EXPORT char *osync_anchor_retrieve(const char *anchordb, const char *key);
 
+OSYNC_EXPORT OSyncAnchorStore *osync_anchor_store_new(const char *anchordb, OSyncError **error);
+OSYNC_EXPORT OSyncAnchorStore *osync_anchor_store_new_from_hashtable(OSyncHashTable *hashtable, OSyncError **error);
+
+OSYNC_EXPORT OSyncAnchorStore *osync_anchor_store_ref(OSyncAnchorStore *store);
+OSYNC_EXPORT void osync_anchor_store_unref(OSyncAnchorStore *store);
+
+OSYNC_EXPORT osync_bool osync_anchor_store_compare(OSyncAnchorStore *store, const char *key, const char *new_anchor, OSyncError **error);
+OSYNC_EXPORT void osync_anchor_store_update(OSyncAnchorStore *store, const char *key, const char *new_anchor);
+OSYNC_EXPORT char *osync_anchor_store_retrieve(OSyncAnchorStore *store, const char *key, OSyncError **error);
+OSYNC_EXPORT osync_bool osync_anchor_store_save(OSyncAnchorStore *store, OSyncError **error);
+
 #endif /* OPENSYNC_ANCHOR_H_ */
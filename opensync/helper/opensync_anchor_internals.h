@@ -0,0 +1,40 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef _OPENSYNC_ANCHOR_INTERNALS_H_
+#define _OPENSYNC_ANCHOR_INTERNALS_H_
+
+/*! @brief Keeps an anchor database open for a whole session */
+struct OSyncAnchorStore {
+	int ref_count;
+	OSyncDB *dbhandle;
+
+	/** The hashtable whose database is shared, NULL if the store opened its own */
+	OSyncHashTable *hashtable;
+
+	/** Prepared statements to look up and to write an anchor */
+	OSyncDBCursor *select;
+	OSyncDBCursor *replace;
+
+	/** Updated anchors which are not saved yet, key -> anchor */
+	GHashTable *pending;
+};
+
+#endif /*_OPENSYNC_ANCHOR_INTERNALS_H_*/
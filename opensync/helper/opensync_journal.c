@@ -0,0 +1,753 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#include "opensync.h"
+#include "opensync_internals.h"
+#include "opensync_journal_internals.h"
+#include "opensync_hashtable_internals.h"
+
+#include "opensync-helper.h"
+#include "opensync-db.h"
+
+#include <unistd.h>
+#include <time.h>
+
+#ifdef HAVE_INOTIFY
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define OSYNC_JOURNAL_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+                                  IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+/**
+ * @defgroup OSyncJournalPrivateAPI OpenSync Change Journal Internals
+ * @ingroup OSyncPrivate
+ * @brief Keeps track of changed files with kernel notifications
+ */
+
+/*@{*/
+
+static char *_osync_journal_build_uid(const char *dir, const char *name)
+{
+  if (!dir[0])
+    return g_strdup(name);
+
+  return g_build_filename(dir, name, NULL);
+}
+
+/* Takes ownership of uid */
+static void _osync_journal_mark_dirty(OSyncJournal *journal, char *uid)
+{
+  g_hash_table_replace(journal->dirty, uid, GINT_TO_POINTER(1));
+}
+
+static void _osync_journal_free(OSyncJournal *journal)
+{
+  if (journal->fd >= 0)
+    close(journal->fd);
+
+  g_hash_table_destroy(journal->watches);
+  g_hash_table_destroy(journal->dirty);
+  g_hash_table_destroy(journal->pending);
+
+  if (journal->hashtable)
+    osync_hashtable_unref(journal->hashtable);
+
+  g_free(journal->uid_table);
+  g_free(journal->state_table);
+  g_free(journal->root);
+  g_free(journal);
+}
+
+#if !GLIB_CHECK_VERSION(2,12,0)
+/*! \brief g_hash_table_foreach_remove foreach function
+ */
+static gboolean remove_entry(gpointer key, gpointer val, gpointer data)
+{
+  return TRUE;
+}
+#endif
+
+static void _osync_journal_clear(GHashTable *table)
+{
+#if GLIB_CHECK_VERSION(2,12,0)
+  g_hash_table_remove_all(table);
+#else
+  g_hash_table_foreach_remove(table, remove_entry, NULL);
+#endif
+}
+
+#ifdef HAVE_INOTIFY
+/*! @brief Gives up on kernel notifications, every synchronization rescans from now on */
+static void _osync_journal_stop_watching(OSyncJournal *journal)
+{
+  osync_trace(TRACE_INTERNAL, "Not watching %s anymore", journal->root);
+
+  close(journal->fd);
+  journal->fd = -1;
+  journal->rescan = TRUE;
+
+  _osync_journal_clear(journal->watches);
+}
+
+/*! @brief Watches a directory and all directories below it
+ *
+ * The watch gets added before the directory gets listed, so a file which
+ * gets created meanwhile is either listed or reported by an event.
+ *
+ * @param journal The journal
+ * @param dir The directory relative to the root of the journal
+ * @param mark_dirty TRUE if all files below the directory should get marked dirty
+ *
+ */
+static void _osync_journal_watch(OSyncJournal *journal, const char *dir, osync_bool mark_dirty)
+{
+  const char *de = NULL;
+  GDir *dirhandle = NULL;
+  char *path = NULL;
+  int wd;
+
+  path = dir[0] ? g_build_filename(journal->root, dir, NULL) : g_strdup(journal->root);
+
+  wd = inotify_add_watch(journal->fd, path, OSYNC_JOURNAL_WATCH_MASK);
+  if (wd < 0) {
+    osync_trace(TRACE_ERROR, "Unable to watch %s: %s", path, g_strerror(errno));
+    /* A directory which vanished meanwhile gets reported by its parent.
+       Anything else, most likely the limit of watches, leaves the journal
+       with a blind spot. */
+    if (errno != ENOENT && errno != ENOTDIR)
+      _osync_journal_stop_watching(journal);
+    g_free(path);
+    return;
+  }
+
+  g_hash_table_replace(journal->watches, GINT_TO_POINTER(wd), g_strdup(dir));
+
+  dirhandle = g_dir_open(path, 0, NULL);
+  if (!dirhandle) {
+    g_free(path);
+    return;
+  }
+
+  while ((de = g_dir_read_name(dirhandle)) && journal->fd >= 0) {
+    char *filename = g_build_filename(path, de, NULL);
+    char *uid = _osync_journal_build_uid(dir, de);
+
+    if (g_file_test(filename, G_FILE_TEST_IS_DIR) && !g_file_test(filename, G_FILE_TEST_IS_SYMLINK)) {
+      _osync_journal_watch(journal, uid, mark_dirty);
+      g_free(uid);
+    } else if (mark_dirty) {
+      _osync_journal_mark_dirty(journal, uid);
+    } else {
+      g_free(uid);
+    }
+
+    g_free(filename);
+  }
+
+  g_dir_close(dirhandle);
+  g_free(path);
+}
+
+typedef struct {
+  OSyncJournal *journal;
+  GString *prefix;
+} OSyncJournalForget;
+
+static gboolean _osync_journal_forget_watch(gpointer key, gpointer value, gpointer user_data)
+{
+  OSyncJournalForget *forget = user_data;
+  const char *dir = value;
+  size_t len = forget->prefix->len;
+
+  if (strncmp(dir, forget->prefix->str, len) || (dir[len] != '\0' && dir[len] != G_DIR_SEPARATOR))
+    return FALSE;
+
+  inotify_rm_watch(forget->journal->fd, GPOINTER_TO_INT(key));
+  return TRUE;
+}
+
+/*! @brief Removes the watches of a directory which got moved away */
+static void _osync_journal_forget_watches(OSyncJournal *journal, const char *dir)
+{
+  OSyncJournalForget forget;
+
+  forget.journal = journal;
+  forget.prefix = g_string_new(dir);
+
+  g_hash_table_foreach_remove(journal->watches, _osync_journal_forget_watch, &forget);
+
+  g_string_free(forget.prefix, TRUE);
+}
+
+static void _osync_journal_handle_event(OSyncJournal *journal, const struct inotify_event *event)
+{
+  const char *dir = NULL;
+  char *uid = NULL;
+
+  if (event->mask & IN_Q_OVERFLOW) {
+    osync_trace(TRACE_INTERNAL, "Event queue of %s overflowed", journal->root);
+    journal->rescan = TRUE;
+    return;
+  }
+
+  dir = g_hash_table_lookup(journal->watches, GINT_TO_POINTER(event->wd));
+  if (!dir)
+    return;
+
+  if (event->mask & IN_IGNORED) {
+    g_hash_table_remove(journal->watches, GINT_TO_POINTER(event->wd));
+    return;
+  }
+
+  if (!event->len) {
+    /* Event of the watched directory itself. Directories below the root
+       get reported by their parent as well, only losing the root is fatal:
+       a new directory at its place would never be watched. */
+    if (!dir[0] && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)))
+      _osync_journal_stop_watching(journal);
+    return;
+  }
+
+  uid = _osync_journal_build_uid(dir, event->name);
+
+  if (event->mask & IN_ISDIR) {
+    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+      _osync_journal_watch(journal, uid, TRUE);
+    } else if (event->mask & IN_MOVED_FROM) {
+      /* The files below went away without an event of their own. A deleted
+         directory was empty, its files got reported one by one before. */
+      _osync_journal_forget_watches(journal, uid);
+      journal->rescan = TRUE;
+    }
+    g_free(uid);
+    return;
+  }
+
+  _osync_journal_mark_dirty(journal, uid);
+}
+
+/*! @brief Marks the files which changed while nobody watched the tree
+ *
+ * A file whose inode changed since the stamp is dirty. A directory which
+ * changed since got entries created, deleted or renamed, which can't be
+ * told apart without a listing of before, so the tree has to be rescanned.
+ *
+ * @param journal The journal, already watching the tree
+ * @param dir The directory relative to the root of the journal
+ * @param stamp The time up to which the stored journal is complete
+ *
+ */
+static void _osync_journal_check_unwatched(OSyncJournal *journal, const char *dir, time_t stamp)
+{
+  const char *de = NULL;
+  GDir *dirhandle = NULL;
+  char *path = NULL;
+  struct stat buf;
+
+  path = dir[0] ? g_build_filename(journal->root, dir, NULL) : g_strdup(journal->root);
+
+  if (lstat(path, &buf) || buf.st_ctime >= stamp || !(dirhandle = g_dir_open(path, 0, NULL))) {
+    osync_trace(TRACE_INTERNAL, "%s changed while not watched", path);
+    journal->rescan = TRUE;
+    g_free(path);
+    return;
+  }
+
+  while ((de = g_dir_read_name(dirhandle)) && !journal->rescan) {
+    char *filename = g_build_filename(path, de, NULL);
+    char *uid = _osync_journal_build_uid(dir, de);
+
+    if (lstat(filename, &buf)) {
+      journal->rescan = TRUE;
+      g_free(uid);
+    } else if (S_ISDIR(buf.st_mode)) {
+      _osync_journal_check_unwatched(journal, uid, stamp);
+      g_free(uid);
+    } else if (buf.st_ctime >= stamp) {
+      _osync_journal_mark_dirty(journal, uid);
+    } else {
+      g_free(uid);
+    }
+
+    g_free(filename);
+  }
+
+  g_dir_close(dirhandle);
+  g_free(path);
+}
+#endif /* HAVE_INOTIFY */
+
+/*! @brief Reads all queued kernel notifications without blocking */
+static void _osync_journal_read_events(OSyncJournal *journal)
+{
+#ifdef HAVE_INOTIFY
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *event = NULL;
+  ssize_t len;
+  char *ptr;
+
+  while (journal->fd >= 0) {
+    len = read(journal->fd, buf, sizeof(buf));
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN)
+        _osync_journal_stop_watching(journal);
+      break;
+    }
+
+    for (ptr = buf; ptr < buf + len && journal->fd >= 0; ptr += sizeof(struct inotify_event) + event->len) {
+      event = (const struct inotify_event *) ptr;
+      _osync_journal_handle_event(journal, event);
+    }
+  }
+#endif
+}
+
+static gboolean _osync_journal_steal_dirty(gpointer key, gpointer value, gpointer user_data)
+{
+  OSyncJournal *journal = user_data;
+
+  /* Keeps the key which is already pending, lists handed out stay valid */
+  g_hash_table_insert(journal->pending, key, value);
+  return TRUE;
+}
+
+static void _osync_journal_list_pending(gpointer key, gpointer value, gpointer user_data)
+{
+  OSyncList **uids = user_data;
+  *uids = osync_list_prepend(*uids, key);
+}
+
+/*! @brief Creates the tables of the journal next to the hashtable if needed */
+static osync_bool _osync_journal_create_tables(OSyncJournal *journal, OSyncError **error)
+{
+  OSyncDB *db = journal->hashtable->dbhandle;
+  char *query = NULL;
+  osync_bool ret = TRUE;
+  int exists;
+
+  exists = osync_db_table_exists(db, journal->uid_table, error);
+  if (exists < 0)
+    return FALSE;
+
+  if (!exists) {
+    query = g_strdup_printf("CREATE TABLE %s (uid VARCHAR PRIMARY KEY)", journal->uid_table);
+    ret = osync_db_query(db, query, error);
+    g_free(query);
+    if (!ret)
+      return FALSE;
+  }
+
+  exists = osync_db_table_exists(db, journal->state_table, error);
+  if (exists < 0)
+    return FALSE;
+
+  if (!exists) {
+    query = g_strdup_printf("CREATE TABLE %s (id INTEGER PRIMARY KEY, stamp INTEGER, rescan INTEGER)", journal->state_table);
+    ret = osync_db_query(db, query, error);
+    g_free(query);
+  }
+
+  return ret;
+}
+
+/*! @brief Restores the journal stored by a previous session
+ *
+ * Without a stored journal, or if it asked for a rescan, the rescan stays
+ * requested. Otherwise the stored uids become dirty again, together with
+ * everything which changed since the journal got stored.
+ *
+ * @param journal The journal, already watching the tree
+ * @param error An error struct
+ * @returns TRUE on success, FALSE if the database can't be read
+ *
+ */
+static osync_bool _osync_journal_load(OSyncJournal *journal, OSyncError **error)
+{
+  OSyncDB *db = journal->hashtable->dbhandle;
+  OSyncList *row = NULL, *result = NULL;
+  char *query = NULL;
+  long long int stamp = 0;
+  int rescan = 1;
+
+  query = g_strdup_printf("SELECT stamp, rescan FROM %s WHERE id=1", journal->state_table);
+  result = osync_db_query_table(db, query, error);
+  g_free(query);
+
+  /* If result is NULL, this means no journal got stored - just check for error. */
+  if (osync_error_is_set(error))
+    return FALSE;
+
+  if (result) {
+    OSyncList *column = result->data;
+    stamp = g_ascii_strtoll(osync_list_nth_data(column, 0), NULL, 10);
+    rescan = atoi(osync_list_nth_data(column, 1));
+    osync_db_free_list(result);
+  }
+
+  if (rescan || journal->fd < 0) {
+    osync_trace(TRACE_INTERNAL, "No usable journal stored for %s", journal->root);
+    return TRUE;
+  }
+
+  query = g_strdup_printf("SELECT uid FROM %s", journal->uid_table);
+  result = osync_db_query_table(db, query, error);
+  g_free(query);
+
+  if (osync_error_is_set(error))
+    return FALSE;
+
+  for (row = result; row; row = row->next) {
+    OSyncList *column = row->data;
+    _osync_journal_mark_dirty(journal, g_strdup(osync_list_nth_data(column, 0)));
+  }
+  osync_db_free_list(result);
+
+  journal->rescan = FALSE;
+#ifdef HAVE_INOTIFY
+  _osync_journal_check_unwatched(journal, "", (time_t)stamp);
+#endif
+
+  return TRUE;
+}
+
+typedef struct {
+  const char *table;
+  GString *query;
+} OSyncJournalInsert;
+
+static void _osync_journal_prepare_insert_query(gpointer key, gpointer value, gpointer user_data)
+{
+  OSyncJournalInsert *insert = user_data;
+  char *escaped_uid = osync_db_sql_escape(key);
+
+  g_string_append_printf(insert->query, "REPLACE INTO %s (uid) VALUES('%s');", insert->table, escaped_uid);
+
+  g_free(escaped_uid);
+}
+
+/*! @brief Stores the journal next to the hashtable
+ *
+ * The dirty and the pending uids get stored, so a synchronization which
+ * didn't finish gets them again after a restart.
+ *
+ * A journal which failed to be stored is not fatal. The journal stored
+ * before is older, so it only makes the next session check more files.
+ *
+ * @param journal The journal
+ *
+ */
+static void _osync_journal_save(OSyncJournal *journal)
+{
+  OSyncError *error = NULL;
+  OSyncJournalInsert insert;
+  osync_bool rescan;
+  char *query = NULL;
+  time_t stamp;
+
+  /* The stamp is taken before the last events get read, anything which
+     happens afterwards is newer. The timestamps of the files come from a
+     coarser clock, which can lag behind by a tick. */
+  stamp = time(NULL) - 1;
+  _osync_journal_read_events(journal);
+
+  rescan = journal->rescan || journal->rescanning || journal->fd < 0;
+
+  insert.table = journal->uid_table;
+  insert.query = g_string_new("BEGIN TRANSACTION;");
+  g_string_append_printf(insert.query, "DELETE FROM %s;", journal->uid_table);
+
+  if (!rescan) {
+    g_hash_table_foreach(journal->dirty, _osync_journal_prepare_insert_query, &insert);
+    g_hash_table_foreach(journal->pending, _osync_journal_prepare_insert_query, &insert);
+  }
+
+  g_string_append_printf(insert.query, "REPLACE INTO %s (id, stamp, rescan) VALUES(1, %lli, %i);",
+                         journal->state_table, (long long int)stamp, rescan ? 1 : 0);
+  g_string_append(insert.query, "COMMIT TRANSACTION;");
+
+  query = g_string_free(insert.query, FALSE);
+  if (!osync_db_query(journal->hashtable->dbhandle, query, &error)) {
+    osync_trace(TRACE_ERROR, "Unable to store the journal of %s: %s", journal->root, osync_error_print(&error));
+    osync_error_unref(&error);
+    osync_db_query(journal->hashtable->dbhandle, "ROLLBACK TRANSACTION", NULL);
+  }
+  g_free(query);
+}
+
+/*@}*/
+
+/**
+ * @defgroup OSyncJournalAPI OpenSync Change Journal
+ * @ingroup OSyncPublic
+ * @brief Keeps track of changed files with kernel notifications
+ *
+ * Plugins which synchronize a directory usually detect changes by walking
+ * the whole tree, stat()ing every file and asking the hashtable for the
+ * changetype of every file. The cost of a fast sync grows with the number
+ * of files, not with the number of changes.
+ *
+ * A journal watches the directory with inotify, on Linux, and keeps the
+ * uids, the paths relative to the root, of all files which got created,
+ * modified, moved or deleted:
+ *
+ * - osync_journal_new() inside of the plugin initialization. The journal
+ *   should live as long as the plugin, since changes are only noticed
+ *   while it exists.
+ *
+ * - osync_journal_get_dirty() inside of get_changes(). If rescan is
+ *   set the plugin walks the whole tree as before and reports deleted
+ *   entries with osync_hashtable_get_deleted(). Otherwise only the
+ *   returned uids need to be checked with the hashtable. A uid of a file
+ *   which doesn't exist anymore is deleted, if the hashtable knows it.
+ *   osync_hashtable_get_deleted() must not be used in this case, since
+ *   all unchecked entries would be reported as deleted.
+ *
+ * - osync_journal_commit() inside of sync_done(), next to
+ *   osync_hashtable_save(). Uids handed out by osync_journal_get_dirty()
+ *   are kept until then, so a failed synchronization gets them again.
+ *
+ * A journal from osync_journal_new() only lives in memory, a rescan is
+ * requested after every start of the plugin. A journal from
+ * osync_journal_new_from_hashtable() gets stored next to the hashtable
+ * when it gets committed and when it gets freed. Nobody watches the tree
+ * while the plugin isn't running, so the next session marks every file
+ * whose inode changed since then dirty as well. If a directory changed
+ * meanwhile a rescan is requested, since files got created, deleted or
+ * renamed.
+ *
+ * A rescan is also requested if the kernel dropped events or if a
+ * directory got moved away. Without inotify support every call requests
+ * a rescan.
+ */
+/*@{*/
+
+/*! @brief Creates a journal for a directory and starts watching it
+ *
+ * @param root the directory to watch
+ * @param error An error struct
+ * @returns A new journal, or NULL if an error occurred.
+ *
+ */
+OSyncJournal *osync_journal_new(const char *root, OSyncError **error)
+{
+  OSyncJournal *journal = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%s, %p)", __func__, root, error);
+  osync_assert(root);
+
+  journal = osync_try_malloc0(sizeof(OSyncJournal), error);
+  if (!journal)
+    goto error;
+
+  journal->ref_count = 1;
+  journal->fd = -1;
+  journal->rescan = TRUE;
+  journal->root = g_strdup(root);
+
+  journal->watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+  journal->dirty = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  journal->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+#ifdef HAVE_INOTIFY
+  journal->fd = inotify_init();
+  if (journal->fd >= 0) {
+    fcntl(journal->fd, F_SETFL, O_NONBLOCK);
+    fcntl(journal->fd, F_SETFD, FD_CLOEXEC);
+    _osync_journal_watch(journal, "", FALSE);
+  } else {
+    osync_trace(TRACE_ERROR, "Unable to initialize inotify: %s", g_strerror(errno));
+  }
+#endif
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, journal);
+  return journal;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+/*! @brief Creates a journal for a directory which gets stored next to a hashtable
+ *
+ * The journal shares the database connection of the hashtable and keeps a
+ * reference on it. The journal stored by the previous session gets
+ * restored, see osync_journal_get_dirty().
+ *
+ * @param root the directory to watch
+ * @param hashtable the hashtable to share the database with
+ * @param error An error struct
+ * @returns A new journal, or NULL if an error occurred.
+ *
+ */
+OSyncJournal *osync_journal_new_from_hashtable(const char *root, OSyncHashTable *hashtable, OSyncError **error)
+{
+  OSyncJournal *journal = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%s, %p, %p)", __func__, root, hashtable, error);
+  osync_assert(hashtable);
+
+  journal = osync_journal_new(root, error);
+  if (!journal)
+    goto error;
+
+  journal->hashtable = osync_hashtable_ref(hashtable);
+  journal->uid_table = g_strdup_printf("%s_journal", hashtable->name);
+  journal->state_table = g_strdup_printf("%s_journal_state", hashtable->name);
+
+  if (!_osync_journal_create_tables(journal, error))
+    goto error_free_journal;
+
+  if (!_osync_journal_load(journal, error))
+    goto error_free_journal;
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, journal);
+  return journal;
+
+ error_free_journal:
+  _osync_journal_free(journal);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
+/*! @brief Increase the reference count of the journal.
+ *
+ * @param journal The journal to increase the reference count
+ * @returns Pointer to increased journal object
+ */
+OSyncJournal *osync_journal_ref(OSyncJournal *journal)
+{
+  osync_assert(journal);
+
+  g_atomic_int_inc(&(journal->ref_count));
+
+  return journal;
+}
+
+/*! @brief Decrease the reference count of the journal. The journal
+ *         stops watching and gets freed if the reference count gets
+ *         less then one.
+ *
+ * A journal stored next to a hashtable gets stored one last time,
+ * including the uids which didn't get committed.
+ *
+ * @param journal The journal to decrease the reference count
+ *
+ */
+void osync_journal_unref(OSyncJournal *journal)
+{
+  osync_assert(journal);
+
+  if (g_atomic_int_dec_and_test(&(journal->ref_count))) {
+    osync_trace(TRACE_ENTRY, "%s(%p)", __func__, journal);
+
+    if (journal->hashtable)
+      _osync_journal_save(journal);
+
+    _osync_journal_free(journal);
+    osync_trace(TRACE_EXIT, "%s", __func__);
+  }
+}
+
+/*! @brief Forgets the uids handed out so far
+ *
+ * Call this function when the synchronization finished successfully,
+ * usually inside of sync_done() after osync_hashtable_save(). A journal
+ * stored next to a hashtable gets stored as well.
+ *
+ * @param journal The journal
+ *
+ */
+void osync_journal_commit(OSyncJournal *journal)
+{
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, journal);
+  osync_assert(journal);
+
+  _osync_journal_read_events(journal);
+
+  _osync_journal_clear(journal->pending);
+  journal->rescanning = FALSE;
+
+  if (journal->hashtable)
+    _osync_journal_save(journal);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+/*! @brief Checks if the journal gets kernel notifications for its directory
+ *
+ * @param journal The journal
+ * @returns TRUE if the directory is watched, FALSE if every call of
+ *          osync_journal_get_dirty() requests a rescan
+ *
+ */
+osync_bool osync_journal_is_watching(OSyncJournal *journal)
+{
+  osync_assert(journal);
+  return journal->fd >= 0;
+}
+
+/*! @brief Get the uids which changed since the last synchronization
+ *
+ * The uids stay in the journal until osync_journal_commit() got called.
+ * The strings of the list are valid until then, or until the next call
+ * of osync_journal_get_dirty() which requests a rescan.
+ *
+ * @param journal The journal
+ * @param rescan Set to TRUE if the changes are unknown and the plugin has to
+ *        walk the whole directory instead
+ * @returns OSyncList containing the dirty uids. Caller is responsible for freeing the list,
+ *          not the content, with osync_list_free(). NULL if a rescan is needed.
+ *
+ */
+OSyncList *osync_journal_get_dirty(OSyncJournal *journal, osync_bool *rescan)
+{
+  OSyncList *uids = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, journal, rescan);
+  osync_assert(journal);
+  osync_assert(rescan);
+
+  _osync_journal_read_events(journal);
+
+  /* A rescan which didn't get saved has to be repeated */
+  if (journal->rescan || journal->rescanning || journal->fd < 0) {
+    /* The rescan covers everything which happened so far */
+    _osync_journal_clear(journal->dirty);
+    _osync_journal_clear(journal->pending);
+    journal->rescan = FALSE;
+    journal->rescanning = TRUE;
+
+    *rescan = TRUE;
+    osync_trace(TRACE_EXIT, "%s: rescan", __func__);
+    return NULL;
+  }
+
+  g_hash_table_foreach_steal(journal->dirty, _osync_journal_steal_dirty, journal);
+  g_hash_table_foreach(journal->pending, _osync_journal_list_pending, &uids);
+
+  *rescan = FALSE;
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, uids);
+  return uids;
+}
+
+/*@}*/
@@ -0,0 +1,37 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef OPENSYNC_JOURNAL_H_
+#define OPENSYNC_JOURNAL_H_
+
+#include <opensync/opensync_list.h>
+
+OSYNC_EXPORT OSyncJournal *osync_journal_new(const char *root, OSyncError **error);
+OSYNC_EXPORT OSyncJournal *osync_journal_new_from_hashtable(const char *root, OSyncHashTable *hashtable, OSyncError **error);
+
+OSYNC_EXPORT OSyncJournal *osync_journal_ref(OSyncJournal *journal);
+OSYNC_EXPORT void osync_journal_unref(OSyncJournal *journal);
+
+OSYNC_EXPORT void osync_journal_commit(OSyncJournal *journal);
+
+OSYNC_EXPORT osync_bool osync_journal_is_watching(OSyncJournal *journal);
+OSYNC_EXPORT OSyncList *osync_journal_get_dirty(OSyncJournal *journal, osync_bool *rescan);
+
+#endif /* OPENSYNC_JOURNAL_H_ */
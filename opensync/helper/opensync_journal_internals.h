@@ -0,0 +1,57 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef _OPENSYNC_JOURNAL_INTERNALS_H_
+#define _OPENSYNC_JOURNAL_INTERNALS_H_
+
+/*! @brief Keeps track of the files which changed below a directory */
+struct OSyncJournal {
+	int ref_count;
+
+	/** The watched directory, uids are relative to it */
+	char *root;
+
+	/** inotify file descriptor, -1 if the tree isn't watched */
+	int fd;
+
+	/** Watch descriptor -> directory relative to root ("" for root) */
+	GHashTable *watches;
+
+	/** uids which changed since the last osync_journal_get_dirty() */
+	GHashTable *dirty;
+
+	/** uids handed out by osync_journal_get_dirty(), not saved yet */
+	GHashTable *pending;
+
+	/** TRUE if events got lost and the tree has to be rescanned */
+	osync_bool rescan;
+
+	/** TRUE if the last osync_journal_get_dirty() asked for the rescan */
+	osync_bool rescanning;
+
+	/** The hashtable whose database stores the journal, NULL if the journal only lives in memory */
+	OSyncHashTable *hashtable;
+
+	/** Tables of the journal in the database of the hashtable */
+	char *uid_table;
+	char *state_table;
+};
+
+#endif /*_OPENSYNC_JOURNAL_INTERNALS_H_*/
@@ -26,6 +26,61 @@
 
 #include "opensync_message_internals.h"
 
+/* Buffers of freed messages are kept for reuse, up to this number and
+ * only if they didn't grow beyond the size limit. */
+#define OSYNC_MESSAGE_BUFFER_POOL_SIZE		16
+#define OSYNC_MESSAGE_BUFFER_POOL_MAX_LEN	(64 * 1024)
+
+#ifndef OPENSYNC_DEBUG_ALLOCATIONS
+static GStaticMutex buffer_pool_mutex = G_STATIC_MUTEX_INIT;
+static GByteArray *buffer_pool[OSYNC_MESSAGE_BUFFER_POOL_SIZE];
+static unsigned int buffer_pool_num = 0;
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+
+static GByteArray *_osync_message_buffer_new(unsigned int size)
+{
+  GByteArray *buffer = NULL;
+
+#ifndef OPENSYNC_DEBUG_ALLOCATIONS
+  g_static_mutex_lock(&buffer_pool_mutex);
+  if (buffer_pool_num > 0)
+    buffer = buffer_pool[--buffer_pool_num];
+  g_static_mutex_unlock(&buffer_pool_mutex);
+
+  if (buffer) {
+    /* Callers may write up to size bytes directly into the buffer data,
+     * make sure the recycled buffer has this capacity. */
+    g_byte_array_set_size(buffer, size);
+    g_byte_array_set_size(buffer, 0);
+    return buffer;
+  }
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+
+  if (size > 0)
+    return g_byte_array_sized_new(size);
+
+  return g_byte_array_new();
+}
+
+static void _osync_message_buffer_free(GByteArray *buffer)
+{
+#ifndef OPENSYNC_DEBUG_ALLOCATIONS
+  if (buffer->len <= OSYNC_MESSAGE_BUFFER_POOL_MAX_LEN) {
+    g_static_mutex_lock(&buffer_pool_mutex);
+    if (buffer_pool_num < OSYNC_MESSAGE_BUFFER_POOL_SIZE) {
+      buffer_pool[buffer_pool_num++] = buffer;
+      buffer = NULL;
+    }
+    g_static_mutex_unlock(&buffer_pool_mutex);
+  }
+
+  if (!buffer)
+    return;
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+
+  g_byte_array_free(buffer, TRUE);
+}
+
 /**
  * @ingroup OSyncMessage
  * @brief A Message used by the inter thread messaging library
@@ -44,16 +99,13 @@
  */
 OSyncMessage *osync_message_new(OSyncMessageCommand cmd, unsigned int size, OSyncError **error)
 {
-  OSyncMessage *message = osync_try_malloc0(sizeof(OSyncMessage), error);
+  OSyncMessage *message = osync_try_slice_alloc0(sizeof(OSyncMessage), error);
   if (!message)
     return NULL;
 
   message->cmd = cmd;
   message->refCount = 1;
-  if (size > 0)
-    message->buffer = g_byte_array_sized_new( size );
-  else
-    message->buffer = g_byte_array_new();
+  message->buffer = _osync_message_buffer_new(size);
   message->buffer_read_pos = 0;
   return message;
 }
@@ -80,9 +132,9 @@ void osync_message_unref(OSyncMessage *message)
 {
   if (g_atomic_int_dec_and_test(&(message->refCount))) {
 		
-    g_byte_array_free(message->buffer, TRUE);
+    _osync_message_buffer_free(message->buffer);
 		
-    g_free(message);
+    osync_slice_free(sizeof(OSyncMessage), message);
   }
 }
 
@@ -604,9 +656,144 @@ char* osync_message_get_commandstr(OSyncMessage *message)
       cmdstr = "OSYNC_MESSAGE_QUEUE_ERROR"; break;
     case OSYNC_MESSAGE_QUEUE_HUP:
       cmdstr = "OSYNC_MESSAGE_QUEUE_HUP"; break;
+    case OSYNC_MESSAGE_RESET:
+      cmdstr = "OSYNC_MESSAGE_RESET"; break;
+    case OSYNC_MESSAGE_QUEUE_CREDIT:
+      cmdstr = "OSYNC_MESSAGE_QUEUE_CREDIT"; break;
+    case OSYNC_MESSAGE_CANCEL:
+      cmdstr = "OSYNC_MESSAGE_CANCEL"; break;
     }
 	
   return cmdstr;	
 }
 
+#define OSYNC_MESSAGE_FILE_MAGIC	0x4f53594e
+#define OSYNC_MESSAGE_FILE_VERSION	1
+
+/* Modifications within this many seconds might share their mtime */
+#define OSYNC_MESSAGE_FILE_STAMP_RACY	2
+
+typedef struct {
+  guint32 magic;
+  guint32 version;
+  guint32 size;
+  guint32 checksum;
+} OSyncMessageFileHeader;
+
+static guint32 _osync_message_file_checksum(const guint8 *data, unsigned int size)
+{
+  /* FNV-1a */
+  guint32 hash = 2166136261U;
+  unsigned int i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+osync_bool osync_message_write_file(OSyncMessage *message, const char *filename, OSyncError **error)
+{
+  OSyncMessageFileHeader header;
+  GByteArray *content = NULL;
+  GError *gerror = NULL;
+
+  osync_assert(message);
+  osync_assert(filename);
+
+  header.magic = OSYNC_MESSAGE_FILE_MAGIC;
+  header.version = OSYNC_MESSAGE_FILE_VERSION;
+  header.size = message->buffer->len;
+  header.checksum = _osync_message_file_checksum(message->buffer->data, message->buffer->len);
+
+  content = g_byte_array_sized_new(sizeof(header) + message->buffer->len);
+  g_byte_array_append(content, (const guint8 *)&header, sizeof(header));
+  g_byte_array_append(content, message->buffer->data, message->buffer->len);
+
+  if (!g_file_set_contents(filename, (const gchar *)content->data, content->len, &gerror)) {
+    osync_error_set(error, OSYNC_ERROR_IO_ERROR, "Unable to write snapshot %s: %s", filename, gerror->message);
+    g_error_free(gerror);
+    g_byte_array_free(content, TRUE);
+    return FALSE;
+  }
+
+  g_byte_array_free(content, TRUE);
+  return TRUE;
+}
+
+OSyncMessage *osync_message_read_file(const char *filename)
+{
+  OSyncMessageFileHeader header;
+  OSyncMessage *message = NULL;
+  gchar *content = NULL;
+  gsize length = 0;
+
+  osync_assert(filename);
+
+  if (!g_file_get_contents(filename, &content, &length, NULL))
+    return NULL;
+
+  if (length < sizeof(header))
+    goto damaged;
+
+  memcpy(&header, content, sizeof(header));
+  if (header.magic != OSYNC_MESSAGE_FILE_MAGIC
+      || header.version != OSYNC_MESSAGE_FILE_VERSION
+      || header.size != length - sizeof(header)
+      || header.checksum != _osync_message_file_checksum((const guint8 *)content + sizeof(header), header.size))
+    goto damaged;
+
+  message = osync_message_new(OSYNC_MESSAGE_NOOP, header.size, NULL);
+  if (!message)
+    goto damaged;
+
+  osync_message_write_data(message, content + sizeof(header), header.size);
+  g_free(content);
+  return message;
+
+ damaged:
+  osync_trace(TRACE_INTERNAL, "Ignoring damaged snapshot %s", filename);
+  g_free(content);
+  return NULL;
+}
+
+osync_bool osync_message_write_file_stamp(OSyncMessage *message, const char *filename)
+{
+  struct stat st;
+  long long int mtime = -1, size = -1;
+
+  osync_assert(message);
+  osync_assert(filename);
+
+  if (!g_stat(filename, &st)) {
+    mtime = st.st_mtime;
+    size = st.st_size;
+  }
+
+  osync_message_write_long_long_int(message, mtime);
+  osync_message_write_long_long_int(message, size);
+
+  return mtime + OSYNC_MESSAGE_FILE_STAMP_RACY < (long long int)time(NULL);
+}
+
+osync_bool osync_message_check_file_stamp(OSyncMessage *message, const char *filename)
+{
+  struct stat st;
+  long long int mtime = -1, size = -1;
+  long long int stamp_mtime = 0, stamp_size = 0;
+
+  osync_assert(message);
+  osync_assert(filename);
 
+  if (!g_stat(filename, &st)) {
+    mtime = st.st_mtime;
+    size = st.st_size;
+  }
+
+  osync_message_read_long_long_int(message, &stamp_mtime);
+  osync_message_read_long_long_int(message, &stamp_size);
+
+  return mtime == stamp_mtime && size == stamp_size;
+}
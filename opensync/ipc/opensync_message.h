@@ -54,7 +54,10 @@ typedef enum {
 	OSYNC_MESSAGE_MAPPINGENTRY_CHANGED,
 	OSYNC_MESSAGE_ERROR,
 	OSYNC_MESSAGE_QUEUE_ERROR,
-	OSYNC_MESSAGE_QUEUE_HUP
+	OSYNC_MESSAGE_QUEUE_HUP,
+	OSYNC_MESSAGE_RESET,
+	OSYNC_MESSAGE_QUEUE_CREDIT,
+	OSYNC_MESSAGE_CANCEL
 } OSyncMessageCommand;
 
 /*! @brief Function which can receive messages
@@ -52,6 +52,45 @@ struct OSyncMessage {
 	int buffer_read_pos;
 };
 
+/*! @brief Stores the serialized buffer of a message as snapshot file
+ *
+ * The file gets a header with a magic, a format version and a checksum
+ * of the buffer and is replaced atomically.
+ *
+ * @param message The message
+ * @param filename The path of the snapshot file
+ * @param error Pointer to a error-struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_message_write_file(OSyncMessage *message, const char *filename, OSyncError **error);
+
+/*! @brief Loads a snapshot file written by osync_message_write_file()
+ *
+ * @param filename The path of the snapshot file
+ * @returns A new message to read the buffer from, or NULL if the file
+ * doesn't exist or is damaged
+ */
+OSyncMessage *osync_message_read_file(const char *filename);
+
+/*! @brief Appends the modification time and size of a file to the message
+ *
+ * Files which got modified within the last seconds get a stamp, but are
+ * reported as unstable: a change in the same second wouldn't be noticed.
+ *
+ * @param message The message
+ * @param filename The path of the file
+ * @returns TRUE if the stamp can be trusted, FALSE otherwise
+ */
+osync_bool osync_message_write_file_stamp(OSyncMessage *message, const char *filename);
+
+/*! @brief Reads a stamp written by osync_message_write_file_stamp()
+ *
+ * @param message The message
+ * @param filename The path of the file
+ * @returns TRUE if the file didn't change since the stamp got written
+ */
+osync_bool osync_message_check_file_stamp(OSyncMessage *message, const char *filename);
+
 /*@}*/
 
 #endif /*_OPENSYNC_MESSAGES_INTERNALS_H*/
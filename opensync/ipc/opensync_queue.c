@@ -157,6 +157,86 @@ gboolean _timeout_dispatch(GSource *source, GSourceFunc callback, gpointer user_
   return TRUE;
 }
 
+/* Returns the credits for the dispatched changes to the remote sender,
+ * once half of the window got used. */
+static void _osync_queue_return_credit(OSyncQueue *queue)
+{
+  OSyncMessage *message = NULL;
+  OSyncError *error = NULL;
+
+  if (!queue->window || !queue->credit_queue)
+    return;
+
+  queue->consumed++;
+  if (queue->consumed < (queue->window + 1) / 2)
+    return;
+
+  message = osync_message_new(OSYNC_MESSAGE_QUEUE_CREDIT, 0, &error);
+  if (!message)
+    goto error;
+
+  osync_message_write_int(message, queue->consumed);
+  osync_message_write_int(message, FALSE);
+
+  if (!osync_queue_send_message(queue->credit_queue, NULL, message, &error))
+    goto error_free_message;
+
+  osync_message_unref(message);
+  queue->consumed = 0;
+  return;
+
+ error_free_message:
+  osync_message_unref(message);
+ error:
+  osync_trace(TRACE_ERROR, "Unable to return credits: %s", osync_error_print(&error));
+  osync_error_unref(&error);
+}
+
+/* Called from the thread reading the credits. Refills the window of the sending queue */
+static void _osync_queue_add_credits(OSyncQueue *queue, OSyncMessage *message)
+{
+  int credits = 0;
+  int reset = FALSE;
+
+  osync_message_read_int(message, &credits);
+  osync_message_read_int(message, &reset);
+
+  g_mutex_lock(queue->creditLock);
+  if (reset || queue->credits < 0)
+    queue->credits = credits;
+  else if (credits > 0)
+    queue->credits += credits;
+  g_cond_broadcast(queue->creditCond);
+  g_mutex_unlock(queue->creditLock);
+
+  osync_trace(TRACE_INTERNAL, "%p: %i credits (%i, reset: %i)", queue, queue->credits, credits, reset);
+}
+
+/* Blocks until the remote side granted a credit for a change message */
+static osync_bool _osync_queue_take_credit(OSyncQueue *queue, OSyncError **error)
+{
+  GTimeVal timeout;
+
+  g_mutex_lock(queue->creditLock);
+  while (queue->credits == 0 && queue->connected) {
+    g_get_current_time(&timeout);
+    g_time_val_add(&timeout, 100000);
+    g_cond_timed_wait(queue->creditCond, queue->creditLock, &timeout);
+  }
+
+  if (queue->credits == 0) {
+    g_mutex_unlock(queue->creditLock);
+    osync_error_set(error, OSYNC_ERROR_IO_ERROR, "Queue got disconnected while waiting for credits");
+    return FALSE;
+  }
+
+  if (queue->credits > 0)
+    queue->credits--;
+  g_mutex_unlock(queue->creditLock);
+
+  return TRUE;
+}
+
 static
 gboolean _incoming_prepare(GSource *source, gint *timeout_)
 {
@@ -228,8 +308,12 @@ gboolean _incoming_dispatch(GSource *source, GSourceFunc callback, gpointer user
       }
 			
       g_mutex_unlock(queue->pendingLock);
-    } else 
+    } else {
       queue->message_handler(message, queue->user_data);
+
+      if (osync_message_get_cmd(message) == OSYNC_MESSAGE_NEW_CHANGE)
+        _osync_queue_return_credit(queue);
+    }
 		
     osync_message_unref(message);
   }
@@ -563,6 +647,25 @@ gboolean _source_dispatch(GSource *source, GSourceFunc callback, gpointer user_d
       } while (read < size);
     }
     osync_message_set_message_size(message, size);
+
+    /* Credits get applied right away. The consumer of the sending queue
+     * might be blocked waiting for them. */
+    if (cmd == OSYNC_MESSAGE_QUEUE_CREDIT && queue->credit_target) {
+      _osync_queue_add_credits(queue->credit_target, message);
+      osync_message_unref(message);
+      continue;
+    }
+
+    /* The same for cancellation requests, the consumer is most likely
+     * busy with the request which should get cancelled. */
+    if (cmd == OSYNC_MESSAGE_CANCEL && queue->cancel_flag) {
+      int cancel = 0;
+      osync_message_read_int(message, &cancel);
+      g_atomic_int_set(queue->cancel_flag, cancel);
+      osync_trace(TRACE_INTERNAL, "%p: cancel flag set to %i", queue, cancel);
+      osync_message_unref(message);
+      continue;
+    }
 		
     g_async_queue_push(queue->incoming, message);
 		
@@ -640,6 +743,10 @@ OSyncQueue *osync_queue_new(const char *name, OSyncError **error)
 
   queue->disconnectLock = g_mutex_new();
 
+  queue->creditLock = g_mutex_new();
+  queue->creditCond = g_cond_new();
+  queue->credits = -1;
+
   osync_trace(TRACE_EXIT, "%s: %p", __func__, queue);
   return queue;
 
@@ -733,6 +840,9 @@ void osync_queue_free(OSyncQueue *queue)
 	
   g_mutex_free(queue->disconnectLock);
 
+  g_cond_free(queue->creditCond);
+  g_mutex_free(queue->creditLock);
+
   g_main_context_unref(queue->context);
 
   _osync_queue_stop_incoming(queue);
@@ -945,6 +1055,11 @@ osync_bool osync_queue_disconnect(OSyncQueue *queue, OSyncError **error)
   queue->fd = -1;
   queue->connected = FALSE;
   g_mutex_unlock(queue->disconnectLock);
+
+  /* Wake up senders waiting for credits */
+  g_mutex_lock(queue->creditLock);
+  g_cond_broadcast(queue->creditCond);
+  g_mutex_unlock(queue->creditLock);
 	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
@@ -981,6 +1096,9 @@ void osync_queue_set_message_handler(OSyncQueue *queue, OSyncMessageHandler hand
  * The queue will then be check for new messages and the messages will be
  * handled.
  * 
+ * If the queue was already set up with a context before, it gets detached
+ * from that context first.
+ * 
  * @param queue The queue to set up
  * @param context The context to use. NULL for default loop
  * 
@@ -990,6 +1108,8 @@ void osync_queue_setup_with_gmainloop(OSyncQueue *queue, GMainContext *context)
   OSyncQueue **queueptr = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, queue, context);
 	
+  _osync_queue_stop_incoming(queue);
+	
   queue->incoming_functions = g_malloc0(sizeof(GSourceFuncs));
   queue->incoming_functions->prepare = _incoming_prepare;
   queue->incoming_functions->check = _incoming_check;
@@ -1087,6 +1207,9 @@ osync_bool osync_queue_send_message_with_timeout(OSyncQueue *queue, OSyncQueue *
 {
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %u, %p)", __func__, queue, replyqueue, message, timeout, error);
 
+  if (osync_message_get_cmd(message) == OSYNC_MESSAGE_NEW_CHANGE && !_osync_queue_take_credit(queue, error))
+    goto error;
+
   if (osync_message_get_handler(message)) {
     OSyncPendingMessage *pending = NULL;
     GTimeVal current_time;
@@ -1194,3 +1317,93 @@ int osync_queue_get_fd(OSyncQueue *queue)
   return queue->fd;
 }
 
+osync_bool osync_queue_set_change_window(OSyncQueue *queue, OSyncQueue *replyqueue, unsigned int window, OSyncError **error)
+{
+  OSyncMessage *message = NULL;
+  osync_trace(TRACE_ENTRY, "%s(%p, %p, %u, %p)", __func__, queue, replyqueue, window, error);
+  osync_assert(queue);
+  osync_assert(replyqueue);
+
+  message = osync_message_new(OSYNC_MESSAGE_QUEUE_CREDIT, 0, error);
+  if (!message)
+    goto error;
+
+  /* A window of 0 resets the remote sender to unlimited credits */
+  osync_message_write_int(message, window ? (int)window : -1);
+  osync_message_write_int(message, TRUE);
+
+  if (!osync_queue_send_message(replyqueue, NULL, message, error))
+    goto error_free_message;
+
+  osync_message_unref(message);
+
+  queue->window = window;
+  queue->consumed = 0;
+  queue->credit_queue = replyqueue;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_free_message:
+  osync_message_unref(message);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+void osync_queue_set_credit_target(OSyncQueue *queue, OSyncQueue *target)
+{
+  osync_assert(queue);
+  queue->credit_target = target;
+}
+
+void osync_queue_set_cancel_flag(OSyncQueue *queue, int *flag)
+{
+  osync_assert(queue);
+  queue->cancel_flag = flag;
+}
+
+unsigned int osync_queue_fail_pending(OSyncQueue *queue, OSyncError *error)
+{
+  OSyncPendingMessage *pending = NULL;
+  OSyncMessage *errormsg = NULL;
+  OSyncError *locerror = NULL;
+  unsigned int failed = 0;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, queue, error);
+  osync_assert(queue);
+
+  g_mutex_lock(queue->pendingLock);
+
+  while (queue->pendingReplies) {
+    pending = queue->pendingReplies->data;
+
+    /* Remove the pending message first, like _timeout_dispatch does,
+       so a late reply doesn't call the callback a second time. */
+    queue->pendingReplies = g_list_remove(queue->pendingReplies, pending);
+    g_mutex_unlock(queue->pendingLock);
+
+    errormsg = osync_message_new_errorreply(NULL, error, &locerror);
+    if (!errormsg) {
+      osync_trace(TRACE_ERROR, "Unable to fail pending message: %s", osync_error_print(&locerror));
+      osync_error_unref(&locerror);
+    }
+
+    osync_assert(pending->callback);
+    pending->callback(errormsg, pending->user_data);
+    if (errormsg)
+      osync_message_unref(errormsg);
+
+    if (pending->timeout_info)
+      g_free(pending->timeout_info);
+    g_free(pending);
+    failed++;
+
+    g_mutex_lock(queue->pendingLock);
+  }
+
+  g_mutex_unlock(queue->pendingLock);
+
+  osync_trace(TRACE_EXIT, "%s: %u", __func__, failed);
+  return failed;
+}
@@ -43,5 +43,52 @@ int osync_queue_get_fd(OSyncQueue *queue);
 
 osync_bool osync_queue_is_alive(OSyncQueue *queue);
 
+/*! @brief Limits the number of change messages the remote side may send ahead
+ *
+ * The remote sender gets a window of change messages it may send before
+ * it has to wait. Credits are returned on replyqueue once half of the
+ * window got dispatched on this queue. This bounds the number of changes
+ * buffered between a client and the engine.
+ *
+ * @param queue The receiving queue the changes arrive on
+ * @param replyqueue The sending queue to the remote side
+ * @param window The number of changes in flight, 0 to disable flow control
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+OSYNC_TEST_EXPORT osync_bool osync_queue_set_change_window(OSyncQueue *queue, OSyncQueue *replyqueue, unsigned int window, OSyncError **error);
+
+/*! @brief Credits received on queue refill the window of target
+ *
+ * Sending a change message on target blocks while the window granted by
+ * the remote side is used up.
+ *
+ * @param queue The receiving queue the credits arrive on
+ * @param target The sending queue the changes get sent on
+ */
+OSYNC_TEST_EXPORT void osync_queue_set_credit_target(OSyncQueue *queue, OSyncQueue *target);
+
+/*! @brief Cancel messages received on queue set flag
+ *
+ * The flag gets set by the thread reading the queue, so it changes even
+ * while the consumer of the queue is blocked in a long running request.
+ * Without a flag, cancel messages get dispatched to the message handler.
+ *
+ * @param queue The receiving queue the cancel messages arrive on
+ * @param flag The flag to set atomically, or NULL
+ */
+OSYNC_TEST_EXPORT void osync_queue_set_cancel_flag(OSyncQueue *queue, int *flag);
+
+/*! @brief Fail all requests which still wait for a reply on queue
+ *
+ * The handlers of the pending requests get called right away with an
+ * error reply, like on a timeout. Replies which arrive later get dropped.
+ *
+ * @param queue The queue the replies are expected on
+ * @param error The error to report to the handlers
+ * @returns the number of failed requests
+ */
+OSYNC_TEST_EXPORT unsigned int osync_queue_fail_pending(OSyncQueue *queue, OSyncError *error);
+
 #endif /* _OPENSYNC_QUEUE_INTERNALS_H */
 
@@ -85,6 +85,23 @@ struct OSyncQueue {
 
   /** Connection status **/
   osync_bool connected;
+
+  /** Flow control of change messages, see osync_queue_set_change_window() */
+  GMutex *creditLock;
+  GCond *creditCond;
+  /** Sending side: changes which may still be sent, -1 if no window got granted */
+  int credits;
+  /** Credits which arrive on this queue refill the credits of this sending queue */
+  OSyncQueue *credit_target;
+  /** Receiving side: window granted to the remote sender, 0 if disabled */
+  unsigned int window;
+  /** Receiving side: changes dispatched since the last credit got returned */
+  unsigned int consumed;
+  /** Receiving side: queue to return the credits on */
+  OSyncQueue *credit_queue;
+
+  /** Receiving side: set right away when a cancel message arrives, see osync_queue_set_cancel_flag() */
+  int *cancel_flag;
 };
 
 
@@ -32,7 +32,7 @@ OSyncMappingEntry *osync_mapping_entry_new(OSyncError **error)
   OSyncMappingEntry *entry = NULL;
   osync_trace(TRACE_ENTRY, "%s(%p)", __func__, error);
 	
-  entry = osync_try_malloc0(sizeof(OSyncMappingEntry), error);
+  entry = osync_try_slice_alloc0(sizeof(OSyncMappingEntry), error);
   if (!entry)
     goto error;
   entry->ref_count = 1;
@@ -63,7 +63,7 @@ void osync_mapping_entry_unref(OSyncMappingEntry *entry)
     if (entry->uid)
       g_free(entry->uid);
 		
-    g_free(entry);
+    osync_slice_free(sizeof(OSyncMappingEntry), entry);
   }
 }
 
@@ -85,6 +85,42 @@ void osync_mapping_table_unref(OSyncMappingTable *table)
   }
 }
 
+typedef struct {
+  OSyncMappingTable *table;
+  OSyncMapping *mapping;
+} OSyncMappingTableLoader;
+
+static osync_bool _osync_mapping_table_load_entry(long long int id, const char *uid, long long int mappingid, long long int memberid, void *userdata, OSyncError **error)
+{
+  OSyncMappingTableLoader *loader = userdata;
+  OSyncMappingEntry *entry = NULL;
+
+  entry = osync_mapping_entry_new(error);
+  if (!entry)
+    return FALSE;
+
+  osync_mapping_entry_set_uid(entry, uid);
+  osync_mapping_entry_set_id(entry, id);
+  osync_mapping_entry_set_member_id(entry, memberid);
+
+  /* Rows are ordered by mappingid, so a new id always starts a new mapping */
+  if (!loader->mapping || osync_mapping_get_id(loader->mapping) != mappingid) {
+    loader->mapping = osync_mapping_new(error);
+    if (!loader->mapping) {
+      osync_mapping_entry_unref(entry);
+      return FALSE;
+    }
+
+    osync_mapping_set_id(loader->mapping, mappingid);
+    osync_mapping_table_add_mapping(loader->table, loader->mapping);
+    osync_mapping_unref(loader->mapping);
+  }
+  osync_mapping_add_entry(loader->mapping, entry);
+  osync_mapping_entry_unref(entry);
+
+  return TRUE;
+}
+
 /**
  * @brief Loads all mappings from archive for a certain object type.
  *
@@ -96,70 +132,19 @@ void osync_mapping_table_unref(OSyncMappingTable *table)
  */ 
 osync_bool osync_mapping_table_load(OSyncMappingTable *table, OSyncArchive *archive, const char *objtype, OSyncError **error)
 {
-  OSyncMappingEntry *entry = NULL;
-  OSyncMapping *mapping = NULL;
-  OSyncList *uids = NULL;
-  OSyncList *ids = NULL;
-  OSyncList *mappings = NULL;
-  OSyncList *memberids = NULL;
-  OSyncList *d = NULL, *u = NULL, *m = NULL, *i = NULL;
+  OSyncMappingTableLoader loader;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %s, %p)", __func__, table, archive, objtype, error);
+
+  loader.table = table;
+  loader.mapping = NULL;
 	
-  if (!osync_archive_load_changes(archive, objtype, &ids, &uids, &mappings, &memberids, error))
+  if (!osync_archive_foreach_change(archive, objtype, _osync_mapping_table_load_entry, &loader, error))
     goto error;
 	
-  d = ids;
-  m = mappings;
-  i = memberids;
-	
-  for (u = uids; u; u = u->next) {
-    long long int id = (long long int)GPOINTER_TO_INT(d->data);
-    char *uid = u->data;
-    long long int memberid = (long long int)GPOINTER_TO_INT(i->data);
-    long long int mappingid = (long long int)GPOINTER_TO_INT(m->data);
-		
-    entry = osync_mapping_entry_new(error);
-    if (!entry)
-      goto error_free;
-		
-    osync_mapping_entry_set_uid(entry, uid);
-    g_free(uid);
-    osync_mapping_entry_set_id(entry, id);
-    osync_mapping_entry_set_member_id(entry, memberid);
-		
-    if (!mapping || osync_mapping_get_id(mapping) != mappingid) {
-      mapping = osync_mapping_new(error);
-      if (!error)
-        goto error_free_entry;
-			
-      osync_mapping_set_id(mapping, mappingid);
-      osync_mapping_table_add_mapping(table, mapping);
-      osync_mapping_unref(mapping);
-    }
-    osync_mapping_add_entry(mapping, entry);
-    osync_mapping_entry_unref(entry);
-		
-    m = m->next;
-    d = d->next;
-    i = i->next;
-  }
-	
-  osync_list_free(ids);
-  osync_list_free(uids);
-  osync_list_free(mappings);
-  osync_list_free(memberids);
-	
   osync_trace(TRACE_EXIT, "%s", __func__);
   return TRUE;
 
- error_free_entry:
-  osync_mapping_entry_unref(entry);
- error_free:
-  osync_list_free(ids);
-  osync_list_free(uids);
-  osync_list_free(mappings);
-  osync_list_free(memberids);
  error:
   osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
   return FALSE;
@@ -44,6 +44,157 @@
  */
 /*@{*/
 
+static void _osync_merger_field_free(gpointer data)
+{
+  OSyncMergerField *field = data;
+
+  if (field->keys)
+    g_hash_table_destroy(field->keys);
+  g_free(field);
+}
+
+static void _osync_merger_plan_free(gpointer data)
+{
+  OSyncMergerPlan *plan = data;
+
+  if (plan->fields)
+    g_hash_table_destroy(plan->fields);
+  g_free(plan);
+}
+
+static int _osync_merger_name_compare(gconstpointer name1, gconstpointer name2)
+{
+  return strcmp(*(const char **)name1, *(const char **)name2);
+}
+
+/**
+ * @brief Compiles the capabilities of an objtype into a merger plan.
+ *  Field and key names are looked up in hash tables, and every field
+ *  gets the position of its name in the sorted capabilities.
+ * @param merger The pointer to a merger object
+ * @param objtype The name of the objtype
+ * @return The newly allocated plan
+ */
+static OSyncMergerPlan *_osync_merger_compile_plan(OSyncMerger *merger, const char *objtype)
+{
+  OSyncMergerPlan *plan = g_malloc0(sizeof(OSyncMergerPlan));
+  OSyncCapability *cap = osync_capabilities_get_first(merger->capabilities, objtype);
+  GPtrArray *names = NULL;
+  unsigned int i;
+
+  /* No capabilities - the device can handle all xmlfields */
+  if (!cap)
+    return plan;
+
+  plan->fields = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, _osync_merger_field_free);
+  names = g_ptr_array_new();
+
+  for (; cap != NULL; cap = osync_capability_get_next(cap)) {
+    const char *name = osync_capability_get_name(cap);
+    OSyncMergerField *field = NULL;
+    xmlNodePtr key = NULL;
+
+    if (g_hash_table_lookup(plan->fields, name))
+      continue;
+
+    field = g_malloc0(sizeof(OSyncMergerField));
+    if (osync_capability_has_key(cap)) {
+      field->keys = g_hash_table_new(g_str_hash, g_str_equal);
+      for (key = cap->node->children; key != NULL; key = key->next)
+        g_hash_table_insert(field->keys, (gpointer)key->name, field);
+    }
+
+    g_hash_table_insert(plan->fields, (gpointer)name, field);
+    g_ptr_array_add(names, (gpointer)name);
+  }
+
+  g_ptr_array_sort(names, _osync_merger_name_compare);
+  for (i = 0; i < names->len; i++) {
+    OSyncMergerField *field = g_hash_table_lookup(plan->fields, g_ptr_array_index(names, i));
+    field->index = i;
+  }
+
+  osync_trace(TRACE_INTERNAL, "Compiled merger plan for %s: %u fields", objtype, names->len);
+  g_ptr_array_free(names, TRUE);
+
+  return plan;
+}
+
+/* The capabilities are not supposed to change while the merger uses them,
+ * so the plan of an objtype is compiled only once. */
+static OSyncMergerPlan *_osync_merger_get_plan(OSyncMerger *merger, const char *objtype)
+{
+  OSyncMergerPlan *plan = g_hash_table_lookup(merger->plans, objtype);
+
+  if (!plan) {
+    plan = _osync_merger_compile_plan(merger, objtype);
+    g_hash_table_insert(merger->plans, g_strdup(objtype), plan);
+  }
+
+  return plan;
+}
+
+static OSyncMergerField *_osync_merger_plan_lookup(OSyncMergerPlan *plan, OSyncXMLField *xmlfield)
+{
+  return g_hash_table_lookup(plan->fields, osync_xmlfield_get_name(xmlfield));
+}
+
+/* TRUE if xmlfield is sorted before entire. Only fields which aren't
+ * part of the capabilities need their names compared. */
+static osync_bool _osync_merger_sorted_before(OSyncXMLField *xmlfield, OSyncMergerField *field, OSyncXMLField *entire, OSyncMergerField *entire_field)
+{
+  const char *name, *entire_name;
+
+  if (field && entire_field)
+    return field->index < entire_field->index;
+
+  name = osync_xmlfield_get_name(xmlfield);
+  entire_name = osync_xmlfield_get_name(entire);
+  if (name == entire_name)
+    return FALSE;
+
+  return strcmp(name, entire_name) < 0;
+}
+
+/**
+ * @brief Replaces the keys of xmlfield which are not supported by the
+ *  capabilities with the keys of entire. Both fields are expected to
+ *  have their keys sorted and in the same order.
+ */
+static void _osync_merger_merge_keys(OSyncMergerField *field, OSyncXMLField *xmlfield, OSyncXMLField *entire)
+{
+  xmlNodePtr new_node = xmlfield->node->children;
+  xmlNodePtr old_node = entire->node->children;
+  const xmlChar *name = NULL;
+  osync_bool supported = FALSE;
+
+  while (old_node && new_node) {
+    xmlNodePtr old_next = old_node->next;
+
+    /* A run of equally named keys gets looked up once */
+    if (old_node->name != name) {
+      name = old_node->name;
+      supported = g_hash_table_lookup(field->keys, name) != NULL;
+    }
+
+    if (supported) {
+      new_node = new_node->next;
+    } else {
+      xmlNodePtr replaced = new_node;
+      new_node = new_node->next;
+
+      xmlUnlinkNode(old_node);
+      xmlDOMWrapAdoptNode(NULL, old_node->doc, old_node, replaced->doc, xmlfield->node, 0);
+      xmlAddPrevSibling(replaced, old_node);
+
+      xmlUnlinkNode(replaced);
+      xmlFreeNode(replaced);
+    }
+
+    old_node = old_next;
+  }
+}
+
 /*@}*/
 
 /**
@@ -75,6 +226,7 @@ OSyncMerger *osync_merger_new(OSyncCapabilities *capabilities, OSyncError **erro
   merger->ref_count = 1;
   osync_capabilities_ref(capabilities);
   merger->capabilities = capabilities;
+  merger->plans = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _osync_merger_plan_free);
 	
   osync_trace(TRACE_EXIT, "%s: %p", __func__, merger);
   return merger;
@@ -104,6 +256,7 @@ void osync_merger_unref(OSyncMerger *merger)
 			
   if (g_atomic_int_dec_and_test(&(merger->ref_count))) {
     osync_capabilities_unref(merger->capabilities);
+    g_hash_table_destroy(merger->plans);
     g_free(merger);
   }
 }
@@ -118,133 +271,70 @@ void osync_merger_unref(OSyncMerger *merger)
 void osync_merger_merge(OSyncMerger *merger, OSyncXMLFormat *xmlformat, OSyncXMLFormat *entire)
 {
   OSyncXMLField *old_cur, *new_cur, *tmp;
-  OSyncCapability *cap_cur;
-  int ret;
+  OSyncMergerField *old_field, *new_field;
+  OSyncMergerPlan *plan;
+  osync_bool before;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, merger, xmlformat, entire);
   osync_assert(merger);
   osync_assert(xmlformat);
   osync_assert(entire);
 	
-  cap_cur = osync_capabilities_get_first(merger->capabilities, osync_xmlformat_get_objtype(xmlformat));
-  if(!cap_cur)
-    return;
-	 	
+  plan = _osync_merger_get_plan(merger, osync_xmlformat_get_objtype(xmlformat));
   new_cur = osync_xmlformat_get_first_field(xmlformat);
+  if(!plan->fields || !new_cur) {
+    osync_trace(TRACE_EXIT, "%s: nothing to merge", __func__);
+    return;
+  }
+
+  new_field = _osync_merger_plan_lookup(plan, new_cur);
   old_cur = osync_xmlformat_get_first_field(entire);
   while(old_cur != NULL)
-    {		 	
-      ret = strcmp(osync_xmlfield_get_name(new_cur), osync_xmlfield_get_name(old_cur));
-      if(ret < 0) {
-        if(osync_xmlfield_get_next(new_cur) != NULL) {
-          new_cur = osync_xmlfield_get_next(new_cur);
-          continue;
-        }
+    {
+      tmp = old_cur;
+      old_cur = osync_xmlfield_get_next(old_cur);
+      old_field = _osync_merger_plan_lookup(plan, tmp);
+
+      /* Both xmlformats are sorted - move to the place of the entire field */
+      while((before = _osync_merger_sorted_before(new_cur, new_field, tmp, old_field)) &&
+            osync_xmlfield_get_next(new_cur) != NULL) {
+        new_cur = osync_xmlfield_get_next(new_cur);
+        new_field = _osync_merger_plan_lookup(plan, new_cur);
       }
-		 
-      /* This should be always NULL reg. #820 */
-      osync_assert(cap_cur);
-
-      ret = strcmp(osync_capability_get_name(cap_cur), osync_xmlfield_get_name(old_cur));
-      if(ret == 0)
-        {
-          /* 
-           * now we have to merge the key/value pairs (second level)
-           * we see the second level as sorted and with the same fields (exception the last key)
-           * KEY(new)		Capabilities		KEY(old)
-           * KEY1				KEY1				KEY1
-           * KEY2(empty)		KEY3				KEY2
-           * KEY2(empty)							KEY2
-           * KEY3									KEY3
-           * 										KEY4
-           * 										KEY4
-           */
-          if( osync_capability_has_key(cap_cur) &&
-              !strcmp(osync_capability_get_name(cap_cur), osync_xmlfield_get_name(new_cur))) 
-            {
-              xmlNodePtr cap_tmp, new_tmp;
-              xmlNodePtr cap_node = cap_cur->node->children;
-              xmlNodePtr new_node = new_cur->node->children;
-              xmlNodePtr old_node = old_cur->node->children;
-              xmlNodePtr new_par_node = new_cur->node;
-			
-              while(old_node) {
-                GSList *list, *tmp;
-                int i, size;
-                const xmlChar *curkeyname;
-					
-                size=0;
-                curkeyname = old_node->name;
-                list = NULL;
-                do {
-                  list = g_slist_prepend(list, old_node);
-                  size++;
-                  old_node = old_node->next;
-                  if(old_node == NULL)
-                    break;
-                  i = xmlStrcmp(old_node->name, curkeyname);
-                } while(i == 0);
-
-                /* search for the curkeyname in the capabilities */
-                for(cap_tmp = cap_node; cap_tmp != NULL; cap_tmp = cap_tmp->next) {
-                  if(!xmlStrcmp(cap_tmp->name, curkeyname)) {
-                    cap_node = cap_tmp;
-                    break;
-                  }
-                }
-
-                if(cap_tmp) { 
-                  /* curkeyname was found in the capibilities */
-                  /* we have to set the new_node ptr to the right position */
-                  for(; new_node && size > 0; size--) {
-                    new_node = new_node->next;
-                  }
-                }else{
-                  /* curkeyname was _not_ found in the capabilities */
-                  /* link all key/value pairs with the key curkeyname to the the new_node */
-						
-                  list = g_slist_reverse(list);
-
-                  if(new_node == NULL) {
-                    for(tmp=list; tmp != NULL; tmp = g_slist_next(tmp)) {
-                      xmlUnlinkNode(tmp->data);
-                    }
-                  }else{
-                    for(tmp=list; tmp != NULL; tmp = g_slist_next(tmp)) {
-                      xmlUnlinkNode(tmp->data);
-                      xmlDOMWrapAdoptNode(NULL, ((xmlNodePtr)tmp->data)->doc, tmp->data, new_node->doc, new_par_node, 0);
-                      xmlAddPrevSibling(new_node, tmp->data);
-                    }
-							
-                    do{
-                      new_tmp = new_node;
-                      new_node = new_node->next;
-                      xmlUnlinkNode(new_tmp);
-                      xmlFreeNode(new_tmp);
-                      size--;
-                    }while(size > 0 && new_node);
-							
-                  }
-                }
-                g_slist_free(list);
-              }
-            }
-          old_cur = osync_xmlfield_get_next(old_cur);
-          continue;		 		
-        }
-      else if(ret < 0)
-        {
-          cap_cur = osync_capability_get_next(cap_cur);
-          continue;
-        }
-      else if(ret > 0)
-        {
-          tmp = old_cur;
-          old_cur = osync_xmlfield_get_next(old_cur);
+
+      if(!old_field) {
+        /* Not listed in the capabilities - take the field of the entire xmlformat */
+        if(before) {
+          osync_xmlfield_adopt_xmlfield_after_field(new_cur, tmp);
+          new_cur = tmp;
+          new_field = NULL;
+        } else {
           osync_xmlfield_adopt_xmlfield_before_field(new_cur, tmp);
-          continue;
         }
-      g_assert_not_reached();
+        continue;
+      }
+
+      if(new_field != old_field)
+        continue;
+
+      /* 
+       * now we have to merge the key/value pairs (second level)
+       * we see the second level as sorted and with the same fields (exception the last key)
+       * KEY(new)		Capabilities		KEY(old)
+       * KEY1				KEY1				KEY1
+       * KEY2(empty)		KEY3				KEY2
+       * KEY2(empty)							KEY2
+       * KEY3									KEY3
+       * 										KEY4
+       * 										KEY4
+       */
+      if(old_field->keys)
+        _osync_merger_merge_keys(old_field, new_cur, tmp);
+
+      /* The next entire field of this name pairs with the next field */
+      if(osync_xmlfield_get_next(new_cur) &&
+         _osync_merger_plan_lookup(plan, osync_xmlfield_get_next(new_cur)) == old_field)
+        new_cur = osync_xmlfield_get_next(new_cur);
     }
 
   /* FIXME: Merger is broken! 
@@ -277,84 +367,52 @@ void osync_merger_merge(OSyncMerger *merger, OSyncXMLFormat *xmlformat, OSyncXML
 void osync_merger_demerge(OSyncMerger *merger, OSyncXMLFormat *xmlformat)
 {
   OSyncXMLField *cur_xmlfield, *tmp;
-  OSyncCapability *cur_capability;
-  int rc;
+  OSyncMergerField *field;
+  OSyncMergerPlan *plan;
 	
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, merger, xmlformat);
   osync_assert(merger);
   osync_assert(xmlformat);
 	
-  cur_capability = osync_capabilities_get_first(merger->capabilities, osync_xmlformat_get_objtype(xmlformat));
+  plan = _osync_merger_get_plan(merger, osync_xmlformat_get_objtype(xmlformat));
   cur_xmlfield = osync_xmlformat_get_first_field(xmlformat);
 	
-  if(!cur_capability) /* if there is no capability - it means that the device can handle all xmlfields */
+  if(!plan->fields) /* if there is no capability - it means that the device can handle all xmlfields */
     goto end;
 
   while(cur_xmlfield != NULL)
     {
-      if(cur_capability == NULL) {
-        /* delete all xmlfields */
-        while(cur_xmlfield) {
-          osync_trace(TRACE_INTERNAL, "Demerge XMLField: %s", osync_xmlfield_get_name(cur_xmlfield));
-          tmp = osync_xmlfield_get_next(cur_xmlfield);
-          osync_xmlfield_delete(cur_xmlfield);
-          cur_xmlfield = tmp;
-        }
-        break; 			
-      }
-		
-      rc = strcmp(osync_xmlfield_get_name(cur_xmlfield), osync_capability_get_name(cur_capability));
-      if(rc == 0) {
-        /* check the secound level here */
-        if(osync_capability_has_key(cur_capability)) /* if there is no key - it means that the xmlfield can handle all keys */
-          {
-            int i, j=0;
-            int capability_keys = osync_capability_get_key_count(cur_capability);
-            int xmlfield_keys = osync_xmlfield_get_key_count(cur_xmlfield);
-	 			
-            for(i=0; i < xmlfield_keys; i++)
-              {
-                int krc = 0;
-                if(j == capability_keys) {
-                  for(; i < xmlfield_keys; i++) {
-                    osync_trace(TRACE_INTERNAL, "Demerge XMLField Key: %s->%s",	osync_xmlfield_get_name(cur_xmlfield), osync_xmlfield_get_nth_key_name(cur_xmlfield, i));
-                    osync_xmlfield_set_nth_key_value(cur_xmlfield, i, "");
-                  }
-                  break;
-                }
-	 				
-                krc = strcmp(osync_xmlfield_get_nth_key_name(cur_xmlfield, i), osync_capability_get_nth_key(cur_capability, j));
-                if(krc == 0) {
-                  continue;
-                }	
-                if(krc > 0) {
-                  j++;
-                  continue;
-                }
-                if(krc < 0) {
-                  osync_trace(TRACE_INTERNAL, "Demerge XMLField Key: %s->%s",	osync_xmlfield_get_name(cur_xmlfield), osync_xmlfield_get_nth_key_name(cur_xmlfield, i));
-                  osync_xmlfield_set_nth_key_value(cur_xmlfield, i, "");
-                  continue;
-                }
-                g_assert_not_reached();
-              }
-          }
-        cur_xmlfield = osync_xmlfield_get_next(cur_xmlfield);
-        continue;
-      }
-      if(rc > 0) {
-        cur_capability = osync_capability_get_next(cur_capability);
+      xmlNodePtr key;
+      const xmlChar *name = NULL;
+      osync_bool supported = FALSE;
+
+      tmp = cur_xmlfield;
+      cur_xmlfield = osync_xmlfield_get_next(cur_xmlfield);
+
+      field = _osync_merger_plan_lookup(plan, tmp);
+      if(!field) {
+        /* delete xmlfield */
+        osync_trace(TRACE_INTERNAL, "Demerge XMLField: %s", osync_xmlfield_get_name(tmp));
+        osync_xmlfield_delete(tmp);
         continue;
       }
-      if(rc < 0) {
-        /* delete xmlfield */
-        osync_trace(TRACE_INTERNAL, "Demerge XMLField: %s", osync_xmlfield_get_name(cur_xmlfield));
-        tmp = osync_xmlfield_get_next(cur_xmlfield);
-        osync_xmlfield_delete(cur_xmlfield);
-        cur_xmlfield = tmp;
+
+      /* if there is no key - it means that the xmlfield can handle all keys */
+      if(!field->keys)
         continue;
+
+      /* check the second level here */
+      for(key = tmp->node->children; key != NULL; key = key->next) {
+        if(key->name != name) {
+          name = key->name;
+          supported = g_hash_table_lookup(field->keys, name) != NULL;
+        }
+
+        if(!supported) {
+          osync_trace(TRACE_INTERNAL, "Demerge XMLField Key: %s->%s", osync_xmlfield_get_name(tmp), (const char *)key->name);
+          xmlNodeSetContent(key, BAD_CAST "");
+        }
       }
-      g_assert_not_reached();
     }
 
  end:
@@ -23,6 +23,26 @@
 #ifndef OPENSYNC_MERGER_INTERNALS_H_
 #define OPENSYNC_MERGER_INTERNALS_H_
 
+/**
+ * @brief A capability compiled into a merger plan
+ * @ingroup OSyncMergerPrivateAPI
+ */
+typedef struct OSyncMergerField {
+	/** Position of the field name in the sorted capabilities */
+	int index;
+	/** The supported keys, NULL if the field supports all keys */
+	GHashTable *keys;
+} OSyncMergerField;
+
+/**
+ * @brief The capabilities of one objtype, compiled for merge and demerge
+ * @ingroup OSyncMergerPrivateAPI
+ */
+typedef struct OSyncMergerPlan {
+	/** Fieldname -> OSyncMergerField, NULL if the objtype has no capabilities */
+	GHashTable *fields;
+} OSyncMergerPlan;
+
 /**
  * @brief Represent a Merger object
  * @ingroup OSyncMergerPrivateAPI
@@ -32,6 +52,8 @@ struct OSyncMerger {
 	int ref_count;
 	/** The pointer to the capabilities object */
 	OSyncCapabilities *capabilities;
+	/** Objtype -> OSyncMergerPlan, compiled on the first merge or demerge */
+	GHashTable *plans;
 };
 
 #endif /*OPENSYNC_MERGER_INTERNALS_H_*/
@@ -24,6 +24,7 @@
 OPENSYNC_BEGIN_DECLS
 
 #include "client/opensync_client.h"
+#include "client/opensync_client_pool.h"
 
 OPENSYNC_END_DECLS
 
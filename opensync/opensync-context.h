@@ -33,6 +33,9 @@ OSYNC_EXPORT void osync_context_unref(OSyncContext *context);
 OSYNC_EXPORT void osync_context_set_callback(OSyncContext *context, OSyncContextCallbackFn callback, void *userdata);
 OSYNC_EXPORT void osync_context_set_changes_callback(OSyncContext *context, OSyncContextChangeFn changes);
 OSYNC_EXPORT void osync_context_set_warning_callback(OSyncContext *context, OSyncContextCallbackFn warning);
+OSYNC_EXPORT void osync_context_set_cancel_flag(OSyncContext *context, int *flag);
+
+OSYNC_EXPORT osync_bool osync_context_is_cancelled(OSyncContext *context);
 
 OSYNC_EXPORT void osync_context_report_error(OSyncContext *context, OSyncErrorType type, const char *format, ...);
 OSYNC_EXPORT void osync_context_report_success(OSyncContext *context);
@@ -23,7 +23,10 @@
 
 OPENSYNC_BEGIN_DECLS
 
+#include "opensync-group.h"
+
 #include "engine/opensync_engine.h"
+#include "engine/opensync_engine_host.h"
 #include "engine/opensync_mapping_engine.h"
 #include "engine/opensync_obj_engine.h"
 
@@ -25,6 +25,7 @@ OPENSYNC_BEGIN_DECLS
 
 #include "helper/opensync_anchor.h"
 #include "helper/opensync_hashtable.h"
+#include "helper/opensync_journal.h"
 
 OPENSYNC_END_DECLS
 
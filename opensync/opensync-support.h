@@ -58,6 +58,15 @@ OSYNC_EXPORT char *osync_strdup_printf(const char *format, ...);
 OSYNC_EXPORT osync_bool osync_file_write(const char *filename, const char *data, unsigned int size, int mode, OSyncError **error);
 OSYNC_EXPORT osync_bool osync_file_read(const char *filename, char **data, unsigned int *size, OSyncError **error);
 
+OSYNC_EXPORT OSyncFileMap *osync_file_map_new(const char *filename, OSyncError **error);
+OSYNC_EXPORT OSyncFileMap *osync_file_map_ref(OSyncFileMap *map);
+OSYNC_EXPORT void osync_file_map_unref(OSyncFileMap *map);
+OSYNC_EXPORT const char *osync_file_map_get_path(OSyncFileMap *map);
+OSYNC_EXPORT const char *osync_file_map_get_identity(OSyncFileMap *map);
+OSYNC_EXPORT osync_bool osync_file_map_validate(OSyncFileMap *map, OSyncError **error);
+OSYNC_EXPORT const char *osync_file_map_get_data(OSyncFileMap *map);
+OSYNC_EXPORT unsigned int osync_file_map_get_size(OSyncFileMap *map);
+
 OSYNC_EXPORT char *osync_rand_str(int maxlength);
 
 OPENSYNC_END_DECLS
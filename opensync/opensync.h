@@ -177,9 +177,11 @@ typedef struct OSyncPluginResource OSyncPluginResource;
 
 /* Engine component */
 typedef struct OSyncEngine OSyncEngine;
+typedef struct OSyncEngineHost OSyncEngineHost;
 typedef struct OSyncObjEngine OSyncObjEngine;
 typedef struct OSyncClient OSyncClient;
 typedef struct OSyncClientProxy OSyncClientProxy;
+typedef struct OSyncClientPool OSyncClientPool;
 
 /* Mapping component */
 typedef struct OSyncMapping OSyncMapping;
@@ -210,11 +212,15 @@ typedef struct OSyncError OSyncError;
 typedef struct OSyncUserInfo OSyncUserInfo;
 typedef struct OSyncContext OSyncContext;
 typedef struct OSyncHashTable OSyncHashTable;
+typedef struct OSyncJournal OSyncJournal;
+typedef struct OSyncAnchorStore OSyncAnchorStore;
 typedef struct OSyncFormatProperty OSyncFormatProperty;
 typedef struct OSyncCustomFilter OSyncCustomFilter;
 typedef struct OSyncMessage OSyncMessage;
 typedef struct OSyncQueue OSyncQueue;
 typedef struct OSyncDB OSyncDB;
+typedef struct OSyncDBCursor OSyncDBCursor;
+typedef struct OSyncFileMap OSyncFileMap;
 typedef int osync_bool;
 
 OPENSYNC_END_DECLS
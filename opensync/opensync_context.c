@@ -74,6 +74,30 @@ void osync_context_set_warning_callback(OSyncContext *context, OSyncContextCallb
   context->warning_function = warning;
 }
 
+void osync_context_set_cancel_flag(OSyncContext *context, int *flag)
+{
+  osync_assert(context);
+  context->cancel_flag = flag;
+}
+
+/*! @brief Check if the engine cancelled the request of this context
+ *
+ * Long running plugin functions should poll this and report an error
+ * as soon as possible once the request got cancelled.
+ *
+ * @param context The context of the request
+ * @returns TRUE if the request got cancelled, FALSE otherwise
+ */
+osync_bool osync_context_is_cancelled(OSyncContext *context)
+{
+  osync_assert(context);
+
+  if (!context->cancel_flag)
+    return FALSE;
+
+  return g_atomic_int_get(context->cancel_flag) ? TRUE : FALSE;
+}
+
 void osync_context_report_osyncerror(OSyncContext *context, OSyncError *error)
 {
   osync_trace(TRACE_ENTRY, "%s(%p, %p:(%s))", __func__, context, error, osync_error_print(&error));
@@ -28,6 +28,8 @@ struct OSyncContext {
 	OSyncContextChangeFn changes_function;
 	void *plugindata;
 	int ref_count;
+	/** Set by the client once the engine cancelled the request, may be NULL */
+	int *cancel_flag;
 };
 
 #endif /*_OPENSYNC_CONTEXT_PRIVATE_H_*/
@@ -75,7 +75,7 @@ void osync_error_set_vargs(OSyncError **error, OSyncErrorType type, const char *
   osync_return_if_fail(osync_error_is_set(error) == FALSE);
   osync_return_if_fail(format);
 
-  *error = g_malloc0(sizeof(OSyncError));
+  *error = osync_slice_alloc0(sizeof(OSyncError));
   (*error)->message = g_strdup_vprintf(format, args);
   (*error)->type = type;
   (*error)->ref_count = 1;
@@ -143,7 +143,7 @@ void osync_error_unref(OSyncError **error)
     if ((*error)->child)
       osync_error_unref(&((*error)->child));
 		
-    g_free(*error);
+    osync_slice_free(sizeof(OSyncError), *error);
   }
 	
   *error = NULL;
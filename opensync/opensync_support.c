@@ -34,8 +34,12 @@ GPrivate* trace_sensitive = NULL;
 GPrivate* print_stderr = NULL;
 const char *trace = NULL;
 
+#include <fcntl.h>
+
 #ifndef _WIN32
 #include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 /**
@@ -419,6 +423,193 @@ osync_bool osync_file_read(const char *filename, char **data, unsigned int *size
   return ret;
 }
 
+static char *_osync_file_map_identity(struct stat *buf)
+{
+  return g_strdup_printf("%llu:%llu:%llu:%lli", (unsigned long long) buf->st_dev, (unsigned long long) buf->st_ino,
+                         (unsigned long long) buf->st_size, (long long) buf->st_mtime);
+}
+
+/*! @brief Maps a file read-only into memory
+ * 
+ * Unlike osync_file_read() the content doesn't get copied into the heap.
+ * The pages are loaded on demand and are shared by every reference of
+ * the mapping, and by every other process which maps the same file.
+ * The data must not be modified.
+ * 
+ * The mapping is not a snapshot. Changes of the file show through, and
+ * accessing pages beyond the end of a file which got truncated meanwhile
+ * raises SIGBUS. Files which might get mapped must be replaced with
+ * rename() instead of being rewritten in place, the mapping keeps the
+ * old file alive then. osync_file_map_validate() detects both cases.
+ * 
+ * @param filename The file to map
+ * @param oserror Pointer to a error struct
+ * @returns The new mapping or NULL on error
+ * 
+ */
+OSyncFileMap *osync_file_map_new(const char *filename, OSyncError **oserror)
+{
+  OSyncFileMap *map = NULL;
+  struct stat buf;
+  int fd = -1;
+  osync_trace(TRACE_ENTRY, "%s(%s, %p)", __func__, filename, oserror);
+  osync_assert(filename);
+
+  fd = g_open(filename, O_RDONLY, 0);
+  if (fd < 0) {
+    osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "Unable to open file %s for reading: %s", filename, g_strerror(errno));
+    goto error;
+  }
+
+  if (fstat(fd, &buf) < 0) {
+    osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "Unable to stat file %s: %s", filename, g_strerror(errno));
+    goto error_close;
+  }
+
+  if (!S_ISREG(buf.st_mode) || (unsigned long long) buf.st_size > G_MAXUINT) {
+    osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "Unable to map file %s: Not a regular file or too large", filename);
+    goto error_close;
+  }
+
+  map = osync_try_malloc0(sizeof(OSyncFileMap), oserror);
+  if (!map)
+    goto error_close;
+
+  map->ref_count = 1;
+  map->size = buf.st_size;
+
+#ifndef _WIN32
+  /* Empty files can't be mapped, data stays NULL */
+  if (map->size) {
+    map->data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map->data == MAP_FAILED) {
+      osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "Unable to map file %s: %s", filename, g_strerror(errno));
+      g_free(map);
+      goto error_close;
+    }
+    map->mapped = TRUE;
+  }
+#else
+  if (!osync_file_read(filename, &(map->data), &(map->size), oserror)) {
+    g_free(map);
+    goto error_close;
+  }
+#endif
+
+  close(fd);
+
+  if (g_path_is_absolute(filename)) {
+    map->path = g_strdup(filename);
+  } else {
+    char *curdir = g_get_current_dir();
+    map->path = g_build_filename(curdir, filename, NULL);
+    g_free(curdir);
+  }
+
+  map->identity = _osync_file_map_identity(&buf);
+
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, map);
+  return map;
+
+ error_close:
+  close(fd);
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(oserror));
+  return NULL;
+}
+
+OSyncFileMap *osync_file_map_ref(OSyncFileMap *map)
+{
+  osync_assert(map);
+
+  g_atomic_int_inc(&(map->ref_count));
+
+  return map;
+}
+
+void osync_file_map_unref(OSyncFileMap *map)
+{
+  osync_assert(map);
+
+  if (g_atomic_int_dec_and_test(&(map->ref_count))) {
+#ifndef _WIN32
+    if (map->mapped)
+      munmap(map->data, map->size);
+    else
+#endif
+      g_free(map->data);
+
+    g_free(map->path);
+    g_free(map->identity);
+    g_free(map);
+  }
+}
+
+/*! @brief Returns the absolute path of the mapped file */
+const char *osync_file_map_get_path(OSyncFileMap *map)
+{
+  osync_assert(map);
+  return map->path;
+}
+
+/*! @brief Returns a string which changes when the mapped file gets replaced or modified
+ * 
+ * Used to verify that a mapping of the same file by another process sees
+ * the same content.
+ * 
+ */
+const char *osync_file_map_get_identity(OSyncFileMap *map)
+{
+  osync_assert(map);
+  return map->identity;
+}
+
+/*! @brief Checks that the mapped file is still the one which got mapped
+ * 
+ * Call this before the content of a mapping, which was created a while
+ * ago, gets passed on. Once the file got rewritten in place the content
+ * is inconsistent or, if it got truncated, not readable anymore.
+ * 
+ * @param map The mapping
+ * @param oserror Pointer to a error struct
+ * @returns TRUE if the file didn't change since it got mapped, FALSE otherwise
+ * 
+ */
+osync_bool osync_file_map_validate(OSyncFileMap *map, OSyncError **oserror)
+{
+  struct stat buf;
+  char *identity = NULL;
+  osync_assert(map);
+
+  if (g_stat(map->path, &buf) < 0) {
+    osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "Unable to stat file %s: %s", map->path, g_strerror(errno));
+    return FALSE;
+  }
+
+  identity = _osync_file_map_identity(&buf);
+  if (strcmp(identity, map->identity)) {
+    osync_error_set(oserror, OSYNC_ERROR_IO_ERROR, "File %s changed since it got mapped", map->path);
+    g_free(identity);
+    return FALSE;
+  }
+
+  g_free(identity);
+  return TRUE;
+}
+
+/*! @brief Returns the read-only content of the mapped file, NULL if the file is empty */
+const char *osync_file_map_get_data(OSyncFileMap *map)
+{
+  osync_assert(map);
+  return map->data;
+}
+
+unsigned int osync_file_map_get_size(OSyncFileMap *map)
+{
+  osync_assert(map);
+  return map->size;
+}
+
 /*! @brief Returns the version of opensync
  * 
  * Returns a string identifying the major and minor version
@@ -476,6 +667,73 @@ void osync_free(void *ptr)
   g_free(ptr);
 }
 
+/*! @brief Allocates a small, fixed size object
+ * 
+ * Objects which get created and destroyed for every change (changes,
+ * data, messages, mapping entries, errors) are taken from the per-thread
+ * magazines of the GSlice allocator instead of malloc. Memory allocated
+ * with this function must be freed with osync_slice_free() and the same
+ * size.
+ * 
+ * With OPENSYNC_DEBUG_ALLOCATIONS every object is allocated with malloc,
+ * to keep them visible for memory debuggers.
+ * 
+ * @param size The size in bytes of the object
+ * @returns A pointer to the zeroed memory
+ * 
+ */
+void *osync_slice_alloc0(unsigned int size)
+{
+#ifdef OPENSYNC_DEBUG_ALLOCATIONS
+  return g_malloc0(size);
+#else
+  return g_slice_alloc0(size);
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+}
+
+/*! @brief Safely tries to allocate a small, fixed size object
+ * 
+ * Like osync_slice_alloc0(), but returns an error in an OOM situation
+ * like osync_try_malloc0() does.
+ * 
+ * @param size The size in bytes of the object
+ * @param error The error which will hold the info in case of an error
+ * @returns A pointer to the zeroed memory or NULL in case of error
+ * 
+ */
+void *osync_try_slice_alloc0(unsigned int size, OSyncError **error)
+{
+#ifdef OPENSYNC_DEBUG_ALLOCATIONS
+  return osync_try_malloc0(size, error);
+#else
+#ifdef OPENSYNC_UNITTESTS
+  if (g_getenv("OSYNC_NOMEMORY")) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "No memory left");
+    return NULL;
+  }
+#endif /* OPENSYNC_UNITTESTS */
+  return g_slice_alloc0(size);
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+}
+
+/*! @brief Frees an object allocated with osync_slice_alloc0()
+ * 
+ * @param size The size in bytes which got allocated
+ * @param ptr Pointer to the object
+ * 
+ */
+void osync_slice_free(unsigned int size, void *ptr)
+{
+  if (!ptr)
+    return;
+
+#ifdef OPENSYNC_DEBUG_ALLOCATIONS
+  g_free(ptr);
+#else
+  g_slice_free1(size, ptr);
+#endif /* OPENSYNC_DEBUG_ALLOCATIONS */
+}
+
 /*! @brief Allocates a new thread with a g_mainloop 
  * 
  * @param context Pointer to GMainContext 
@@ -708,6 +966,133 @@ int osync_bitcount(unsigned int u)
   return ((uCount + (uCount >> 3)) & 030707070707) % 63;
 }
 
+#define OSYNC_BITSET_WORD_BITS (sizeof(unsigned int) * 8)
+
+/*! @brief Sets a position in a bitset
+ * 
+ * The bitset grows if the position is beyond its current storage.
+ * 
+ * @param set The bitset
+ * @param position The position to set
+ * @returns TRUE if the position was not set before, FALSE otherwise
+ * 
+ */
+osync_bool osync_bitset_set(OSyncBitset *set, unsigned int position)
+{
+  unsigned int word = position / OSYNC_BITSET_WORD_BITS;
+  unsigned int mask = 1u << (position % OSYNC_BITSET_WORD_BITS);
+  osync_assert(set);
+
+  if (word >= set->size) {
+    unsigned int size = set->size ? set->size : 1;
+    while (size <= word)
+      size *= 2;
+
+    set->bits = g_realloc(set->bits, size * sizeof(unsigned int));
+    memset(set->bits + set->size, 0, (size - set->size) * sizeof(unsigned int));
+    set->size = size;
+  }
+
+  if (set->bits[word] & mask)
+    return FALSE;
+
+  set->bits[word] |= mask;
+  set->count++;
+  return TRUE;
+}
+
+/*! @brief Checks if a position is set in a bitset
+ * 
+ * @param set The bitset
+ * @param position The position to check
+ * @returns TRUE if the position is set, FALSE otherwise
+ * 
+ */
+osync_bool osync_bitset_test(const OSyncBitset *set, unsigned int position)
+{
+  unsigned int word = position / OSYNC_BITSET_WORD_BITS;
+  osync_assert(set);
+
+  if (word >= set->size)
+    return FALSE;
+
+  return !!(set->bits[word] & (1u << (position % OSYNC_BITSET_WORD_BITS)));
+}
+
+/*! @brief Returns the number of positions set in a bitset
+ * 
+ * The count is maintained while setting positions, so this is O(1).
+ * 
+ * @param set The bitset
+ * @returns The number of set positions
+ * 
+ */
+unsigned int osync_bitset_count(const OSyncBitset *set)
+{
+  osync_assert(set);
+  return set->count;
+}
+
+/*! @brief Returns the number of positions set in either of two bitsets
+ * 
+ * Shortcuts to the maintained counts if one of the sets is empty,
+ * otherwise only the words both sets share get counted.
+ * 
+ * @param a The first bitset
+ * @param b The second bitset
+ * @returns The number of positions set in a or b
+ * 
+ */
+unsigned int osync_bitset_count_union(const OSyncBitset *a, const OSyncBitset *b)
+{
+  unsigned int i, size, overlap = 0;
+  osync_assert(a);
+  osync_assert(b);
+
+  if (!a->count || !b->count)
+    return a->count + b->count;
+
+  size = a->size < b->size ? a->size : b->size;
+  for (i = 0; i < size; i++) {
+    unsigned int both = a->bits[i] & b->bits[i];
+    if (both)
+      overlap += osync_bitcount(both);
+  }
+
+  return a->count + b->count - overlap;
+}
+
+/*! @brief Unsets all positions of a bitset
+ * 
+ * The storage is kept, so a bitset can get reused without reallocation.
+ * 
+ * @param set The bitset
+ * 
+ */
+void osync_bitset_reset(OSyncBitset *set)
+{
+  osync_assert(set);
+
+  if (set->count)
+    memset(set->bits, 0, set->size * sizeof(unsigned int));
+  set->count = 0;
+}
+
+/*! @brief Releases the storage of a bitset
+ * 
+ * @param set The bitset
+ * 
+ */
+void osync_bitset_clear(OSyncBitset *set)
+{
+  osync_assert(set);
+
+  g_free(set->bits);
+  set->bits = NULL;
+  set->size = 0;
+  set->count = 0;
+}
+
 /*! @brief Creates a random string
  * 
  * Creates a random string of given length or less
@@ -36,8 +36,45 @@ OSYNC_TEST_EXPORT void osync_thread_stop(OSyncThread *thread);
 OSYNC_TEST_EXPORT void osync_thread_exit(OSyncThread *thread, int retval);
 OSYNC_TEST_EXPORT OSyncThread *osync_thread_create(GThreadFunc func, void *userdata, OSyncError **error);
 
+void *osync_slice_alloc0(unsigned int size);
+void *osync_try_slice_alloc0(unsigned int size, OSyncError **error);
+void osync_slice_free(unsigned int size, void *ptr);
+
 int osync_bitcount(unsigned int u);
 
+/*! @brief Growable set of positions with a maintained population count
+ *
+ * Embedded by value, so a zeroed OSyncBitset is a valid empty set.
+ * Storage grows on demand when a position gets set.
+ */
+typedef struct OSyncBitset {
+	unsigned int *bits;
+	/** Number of allocated words in bits */
+	unsigned int size;
+	/** Number of positions set */
+	unsigned int count;
+} OSyncBitset;
+
+OSYNC_TEST_EXPORT osync_bool osync_bitset_set(OSyncBitset *set, unsigned int position);
+OSYNC_TEST_EXPORT osync_bool osync_bitset_test(const OSyncBitset *set, unsigned int position);
+OSYNC_TEST_EXPORT unsigned int osync_bitset_count(const OSyncBitset *set);
+OSYNC_TEST_EXPORT unsigned int osync_bitset_count_union(const OSyncBitset *a, const OSyncBitset *b);
+OSYNC_TEST_EXPORT void osync_bitset_reset(OSyncBitset *set);
+OSYNC_TEST_EXPORT void osync_bitset_clear(OSyncBitset *set);
+
+/*! @brief A read-only mapping of a file, shared by everyone who references it */
+struct OSyncFileMap {
+	int ref_count;
+	/** Absolute path of the mapped file */
+	char *path;
+	/** Device, inode, size and modification time of the mapped file */
+	char *identity;
+	char *data;
+	unsigned int size;
+	/** FALSE if data got read into the heap instead */
+	osync_bool mapped;
+};
+
 char *osync_print_binary(const unsigned char *data, int len);
 
 #endif /* _OPENSYNC_SUPPORT_INTERNALS_H */
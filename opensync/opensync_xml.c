@@ -189,226 +189,356 @@ osync_bool osync_xml_has_property(xmlNode *parent, const char *name)
   return (xmlHasProp(parent, (xmlChar*)name) != NULL);
 }
 
-static osync_bool osync_xml_compare_node(xmlNode *leftnode, xmlNode *rightnode)
+/* The documents don't get modified while comparing. Nodes which got
+ * paired or dropped already are remembered in a set of consumed nodes
+ * instead of removing them from a copy of the document. */
+static osync_bool _osync_xml_node_consumed(GHashTable *consumed, xmlNode *node)
+{
+  for (; node && node->type != XML_DOCUMENT_NODE; node = node->parent) {
+    if (g_hash_table_lookup(consumed, node))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static void _osync_xml_node_consume(GHashTable *consumed, xmlNode *node)
+{
+  g_hash_table_insert(consumed, node, node);
+}
+
+static osync_bool osync_xml_compare_node(xmlNode *leftnode, xmlNode *rightnode, GHashTable *lconsumed, GHashTable *rconsumed)
 {
   xmlNode *rightstartnode = NULL;
-  osync_trace(TRACE_ENTRY, "%s(%p:%s, %p:%s)", __func__, leftnode, leftnode->name, rightnode, rightnode->name);
-  if (xmlStrcmp(leftnode->name, rightnode->name)) {
-    osync_trace(TRACE_EXIT, "%s: FALSE: Different Name", __func__);
+  osync_bool found_left = FALSE, found_right = FALSE;
+
+  if (xmlStrcmp(leftnode->name, rightnode->name))
     return FALSE;
-  }
 	
   leftnode = leftnode->children;
   rightnode = rightnode->children;
   rightstartnode = rightnode;
+
+  for (; leftnode && g_hash_table_lookup(lconsumed, leftnode); leftnode = leftnode->next) ;
+  for (; rightstartnode && g_hash_table_lookup(rconsumed, rightstartnode); rightstartnode = rightstartnode->next) ;
+  found_left = (leftnode != NULL);
+  found_right = (rightstartnode != NULL);
 	
-  if (!leftnode && !rightnode) {
-    osync_trace(TRACE_EXIT, "%s: TRUE. Both 0", __func__);
+  if (!found_left && !found_right)
     return TRUE;
-  }
 	
-  if (!leftnode || !rightnode) {
-    osync_trace(TRACE_EXIT, "%s: FALSE. One 0", __func__);
+  if (!found_left || !found_right)
     return FALSE;
-  }
 	
-  do {
+  for (; leftnode; leftnode = leftnode->next) {
     xmlChar *leftcontent = NULL;
+    if (g_hash_table_lookup(lconsumed, leftnode))
+      continue;
     if (!strcmp("UnknownParam", (char*)leftnode->name))
       continue;
     if (!strcmp("Order", (char*)leftnode->name))
       continue;
-    rightnode = rightstartnode;
     leftcontent = xmlNodeGetContent(leftnode);
 		
-    do {
+    for (rightnode = rightstartnode; rightnode; rightnode = rightnode->next) {
       xmlChar *rightcontent = NULL;
+      if (g_hash_table_lookup(rconsumed, rightnode))
+        continue;
       if (!strcmp("UnknownParam", (char*)rightnode->name))
         continue;
       rightcontent = xmlNodeGetContent(rightnode);
 			
-      osync_trace(TRACE_INTERNAL, "leftcontent %s (%s), rightcontent %s (%s)", leftcontent, leftnode->name, rightcontent, rightnode->name);
-      if (leftcontent == rightcontent) {
-        xmlFree(rightcontent);
-        goto next;
-      }
+      if (leftcontent == rightcontent)
+        break;
       if (!leftcontent || !rightcontent) {
-        osync_trace(TRACE_EXIT, "%s: One is empty", __func__);
+        xmlFree(leftcontent);
+        xmlFree(rightcontent);
         return FALSE;
       }
       if (!xmlStrcmp(leftcontent, rightcontent)) {
         xmlFree(rightcontent);
-        goto next;
+        break;
       }
       xmlFree(rightcontent);
-    } while ((rightnode = rightnode->next));
-    osync_trace(TRACE_EXIT, "%s: Could not match one", __func__);
-    xmlFree(leftcontent);
-    return FALSE;
-  next:;
+    }
     xmlFree(leftcontent);
-  } while ((leftnode = leftnode->next));
+
+    if (!rightnode)
+      return FALSE;
+  }
 	
-  osync_trace(TRACE_EXIT, "%s: TRUE", __func__);
   return TRUE;
 }
 
+static gint _osync_xml_compare_content(gconstpointer a, gconstpointer b)
+{
+  return xmlStrcmp(*(const xmlChar **)a, *(const xmlChar **)b);
+}
+
+/* Normalized content of a node: its name and the distinct contents of its
+ * children, sorted. Nodes with the same key always match with
+ * osync_xml_compare_node(). */
+static char *_osync_xml_node_key(xmlNode *node, GHashTable *consumed)
+{
+  GString *key = g_string_new((const char *)node->name);
+  GPtrArray *contents = g_ptr_array_new();
+  osync_bool has_children = FALSE;
+  xmlNode *cur = NULL;
+  unsigned int i;
+
+  for (cur = node->children; cur; cur = cur->next) {
+    xmlChar *content = NULL;
+    if (g_hash_table_lookup(consumed, cur))
+      continue;
+    has_children = TRUE;
+    if (!strcmp("UnknownParam", (char*)cur->name) || !strcmp("Order", (char*)cur->name))
+      continue;
+    content = xmlNodeGetContent(cur);
+    if (content)
+      g_ptr_array_add(contents, content);
+  }
+
+  g_string_append_c(key, has_children ? '+' : '-');
+
+  g_ptr_array_sort(contents, _osync_xml_compare_content);
+  for (i = 0; i < contents->len; i++) {
+    xmlChar *content = g_ptr_array_index(contents, i);
+    if (!i || xmlStrcmp(content, g_ptr_array_index(contents, i - 1)))
+      g_string_append_printf(key, "%u:%s", xmlStrlen(content), (const char *)content);
+  }
+
+  for (i = 0; i < contents->len; i++)
+    xmlFree(g_ptr_array_index(contents, i));
+  g_ptr_array_free(contents, TRUE);
+
+  return g_string_free(key, FALSE);
+}
+
+/* Pairs each left node with an unpaired right node. Right nodes with the same
+ * normalized content are found by hash; only left nodes without such a twin
+ * get compared with the right nodes of the same name.
+ * Returns the number of left nodes which didn't find a partner. */
+static int _osync_xml_pair_nodes(GPtrArray *lnodes, GPtrArray *rnodes, GHashTable *lconsumed, GHashTable *rconsumed, int value, int *res_score, int *right_remaining)
+{
+  GHashTable *bykey = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_queue_free);
+  GHashTable *byname = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_queue_free);
+  osync_bool *paired = g_malloc0(sizeof(osync_bool) * (rnodes->len + 1));
+  int unpaired = 0;
+  unsigned int i;
+
+  for (i = 0; i < rnodes->len; i++) {
+    xmlNode *node = g_ptr_array_index(rnodes, i);
+    char *key = _osync_xml_node_key(node, rconsumed);
+    GQueue *queue = g_hash_table_lookup(bykey, key);
+    if (!queue) {
+      queue = g_queue_new();
+      g_hash_table_insert(bykey, key, queue);
+    } else {
+      g_free(key);
+    }
+    g_queue_push_tail(queue, GUINT_TO_POINTER(i));
+
+    queue = g_hash_table_lookup(byname, node->name);
+    if (!queue) {
+      queue = g_queue_new();
+      g_hash_table_insert(byname, (gpointer)node->name, queue);
+    }
+    g_queue_push_tail(queue, GUINT_TO_POINTER(i));
+  }
+
+  for (i = 0; i < lnodes->len; i++) {
+    xmlNode *lnode = g_ptr_array_index(lnodes, i);
+    char *key = _osync_xml_node_key(lnode, lconsumed);
+    GQueue *queue = g_hash_table_lookup(bykey, key);
+    int match = -1;
+    g_free(key);
+
+    while (queue && !g_queue_is_empty(queue)) {
+      unsigned int n = GPOINTER_TO_UINT(g_queue_pop_head(queue));
+      if (!paired[n]) {
+        match = n;
+        break;
+      }
+    }
+
+    if (match < 0) {
+      GList *l = NULL;
+      queue = g_hash_table_lookup(byname, lnode->name);
+      for (l = queue ? queue->head : NULL; l; l = l->next) {
+        unsigned int n = GPOINTER_TO_UINT(l->data);
+        if (!paired[n] && osync_xml_compare_node(lnode, g_ptr_array_index(rnodes, n), lconsumed, rconsumed)) {
+          match = n;
+          break;
+        }
+      }
+    }
+
+    if (match < 0) {
+      osync_trace(TRACE_INTERNAL, "Subtracting %i for %s", value, lnode->name);
+      *res_score -= value;
+      unpaired++;
+      continue;
+    }
+
+    osync_trace(TRACE_INTERNAL, "Adding %i for %s", value, lnode->name);
+    *res_score += value;
+    paired[match] = TRUE;
+    _osync_xml_node_consume(lconsumed, lnode);
+    _osync_xml_node_consume(rconsumed, g_ptr_array_index(rnodes, match));
+  }
+
+  *right_remaining = 0;
+  for (i = 0; i < rnodes->len; i++) {
+    if (!paired[i])
+      (*right_remaining)++;
+  }
+
+  g_free(paired);
+  g_hash_table_destroy(bykey);
+  g_hash_table_destroy(byname);
+
+  return unpaired;
+}
+
+static void _osync_xml_compiled_paths_free(gpointer data)
+{
+  g_hash_table_destroy(data);
+}
+
+/* Compiled score paths. Each thread keeps its own, as compiled
+ * expressions are not meant to be evaluated concurrently. */
+static GStaticPrivate compiled_paths = G_STATIC_PRIVATE_INIT;
+
+static xmlXPathCompExprPtr _osync_xml_compile_path(const char *path)
+{
+  GHashTable *paths = g_static_private_get(&compiled_paths);
+  xmlXPathCompExprPtr comp = NULL;
+
+  if (!paths) {
+    paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)xmlXPathFreeCompExpr);
+    g_static_private_set(&compiled_paths, paths, _osync_xml_compiled_paths_free);
+  }
+
+  comp = g_hash_table_lookup(paths, path);
+  if (!comp) {
+    comp = xmlXPathCompile((const xmlChar *)path);
+    if (!comp) {
+      osync_trace(TRACE_ERROR, "Unable to compile xpath expression \"%s\"", path);
+      return NULL;
+    }
+    g_hash_table_insert(paths, g_strdup(path), comp);
+  }
+
+  return comp;
+}
+
+/* Collects the nodes selected by the path which are not consumed yet */
+static GPtrArray *_osync_xml_select_nodes(xmlXPathContextPtr ctx, xmlXPathCompExprPtr comp, GHashTable *consumed)
+{
+  GPtrArray *nodes = g_ptr_array_new();
+  xmlXPathObjectPtr xobj = NULL;
+  int i;
+
+  xobj = xmlXPathCompiledEval(comp, ctx);
+  if (!xobj)
+    return nodes;
+
+  for (i = 0; xobj->nodesetval && i < xobj->nodesetval->nodeNr; i++) {
+    xmlNode *node = xobj->nodesetval->nodeTab[i];
+    if (!_osync_xml_node_consumed(consumed, node))
+      g_ptr_array_add(nodes, node);
+  }
+
+  xmlXPathFreeObject(xobj);
+  return nodes;
+}
+
+/* The fields of the document: the element children of the root node */
+static GPtrArray *_osync_xml_select_fields(xmlDoc *doc, GHashTable *consumed)
+{
+  GPtrArray *nodes = g_ptr_array_new();
+  xmlNode *root = xmlDocGetRootElement(doc);
+  xmlNode *cur = NULL;
+
+  for (cur = root ? root->children : NULL; cur; cur = cur->next) {
+    if (cur->type == XML_ELEMENT_NODE && !g_hash_table_lookup(consumed, cur))
+      g_ptr_array_add(nodes, cur);
+  }
+
+  return nodes;
+}
+
 OSyncConvCmpResult osync_xml_compare(xmlDoc *leftinpdoc, xmlDoc *rightinpdoc, OSyncXMLScore *scores, int default_score, int treshold)
 {
-  int z = 0, i = 0, n = 0;
+  int z = 0;
+  unsigned int i = 0;
   int res_score = 0;
-  xmlDoc *leftdoc = NULL;
-  xmlDoc *rightdoc = NULL;
+  int left_remaining = 0, right_remaining = 0;
+  GHashTable *lconsumed = NULL;
+  GHashTable *rconsumed = NULL;
+  xmlXPathContextPtr leftctx = NULL;
+  xmlXPathContextPtr rightctx = NULL;
+  GPtrArray *lnodes = NULL;
+  GPtrArray *rnodes = NULL;
+  osync_bool same = TRUE;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, leftinpdoc, rightinpdoc, scores);
-	
-  leftdoc = xmlCopyDoc(leftinpdoc, TRUE);
-  rightdoc = xmlCopyDoc(rightinpdoc, TRUE);
+
+  lconsumed = g_hash_table_new(g_direct_hash, g_direct_equal);
+  rconsumed = g_hash_table_new(g_direct_hash, g_direct_equal);
+  leftctx = xmlXPathNewContext(leftinpdoc);
+  rightctx = xmlXPathNewContext(rightinpdoc);
 	
   osync_trace(TRACE_INTERNAL, "Comparing given score list");
-  while (scores && scores[z].path) {
+  while (leftctx && rightctx && scores && scores[z].path) {
     OSyncXMLScore *score = &scores[z];
-    xmlXPathObject *leftxobj = osync_xml_get_nodeset(leftdoc, score->path);
-    xmlXPathObject *rightxobj = osync_xml_get_nodeset(rightdoc, score->path);
-		
-    xmlNodeSet *lnodes = leftxobj->nodesetval;
-    xmlNodeSet *rnodes = rightxobj->nodesetval;
-		
-    int lsize = (lnodes) ? lnodes->nodeNr : 0;
-    int rsize = (rnodes) ? rnodes->nodeNr : 0;
+    xmlXPathCompExprPtr comp = _osync_xml_compile_path(score->path);
     z++;
+    if (!comp)
+      continue;
+
     osync_trace(TRACE_INTERNAL, "parsing next path %s", score->path);
+    lnodes = _osync_xml_select_nodes(leftctx, comp, lconsumed);
+    rnodes = _osync_xml_select_nodes(rightctx, comp, rconsumed);
 		
     if (!score->value) {
-      for (i = 0; i < lsize; i++) {
-        xmlUnlinkNode(lnodes->nodeTab[i]);
-        xmlFreeNode(lnodes->nodeTab[i]);
-        lnodes->nodeTab[i] = NULL;
-      }
-			
-      for (n = 0; n < rsize; n++) {
-        xmlUnlinkNode(rnodes->nodeTab[n]);
-        xmlFreeNode(rnodes->nodeTab[n]);
-        rnodes->nodeTab[n] = NULL;
-      }
+      for (i = 0; i < lnodes->len; i++)
+        _osync_xml_node_consume(lconsumed, g_ptr_array_index(lnodes, i));
+      for (i = 0; i < rnodes->len; i++)
+        _osync_xml_node_consume(rconsumed, g_ptr_array_index(rnodes, i));
     } else {
-      for (i = 0; i < lsize; i++) {
-        if (!lnodes->nodeTab[i])
-          continue;
-        for (n = 0; n < rsize; n++) {
-          xmlChar *lcontent = NULL;
-          xmlChar *rcontent = NULL;
-          if (!rnodes->nodeTab[n])
-            continue;
-          lcontent = osync_xml_find_node(lnodes->nodeTab[i], "Content");
-          rcontent = osync_xml_find_node(rnodes->nodeTab[n], "Content"); 
-          osync_trace(TRACE_INTERNAL, "cmp %i:%s (%s), %i:%s (%s)", i, lnodes->nodeTab[i]->name, lcontent, n, rnodes->nodeTab[n]->name, rcontent);
-          xmlFree(lcontent);
-          xmlFree(rcontent);
-
-          if (osync_xml_compare_node(lnodes->nodeTab[i], rnodes->nodeTab[n])) {
-            osync_trace(TRACE_INTERNAL, "Adding %i for %s", score->value, score->path);
-            res_score += score->value;
-            xmlUnlinkNode(lnodes->nodeTab[i]);
-            xmlFreeNode(lnodes->nodeTab[i]);
-            lnodes->nodeTab[i] = NULL;
-            xmlUnlinkNode(rnodes->nodeTab[n]);
-            xmlFreeNode(rnodes->nodeTab[n]);
-            rnodes->nodeTab[n] = NULL;
-            goto next;
-          }
-        }
-        osync_trace(TRACE_INTERNAL, "Subtracting %i for %s", score->value, score->path);
-        res_score -= score->value;
-      next:;
-      }
-      for(i = 0; i < rsize; i++) {
-        if (!rnodes->nodeTab[i])
-          continue;
-        res_score -= score->value;
-      }
+      _osync_xml_pair_nodes(lnodes, rnodes, lconsumed, rconsumed, score->value, &res_score, &right_remaining);
+      res_score -= right_remaining * score->value;
     }
 		
-    xmlXPathFreeObject(leftxobj);
-    xmlXPathFreeObject(rightxobj);
+    g_ptr_array_free(lnodes, TRUE);
+    g_ptr_array_free(rnodes, TRUE);
   }
 
-  { /* Block for new variables */
-    xmlXPathObject *leftxobj = osync_xml_get_nodeset(leftdoc, "/*/*");
-    xmlXPathObject *rightxobj = osync_xml_get_nodeset(rightdoc, "/*/*");
-	
-    xmlNodeSet *lnodes = leftxobj->nodesetval;
-    xmlNodeSet *rnodes = rightxobj->nodesetval;
-	
-    int lsize = (lnodes) ? lnodes->nodeNr : 0;
-    int rsize = (rnodes) ? rnodes->nodeNr : 0;
-    osync_bool same = TRUE;
-    osync_trace(TRACE_INTERNAL, "Comparing remaining list");
-
-    for(i = 0; i < lsize; i++) {		
-      for (n = 0; n < rsize; n++) {
-        xmlChar *lcontent = NULL;
-        xmlChar *rcontent = NULL;
-
-        if (!rnodes->nodeTab[n])
-          continue;
-
-        lcontent = osync_xml_find_node(lnodes->nodeTab[i], "Content");
-        rcontent = osync_xml_find_node(rnodes->nodeTab[n], "Content"); 
-
-        osync_trace(TRACE_INTERNAL, "cmp %i:%s (%s), %i:%s (%s)", i, lnodes->nodeTab[i]->name, lcontent, n, rnodes->nodeTab[n]->name, rcontent);
-
-        xmlFree(lcontent);
-        xmlFree(rcontent);
-
-        if (osync_xml_compare_node(lnodes->nodeTab[i], rnodes->nodeTab[n])) {
-          xmlUnlinkNode(lnodes->nodeTab[i]);
-          xmlFreeNode(lnodes->nodeTab[i]);
-          lnodes->nodeTab[i] = NULL;
-          xmlUnlinkNode(rnodes->nodeTab[n]);
-          xmlFreeNode(rnodes->nodeTab[n]);
-          rnodes->nodeTab[n] = NULL;
-          osync_trace(TRACE_INTERNAL, "Adding %i", default_score);
-          res_score += default_score;
-          goto next2;
-        }
-      }
-      osync_trace(TRACE_INTERNAL, "Subtracting %i", default_score);
-      res_score -= default_score;
-      same = FALSE;
-      //goto out;
-    next2:;
-    }
-	
-    for(i = 0; i < lsize; i++) {
-      if (!lnodes->nodeTab[i])
-        continue;
-      osync_trace(TRACE_INTERNAL, "left remaining: %s", lnodes->nodeTab[i]->name);
-      same = FALSE;
-      goto out;
-    }
-	
-    for(i = 0; i < rsize; i++) {
-      if (!rnodes->nodeTab[i])
-        continue;
-      osync_trace(TRACE_INTERNAL, "right remaining: %s", rnodes->nodeTab[i]->name);
-      same = FALSE;
-      goto out;
-    }
-  out:
-    xmlXPathFreeObject(leftxobj);
-    xmlXPathFreeObject(rightxobj);
-
-    osync_xml_free_doc(leftdoc);
-    osync_xml_free_doc(rightdoc);	
-        
-
-    osync_trace(TRACE_INTERNAL, "Result is: %i, Treshold is: %i", res_score, treshold);
-    if (same) {
-      osync_trace(TRACE_EXIT, "%s: SAME", __func__);
-      return OSYNC_CONV_DATA_SAME;
-    }
-  } /* Block for new variables */
+  osync_trace(TRACE_INTERNAL, "Comparing remaining list");
+  lnodes = _osync_xml_select_fields(leftinpdoc, lconsumed);
+  rnodes = _osync_xml_select_fields(rightinpdoc, rconsumed);
+
+  left_remaining = _osync_xml_pair_nodes(lnodes, rnodes, lconsumed, rconsumed, default_score, &res_score, &right_remaining);
+  if (left_remaining || right_remaining) {
+    osync_trace(TRACE_INTERNAL, "%i left and %i right fields remaining", left_remaining, right_remaining);
+    same = FALSE;
+  }
+
+  g_ptr_array_free(lnodes, TRUE);
+  g_ptr_array_free(rnodes, TRUE);
+
+  if (leftctx)
+    xmlXPathFreeContext(leftctx);
+  if (rightctx)
+    xmlXPathFreeContext(rightctx);
+  g_hash_table_destroy(lconsumed);
+  g_hash_table_destroy(rconsumed);
+
+  osync_trace(TRACE_INTERNAL, "Result is: %i, Treshold is: %i", res_score, treshold);
+  if (same) {
+    osync_trace(TRACE_EXIT, "%s: SAME", __func__);
+    return OSYNC_CONV_DATA_SAME;
+  }
   if (res_score >= treshold) {
     osync_trace(TRACE_EXIT, "%s: SIMILAR", __func__);
     return OSYNC_CONV_DATA_SIMILAR;
@@ -472,31 +602,121 @@ osync_bool osync_xml_demarshal(OSyncMessage *message, char **output, unsigned in
   return FALSE;
 }
 
+/* Compiled schemas, shared by all threads of the process. A schema file
+ * only gets parsed again if it changed on disk. */
+typedef struct OSyncXMLSchemaCacheEntry {
+  int ref_count;
+  xmlSchemaPtr schema;
+  time_t mtime;
+  off_t size;
+  /** Unused validation contexts - one per thread which validated concurrently */
+  GSList *contexts;
+} OSyncXMLSchemaCacheEntry;
+
+static GHashTable *schema_cache = NULL;
+static GStaticMutex schema_cache_mutex = G_STATIC_MUTEX_INIT;
+
+static void _osync_xml_schema_cache_entry_unref(OSyncXMLSchemaCacheEntry *entry)
+{
+  GSList *c;
+
+  if (!g_atomic_int_dec_and_test(&(entry->ref_count)))
+    return;
+
+  for (c = entry->contexts; c; c = c->next)
+    xmlSchemaFreeValidCtxt(c->data);
+  g_slist_free(entry->contexts);
+
+  xmlSchemaFree(entry->schema);
+  g_free(entry);
+}
+
+static OSyncXMLSchemaCacheEntry *_osync_xml_schema_cache_get(const char *schemafilepath)
+{
+  OSyncXMLSchemaCacheEntry *entry = NULL;
+  xmlSchemaParserCtxtPtr xmlSchemaParserCtxt = NULL;
+  struct stat st;
+
+  if (g_stat(schemafilepath, &st) < 0)
+    return NULL;
+
+  g_static_mutex_lock(&schema_cache_mutex);
+
+  if (!schema_cache)
+    schema_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_osync_xml_schema_cache_entry_unref);
+
+  entry = g_hash_table_lookup(schema_cache, schemafilepath);
+  if (entry && entry->mtime == st.st_mtime && entry->size == st.st_size)
+    goto out;
+
+  /* Not cached yet or the schema file got modified. Threads which
+     still validate against a replaced schema keep their reference. */
+  entry = NULL;
+
+  xmlSchemaParserCtxt = xmlSchemaNewParserCtxt(schemafilepath);
+  if (!xmlSchemaParserCtxt)
+    goto out;
+
+  entry = g_malloc0(sizeof(OSyncXMLSchemaCacheEntry));
+  entry->schema = xmlSchemaParse(xmlSchemaParserCtxt);
+  xmlSchemaFreeParserCtxt(xmlSchemaParserCtxt);
+  if (!entry->schema) {
+    g_free(entry);
+    entry = NULL;
+    g_hash_table_remove(schema_cache, schemafilepath);
+    goto out;
+  }
+
+  entry->ref_count = 1;
+  entry->mtime = st.st_mtime;
+  entry->size = st.st_size;
+  g_hash_table_replace(schema_cache, g_strdup(schemafilepath), entry);
+
+ out:
+  if (entry)
+    g_atomic_int_inc(&(entry->ref_count));
+
+  g_static_mutex_unlock(&schema_cache_mutex);
+  return entry;
+}
+
 osync_bool osync_xml_validate_document(xmlDocPtr doc, char *schemafilepath)
 {
   int rc = 0;
-  xmlSchemaParserCtxtPtr xmlSchemaParserCtxt = NULL;
-  xmlSchemaPtr xmlSchema = NULL;
+  OSyncXMLSchemaCacheEntry *entry = NULL;
   xmlSchemaValidCtxtPtr xmlSchemaValidCtxt = NULL;
 
   osync_assert(doc);
   osync_assert(schemafilepath);
-	
-  xmlSchemaParserCtxt = xmlSchemaNewParserCtxt(schemafilepath);
-  xmlSchema = xmlSchemaParse(xmlSchemaParserCtxt);
-  xmlSchemaFreeParserCtxt(xmlSchemaParserCtxt);
 
-  xmlSchemaValidCtxt = xmlSchemaNewValidCtxt(xmlSchema);
+  entry = _osync_xml_schema_cache_get(schemafilepath);
+  if (!entry)
+    return FALSE;
+
+  /* A validation context must not be used by two threads at the same time */
+  g_static_mutex_lock(&schema_cache_mutex);
+  if (entry->contexts) {
+    xmlSchemaValidCtxt = entry->contexts->data;
+    entry->contexts = g_slist_delete_link(entry->contexts, entry->contexts);
+  }
+  g_static_mutex_unlock(&schema_cache_mutex);
+
+  if (!xmlSchemaValidCtxt)
+    xmlSchemaValidCtxt = xmlSchemaNewValidCtxt(entry->schema);
+
   if (xmlSchemaValidCtxt == NULL) {
-    xmlSchemaFree(xmlSchema);
     rc = 1;
-  }else{
+  } else {
     /* Validate the document */
     rc = xmlSchemaValidateDoc(xmlSchemaValidCtxt, doc);
-    xmlSchemaFree(xmlSchema);
-    xmlSchemaFreeValidCtxt(xmlSchemaValidCtxt);
+
+    g_static_mutex_lock(&schema_cache_mutex);
+    entry->contexts = g_slist_prepend(entry->contexts, xmlSchemaValidCtxt);
+    g_static_mutex_unlock(&schema_cache_mutex);
   }
 
+  _osync_xml_schema_cache_entry_unref(entry);
+
   if(rc != 0)
     return FALSE;
   return TRUE;
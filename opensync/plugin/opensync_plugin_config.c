@@ -24,6 +24,8 @@
 #include "opensync-plugin.h"
 #include "opensync-format.h"
 
+#include "opensync-ipc.h"
+#include "ipc/opensync_message_internals.h"
 #include "opensync_xml.h"
 
 #include "opensync_plugin_advancedoptions_private.h"	/* FIXME: direct access to private header */
@@ -34,6 +36,7 @@
 #include "opensync_plugin_resource_private.h"		/* FIXME: direct access to private header */
 
 #include "opensync_plugin_config_private.h"
+#include "opensync_plugin_config_internals.h"
 
 static OSyncPluginAdvancedOptionParameter *_osync_plugin_config_parse_advancedoption_param(OSyncPluginAdvancedOption *option, xmlNode *cur, OSyncError **error)
 {
@@ -1556,3 +1559,387 @@ void osync_plugin_config_set_connection(OSyncPluginConfig *config, OSyncPluginCo
   }
 }
 
+/* Snapshot serialization
+ *
+ * Every field gets written, in declaration order of the structs. Optional
+ * objects are preceded by a presence flag, lists by their length.
+ */
+
+static void _osync_plugin_config_snapshot_read_string(OSyncMessage *message, char **field)
+{
+  g_free(*field);
+  osync_message_read_string(message, field);
+}
+
+static void _osync_plugin_config_snapshot_write_strings(OSyncMessage *message, OSyncList *strings)
+{
+  osync_message_write_uint(message, osync_list_length(strings));
+  for (; strings; strings = strings->next)
+    osync_message_write_string(message, strings->data);
+}
+
+static OSyncList *_osync_plugin_config_snapshot_read_strings(OSyncMessage *message)
+{
+  OSyncList *strings = NULL;
+  unsigned int i, num = 0;
+  char *str = NULL;
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    osync_message_read_string(message, &str);
+    strings = osync_list_prepend(strings, str);
+  }
+
+  return osync_list_reverse(strings);
+}
+
+static void _osync_plugin_config_snapshot_write_connection(OSyncMessage *message, OSyncPluginConnection *conn)
+{
+  osync_message_write_int(message, conn->type);
+  osync_message_write_string(message, conn->bt_address);
+  osync_message_write_string(message, conn->bt_sdpuuid);
+  osync_message_write_uint(message, conn->bt_channel);
+  osync_message_write_string(message, conn->usb_vendorid);
+  osync_message_write_string(message, conn->usb_productid);
+  osync_message_write_uint(message, conn->usb_interface);
+  osync_message_write_string(message, conn->net_address);
+  osync_message_write_uint(message, conn->net_port);
+  osync_message_write_string(message, conn->net_protocol);
+  osync_message_write_string(message, conn->net_dnssd);
+  osync_message_write_uint(message, conn->serial_speed);
+  osync_message_write_string(message, conn->serial_devicenode);
+  osync_message_write_string(message, conn->irda_service);
+  osync_message_write_int(message, conn->supported);
+  osync_message_write_int(message, conn->supported_options);
+}
+
+static void _osync_plugin_config_snapshot_read_connection(OSyncMessage *message, OSyncPluginConnection *conn)
+{
+  int value = 0;
+
+  osync_message_read_int(message, &value);
+  conn->type = value;
+  _osync_plugin_config_snapshot_read_string(message, &conn->bt_address);
+  _osync_plugin_config_snapshot_read_string(message, &conn->bt_sdpuuid);
+  osync_message_read_uint(message, &conn->bt_channel);
+  _osync_plugin_config_snapshot_read_string(message, &conn->usb_vendorid);
+  _osync_plugin_config_snapshot_read_string(message, &conn->usb_productid);
+  osync_message_read_uint(message, &conn->usb_interface);
+  _osync_plugin_config_snapshot_read_string(message, &conn->net_address);
+  osync_message_read_uint(message, &conn->net_port);
+  _osync_plugin_config_snapshot_read_string(message, &conn->net_protocol);
+  _osync_plugin_config_snapshot_read_string(message, &conn->net_dnssd);
+  osync_message_read_uint(message, &conn->serial_speed);
+  _osync_plugin_config_snapshot_read_string(message, &conn->serial_devicenode);
+  _osync_plugin_config_snapshot_read_string(message, &conn->irda_service);
+  osync_message_read_int(message, &value);
+  conn->supported = value;
+  osync_message_read_int(message, &value);
+  conn->supported_options = value;
+}
+
+static void _osync_plugin_config_snapshot_write_resource(OSyncMessage *message, OSyncPluginResource *res)
+{
+  OSyncList *s = NULL;
+
+  osync_message_write_int(message, res->enabled);
+  osync_message_write_string(message, res->name);
+  osync_message_write_string(message, res->mime);
+  osync_message_write_string(message, res->objtype);
+  osync_message_write_string(message, res->preferred_format);
+
+  osync_message_write_uint(message, osync_list_length(res->objformatsinks));
+  for (s = res->objformatsinks; s; s = s->next) {
+    osync_message_write_string(message, osync_objformat_sink_get_objformat(s->data));
+    osync_message_write_string(message, osync_objformat_sink_get_config(s->data));
+  }
+
+  osync_message_write_string(message, res->path);
+  osync_message_write_string(message, res->url);
+  osync_message_write_int(message, res->supported_options);
+}
+
+static osync_bool _osync_plugin_config_snapshot_read_resource(OSyncMessage *message, OSyncPluginResource *res, OSyncError **error)
+{
+  OSyncObjFormatSink *sink = NULL;
+  unsigned int i, num = 0;
+  char *objformat = NULL, *config = NULL;
+  int value = 0;
+
+  osync_message_read_int(message, &res->enabled);
+  _osync_plugin_config_snapshot_read_string(message, &res->name);
+  _osync_plugin_config_snapshot_read_string(message, &res->mime);
+  _osync_plugin_config_snapshot_read_string(message, &res->objtype);
+  _osync_plugin_config_snapshot_read_string(message, &res->preferred_format);
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    osync_message_read_string(message, &objformat);
+    osync_message_read_string(message, &config);
+
+    sink = osync_objformat_sink_new(objformat, error);
+    g_free(objformat);
+    if (!sink) {
+      g_free(config);
+      return FALSE;
+    }
+
+    osync_objformat_sink_set_config(sink, config);
+    g_free(config);
+
+    res->objformatsinks = osync_list_append(res->objformatsinks, sink);
+  }
+
+  _osync_plugin_config_snapshot_read_string(message, &res->path);
+  _osync_plugin_config_snapshot_read_string(message, &res->url);
+  osync_message_read_int(message, &value);
+  res->supported_options = value;
+
+  return TRUE;
+}
+
+static void _osync_plugin_config_snapshot_write_advancedoption(OSyncMessage *message, OSyncPluginAdvancedOption *option)
+{
+  OSyncList *p = NULL;
+
+  osync_message_write_string(message, option->displayname);
+  osync_message_write_uint(message, option->maxoccurs);
+  osync_message_write_uint(message, option->max);
+  osync_message_write_uint(message, option->min);
+  osync_message_write_string(message, option->name);
+  osync_message_write_int(message, option->type);
+  _osync_plugin_config_snapshot_write_strings(message, option->valenum);
+  osync_message_write_string(message, option->value);
+
+  osync_message_write_uint(message, osync_list_length(option->parameters));
+  for (p = option->parameters; p; p = p->next) {
+    OSyncPluginAdvancedOptionParameter *param = p->data;
+    osync_message_write_string(message, param->displayname);
+    osync_message_write_string(message, param->name);
+    osync_message_write_int(message, param->type);
+    _osync_plugin_config_snapshot_write_strings(message, param->valenum);
+    osync_message_write_string(message, param->value);
+  }
+}
+
+static osync_bool _osync_plugin_config_snapshot_read_advancedoption(OSyncMessage *message, OSyncPluginAdvancedOption *option, OSyncError **error)
+{
+  OSyncPluginAdvancedOptionParameter *param = NULL;
+  unsigned int i, num = 0;
+  int value = 0;
+
+  _osync_plugin_config_snapshot_read_string(message, &option->displayname);
+  osync_message_read_uint(message, &option->maxoccurs);
+  osync_message_read_uint(message, &option->max);
+  osync_message_read_uint(message, &option->min);
+  _osync_plugin_config_snapshot_read_string(message, &option->name);
+  osync_message_read_int(message, &value);
+  option->type = value;
+  option->valenum = _osync_plugin_config_snapshot_read_strings(message);
+  _osync_plugin_config_snapshot_read_string(message, &option->value);
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    param = osync_plugin_advancedoption_param_new(error);
+    if (!param)
+      return FALSE;
+
+    _osync_plugin_config_snapshot_read_string(message, &param->displayname);
+    _osync_plugin_config_snapshot_read_string(message, &param->name);
+    osync_message_read_int(message, &value);
+    param->type = value;
+    param->valenum = _osync_plugin_config_snapshot_read_strings(message);
+    _osync_plugin_config_snapshot_read_string(message, &param->value);
+
+    option->parameters = osync_list_append(option->parameters, param);
+  }
+
+  return TRUE;
+}
+
+void osync_plugin_config_snapshot_write(OSyncMessage *message, OSyncPluginConfig *config)
+{
+  OSyncList *l = NULL;
+
+  osync_assert(message);
+  osync_assert(config);
+
+  osync_message_write_int(message, config->supported);
+
+  osync_message_write_int(message, config->connection != NULL);
+  if (config->connection)
+    _osync_plugin_config_snapshot_write_connection(message, config->connection);
+
+  osync_message_write_int(message, config->authentication != NULL);
+  if (config->authentication) {
+    osync_message_write_string(message, config->authentication->username);
+    osync_message_write_string(message, config->authentication->password);
+    osync_message_write_string(message, config->authentication->reference);
+    osync_message_write_int(message, config->authentication->supported_options);
+  }
+
+  osync_message_write_int(message, config->localization != NULL);
+  if (config->localization) {
+    osync_message_write_string(message, config->localization->encoding);
+    osync_message_write_string(message, config->localization->timezone);
+    osync_message_write_string(message, config->localization->language);
+    osync_message_write_int(message, config->localization->supported_options);
+  }
+
+  osync_message_write_uint(message, osync_list_length(config->resources));
+  for (l = config->resources; l; l = l->next)
+    _osync_plugin_config_snapshot_write_resource(message, l->data);
+
+  osync_message_write_uint(message, osync_list_length(config->advancedoptions));
+  for (l = config->advancedoptions; l; l = l->next)
+    _osync_plugin_config_snapshot_write_advancedoption(message, l->data);
+}
+
+osync_bool osync_plugin_config_snapshot_read(OSyncMessage *message, OSyncPluginConfig *config, OSyncError **error)
+{
+  OSyncPluginResource *res = NULL;
+  OSyncPluginAdvancedOption *option = NULL;
+  unsigned int i, num = 0;
+  int value = 0;
+
+  osync_assert(message);
+  osync_assert(config);
+
+  osync_message_read_int(message, &value);
+  config->supported = value;
+
+  osync_message_read_int(message, &value);
+  if (value) {
+    config->connection = osync_plugin_connection_new(error);
+    if (!config->connection)
+      goto error;
+    _osync_plugin_config_snapshot_read_connection(message, config->connection);
+  }
+
+  osync_message_read_int(message, &value);
+  if (value) {
+    config->authentication = osync_plugin_authentication_new(error);
+    if (!config->authentication)
+      goto error;
+    _osync_plugin_config_snapshot_read_string(message, &config->authentication->username);
+    _osync_plugin_config_snapshot_read_string(message, &config->authentication->password);
+    _osync_plugin_config_snapshot_read_string(message, &config->authentication->reference);
+    osync_message_read_int(message, &value);
+    config->authentication->supported_options = value;
+  }
+
+  osync_message_read_int(message, &value);
+  if (value) {
+    config->localization = osync_plugin_localization_new(error);
+    if (!config->localization)
+      goto error;
+    _osync_plugin_config_snapshot_read_string(message, &config->localization->encoding);
+    _osync_plugin_config_snapshot_read_string(message, &config->localization->timezone);
+    _osync_plugin_config_snapshot_read_string(message, &config->localization->language);
+    osync_message_read_int(message, &value);
+    config->localization->supported_options = value;
+  }
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    res = osync_plugin_resource_new(error);
+    if (!res)
+      goto error;
+
+    config->resources = osync_list_append(config->resources, res);
+    if (!_osync_plugin_config_snapshot_read_resource(message, res, error))
+      goto error;
+  }
+
+  osync_message_read_uint(message, &num);
+  for (i = 0; i < num; i++) {
+    option = osync_plugin_advancedoption_new(error);
+    if (!option)
+      goto error;
+
+    config->advancedoptions = osync_list_append(config->advancedoptions, option);
+    if (!_osync_plugin_config_snapshot_read_advancedoption(message, option, error))
+      goto error;
+  }
+
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+osync_bool osync_plugin_config_file_load_snapshot(OSyncPluginConfig *config, const char *path, const char *schemadir, const char *snapshot, OSyncError **error)
+{
+  OSyncMessage *message = NULL;
+  char *schemafile = NULL;
+  char *source = NULL;
+  osync_bool uptodate = FALSE;
+  osync_bool stable = TRUE;
+  OSyncError *locerror = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %s, %s, %p)", __func__, config, __NULLSTR(path), __NULLSTR(schemadir), __NULLSTR(snapshot), error);
+
+  schemafile = g_strdup_printf("%s%c%s", schemadir ? schemadir : OPENSYNC_SCHEMASDIR, G_DIR_SEPARATOR, OSYNC_PLUGIN_CONFING_SCHEMA);
+
+  message = osync_message_read_file(snapshot);
+  if (message) {
+    osync_message_read_string(message, &source);
+    uptodate = source && !strcmp(source, path)
+      && osync_message_check_file_stamp(message, path)
+      && osync_message_check_file_stamp(message, schemafile);
+    g_free(source);
+
+    if (uptodate) {
+      if (!osync_plugin_config_snapshot_read(message, config, error))
+        goto error;
+
+      osync_message_unref(message);
+      g_free(schemafile);
+      osync_trace(TRACE_EXIT, "%s: Loaded snapshot", __func__);
+      return TRUE;
+    }
+
+    osync_message_unref(message);
+  }
+
+  if (!osync_plugin_config_file_load(config, path, schemadir, error))
+    goto error_free_schemafile;
+
+  /* Files modified within the timestamp granularity could change again
+   * without the stamp noticing. Don't snapshot them yet. */
+  message = osync_message_new(OSYNC_MESSAGE_NOOP, 0, &locerror);
+  if (!message)
+    goto error_snapshot;
+
+  osync_message_write_string(message, path);
+  stable = osync_message_write_file_stamp(message, path) && stable;
+  stable = osync_message_write_file_stamp(message, schemafile) && stable;
+  osync_plugin_config_snapshot_write(message, config);
+
+  if (stable && !osync_message_write_file(message, snapshot, &locerror))
+    goto error_snapshot;
+
+  osync_message_unref(message);
+  g_free(schemafile);
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error_snapshot:
+  /* The configuration got loaded, only the snapshot is missing */
+  osync_trace(TRACE_INTERNAL, "Unable to write snapshot: %s", osync_error_print(&locerror));
+  osync_error_unref(&locerror);
+  if (message)
+    osync_message_unref(message);
+  g_free(schemafile);
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_message_unref(message);
+ error_free_schemafile:
+  g_free(schemafile);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
@@ -0,0 +1,60 @@
+/*
+ * libopensync - A synchronization framework
+ * Copyright (C) 2008  The OpenSync Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ */
+
+#ifndef _OPENSYNC_PLUGIN_CONFIG_INTERNALS_H_
+#define _OPENSYNC_PLUGIN_CONFIG_INTERNALS_H_
+
+/*! @brief Serializes a complete plugin configuration for a snapshot
+ *
+ * Unlike osync_marshal_pluginconfig() nothing gets dropped, the supported
+ * flags and the settings of inactive connection types included. The
+ * configuration read back is identical to the one parsed from XML.
+ *
+ * @param message The message to append the configuration to
+ * @param config The plugin configuration
+ */
+void osync_plugin_config_snapshot_write(OSyncMessage *message, OSyncPluginConfig *config);
+
+/*! @brief Reads a plugin configuration written by osync_plugin_config_snapshot_write()
+ *
+ * @param message The message to read the configuration from
+ * @param config A new, empty plugin configuration which gets filled
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_plugin_config_snapshot_read(OSyncMessage *message, OSyncPluginConfig *config, OSyncError **error);
+
+/*! @brief Loads a plugin configuration file through a snapshot
+ *
+ * The snapshot is used as long as the configuration file and the schema
+ * file it got validated against are unchanged. Otherwise the file gets
+ * parsed and validated like osync_plugin_config_file_load() does and a new
+ * snapshot is written.
+ *
+ * @param config A new, empty plugin configuration which gets filled
+ * @param path The path of the configuration file
+ * @param schemadir The schema directory or NULL for the default one
+ * @param snapshot The path of the snapshot file
+ * @param error Pointer to an error struct
+ * @returns TRUE on success, FALSE otherwise
+ */
+osync_bool osync_plugin_config_file_load_snapshot(OSyncPluginConfig *config, const char *path, const char *schemadir, const char *snapshot, OSyncError **error);
+
+#endif /* _OPENSYNC_PLUGIN_CONFIG_INTERNALS_H_ */
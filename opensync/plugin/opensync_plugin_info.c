@@ -263,3 +263,19 @@ OSyncCapabilities *osync_plugin_info_get_capabilities(OSyncPluginInfo *info)
   osync_assert(info);
   return info->capabilities;
 }
+
+void osync_plugin_info_set_cancel_flag(OSyncPluginInfo *info, int *flag)
+{
+  osync_assert(info);
+  info->cancel_flag = flag;
+}
+
+osync_bool osync_plugin_info_is_cancelled(OSyncPluginInfo *info)
+{
+  osync_assert(info);
+
+  if (!info->cancel_flag)
+    return FALSE;
+
+  return g_atomic_int_get(info->cancel_flag) ? TRUE : FALSE;
+}
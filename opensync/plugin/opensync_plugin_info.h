@@ -233,6 +233,25 @@ OSYNC_EXPORT void osync_plugin_info_set_capabilities(OSyncPluginInfo *info, OSyn
  */
 OSYNC_EXPORT OSyncCapabilities *osync_plugin_info_get_capabilities(OSyncPluginInfo *info);
 
+/*! @brief Set the flag which tells if the engine cancelled the current requests
+ *
+ * @param info Pointer to the plugin info object
+ * @param flag Pointer to the flag, set by the client when a cancel message arrives
+ */
+OSYNC_EXPORT void osync_plugin_info_set_cancel_flag(OSyncPluginInfo *info, int *flag);
+
+/*! @brief Check if the engine cancelled the requests of the current synchronization
+ *
+ * The flag gets set as soon as the engine aborts the synchronization,
+ * even while a plugin function is still running. Long running loops,
+ * like reporting thousands of changes, should check it and report an
+ * error once it is set.
+ *
+ * @param info Pointer to the plugin info object
+ * @returns TRUE if the synchronization got cancelled, FALSE otherwise
+ */
+OSYNC_EXPORT osync_bool osync_plugin_info_is_cancelled(OSyncPluginInfo *info);
+
 /*@}*/
 
 #endif /*OPENSYNC_PLUGIN_INFO_H_*/
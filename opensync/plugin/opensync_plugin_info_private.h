@@ -37,6 +37,8 @@ struct OSyncPluginInfo {
 	char *groupname;
 	OSyncVersion *version;
 	OSyncCapabilities *capabilities;
+	/** Set by the client once the engine cancelled the synchronization, may be NULL */
+	int *cancel_flag;
 
 #ifdef OPENSYNC_UNITTESTS
 	long long int memberid; // introduced only for testing purpose (mock-sync)
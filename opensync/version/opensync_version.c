@@ -211,6 +211,516 @@ OSyncList *osync_version_load_from_descriptions(OSyncError **error, const char *
   return NULL;
 }
 
+#ifndef _WIN32
+static void _osync_version_regerror(int ret, regex_t *preg, OSyncError **error)
+{
+  char *errbuf = NULL;
+  size_t errbuf_size = regerror(ret, preg, NULL, 0);
+
+  errbuf = osync_try_malloc0(errbuf_size, error);
+  if (!errbuf)
+    return;
+
+  regerror(ret, preg, errbuf, errbuf_size);
+  osync_error_set(error, OSYNC_ERROR_GENERIC, "%s", errbuf);
+  g_free(errbuf);
+}
+#endif
+
+static const char *_osync_version_get_field(OSyncVersion *version, int field)
+{
+  switch (field) {
+  case 0:
+    return version->plugin;
+  case 1:
+    return version->vendor;
+  case 2:
+    return version->modelversion;
+  case 3:
+    return version->firmwareversion;
+  case 4:
+    return version->softwareversion;
+  case 5:
+    return version->hardwareversion;
+  }
+  return NULL;
+}
+
+static void _osync_version_pattern_free(OSyncVersionPattern *pattern)
+{
+#ifndef _WIN32
+  int i;
+
+  for (i = 0; i < OSYNC_VERSION_DB_NUM_FIELDS; i++) {
+    if (pattern->compiled[i])
+      regfree(&pattern->regex[i]);
+  }
+#endif
+
+  osync_version_unref(pattern->version);
+  g_free(pattern);
+}
+
+/* Returns 1 on match, 0 if not matching and -1 on error */
+static int _osync_version_pattern_match(OSyncVersionPattern *pattern, OSyncVersion *version, OSyncError **error)
+{
+#ifndef _WIN32
+  const char *string = NULL;
+  int i, ret;
+
+  for (i = 0; i < OSYNC_VERSION_DB_NUM_FIELDS; i++) {
+    if (!pattern->compiled[i])
+      continue;
+
+    string = _osync_version_get_field(version, i);
+    ret = regexec(&pattern->regex[i], string ? string : "", 0, NULL, 0);
+    if (ret == REG_NOMATCH)
+      return 0;
+
+    if (ret) {
+      _osync_version_regerror(ret, &pattern->regex[i], error);
+      return -1;
+    }
+  }
+#endif
+
+  return 1;
+}
+
+/* Identifies the state of the description directory and the schema. NULL if
+ * the directory doesn't exist. */
+static char *_osync_version_db_stamp(const char *descpath, const char *schemapath)
+{
+  struct stat st;
+  GString *stamp = NULL;
+  GDir *dir = NULL;
+  const gchar *de = NULL;
+  char *filename = NULL;
+
+  if (g_stat(descpath, &st) < 0)
+    return NULL;
+
+  dir = g_dir_open(descpath, 0, NULL);
+  if (!dir)
+    return NULL;
+
+  stamp = g_string_new(descpath);
+  g_string_append_printf(stamp, ":%ld", (long)st.st_mtime);
+
+  filename = g_strdup_printf("%s%c%s", schemapath, G_DIR_SEPARATOR, "descriptions.xsd");
+  if (!g_stat(filename, &st))
+    g_string_append_printf(stamp, ":%ld", (long)st.st_mtime);
+  g_free(filename);
+
+  /* Files edited in place don't change the mtime of the directory */
+  while ((de = g_dir_read_name(dir))) {
+    if (!g_pattern_match_simple("*.xml", de))
+      continue;
+
+    filename = g_strdup_printf("%s%c%s", descpath, G_DIR_SEPARATOR, de);
+    if (!g_stat(filename, &st) && S_ISREG(st.st_mode))
+      g_string_append_printf(stamp, ":%s/%ld/%lld", de, (long)st.st_mtime, (long long)st.st_size);
+    g_free(filename);
+  }
+
+  g_dir_close(dir);
+
+  return g_string_free(stamp, FALSE);
+}
+
+static const char *_osync_version_db_cache_keys[] = {
+  "Plugin",
+  "Priority",
+  "Vendor",
+  "ModelVersion",
+  "FirmwareVersion",
+  "SoftwareVersion",
+  "HardwareVersion",
+  "Identifier",
+  NULL
+};
+
+static void (*_osync_version_db_cache_setters[])(OSyncVersion *, const char *) = {
+  osync_version_set_plugin,
+  osync_version_set_priority,
+  osync_version_set_vendor,
+  osync_version_set_modelversion,
+  osync_version_set_firmwareversion,
+  osync_version_set_softwareversion,
+  osync_version_set_hardwareversion,
+  osync_version_set_identifier
+};
+
+/* Loads the descriptions from the cache file if it got written for the same stamp */
+static osync_bool _osync_version_db_load_cache(OSyncVersionDB *db, const char *cachefile, const char *stamp, OSyncError **error)
+{
+  GKeyFile *keyfile = NULL;
+  char **groups = NULL;
+  char *cached_stamp = NULL;
+  OSyncVersion *version = NULL;
+  osync_bool ret = FALSE;
+  int i, j;
+
+  keyfile = g_key_file_new();
+  if (!g_key_file_load_from_file(keyfile, cachefile, G_KEY_FILE_NONE, NULL))
+    goto end;
+
+  cached_stamp = g_key_file_get_string(keyfile, "VersionDB", "Stamp", NULL);
+  if (!cached_stamp || strcmp(cached_stamp, stamp))
+    goto end;
+
+  groups = g_key_file_get_groups(keyfile, NULL);
+  for (i = 0; groups[i]; i++) {
+    if (!strcmp(groups[i], "VersionDB"))
+      continue;
+
+    version = osync_version_new(error);
+    if (!version)
+      goto end;
+
+    for (j = 0; _osync_version_db_cache_keys[j]; j++) {
+      char *value = g_key_file_get_string(keyfile, groups[i], _osync_version_db_cache_keys[j], NULL);
+      _osync_version_db_cache_setters[j](version, value);
+      g_free(value);
+    }
+
+    if (!osync_version_db_add(db, version, error)) {
+      osync_version_unref(version);
+      goto end;
+    }
+    osync_version_unref(version);
+  }
+
+  ret = TRUE;
+
+ end:
+  g_strfreev(groups);
+  g_free(cached_stamp);
+  g_key_file_free(keyfile);
+  return ret;
+}
+
+static void _osync_version_db_save_cache(OSyncList *versions, const char *cachefile, const char *stamp)
+{
+  GKeyFile *keyfile = NULL;
+  GError *gerror = NULL;
+  OSyncList *v = NULL;
+  char *data = NULL, *dirname = NULL;
+  gsize length = 0;
+  int i = 0, j;
+
+  keyfile = g_key_file_new();
+  g_key_file_set_string(keyfile, "VersionDB", "Stamp", stamp);
+
+  for (v = versions; v; v = v->next) {
+    OSyncVersion *version = v->data;
+    const char *values[] = {version->plugin, version->priority, version->vendor, version->modelversion,
+                            version->firmwareversion, version->softwareversion, version->hardwareversion,
+                            version->identifier};
+    char *group = g_strdup_printf("Version %i", i++);
+
+    for (j = 0; _osync_version_db_cache_keys[j]; j++) {
+      if (values[j])
+        g_key_file_set_string(keyfile, group, _osync_version_db_cache_keys[j], values[j]);
+    }
+    g_free(group);
+  }
+
+  data = g_key_file_to_data(keyfile, &length, NULL);
+  g_key_file_free(keyfile);
+
+  dirname = g_path_get_dirname(cachefile);
+  g_mkdir_with_parents(dirname, 0700);
+  g_free(dirname);
+
+  if (!g_file_set_contents(cachefile, data, length, &gerror)) {
+    osync_trace(TRACE_INTERNAL, "Unable to write version description cache %s: %s", cachefile, gerror->message);
+    g_error_free(gerror);
+  }
+
+  g_free(data);
+}
+
+static osync_bool _osync_version_db_load_stamped(OSyncVersionDB *db, const char *descpath, const char *schemapath, const char *cachefile, char *stamp, OSyncError **error)
+{
+  OSyncList *versions = NULL, *v = NULL;
+
+  if (!stamp)
+    return TRUE;
+
+  if (cachefile && _osync_version_db_load_cache(db, cachefile, stamp, error)) {
+    osync_trace(TRACE_INTERNAL, "Loaded version descriptions from cache %s", cachefile);
+    goto end;
+  }
+
+  if (osync_error_is_set(error))
+    goto error;
+
+  versions = osync_version_load_from_descriptions(error, descpath, schemapath);
+  if (osync_error_is_set(error))
+    goto error;
+
+  for (v = versions; v; v = v->next) {
+    if (!osync_version_db_add(db, v->data, error))
+      goto error_free_versions;
+  }
+
+  if (cachefile)
+    _osync_version_db_save_cache(versions, cachefile, stamp);
+
+  for (v = versions; v; v = v->next)
+    osync_version_unref(v->data);
+  osync_list_free(versions);
+
+ end:
+  g_free(db->stamp);
+  db->stamp = stamp;
+  return TRUE;
+
+ error_free_versions:
+  for (v = versions; v; v = v->next)
+    osync_version_unref(v->data);
+  osync_list_free(versions);
+ error:
+  g_free(stamp);
+  return FALSE;
+}
+
+/**
+ * @brief Creates a new, empty version description database
+ *
+ * @param error Pointer to error-struct
+ * @returns Pointer to the new database, NULL on error
+ */
+OSyncVersionDB *osync_version_db_new(OSyncError **error)
+{
+  OSyncVersionDB *db = osync_try_malloc0(sizeof(OSyncVersionDB), error);
+  if (!db)
+    return NULL;
+
+  db->ref_count = 1;
+  return db;
+}
+
+OSyncVersionDB *osync_version_db_ref(OSyncVersionDB *db)
+{
+  osync_assert(db);
+
+  g_atomic_int_inc(&(db->ref_count));
+
+  return db;
+}
+
+void osync_version_db_unref(OSyncVersionDB *db)
+{
+  osync_assert(db);
+
+  if (g_atomic_int_dec_and_test(&(db->ref_count))) {
+    while (db->patterns) {
+      _osync_version_pattern_free(db->patterns->data);
+      db->patterns = osync_list_delete_link(db->patterns, db->patterns);
+    }
+
+    g_free(db->stamp);
+    g_free(db);
+  }
+}
+
+/**
+ * @brief Compiles the patterns of a version description and adds it to the database
+ *
+ * Descriptions without a positive priority can never match and get ignored.
+ *
+ * @param db Pointer to the database
+ * @param pattern The version object which acts as pattern
+ * @param error Pointer to error-struct
+ * @returns TRUE on success, FALSE if a pattern doesn't compile
+ */
+osync_bool osync_version_db_add(OSyncVersionDB *db, OSyncVersion *pattern, OSyncError **error)
+{
+  OSyncVersionPattern *compiled = NULL;
+  OSyncList *cur = NULL, *prev = NULL;
+  int priority;
+#ifndef _WIN32
+  const char *field = NULL;
+  int i, ret;
+#endif
+
+  osync_assert(db);
+  osync_assert(pattern);
+
+  priority = pattern->priority ? atoi(pattern->priority) : 0;
+  if (priority <= 0)
+    return TRUE;
+
+  compiled = osync_try_malloc0(sizeof(OSyncVersionPattern), error);
+  if (!compiled)
+    goto error;
+
+  compiled->version = osync_version_ref(pattern);
+  compiled->priority = priority;
+
+#ifndef _WIN32
+  for (i = 0; i < OSYNC_VERSION_DB_NUM_FIELDS; i++) {
+    field = _osync_version_get_field(pattern, i);
+    if (!field || !strlen(field))
+      continue;
+
+    ret = regcomp(&compiled->regex[i], field, 0);
+    if (ret) {
+      _osync_version_regerror(ret, &compiled->regex[i], error);
+      regfree(&compiled->regex[i]);
+      goto error_free_pattern;
+    }
+    compiled->compiled[i] = TRUE;
+  }
+#endif
+
+  /* Keep the list ordered by priority, first added wins on equal priority */
+  for (cur = db->patterns; cur; cur = cur->next) {
+    if (((OSyncVersionPattern *)cur->data)->priority < priority)
+      break;
+    prev = cur;
+  }
+
+  if (prev)
+    osync_list_insert_before(db->patterns, prev->next, compiled);
+  else
+    db->patterns = osync_list_prepend(db->patterns, compiled);
+
+  return TRUE;
+
+ error_free_pattern:
+  _osync_version_pattern_free(compiled);
+ error:
+  osync_trace(TRACE_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+/**
+ * @brief Loads the version descriptions of a directory into the database
+ *
+ * If a cache file is given and it got written for the current state of the
+ * description directory, the descriptions get loaded from there without
+ * parsing and validating the XML files. Otherwise the cache file gets
+ * (re)written.
+ *
+ * @param db Pointer to the database
+ * @param descriptiondir Path to description directory
+ * @param schemadir Path to XML schema directory
+ * @param cachefile Path to the cache file or NULL
+ * @param error Pointer to error-struct
+ * @returns TRUE on success, FALSE on error
+ */
+osync_bool osync_version_db_load(OSyncVersionDB *db, const char *descriptiondir, const char *schemadir, const char *cachefile, OSyncError **error)
+{
+  const char *descpath = descriptiondir ? descriptiondir : OPENSYNC_DESCRIPTIONSDIR; 
+  const char *schemapath = schemadir ? schemadir : OPENSYNC_SCHEMASDIR; 
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %s, %s, %p)", __func__, db, __NULLSTR(descriptiondir), __NULLSTR(schemadir), __NULLSTR(cachefile), error);
+  osync_assert(db);
+
+  if (!_osync_version_db_load_stamped(db, descpath, schemapath, cachefile, _osync_version_db_stamp(descpath, schemapath), error))
+    goto error;
+
+  osync_trace(TRACE_EXIT, "%s", __func__);
+  return TRUE;
+
+ error:
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return FALSE;
+}
+
+/**
+ * @brief Finds the version description with the highest priority matching a version
+ *
+ * @param db Pointer to the database
+ * @param version The version (original) object supplied to find a fitting version pattern
+ * @param error Pointer to error-struct
+ * @returns The matching version description (the caller is responsible for unref),
+ * NULL if none matches or on error
+ */
+OSyncVersion *osync_version_db_find(OSyncVersionDB *db, OSyncVersion *version, OSyncError **error)
+{
+  OSyncList *cur = NULL;
+  int ret;
+
+  osync_assert(db);
+  osync_assert(version);
+
+  for (cur = db->patterns; cur; cur = cur->next) {
+    OSyncVersionPattern *pattern = cur->data;
+
+    ret = _osync_version_pattern_match(pattern, version, error);
+    if (ret < 0)
+      return NULL;
+
+    if (ret > 0)
+      return osync_version_ref(pattern->version);
+  }
+
+  return NULL;
+}
+
+static GStaticMutex default_db_mutex = G_STATIC_MUTEX_INIT;
+static OSyncVersionDB *default_db = NULL;
+
+/**
+ * @brief Gets the database of the default description directory
+ *
+ * The database is shared by the whole process and only gets reloaded if
+ * the description directory changed. Other processes pick it up from the
+ * cache file in the user cache directory.
+ *
+ * @param error Pointer to error-struct
+ * @returns Pointer to the database (the caller is responsible for unref), NULL on error
+ */
+OSyncVersionDB *osync_version_db_get_default(OSyncError **error)
+{
+  OSyncVersionDB *db = NULL;
+  char *stamp = NULL, *cachefile = NULL;
+
+  osync_trace(TRACE_ENTRY, "%s(%p)", __func__, error);
+
+  stamp = _osync_version_db_stamp(OPENSYNC_DESCRIPTIONSDIR, OPENSYNC_SCHEMASDIR);
+
+  g_static_mutex_lock(&default_db_mutex);
+
+  if (default_db && ((!stamp && !default_db->stamp) || (stamp && default_db->stamp && !strcmp(stamp, default_db->stamp)))) {
+    g_free(stamp);
+    db = osync_version_db_ref(default_db);
+    goto end;
+  }
+
+  db = osync_version_db_new(error);
+  if (!db) {
+    g_free(stamp);
+    goto error;
+  }
+
+  cachefile = g_build_filename(g_get_user_cache_dir(), "opensync", "descriptions.cache", NULL);
+  if (!_osync_version_db_load_stamped(db, OPENSYNC_DESCRIPTIONSDIR, OPENSYNC_SCHEMASDIR, cachefile, stamp, error)) {
+    g_free(cachefile);
+    osync_version_db_unref(db);
+    goto error;
+  }
+  g_free(cachefile);
+
+  if (default_db)
+    osync_version_db_unref(default_db);
+  default_db = osync_version_db_ref(db);
+
+ end:
+  g_static_mutex_unlock(&default_db_mutex);
+  osync_trace(TRACE_EXIT, "%s: %p", __func__, db);
+  return db;
+
+ error:
+  g_static_mutex_unlock(&default_db_mutex);
+  osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+  return NULL;
+}
+
 /*@}*/
 
 /**
@@ -571,47 +1081,24 @@ OSyncList *osync_version_load_from_default_descriptions(OSyncError **error)
  */
 OSyncCapabilities *osync_version_find_capabilities(OSyncVersion *version, OSyncError **error)
 {
-  int priority = -1;
   OSyncVersion *winner = NULL;
   OSyncCapabilities *capabilities = NULL;
-  OSyncList *versions = NULL;
-  OSyncList *cur = NULL;
+  OSyncVersionDB *db = NULL;
 
   osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, version, error);
   osync_assert(version);
 
-  versions = osync_version_load_from_default_descriptions(error);
-  if (*error) /* versions can be null */
+  db = osync_version_db_get_default(error);
+  if (!db)
     goto error;
 
-  cur = osync_list_first(versions);
-  while(cur) {
-    int curpriority = osync_version_matches(cur->data, version, error);
-    if (curpriority == -1) {
-      if (versions)
-        osync_list_free(versions);
-
-      if (winner)
-        osync_version_unref(winner);
-
-      goto error;
-    }
-
-    if( curpriority > 0 && curpriority > priority) {
-      if(winner)
-        osync_version_unref(winner);
-
-      winner = cur->data;
-      osync_version_ref(winner);
-      priority = curpriority;
-    }
-    osync_version_unref(cur->data);
-    cur = cur->next;
-  }
-  osync_list_free(versions);
+  winner = osync_version_db_find(db, version, error);
+  osync_version_db_unref(db);
+  if (osync_error_is_set(error))
+    goto error;
 	
   /* we found or own capabilities */
-  if(priority > 0)
+  if(winner)
     {
       osync_trace(TRACE_INTERNAL, "Found capabilities file by version: %s ", (const char*)osync_version_get_identifier(winner));
 
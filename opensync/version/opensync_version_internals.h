@@ -39,5 +39,18 @@ char *osync_version_get_identifier(OSyncVersion *version);
 
 OSYNC_TEST_EXPORT int osync_version_matches(OSyncVersion *pattern, OSyncVersion *version, OSyncError **error);
 
+/*! @brief Database of version descriptions with precompiled patterns */
+typedef struct OSyncVersionDB OSyncVersionDB;
+
+OSYNC_TEST_EXPORT OSyncVersionDB *osync_version_db_new(OSyncError **error);
+OSYNC_TEST_EXPORT OSyncVersionDB *osync_version_db_ref(OSyncVersionDB *db);
+OSYNC_TEST_EXPORT void osync_version_db_unref(OSyncVersionDB *db);
+
+OSYNC_TEST_EXPORT osync_bool osync_version_db_add(OSyncVersionDB *db, OSyncVersion *pattern, OSyncError **error);
+OSYNC_TEST_EXPORT osync_bool osync_version_db_load(OSyncVersionDB *db, const char *descriptiondir, const char *schemadir, const char *cachefile, OSyncError **error);
+OSYNC_TEST_EXPORT OSyncVersion *osync_version_db_find(OSyncVersionDB *db, OSyncVersion *version, OSyncError **error);
+
+OSyncVersionDB *osync_version_db_get_default(OSyncError **error);
+
 #endif /* OPENSYNC_VERSION_INTERNALS_H_ */
 
@@ -40,5 +40,28 @@ struct OSyncVersion{
 	char *identifier;
 };
 
+#define OSYNC_VERSION_DB_NUM_FIELDS	6
+
+/*! @brief A version description with its patterns compiled */
+typedef struct OSyncVersionPattern {
+	OSyncVersion *version;
+	int priority;
+#ifndef _WIN32
+	/** Compiled patterns of plugin, vendor, model-, firmware-, software-
+	 * and hardwareversion. Empty patterns match everything and don't get compiled. */
+	regex_t regex[OSYNC_VERSION_DB_NUM_FIELDS];
+	osync_bool compiled[OSYNC_VERSION_DB_NUM_FIELDS];
+#endif
+} OSyncVersionPattern;
+
+struct OSyncVersionDB {
+	/** The reference counter for this object */
+	int ref_count;
+	/** List of OSyncVersionPattern, highest priority first */
+	OSyncList *patterns;
+	/** Identifies the state of the description directory the patterns got loaded from */
+	char *stamp;
+};
+
 #endif /* OPENSYNC_VERSION_PRIVATE_H_ */
 
@@ -49,6 +49,7 @@ OSyncXMLField *osync_xmlfield_new_node(OSyncXMLFormat *xmlformat, xmlNodePtr nod
     xmlformat->last_child->next = xmlfield;
   xmlformat->last_child = xmlfield;
   xmlformat->child_count++;
+  osync_xmlformat_invalidate_index(xmlformat);
 
   // We don't know if the parsed xmlformat got sorted xmlfield -> unsorted
   xmlfield->sorted = FALSE;
@@ -78,6 +79,7 @@ void osync_xmlfield_unlink(OSyncXMLField *xmlfield)
   xmlfield->next = NULL;
   xmlfield->prev = NULL;
   ((OSyncXMLFormat *)xmlfield->node->doc->_private)->child_count--;
+  osync_xmlformat_invalidate_index((OSyncXMLFormat *)xmlfield->node->doc->_private);
 }
 
 int osync_xmlfield_compare_stdlib(const void *xmlfield1, const void *xmlfield2)
@@ -117,6 +119,7 @@ void osync_xmlfield_adopt_xmlfield_before_field(OSyncXMLField *xmlfield, OSyncXM
     ((OSyncXMLFormat *)xmlfield->node->doc->_private)->first_child = to_link;
   xmlfield->prev = to_link;
   ((OSyncXMLFormat *)xmlfield->node->doc->_private)->child_count++;
+  osync_xmlformat_invalidate_index((OSyncXMLFormat *)xmlfield->node->doc->_private);
 }
 
 void osync_xmlfield_adopt_xmlfield_after_field(OSyncXMLField *xmlfield, OSyncXMLField *to_link)
@@ -138,6 +141,7 @@ void osync_xmlfield_adopt_xmlfield_after_field(OSyncXMLField *xmlfield, OSyncXML
     ((OSyncXMLFormat *)xmlfield->node->doc->_private)->last_child = to_link;
   xmlfield->next = to_link;
   ((OSyncXMLFormat *)xmlfield->node->doc->_private)->child_count++;
+  osync_xmlformat_invalidate_index((OSyncXMLFormat *)xmlfield->node->doc->_private);
 }
 
 OSyncXMLField *osync_xmlfield_new(OSyncXMLFormat *xmlformat, const char *name, OSyncError **error)
@@ -181,6 +185,7 @@ void osync_xmlfield_set_name(OSyncXMLField *xmlfield, const char *name)
   osync_assert(name);
 
   xmlNodeSetName(xmlfield->node, BAD_CAST name);	
+  osync_xmlformat_invalidate_index((OSyncXMLFormat *)xmlfield->node->doc->_private);
 }
 
 OSyncXMLField *osync_xmlfield_get_next(OSyncXMLField *xmlfield)
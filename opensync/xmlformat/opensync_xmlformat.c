@@ -135,6 +135,7 @@ void osync_xmlformat_unref(OSyncXMLFormat *xmlformat)
         cur = tmp;
       }
     osync_xml_free_doc(xmlformat->doc);
+    g_free(xmlformat->index);
     g_free(xmlformat);
   }
 }
@@ -146,20 +147,60 @@ OSyncXMLField *osync_xmlformat_get_first_field(OSyncXMLFormat *xmlformat)
   return xmlformat->first_child;
 }
 
-OSyncXMLFieldList *osync_xmlformat_search_field(OSyncXMLFormat *xmlformat, const char *name, OSyncError **error, ...)
+static osync_bool _osync_xmlformat_build_index(OSyncXMLFormat *xmlformat, OSyncError **error)
 {
-  int index;
-  void *ret;
-  OSyncXMLField *cur, *key, *res;
-  OSyncXMLFieldList *xmlfieldlist = NULL;
-  void **liste = NULL;
-  osync_bool all_attr_equal;
+  OSyncXMLField *cur;
+  int index = 0;
+
+  if (xmlformat->index_valid)
+    return TRUE;
+
+  /* Only grow the index, it gets rebuilt after each change of the xmlfields */
+  if (xmlformat->index_size < xmlformat->child_count) {
+    OSyncXMLField **newindex = osync_try_malloc0(sizeof(OSyncXMLField *) * xmlformat->child_count, error);
+    if (!newindex)
+      return FALSE;
+
+    g_free(xmlformat->index);
+    xmlformat->index = newindex;
+    xmlformat->index_size = xmlformat->child_count;
+  }
+
+  cur = osync_xmlformat_get_first_field(xmlformat);
+  for (; cur != NULL; cur = osync_xmlfield_get_next(cur))
+    xmlformat->index[index++] = cur;
+
+  xmlformat->index_valid = TRUE;
+  return TRUE;
+}
+
+/* Binary search of the first xmlfield with the given name in the index */
+static int _osync_xmlformat_lower_bound(OSyncXMLFormat *xmlformat, const char *name)
+{
+  int low = 0, high = xmlformat->child_count;
+
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (strcmp(osync_xmlfield_get_name(xmlformat->index[mid]), name) < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+OSyncXMLField *osync_xmlformat_search_field_range(OSyncXMLFormat *xmlformat, const char *name, unsigned int *count, OSyncError **error)
+{
+  int first, last;
 
-  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, ...)", __func__, xmlformat, name, error);
   osync_assert(xmlformat);
   osync_assert(name);
-	
-  /* Searching breaks if the xmlformat is not sorted (bsearch!).
+  osync_assert(count);
+
+  *count = 0;
+
+  /* Searching breaks if the xmlformat is not sorted (binary search!).
      ASSERT in development builds (when NDEBUG is not defined) - see ticket #754. */
   osync_assert(xmlformat->sorted);
   if (!xmlformat->sorted) {
@@ -167,42 +208,50 @@ OSyncXMLFieldList *osync_xmlformat_search_field(OSyncXMLFormat *xmlformat, const
     goto error;
   }
 
-  xmlfieldlist = osync_xmlfieldlist_new(error);
-  if (!xmlfieldlist)
+  if (!_osync_xmlformat_build_index(xmlformat, error))
     goto error;
 
-  liste = osync_try_malloc0(sizeof(OSyncXMLField *) * xmlformat->child_count, error);
-  if (!liste)
-    goto error;
+  first = _osync_xmlformat_lower_bound(xmlformat, name);
+  for (last = first; last < xmlformat->child_count && !strcmp(osync_xmlfield_get_name(xmlformat->index[last]), name); last++) ;
 
-  index = 0;
-  cur = osync_xmlformat_get_first_field(xmlformat);
-  for (; cur != NULL; cur = osync_xmlfield_get_next(cur)) {
-    liste[index] = cur;
-    index++;
-  }
+  if (first == last)
+    return NULL;
 
-  key = osync_try_malloc0(sizeof(OSyncXMLField), error);
-  if (!key) {
-    g_free(liste);
-    goto error;
-  }
+  *count = last - first;
+  return xmlformat->index[first];
 
-  key->node = xmlNewNode(NULL, BAD_CAST name);
-	
-  ret = bsearch(&key, liste, xmlformat->child_count, sizeof(OSyncXMLField *), osync_xmlfield_compare_stdlib);
+ error:
+  osync_trace(TRACE_ERROR, "%s: %s" , __func__, osync_error_print(error));
+  return NULL;
+}
 
-  /* no result - return empty xmlfieldlist */
-  if (!ret)
-    goto end;
+OSyncXMLFieldList *osync_xmlformat_search_field(OSyncXMLFormat *xmlformat, const char *name, OSyncError **error, ...)
+{
+  OSyncXMLField *cur;
+  OSyncXMLFieldList *xmlfieldlist = NULL;
+  unsigned int count = 0;
+  osync_bool all_attr_equal;
+
+  osync_trace(TRACE_ENTRY, "%s(%p, %s, %p, ...)", __func__, xmlformat, name, error);
+  osync_assert(xmlformat);
+  osync_assert(name);
+
+  /* see ticket #754 */
+  osync_assert(xmlformat->sorted);
+  if (!xmlformat->sorted) {
+    osync_error_set(error, OSYNC_ERROR_GENERIC, "XMLFormat is unsorted. Search result would be not valid.");
+    goto error;
+  }
 
-  /* if ret is valid pointer (not NULL!) - reference it here. avoid segfaults */
-  res = *(OSyncXMLField **) ret;
+  cur = osync_xmlformat_search_field_range(xmlformat, name, &count, error);
+  if (!cur && osync_error_is_set(error))
+    goto error;
 
-  /* we set the cur ptr to the first field from the fields with name name because -> bsearch -> more than one field with the same name*/
-  for (cur = res; cur->prev != NULL && !strcmp(osync_xmlfield_get_name(cur->prev), name); cur = cur->prev) ;
+  xmlfieldlist = osync_xmlfieldlist_new(error);
+  if (!xmlfieldlist)
+    goto error;
 
-  for (; cur != NULL && !strcmp(osync_xmlfield_get_name(cur), name); cur = cur->next) {
+  for (; count > 0; cur = cur->next, count--) {
     const char *attr, *value;
     va_list args;
     all_attr_equal = TRUE;
@@ -222,12 +271,6 @@ OSyncXMLFieldList *osync_xmlformat_search_field(OSyncXMLFormat *xmlformat, const
       osync_xmlfieldlist_add(xmlfieldlist, cur);
   }
 
- end:	
-  /* free lists here (later) - bsearch result is still pointing in liste array */
-  xmlFreeNode(key->node);
-  g_free(key);
-  g_free(liste);
-
   osync_trace(TRACE_EXIT, "%s: %p", __func__, xmlfieldlist);
   return xmlfieldlist;
 
@@ -246,6 +289,15 @@ osync_bool osync_xmlformat_assemble(OSyncXMLFormat *xmlformat, char **buffer, un
   return TRUE;	
 }
 
+void osync_xmlformat_assemble_compact(OSyncXMLFormat *xmlformat, char **buffer, unsigned int *size)
+{
+  osync_assert(xmlformat);
+  osync_assert(buffer);
+  osync_assert(size);
+	
+  xmlDocDumpFormatMemoryEnc(xmlformat->doc, (xmlChar **)buffer, (int *)size, NULL, 0);
+}
+
 void osync_xmlformat_sort(OSyncXMLFormat *xmlformat)
 {
   int index;
@@ -290,7 +342,11 @@ void osync_xmlformat_sort(OSyncXMLFormat *xmlformat)
     else
       cur->prev = NULL;
   }
-  g_free(list);
+  /* the sorted list becomes the search index */
+  g_free(xmlformat->index);
+  xmlformat->index = (OSyncXMLField **)list;
+  xmlformat->index_size = xmlformat->child_count;
+  xmlformat->index_valid = TRUE;
 
  end:	
   xmlformat->sorted = TRUE;
@@ -327,10 +383,18 @@ void osync_xmlformat_set_unsorted(OSyncXMLFormat *xmlformat)
   osync_assert(xmlformat);
 
   xmlformat->sorted = FALSE;
+  xmlformat->index_valid = FALSE;
 
   osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
+void osync_xmlformat_invalidate_index(OSyncXMLFormat *xmlformat)
+{
+  osync_assert(xmlformat);
+
+  xmlformat->index_valid = FALSE;
+}
+
 osync_bool osync_xmlformat_copy(OSyncXMLFormat *source, OSyncXMLFormat **destination, OSyncError **error)
 {
   char *buffer = NULL;
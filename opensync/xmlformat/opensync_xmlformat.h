@@ -83,6 +83,23 @@ OSYNC_EXPORT OSyncXMLField *osync_xmlformat_get_first_field(OSyncXMLFormat *xmlf
  */
 OSYNC_EXPORT OSyncXMLFieldList *osync_xmlformat_search_field(OSyncXMLFormat *xmlformat, const char *name, OSyncError **error, ...);
 
+/**
+ * @brief Get all xmlfields with the given name of a sorted xmlformat
+ *
+ *  The xmlfields with the same name are neighbours in a sorted xmlformat.
+ *  The range starts with the returned xmlfield and consists of count
+ *  xmlfields, which can be iterated with osync_xmlfield_get_next().
+ *  Unlike osync_xmlformat_search_field() this doesn't allocate anything.
+ *
+ * @param xmlformat The pointer to the xmlformat object
+ * @param name The name of the xmlfields to search for
+ * @param count Returns the number of xmlfields in the range
+ * @param error The error which will hold the info in case of an error
+ * @return The first xmlfield of the range, or NULL if there is no xmlfield
+ *  with this name or in case of error
+ */
+OSYNC_EXPORT OSyncXMLField *osync_xmlformat_search_field_range(OSyncXMLFormat *xmlformat, const char *name, unsigned int *count, OSyncError **error);
+
 /**
  * @brief Dump the xmlformat into a buffer.
  * @param xmlformat The pointer to the xmlformat object 
@@ -46,12 +46,35 @@ const char *osync_xmlformat_root_name(OSyncXMLFormat *xmlformat);
 const char *osync_xmlformat_get_objtype(OSyncXMLFormat *xmlformat);
 
 
+/**
+ * @brief Dump the xmlformat into a buffer without indentation
+ *
+ *  Like osync_xmlformat_assemble(), but without the whitespace only
+ *  needed by human readers. Used for data which gets stored.
+ *
+ * @param xmlformat The pointer to a xmlformat object
+ * @param buffer The pointer to the buffer which will hold the xml document. It is up 
+ *  to the caller to free this buffer.
+ * @param size The pointer to the buffer which will hold the size of the xml document
+ */
+void osync_xmlformat_assemble_compact(OSyncXMLFormat *xmlformat, char **buffer, unsigned int *size);
+
 /**
  * @brief Mark/Taint the xmlformat as unsorted
  * @param xmlformat The pointer to a xmlformat object
  */
 void osync_xmlformat_set_unsorted(OSyncXMLFormat *xmlformat);
 
+/**
+ * @brief Mark the search index of the xmlformat as outdated
+ *
+ *  Must be called whenever xmlfields get added, removed or renamed.
+ *  The index gets rebuilt with the next search.
+ *
+ * @param xmlformat The pointer to a xmlformat object
+ */
+void osync_xmlformat_invalidate_index(OSyncXMLFormat *xmlformat);
+
 /*@}*/
 
 #endif /* OPENSYNC_XMLFORMAT_INTERNAL_H_ */
@@ -42,6 +42,12 @@ struct OSyncXMLFormat {
 	xmlDocPtr doc;
 	/** sorted status of xmlformat */
 	osync_bool sorted;
+	/** The xmlfields in list order, used to search the sorted xmlformat */
+	OSyncXMLField **index;
+	/** Number of allocated entries of the index */
+	int index_size;
+	/** FALSE if the xmlfields got changed since the index got built */
+	osync_bool index_valid;
 
 };
 
@@ -2,7 +2,9 @@
 
 #include <opensync/opensync.h>
 #include <opensync/opensync-archive.h>
+#include <opensync/opensync-db.h>
 #include "archive/opensync_archive_internals.h"
+#include "archive/opensync_archive_private.h"
 
 
 START_TEST (archive_new)
@@ -182,6 +184,284 @@ START_TEST (archive_load_data_with_closing_db)
 }
 END_TEST
 
+START_TEST (archive_load_data_compressed)
+{
+	char *testbed = setup_testbed("merger");
+
+	OSyncError *error = NULL;
+	OSyncArchive *archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	long long int id = osync_archive_save_change(archive, 0, "uid", "contact", 1, 1, &error);
+	fail_unless(id != 0, NULL);
+	fail_unless(error == NULL, NULL);
+
+	GString *testdata = g_string_new("");
+	int i;
+	for (i = 0; i < 100; i++)
+		g_string_append_printf(testdata, "<Telephone><Content>%i</Content></Telephone>", i);
+
+	fail_unless(osync_archive_save_data(archive, 1, "contact", testdata->str, testdata->len, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_archive_unref(archive);
+	archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+
+	char *buffer;
+	unsigned int size;
+	fail_unless(osync_archive_load_data(archive, "uid", "contact", &buffer, &size, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(size == testdata->len, NULL);
+	fail_unless(memcmp(buffer, testdata->str, size) == 0, NULL);
+
+	g_free(buffer);
+	g_string_free(testdata, TRUE);
+
+	osync_archive_unref(archive);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (archive_recompact)
+{
+	char *testbed = setup_testbed("merger");
+
+	OSyncError *error = NULL;
+	OSyncArchive *archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Nothing stored yet */
+	fail_unless(osync_archive_recompact(archive, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	long long int id = osync_archive_save_change(archive, 0, "uid1", "contact", 1, 1, &error);
+	fail_unless(id != 0, NULL);
+	id = osync_archive_save_change(archive, 0, "uid2", "contact", 2, 1, &error);
+	fail_unless(id != 0, NULL);
+
+	/* Indented, like the entries of older versions */
+	const char *testdata = "<?xml version=\"1.0\"?>\n<contact>\n  <Name>\n    <FirstName>John</FirstName>\n  </Name>\n</contact>\n";
+
+	/* Older versions stored the plain data, without any header */
+	fail_unless(osync_db_bind_blob(archive->db, "REPLACE INTO tbl_archive (objtype, mappingid, data) VALUES('contact', 1, ?)", testdata, strlen(testdata), &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_archive_set_compression(archive, FALSE);
+	fail_unless(osync_archive_save_data(archive, 2, "contact", testdata, strlen(testdata), &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+
+	char *buffer;
+	unsigned int size;
+	fail_unless(osync_archive_load_data(archive, "uid1", "contact", &buffer, &size, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(size == strlen(testdata), NULL);
+	fail_unless(memcmp(buffer, testdata, size) == 0, NULL);
+	g_free(buffer);
+
+	osync_archive_set_compression(archive, TRUE);
+	fail_unless(osync_archive_recompact(archive, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* The legacy entry got rewritten with the header */
+	fail_unless(osync_db_get_blob(archive->db, "SELECT data FROM tbl_archive WHERE objtype='contact' AND mappingid=1", &buffer, &size, &error) == 1, NULL);
+	fail_unless(size >= OSYNC_ARCHIVE_HEADER_SIZE, NULL);
+	fail_unless(memcmp(buffer, OSYNC_ARCHIVE_MAGIC, OSYNC_ARCHIVE_MAGIC_SIZE) == 0, NULL);
+	g_free(buffer);
+
+	fail_unless(osync_archive_load_data(archive, "uid1", "contact", &buffer, &size, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(size < strlen(testdata), NULL);
+	fail_unless(strstr(buffer, "<contact><Name><FirstName>John</FirstName></Name></contact>") != NULL, NULL);
+	g_free(buffer);
+
+	fail_unless(osync_archive_load_data(archive, "uid2", "contact", &buffer, &size, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(size < strlen(testdata), NULL);
+	fail_unless(strstr(buffer, "<contact><Name><FirstName>John</FirstName></Name></contact>") != NULL, NULL);
+	g_free(buffer);
+
+	osync_archive_unref(archive);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+static int num_foreach_changes = 0;
+
+static osync_bool archive_foreach_change_cb(long long int id, const char *uid, long long int mappingid, long long int memberid, void *userdata, OSyncError **error)
+{
+	fail_unless(userdata == &num_foreach_changes, NULL);
+
+	/* Ordered by mappingid */
+	if (num_foreach_changes == 0) {
+		fail_unless(!strcmp(uid, "uid2"), NULL);
+		fail_unless(mappingid == 2, NULL);
+	} else {
+		fail_unless(!strcmp(uid, "uid1"), NULL);
+		fail_unless(mappingid == 5000000000LL, NULL);
+		fail_unless(memberid == 6000000000LL, NULL);
+	}
+
+	num_foreach_changes++;
+	return TRUE;
+}
+
+START_TEST (archive_foreach_change)
+{
+	char *testbed = setup_testbed("merger");
+
+	OSyncError *error = NULL;
+	OSyncArchive *archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	long long int id = osync_archive_save_change(archive, 0, "uid1", "contact", 5000000000LL, 6000000000LL, &error);
+	fail_unless(id != 0, NULL);
+	fail_unless(error == NULL, NULL);
+
+	id = osync_archive_save_change(archive, 0, "uid2", "contact", 2, 1, &error);
+	fail_unless(id != 0, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_archive_foreach_change(archive, "contact", archive_foreach_change_cb, &num_foreach_changes, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(num_foreach_changes == 2, NULL);
+
+	osync_archive_unref(archive);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+static int num_checkpoint_entries = 0;
+
+static osync_bool archive_checkpoint_cb(long long int mappingid, long long int memberid, const char *signature, void *userdata, OSyncError **error)
+{
+	fail_unless(userdata == &num_checkpoint_entries, NULL);
+
+	if (mappingid == 1) {
+		fail_unless(memberid == 2, NULL);
+		fail_unless(!strcmp(signature, "1:1:hash"), NULL);
+	} else {
+		fail_unless(mappingid == 5000000000LL, NULL);
+		fail_unless(memberid == 1, NULL);
+		fail_unless(signature == NULL, NULL);
+	}
+
+	num_checkpoint_entries++;
+	return TRUE;
+}
+
+START_TEST (archive_checkpoint)
+{
+	char *testbed = setup_testbed("merger");
+	osync_bool slowsync = FALSE;
+
+	OSyncError *error = NULL;
+	OSyncArchive *archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_archive_load_checkpoint(archive, "contact", &slowsync, archive_checkpoint_cb, &num_checkpoint_entries, &error) == 0, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_archive_begin_checkpoint(archive, "contact", TRUE, &error), NULL);
+	fail_unless(osync_archive_save_checkpoint_entry(archive, "contact", 1, 2, "1:1:hash", &error), NULL);
+	fail_unless(osync_archive_save_checkpoint_entry(archive, "contact", 5000000000LL, 1, NULL, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Interrupted */
+	osync_archive_unref(archive);
+	archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+
+	fail_unless(osync_archive_load_checkpoint(archive, "event", &slowsync, archive_checkpoint_cb, &num_checkpoint_entries, &error) == 0, NULL);
+	fail_unless(osync_archive_load_checkpoint(archive, "contact", &slowsync, archive_checkpoint_cb, &num_checkpoint_entries, &error) == 1, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(slowsync == TRUE, NULL);
+	fail_unless(num_checkpoint_entries == 2, NULL);
+
+	/* Resumed as fast sync, the written entries are kept */
+	fail_unless(osync_archive_begin_checkpoint(archive, "contact", FALSE, &error), NULL);
+	num_checkpoint_entries = 0;
+	fail_unless(osync_archive_load_checkpoint(archive, "contact", &slowsync, archive_checkpoint_cb, &num_checkpoint_entries, &error) == 1, NULL);
+	fail_unless(slowsync == FALSE, NULL);
+	fail_unless(num_checkpoint_entries == 2, NULL);
+
+	fail_unless(osync_archive_flush_checkpoint(archive, "contact", &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(osync_archive_load_checkpoint(archive, "contact", &slowsync, archive_checkpoint_cb, &num_checkpoint_entries, &error) == 0, NULL);
+
+	osync_archive_unref(archive);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (archive_writer)
+{
+	char *testbed = setup_testbed("merger");
+
+	OSyncError *error = NULL;
+	OSyncArchive *archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_archive_start_writer(archive, TRUE, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	long long int id1 = osync_archive_save_change(archive, 0, "uid1", "contact", 1, 1, &error);
+	long long int id2 = osync_archive_save_change(archive, 0, "uid2", "contact", 2, 1, &error);
+	fail_unless(id1 != 0, NULL);
+	fail_unless(id2 != 0 && id2 != id1, NULL);
+	fail_unless(error == NULL, NULL);
+
+	const char *testdata = "testdata";
+	unsigned int testsize = strlen(testdata);
+	fail_unless(osync_archive_save_data(archive, 1, "contact", testdata, testsize, &error) == TRUE, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Reads wait for the queued writes */
+	char *buffer;
+	unsigned int size;
+	fail_unless(osync_archive_load_data(archive, "uid1", "contact", &buffer, &size, &error) == 1, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(size == testsize, NULL);
+	fail_unless(memcmp(buffer, testdata, testsize) == 0, NULL);
+	g_free(buffer);
+
+	fail_unless(osync_archive_sync(archive, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_archive_unref(archive);
+
+	/* Everything made it to the disk */
+	archive = osync_archive_new("archive.db", &error);
+	fail_unless(archive != NULL, NULL);
+
+	OSyncList *ids;
+	OSyncList *uids;
+	OSyncList *mappingids;
+	OSyncList *memberids;
+	fail_unless(osync_archive_load_changes(archive, "contact", &ids, &uids, &mappingids, &memberids, &error), NULL);
+	fail_unless(osync_list_length(ids) == 2, NULL);
+
+	osync_list_free(ids);
+	osync_list_foreach(uids, (GFunc)g_free, NULL);
+	osync_list_free(uids);
+	osync_list_free(mappingids);
+	osync_list_free(memberids);
+
+	osync_archive_unref(archive);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
 Suite *archive_suite(void)
 {
 	Suite *s = suite_create("Archive");
@@ -191,6 +471,11 @@ Suite *archive_suite(void)
 	create_case(s, "archive_save_data", archive_save_data);
 	create_case(s, "archive_load_data", archive_load_data);
 	create_case(s, "archive_load_data_with_closing_db", archive_load_data_with_closing_db);
+	create_case(s, "archive_foreach_change", archive_foreach_change);
+	create_case(s, "archive_load_data_compressed", archive_load_data_compressed);
+	create_case(s, "archive_recompact", archive_recompact);
+	create_case(s, "archive_checkpoint", archive_checkpoint);
+	create_case(s, "archive_writer", archive_writer);
 	return s;
 }
 
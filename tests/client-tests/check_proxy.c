@@ -264,6 +264,79 @@ START_TEST (proxy_connect)
 }
 END_TEST
 
+START_TEST (proxy_pool_reuse)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	char *plugindir = g_strdup_printf("%s/plugins",  testbed);
+
+	OSyncFormatEnv *formatenv = osync_testing_load_formatenv(formatdir);
+	
+	OSyncError *error = NULL;
+	OSyncThread *thread = osync_thread_new(NULL, &error);
+	fail_unless(thread != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_thread_start(thread);
+	
+	OSyncClientPool *pool = osync_client_pool_new(&error);
+	fail_unless(pool != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	int i;
+	for (i = 0; i < 3; i++) {
+		/* The third session belongs to another group and must not get the pooled client */
+		const char *groupname = i < 2 ? "test" : "test2";
+		
+		OSyncClientProxy *proxy = osync_client_proxy_new(formatenv, NULL, &error);
+		fail_unless(proxy != NULL, NULL);
+		fail_unless(error == NULL, NULL);
+		
+		osync_client_proxy_set_pool(proxy, pool);
+		
+		fail_unless(osync_client_proxy_spawn(proxy, OSYNC_START_TYPE_THREAD, NULL, &error), NULL);
+		fail_unless(error == NULL, NULL);
+		
+		OSyncPluginConfig *config = simple_plugin_config(NULL, "data1", "mockobjtype1", "mockformat1", NULL);
+		fail_unless(osync_client_proxy_initialize(proxy, initialize_callback, GINT_TO_POINTER(1), formatdir, plugindir, "mock-sync", groupname, testbed, config, &error), NULL);
+		osync_plugin_config_unref(config);
+		fail_unless(error == NULL, NULL);
+		
+		while (init_replies != i + 1) { g_usleep(100); }
+		
+		/* The second session leased the client of the first one */
+		fail_unless(osync_client_pool_num_idle(pool) == (i == 2 ? 1 : 0), NULL);
+		
+		fail_unless(osync_client_proxy_finalize(proxy, finalize_callback, GINT_TO_POINTER(1), &error), NULL);
+		fail_unless(error == NULL, NULL);
+		
+		while (fin_replies != i + 1) { g_usleep(100); }
+		
+		fail_unless(osync_client_proxy_shutdown(proxy, &error), NULL);
+		fail_unless(error == NULL, NULL);
+		
+		osync_client_proxy_unref(proxy);
+		
+		fail_unless(osync_client_pool_num_idle(pool) == (i == 2 ? 2 : 1), NULL);
+	}
+	
+	osync_client_pool_set_max_idle(pool, 1);
+	fail_unless(osync_client_pool_num_idle(pool) == 1, NULL);
+	
+	osync_client_pool_flush(pool);
+	fail_unless(osync_client_pool_num_idle(pool) == 0, NULL);
+	
+	osync_client_pool_unref(pool);
+	
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	osync_thread_stop(thread);
+	osync_thread_free(thread);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
 Suite *proxy_suite(void)
 {
 	Suite *s = suite_create("Proxy");
@@ -274,6 +347,7 @@ Suite *proxy_suite(void)
 	create_case(s, "proxy_init", proxy_init);
 	create_case(s, "proxy_discover", proxy_discover);
 	create_case(s, "proxy_connect", proxy_connect);
+	create_case(s, "proxy_pool_reuse", proxy_pool_reuse);
 	
 	return s;
 }
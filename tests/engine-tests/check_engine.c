@@ -10,6 +10,10 @@
 
 #include "opensync/engine/opensync_engine_internals.h"
 #include "opensync/engine/opensync_engine_private.h"
+#include "opensync/engine/opensync_engine_host_internals.h"
+
+#include "opensync/format/opensync_filter_internals.h"
+#include "opensync/format/opensync_filter_private.h"
 
 #include "opensync/group/opensync_member_internals.h"
 #include "opensync/client/opensync_client_internals.h"
@@ -32,6 +36,41 @@ static void _member_add_format(OSyncMember *member, const char *objtype, const c
        osync_member_add_objformat(member, objtype, objformat);
 }
 
+START_TEST (engine_bitset)
+{
+	OSyncBitset done, errors;
+	unsigned int i;
+
+	memset(&done, 0, sizeof(done));
+	memset(&errors, 0, sizeof(errors));
+
+	fail_unless(osync_bitset_count(&done) == 0, NULL);
+	fail_unless(!osync_bitset_test(&done, 100), NULL);
+
+	/* More positions than fit into a single word */
+	for (i = 0; i < 200; i += 2)
+		fail_unless(osync_bitset_set(&done, i), NULL);
+	fail_unless(!osync_bitset_set(&done, 198), NULL);
+	fail_unless(osync_bitset_count(&done) == 100, NULL);
+	fail_unless(osync_bitset_test(&done, 64), NULL);
+	fail_unless(!osync_bitset_test(&done, 65), NULL);
+
+	for (i = 100; i < 300; i++)
+		osync_bitset_set(&errors, i);
+	fail_unless(osync_bitset_count(&errors) == 200, NULL);
+	fail_unless(osync_bitset_count_union(&done, &errors) == 250, NULL);
+	fail_unless(osync_bitset_count_union(&errors, &done) == 250, NULL);
+
+	osync_bitset_reset(&done);
+	fail_unless(osync_bitset_count(&done) == 0, NULL);
+	fail_unless(!osync_bitset_test(&done, 64), NULL);
+	fail_unless(osync_bitset_count_union(&done, &errors) == 200, NULL);
+
+	osync_bitset_clear(&done);
+	osync_bitset_clear(&errors);
+}
+END_TEST
+
 START_TEST (engine_new)
 {
 	char *testbed = setup_testbed(NULL);
@@ -671,6 +710,193 @@ START_TEST (engine_sync_multi_obj)
 }
 END_TEST
 
+/* Pipelined, mockobjtype3 keeps reading until mockobjtype1 got through sync_done.
+   The object types only overlap if mockobjtype1 doesn't wait for mockobjtype3. */
+static int num_pipelined_overlaps = 0;
+static int num_pipelined_early_writes = 0;
+
+static void get_changes_held(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
+{
+	mock_env *env = data;
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, data, info, ctx);
+	
+	osync_assert(env->num_connect == 3);
+	osync_assert(env->main_get_changes == 0);
+	
+	g_atomic_int_inc(&(env->num_get_changes));
+	
+	env->ctx[0] = ctx;
+	osync_context_ref(ctx);
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+static void committed_all_pipelined(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
+{
+	mock_env *env = data;
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, data, info, ctx);
+	
+	/* The write has to wait for the main sink */
+	if (!env->main_get_changes)
+		g_atomic_int_inc(&num_pipelined_early_writes);
+	
+	osync_context_report_success(ctx);
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+static void sync_done_pipelined(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
+{
+	mock_env *env = data;
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, data, info, ctx);
+	
+	g_atomic_int_inc(&(env->num_sync_done));
+	
+	/* mockobjtype3 is still reading, let it finish */
+	if (env->ctx[0]) {
+		g_atomic_int_inc(&num_pipelined_overlaps);
+		osync_context_report_success(env->ctx[0]);
+		osync_context_unref(env->ctx[0]);
+		env->ctx[0] = NULL;
+	}
+	
+	osync_context_report_success(ctx);
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+static void *initialize_pipelined(OSyncPlugin *plugin, OSyncPluginInfo *info, OSyncError **error)
+{
+	osync_trace(TRACE_ENTRY, "%s(%p, %p)", __func__, info, error);
+
+	mock_env *env = osync_try_malloc0(sizeof(mock_env), error);
+	if (!env)
+		goto error;
+
+	OSyncObjTypeSink *sink = osync_objtype_sink_new("mockobjtype1", error);
+	if (!sink)
+		goto error;
+	
+	OSyncObjFormatSink *format_sink = osync_objformat_sink_new("mockformat1", error);
+	osync_objtype_sink_add_objformat_sink(sink, format_sink);
+	osync_objformat_sink_unref(format_sink);
+	
+	OSyncObjTypeSinkFunctions functions;
+	memset(&functions, 0, sizeof(functions));
+	functions.connect = connect2;
+	functions.disconnect = disconnect2;
+	functions.get_changes = get_changes2;
+	functions.committed_all = committed_all_pipelined;
+	functions.sync_done = sync_done_pipelined;
+	
+	osync_objtype_sink_set_functions(sink, functions, NULL);
+	osync_plugin_info_add_objtype(info, sink);
+	osync_objtype_sink_unref(sink);
+	
+	sink = osync_objtype_sink_new("mockobjtype2", error);
+	if (!sink)
+		goto error;
+	
+	format_sink = osync_objformat_sink_new("vcard", error);
+	osync_objtype_sink_add_objformat_sink(sink, format_sink);
+	osync_objformat_sink_unref(format_sink);
+	
+	memset(&functions, 0, sizeof(functions));
+	functions.connect = connect2;
+	functions.disconnect = disconnect2;
+	functions.get_changes = get_changes2;
+	functions.committed_all = committed_all_pipelined;
+	
+	osync_objtype_sink_set_functions(sink, functions, NULL);
+	osync_plugin_info_add_objtype(info, sink);
+	osync_objtype_sink_unref(sink);
+	
+	sink = osync_objtype_sink_new("mockobjtype3", error);
+	if (!sink)
+		goto error;
+	
+	format_sink = osync_objformat_sink_new("plain", error);
+	osync_objtype_sink_add_objformat_sink(sink, format_sink);
+	osync_objformat_sink_unref(format_sink);
+
+	memset(&functions, 0, sizeof(functions));
+	functions.connect = connect2;
+	functions.disconnect = disconnect2;
+	functions.get_changes = get_changes_held;
+	functions.committed_all = committed_all_pipelined;
+	
+	osync_objtype_sink_set_functions(sink, functions, NULL);
+	osync_plugin_info_add_objtype(info, sink);
+	osync_objtype_sink_unref(sink);
+	
+	/* The main sink */
+	sink = osync_objtype_main_sink_new(error);
+	if (!sink)
+		goto error;
+	
+	memset(&functions, 0, sizeof(functions));
+	functions.connect = main_connect2;
+	functions.disconnect = main_disconnect2;
+	functions.get_changes = main_get_changes2;
+	
+	osync_objtype_sink_set_functions(sink, functions, NULL);
+	osync_plugin_info_set_main_sink(info, sink);
+	osync_objtype_sink_unref(sink);
+	
+	osync_trace(TRACE_EXIT, "%s: %p", __func__, env);
+	return (void *)env;
+
+error:
+	osync_trace(TRACE_EXIT_ERROR, "%s: %s", __func__, osync_error_print(error));
+	return NULL;
+}
+
+START_TEST (engine_sync_multi_obj_pipelined)
+{
+	char *testbed = setup_testbed("sync_setup");
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	
+	OSyncError *error = NULL;
+	OSyncDebugGroup *debug = _create_group2(testbed);
+	osync_plugin_set_initialize(debug->plugin, initialize_pipelined);
+
+	num_pipelined_overlaps = 0;
+	num_pipelined_early_writes = 0;
+
+	OSyncEngine *engine = osync_engine_new(debug->group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_engine_set_formatdir(engine, formatdir);
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_pipelined(engine, TRUE);
+
+	_engine_instrument_pluginenv(engine, debug);
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* mockobjtype1 finished on both members while mockobjtype3 was still reading */
+	fail_unless(num_pipelined_overlaps == 2, NULL);
+	/* No object type wrote before the main sinks got read */
+	fail_unless(num_pipelined_early_writes == 0, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	_free_group(debug);
+	
+	osync_engine_unref(engine);
+	
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+
+}
+END_TEST
+
 static void connect3(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
 {
 	mock_env *env = data;
@@ -1307,6 +1533,179 @@ START_TEST (engine_sync_reuse)
 }
 END_TEST
 
+START_TEST (engine_sync_host)
+{
+	char *testbed = setup_testbed("sync_setup");
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	
+	OSyncError *error = NULL;
+	OSyncDebugGroup *debug = _create_group4(testbed);
+
+	OSyncEngineHost *host = osync_engine_host_new(NULL, formatdir, 1, &error);
+	fail_unless(host != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	OSyncEngine *engine1 = osync_engine_new_with_host(debug->group, host, &error);
+	fail_unless(engine1 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_engine_set_schemadir(engine1, testbed);
+
+	OSyncEngine *engine2 = osync_engine_new_with_host(debug->group, host, &error);
+	fail_unless(engine2 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_engine_set_schemadir(engine2, testbed);
+
+	/* Both engines get dispatched by the single thread of the host */
+	fail_unless(osync_engine_host_num_engines(host) == 2, NULL);
+	fail_unless(engine1->context == engine2->context, NULL);
+	fail_unless(engine1->thread == NULL, NULL);
+
+	_engine_instrument_pluginenv(engine1, debug);
+	
+	fail_unless(osync_engine_initialize(engine1, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(engine1->formatenv == osync_engine_host_get_format_env(host), NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine1, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine1, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	osync_engine_unref(engine1);
+	fail_unless(osync_engine_host_num_engines(host) == 1, NULL);
+
+	/* The finalized engine left the environments of the host loaded */
+	fail_unless(osync_engine_host_get_format_env(host) != NULL, NULL);
+
+	osync_engine_unref(engine2);
+	fail_unless(osync_engine_host_num_engines(host) == 0, NULL);
+
+	osync_engine_host_unref(host);
+	
+	_free_group(debug);
+	
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+static gpointer _engine_sync_thread(gpointer data)
+{
+	OSyncEngine *engine = data;
+	OSyncError *error = NULL;
+
+	if (!osync_engine_synchronize_and_block(engine, &error)) {
+		osync_error_unref(&error);
+		return GINT_TO_POINTER(FALSE);
+	}
+
+	return GINT_TO_POINTER(TRUE);
+}
+
+START_TEST (engine_sync_host_filter)
+{
+	char *testbed = setup_testbed("filter_sync_custom");
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	char *plugindir = g_strdup_printf("%s/plugins",  testbed);
+	char *configdir = g_strdup_printf("%s/.opensync",  testbed);
+	OSyncCustomFilter *custom_filter = NULL;
+	OSyncGroup *groups[2];
+	OSyncEngine *engines[2];
+	GThread *threads[2];
+	int i;
+
+	/* A second group with its own data */
+	osync_testing_system_abort("cp -R configs/group configs/group2");
+	osync_testing_system_abort("cp -R data1 data3");
+	osync_testing_system_abort("cp -R data2 data4");
+	osync_testing_system_abort("sed 's/data1/data3/' configs/group/1/mock-sync.conf > configs/group2/1/mock-sync.conf");
+	osync_testing_system_abort("sed 's/data2/data4/' configs/group/2/mock-sync.conf > configs/group2/2/mock-sync.conf");
+
+	/* The host gets placeholders from the format cache written here */
+	fail_unless(!g_mkdir(configdir, 0700), NULL);
+	g_setenv("HOME", testbed, TRUE);
+	OSyncFormatEnv *formatenv = osync_testing_load_formatenv(formatdir);
+	osync_format_env_free(formatenv);
+
+	OSyncError *error = NULL;
+	OSyncEngineHost *host = osync_engine_host_new(plugindir, formatdir, 2, &error);
+	fail_unless(host != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* The format plugins got loaded before the threads of the host started */
+	formatenv = osync_engine_host_get_format_env(host);
+	for (i = 0; i < osync_format_env_num_filters(formatenv); i++) {
+		OSyncCustomFilter *filter = osync_format_env_nth_filter(formatenv, i);
+		fail_unless(filter->cache_module == NULL, NULL);
+		if (!strcmp(filter->name, "mockformat1_uid"))
+			custom_filter = filter;
+	}
+	fail_unless(custom_filter != NULL, NULL);
+	fail_unless(custom_filter->hook != NULL, NULL);
+
+	for (i = 0; i < 2; i++) {
+		groups[i] = osync_group_new(&error);
+		fail_unless(groups[i] != NULL, NULL);
+		fail_unless(error == NULL, NULL);
+
+		osync_group_set_schemadir(groups[i], testbed);
+		osync_group_load(groups[i], i ? "configs/group2" : "configs/group", &error);
+		fail_unless(error == NULL, osync_error_print(&error));
+
+		/* Each group denies another one of its entries */
+		OSyncFilter *filter = osync_filter_new_custom(custom_filter, i ? "testdata2" : "testdata", OSYNC_FILTER_DENY, &error);
+		fail_unless(filter != NULL, NULL);
+		osync_group_add_filter(groups[i], filter);
+		osync_filter_unref(filter);
+
+		engines[i] = osync_engine_new_with_host(groups[i], host, &error);
+		fail_unless(engines[i] != NULL, NULL);
+		fail_unless(error == NULL, NULL);
+
+		osync_engine_set_plugindir(engines[i], plugindir);
+		osync_engine_set_formatdir(engines[i], formatdir);
+		osync_engine_set_schemadir(engines[i], testbed);
+
+		fail_unless(osync_engine_initialize(engines[i], &error), NULL);
+		fail_unless(error == NULL, NULL);
+	}
+
+	/* Each engine got its own thread of the host */
+	fail_unless(engines[0]->context != engines[1]->context, NULL);
+
+	for (i = 0; i < 2; i++) {
+		threads[i] = g_thread_create(_engine_sync_thread, engines[i], TRUE, NULL);
+		fail_unless(threads[i] != NULL, NULL);
+	}
+
+	for (i = 0; i < 2; i++)
+		fail_unless(GPOINTER_TO_INT(g_thread_join(threads[i])), NULL);
+
+	for (i = 0; i < 2; i++) {
+		fail_unless(osync_engine_finalize(engines[i], &error), NULL);
+		fail_unless(error == NULL, NULL);
+		osync_engine_unref(engines[i]);
+		osync_group_unref(groups[i]);
+	}
+
+	fail_unless(osync_engine_host_num_engines(host) == 0, NULL);
+	osync_engine_host_unref(host);
+
+	/* The first group denied testdata, the second one testdata2 */
+	fail_unless(!osync_testing_file_exists("data2/testdata"), NULL);
+	fail_unless(osync_testing_file_exists("data1/testdata2"), NULL);
+	fail_unless(osync_testing_file_exists("data4/testdata"), NULL);
+	fail_unless(!osync_testing_file_exists("data3/testdata2"), NULL);
+
+	g_free(configdir);
+	g_free(plugindir);
+	g_free(formatdir);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
 START_TEST (engine_sync_stress)
 {
 	int n = 1000;
@@ -1990,12 +2389,16 @@ Suite *engine_suite(void)
 	Suite *s = suite_create("Engine");
 //	Suite *s2 = suite_create("Engine");
 	
+	create_case(s, "engine_bitset", engine_bitset);
 	create_case(s, "engine_new", engine_new);
 	create_case(s, "engine_init", engine_init);
 	create_case(s, "engine_sync", engine_sync);
 	create_case(s, "engine_sync_multi_obj", engine_sync_multi_obj);
+	create_case(s, "engine_sync_multi_obj_pipelined", engine_sync_multi_obj_pipelined);
 	create_case(s, "engine_sync_out_of_order", engine_sync_out_of_order);
 	create_case(s, "engine_sync_reuse", engine_sync_reuse);
+	create_case(s, "engine_sync_host", engine_sync_host);
+	create_case(s, "engine_sync_host_filter", engine_sync_host_filter);
 	create_case(s, "engine_sync_stress", engine_sync_stress);
 
 	create_case(s, "engine_sync_read_write_stress", engine_sync_read_write_stress);
@@ -1,5 +1,8 @@
 #include "support.h"
 #include "engine_support.h"
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
 
 #include "opensync/engine/opensync_engine_internals.h"
 #include "opensync/engine/opensync_engine_private.h"
@@ -1752,6 +1755,69 @@ START_TEST (get_changes_timeout_and_error)
 }
 END_TEST
 
+START_TEST (get_changes_hang_deadline)
+{
+	char *testbed = setup_testbed("multisync_conflict_data_choose2");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	GTimer *timer = NULL;
+	
+	g_setenv("GET_CHANGES_HANG", "2", TRUE);
+	g_setenv("NO_COMMITTED_ALL_CHECK", "1", TRUE);
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	osync_group_set_schemadir(group, testbed);
+	osync_group_load(group, "configs/group", &error);
+	fail_unless(error == NULL, NULL);
+
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	osync_engine_set_deadline(engine, 2);
+	osync_engine_set_abort_timeout(engine, 1);
+
+	discover_all_once(engine, &error);
+
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_modified, GINT_TO_POINTER(3));
+
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	/* The second member never returns from get_changes. Neither the
+	   synchronization nor the finalization may wait for it. */
+	timer = g_timer_new();
+	
+	fail_unless(!synchronize_once(engine, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	fail_unless(osync_error_is_set(&error), NULL);
+	fail_unless(g_timer_elapsed(timer, NULL) < 10, NULL);
+	
+	osync_error_unref(&error);
+	osync_engine_finalize(engine, &error);
+	osync_engine_unref(engine);
+	
+	fail_unless(g_timer_elapsed(timer, NULL) < 15, NULL);
+	g_timer_destroy(timer);
+
+	fail_unless(num_engine_errors == 1, NULL);
+	fail_unless(num_engine_successful == 0, NULL);
+	fail_unless(num_change_written == 0, NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
 /* FIXME */
 #if 0 
 START_TEST (get_changes_timeout_sleep)
@@ -1884,6 +1950,200 @@ START_TEST (single_commit_error)
 }
 END_TEST
 
+#ifndef _WIN32
+static int num_engine_resumed_slowsync = 0;
+
+/* Records whether the object engines slow-sync once they connected */
+static void engine_status_slowsync(OSyncEngineUpdate *status, void *user_data)
+{
+	OSyncEngine *engine = user_data;
+	GList *o = NULL;
+
+	if (status->type == OSYNC_ENGINE_EVENT_CONNECTED) {
+		for (o = engine->object_engines; o; o = o->next) {
+			if (osync_obj_engine_get_slowsync(o->data))
+				num_engine_resumed_slowsync++;
+		}
+	}
+
+	engine_status(status, NULL);
+}
+
+/* Runs a synchronization which fails to commit to the third member in a
+   child process. The child exits like an interrupted frontend, without
+   unlocking the group: it leaves the stale lock and the checkpoint behind. */
+static void _commit_error_interrupt(const char *testbed, const char *formatdir, const char *plugindir)
+{
+	int status = 0;
+	pid_t cpid = fork();
+	fail_unless(cpid >= 0, NULL);
+
+	if (cpid == 0) { //Child
+		OSyncError *error = NULL;
+		OSyncGroup *group = osync_group_new(&error);
+		osync_group_set_schemadir(group, testbed);
+		osync_group_load(group, "configs/group", &error);
+		fail_unless(error == NULL, NULL);
+
+		g_setenv("COMMIT_ERROR", "4", TRUE);
+
+		OSyncEngine *engine = osync_engine_new(group, &error);
+		fail_unless(engine != NULL, NULL);
+
+		osync_engine_set_schemadir(engine, testbed);
+		osync_engine_set_plugindir(engine, plugindir);
+		osync_engine_set_formatdir(engine, formatdir);
+
+		osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+		osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+		osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+		osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+		osync_engine_set_conflict_callback(engine, conflict_handler_choose_modified, GINT_TO_POINTER(3));
+
+		if (!osync_engine_initialize(engine, &error))
+			exit(1);
+
+		if (synchronize_once(engine, &error))
+			exit(1);
+		osync_error_unref(&error);
+
+		osync_engine_finalize(engine, &error);
+		osync_engine_unref(engine);
+
+		/* Written to the second member, failed for the third one */
+		if (num_change_written != 3 || num_change_error != 3 || num_engine_errors != 1)
+			exit(1);
+
+		exit(0);
+	}
+
+	fail_unless(waitpid(cpid, &status, 0) == cpid, NULL);
+	fail_unless(WIFEXITED(status), NULL);
+	fail_unless(WEXITSTATUS(status) == 0, NULL);
+
+	fail_unless(g_file_test("configs/group/lock", G_FILE_TEST_EXISTS), NULL);
+	fail_unless(osync_testing_diff("data1", "data2"));
+	fail_unless(!system("test \"x$(diff -x \".*\" data1 data3)\" != \"x\""), NULL);
+}
+
+/* Resumes the synchronization interrupted by _commit_error_interrupt() */
+static void _commit_error_resume(const char *testbed, const char *formatdir, const char *plugindir)
+{
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	osync_group_set_schemadir(group, testbed);
+	osync_group_load(group, "configs/group", &error);
+	fail_unless(error == NULL, NULL);
+
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status_slowsync, engine);
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_modified, GINT_TO_POINTER(3));
+
+	num_engine_prev_unclean = 0;
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(num_engine_prev_unclean == 1, NULL);
+
+	num_engine_resumed_slowsync = 0;
+	fail_unless(synchronize_once(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	osync_engine_unref(engine);
+	osync_group_unref(group);
+
+	fail_unless(!g_file_test("configs/group/lock", G_FILE_TEST_EXISTS), NULL);
+}
+
+START_TEST (commit_error_resume)
+{
+	char *testbed = setup_testbed("multisync_easy_new");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	if (system("cp newdata1 data1/testdata1") || system("cp newdata2 data1/testdata2"))
+		abort();
+
+	/* The first synchronization gets interrupted after the three entries
+	   got committed to the second member. Its stale lock would ask for a
+	   slow-sync, but the checkpoint takes precedence: the second one
+	   resumes it and must only write to the third member. */
+	_commit_error_interrupt(testbed, formatdir, plugindir);
+	_commit_error_resume(testbed, formatdir, plugindir);
+	
+	fail_unless(num_engine_resumed_slowsync == 0, NULL);
+	fail_unless(num_change_written == 3, NULL);
+	fail_unless(num_change_error == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+	
+	fail_unless(osync_testing_diff("data1", "data2"));
+	fail_unless(osync_testing_diff("data1", "data3"));
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (commit_error_resume_slowsync)
+{
+	char *testbed = setup_testbed("multisync_easy_new");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	if (system("cp newdata1 data1/testdata1") || system("cp newdata2 data1/testdata2"))
+		abort();
+
+	/* A stale lock of an earlier crash turns the first synchronization
+	   into a slow-sync */
+	int lock_fd = g_open("configs/group/lock", O_CREAT | O_WRONLY, 00700);
+	fail_unless(lock_fd > 0, NULL);
+	close(lock_fd);
+
+	/* The interrupted slow-sync gets resumed as a slow-sync, which keeps
+	   the mappings it wrote and must only write to the third member */
+	_commit_error_interrupt(testbed, formatdir, plugindir);
+	_commit_error_resume(testbed, formatdir, plugindir);
+	
+	fail_unless(num_engine_resumed_slowsync == 1, NULL);
+	fail_unless(num_change_written == 3, NULL);
+	fail_unless(num_change_error == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+	
+	fail_unless(osync_testing_diff("data1", "data2"));
+	fail_unless(osync_testing_diff("data1", "data3"));
+
+	/* No entry got duplicated by matching it a second time */
+	char *path = g_strdup_printf("%s/configs/group/archive.db", testbed);
+	OSyncMappingTable *maptable = mappingtable_load(path, "mockobjtype1", 3);
+	g_free(path);
+	osync_mapping_table_close(maptable);
+	osync_mapping_table_unref(maptable);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+#endif /* _WIN32 */
+
 START_TEST (dual_commit_error)
 {
 	char *testbed = setup_testbed("multisync_easy_new");
@@ -3335,6 +3595,7 @@ Suite *error_suite(void)
 
 	create_case(s, "one_of_three_get_changes_timeout", one_of_three_get_changes_timeout);
 	create_case(s, "get_changes_timeout_and_error", get_changes_timeout_and_error);
+	create_case(s, "get_changes_hang_deadline", get_changes_hang_deadline);
 
 	/* FIXME: If get_changes delays and got timed out .. set change_callback to NULL.
 	   Make sure changes from the plugin got completely ignored by the engine when the timout handler got called.
@@ -3344,6 +3605,10 @@ Suite *error_suite(void)
 	*/
 
 	create_case(s, "single_commit_error", single_commit_error);
+#ifndef _WIN32
+	create_case(s, "commit_error_resume", commit_error_resume);
+	create_case(s, "commit_error_resume_slowsync", commit_error_resume_slowsync);
+#endif
 	create_case(s, "dual_commit_error", dual_commit_error);
 
 	create_case(s, "single_commit_timeout", single_commit_timeout);
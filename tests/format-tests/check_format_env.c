@@ -1,8 +1,16 @@
 #include "support.h"
 
+#include <time.h>
+#include <utime.h>
+
 #include <opensync/opensync-module.h>
 #include <opensync/opensync-format.h>
+#include <opensync/opensync-ipc.h>
 #include "opensync/format/opensync_filter_internals.h"
+#include "opensync/format/opensync_format_env_internals.h"
+#include "opensync/format/opensync_objformat_internals.h"
+
+#include "../../formats/file.h"
 
 START_TEST (conv_env_create)
 {
@@ -356,6 +364,325 @@ START_TEST (conv_env_load_plugins)
 }
 END_TEST
 
+START_TEST (conv_env_load_plugins_cached)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *cachefile = g_strdup_printf("%s/formatcache.xml", testbed);
+	int num_objformats, num_converters;
+	
+	OSyncError *error = NULL;
+	OSyncFormatEnv *env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	/* First load writes the manifest */
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(g_file_test(cachefile, G_FILE_TEST_IS_REGULAR), NULL);
+	
+	num_objformats = osync_format_env_num_objformats(env);
+	num_converters = osync_format_env_num_converters(env);
+	fail_unless(num_objformats > 0, NULL);
+	
+	osync_format_env_free(env);
+	
+	/* Second load only registers placeholders from the manifest */
+	env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_format_env_num_objformats(env) == num_objformats, NULL);
+	fail_unless(osync_format_env_num_converters(env) == num_converters, NULL);
+	
+	/* Accessing the placeholder loads the mock format plugin */
+	OSyncObjFormat *format = osync_format_env_find_objformat(env, "mockformat1");
+	fail_unless(format != NULL, NULL);
+	fail_unless(osync_objformat_must_marshal(format) == TRUE, NULL);
+	
+	OSyncObjFormat *format2 = osync_format_env_find_objformat(env, "mockformat2");
+	fail_unless(format2 != NULL, NULL);
+	fail_unless(osync_format_env_find_converter(env, format, format2) != NULL, NULL);
+	
+	osync_format_env_free(env);
+	
+	g_free(cachefile);
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (conv_env_load_plugins_cached_missing)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *cachefile = g_strdup_printf("%s/formatcache.xml", testbed);
+	char *module = g_strdup_printf("%s/mock-format.%s", formatdir, G_MODULE_SUFFIX);
+	char *moved = g_strdup_printf("%s.moved", module);
+	char *output = NULL;
+	unsigned int outsize = 0;
+	
+	OSyncError *error = NULL;
+	OSyncFormatEnv *env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	osync_format_env_free(env);
+	
+	env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	/* The module is gone once the placeholders need it */
+	fail_unless(!g_rename(module, moved), NULL);
+	
+	OSyncObjFormat *format = osync_format_env_find_objformat(env, "mockformat1");
+	fail_unless(format != NULL, NULL);
+	OSyncObjFormat *format2 = osync_format_env_find_objformat(env, "mockformat2");
+	fail_unless(format2 != NULL, NULL);
+	OSyncFormatConverter *converter = osync_format_env_find_converter(env, format, format2);
+	fail_unless(converter != NULL, NULL);
+	
+	OSyncData *data = osync_data_new(g_strdup("data"), 5, format, &error);
+	fail_unless(data != NULL, NULL);
+	
+	/* The placeholders fail instead of running without their functions */
+	fail_unless(!osync_converter_invoke(converter, data, NULL, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	
+	fail_unless(!osync_converter_invoke(converter, data, NULL, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	
+	fail_unless(!osync_objformat_copy(format, "data", 5, &output, &outsize, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	
+	fail_unless(osync_objformat_compare(format, "data", 5, "data", 5) == OSYNC_CONV_DATA_MISMATCH, NULL);
+	
+	osync_data_unref(data);
+	osync_format_env_free(env);
+	
+	fail_unless(!g_rename(moved, module), NULL);
+	
+	g_free(moved);
+	g_free(module);
+	g_free(cachefile);
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (conv_env_load_plugins_broken_cache)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *cachefile = g_strdup_printf("%s/formatcache.xml", testbed);
+	char *content = NULL;
+	int num_objformats, num_converters, num_filters;
+	
+	OSyncError *error = NULL;
+	OSyncFormatEnv *env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	num_objformats = osync_format_env_num_objformats(env);
+	num_converters = osync_format_env_num_converters(env);
+	num_filters = osync_format_env_num_filters(env);
+	osync_format_env_free(env);
+	
+	/* The last entry references a module which isn't listed */
+	fail_unless(g_file_get_contents(cachefile, &content, NULL, NULL), NULL);
+	char **parts = g_strsplit(content, "</formatcache>", 2);
+	g_free(content);
+	content = g_strconcat(parts[0], "<filter name=\"broken\" module=\"99\"/></formatcache>", parts[1], NULL);
+	g_strfreev(parts);
+	fail_unless(g_file_set_contents(cachefile, content, -1, NULL), NULL);
+	g_free(content);
+	
+	/* Falls back to loading the plugins, without any placeholders left */
+	env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	
+	osync_format_env_set_cache_file(env, cachefile);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_format_env_num_objformats(env) == num_objformats, NULL);
+	fail_unless(osync_format_env_num_converters(env) == num_converters, NULL);
+	fail_unless(osync_format_env_num_filters(env) == num_filters, NULL);
+	osync_format_env_free(env);
+	
+	/* And wrote a correct manifest again */
+	fail_unless(g_file_get_contents(cachefile, &content, NULL, NULL), NULL);
+	fail_unless(strstr(content, "broken") == NULL, NULL);
+	g_free(content);
+	
+	g_free(cachefile);
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (conv_env_load_plugins_prune_cache)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *configdir = g_strdup_printf("%s/.opensync", testbed);
+	char *orphan = g_strdup_printf("%s/formatcache-00000001.xml", configdir);
+	char *unused = g_strdup_printf("%s/formatcache-00000002.xml", configdir);
+	struct utimbuf old_times;
+	const gchar *de = NULL;
+	int num_caches = 0;
+
+	old_times.actime = old_times.modtime = time(NULL) - 60 * 24 * 60 * 60;
+
+	char *home = g_strdup(g_getenv("HOME"));
+
+	fail_unless(!g_mkdir(configdir, 0700), NULL);
+	g_setenv("HOME", testbed, TRUE);
+
+	/* Points to a plugin directory which is gone */
+	fail_unless(g_file_set_contents(orphan, "<formatcache path=\"/nonexisting\"/>", -1, NULL), NULL);
+	fail_unless(!utime(orphan, &old_times), NULL);
+
+	/* Valid directory, but not used for a long time */
+	char *content = g_strdup_printf("<formatcache path=\"%s\"/>", testbed);
+	fail_unless(g_file_set_contents(unused, content, -1, NULL), NULL);
+	fail_unless(!utime(unused, &old_times), NULL);
+	g_free(content);
+
+	OSyncError *error = NULL;
+	OSyncFormatEnv *env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	osync_format_env_free(env);
+
+	fail_unless(!g_file_test(orphan, G_FILE_TEST_EXISTS), NULL);
+	fail_unless(!g_file_test(unused, G_FILE_TEST_EXISTS), NULL);
+
+	/* Only the manifest of the format directory is left */
+	GDir *dir = g_dir_open(configdir, 0, NULL);
+	fail_unless(dir != NULL, NULL);
+	while ((de = g_dir_read_name(dir)))
+		if (g_str_has_prefix(de, "formatcache-"))
+			num_caches++;
+	g_dir_close(dir);
+	fail_unless(num_caches == 1, NULL);
+
+	if (home)
+		g_setenv("HOME", home, TRUE);
+	else
+		g_unsetenv("HOME");
+	g_free(home);
+
+	g_free(orphan);
+	g_free(unused);
+	g_free(configdir);
+	g_free(formatdir);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (conv_env_file_map)
+{
+	char *testbed = setup_testbed(NULL);
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *output = NULL, *copy = NULL;
+	unsigned int outsize = 0, copysize = 0;
+	
+	OSyncError *error = NULL;
+	OSyncFormatEnv *env = osync_format_env_new(&error);
+	fail_unless(env != NULL, NULL);
+	fail_unless(osync_format_env_load_plugins(env, formatdir, &error), NULL);
+	
+	OSyncObjFormat *format = osync_format_env_find_objformat(env, "file");
+	fail_unless(format != NULL, NULL);
+	
+	osync_testing_system_abort("dd if=/dev/zero of=mapped bs=1024 count=64 2>/dev/null");
+	
+	OSyncFileMap *map = osync_file_map_new("mapped", &error);
+	fail_unless(map != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(osync_file_map_get_size(map) == 65536, NULL);
+	fail_unless(osync_file_map_get_data(map)[65535] == 0, NULL);
+	fail_unless(g_path_is_absolute(osync_file_map_get_path(map)), NULL);
+	fail_unless(osync_file_map_validate(map, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	OSyncFileFormat *file = osync_try_malloc0(sizeof(OSyncFileFormat), &error);
+	fail_unless(file != NULL, NULL);
+	file->path = g_strdup("mapped");
+	file->map = map;
+	file->data = (char *)osync_file_map_get_data(map);
+	file->size = osync_file_map_get_size(map);
+	
+	/* Copies share the mapping */
+	fail_unless(osync_objformat_copy(format, (char *)file, sizeof(OSyncFileFormat), &copy, &copysize, &error), NULL);
+	fail_unless(((OSyncFileFormat *)copy)->map == map, NULL);
+	fail_unless(((OSyncFileFormat *)copy)->data == file->data, NULL);
+	osync_objformat_destroy(format, copy, copysize);
+	
+	/* Only the reference to the file gets transferred */
+	OSyncMessage *message = osync_message_new(OSYNC_MESSAGE_NOOP, 0, &error);
+	fail_unless(message != NULL, NULL);
+	fail_unless(osync_objformat_marshal(format, (char *)file, sizeof(OSyncFileFormat), message, &error), NULL);
+	fail_unless(osync_message_get_message_size(message) < 1024, NULL);
+	
+	fail_unless(osync_objformat_demarshal(format, message, &output, &outsize, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(((OSyncFileFormat *)output)->map != NULL, NULL);
+	fail_unless(osync_objformat_compare(format, (char *)file, sizeof(OSyncFileFormat), output, outsize) == OSYNC_CONV_DATA_SAME, NULL);
+	osync_objformat_destroy(format, output, outsize);
+	osync_message_unref(message);
+	
+	/* The file changed after it got marshaled */
+	message = osync_message_new(OSYNC_MESSAGE_NOOP, 0, &error);
+	fail_unless(osync_objformat_marshal(format, (char *)file, sizeof(OSyncFileFormat), message, &error), NULL);
+	osync_testing_system_abort("echo \"changed content, longer\" > mapped");
+	fail_unless(!osync_objformat_demarshal(format, message, &output, &outsize, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	osync_message_unref(message);
+	
+	/* The truncated file doesn't get handed over anymore */
+	fail_unless(!osync_file_map_validate(map, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	
+	message = osync_message_new(OSYNC_MESSAGE_NOOP, 0, &error);
+	fail_unless(!osync_objformat_marshal(format, (char *)file, sizeof(OSyncFileFormat), message, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	osync_message_unref(message);
+	
+	osync_objformat_destroy(format, (char *)file, sizeof(OSyncFileFormat));
+	osync_format_env_free(env);
+	
+	g_free(formatdir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
 START_TEST (conv_env_plugin)
 {
 	char *testbed = setup_testbed(NULL);
@@ -414,6 +741,11 @@ Suite *format_env_suite(void)
 	create_case(s, "conv_env_register_filter_count", conv_env_register_filter_count);
 
 	create_case(s, "conv_env_load_plugins", conv_env_load_plugins);
+	create_case(s, "conv_env_load_plugins_cached", conv_env_load_plugins_cached);
+	create_case(s, "conv_env_load_plugins_cached_missing", conv_env_load_plugins_cached_missing);
+	create_case(s, "conv_env_load_plugins_broken_cache", conv_env_load_plugins_broken_cache);
+	create_case(s, "conv_env_load_plugins_prune_cache", conv_env_load_plugins_prune_cache);
+	create_case(s, "conv_env_file_map", conv_env_file_map);
 	create_case(s, "conv_env_plugin", conv_env_plugin);
 	
 	return s;
@@ -194,6 +194,42 @@ START_TEST (time_unix_converters)
 }
 END_TEST
 
+START_TEST (time_vcal_converters)
+{
+	char *utc = NULL, *local = NULL;
+	const char *vcal =
+		"BEGIN:VEVENT\r\n"
+		"DTSTART:20070611T010000\r\n"
+		"DTEND:20070101T000000\r\n"
+		"X-DUE:20070101T000000\r\n"
+		"DUE:20070101T050000Z\r\n"
+		"END:VEVENT";
+
+	putenv("TZ=America/Montreal");
+
+	utc = osync_time_vcal2utc(vcal);
+	fail_unless(!strcmp(utc,
+		"BEGIN:VEVENT\r\n"
+		"DTSTART:20070611T050000Z\r\n"
+		"DTEND:20070101T050000Z\r\n"
+		"X-DUE:20070101T000000\r\n"
+		"DUE:20070101T050000Z\r\n"
+		"END:VEVENT"), NULL);
+
+	local = osync_time_vcal2localtime(utc);
+	fail_unless(!strcmp(local,
+		"BEGIN:VEVENT\r\n"
+		"DTSTART:20070611T010000\r\n"
+		"DTEND:20070101T000000\r\n"
+		"X-DUE:20070101T000000\r\n"
+		"DUE:20070101T000000\r\n"
+		"END:VEVENT"), NULL);
+
+	g_free(utc);
+	g_free(local);
+}
+END_TEST
+
 Suite *env_suite(void)
 {
 	Suite *s = suite_create("Time");
@@ -201,6 +237,7 @@ Suite *env_suite(void)
 	TCase *tc_timezones = tcase_create("timezones");
 	TCase *tc_relative  = tcase_create("relative");
 	TCase *tc_unix      = tcase_create("unix_converters");
+	TCase *tc_vcal      = tcase_create("vcal_converters");
 
 	suite_add_tcase (s, tc_timezones);
 	tcase_add_test(tc_timezones, time_timezone_diff);
@@ -211,6 +248,9 @@ Suite *env_suite(void)
 	suite_add_tcase (s, tc_unix);
 	tcase_add_test(tc_unix, time_unix_converters);
 
+	suite_add_tcase (s, tc_vcal);
+	tcase_add_test(tc_vcal, time_vcal_converters);
+
 	return s;
 }
 
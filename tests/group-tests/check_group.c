@@ -4,6 +4,8 @@
 #include <opensync/opensync-group.h>
 #include <opensync/opensync_internals.h>
 
+#include <utime.h>
+
 
 START_TEST (group_last_sync)
 {
@@ -62,11 +64,87 @@ START_TEST (group_last_sync)
 }
 END_TEST
 
+static void age_file(const char *filename)
+{
+	struct utimbuf times;
+	times.actime = times.modtime = time(NULL) - 3600;
+	fail_unless(utime(filename, &times) == 0, NULL);
+}
+
+static void age_group_files(void)
+{
+	age_file("configs/group/syncgroup.conf");
+	age_file("configs/group/1/syncmember.conf");
+	age_file("configs/group/2/syncmember.conf");
+}
+
+START_TEST (group_load_snapshot)
+{
+	char *testbed = setup_testbed("filter_save_and_load");
+	OSyncError *error = NULL;
+
+	/* Just written files are too recent for a snapshot */
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(!g_file_test("configs/group/syncgroup.snapshot", G_FILE_TEST_EXISTS), NULL);
+	osync_group_unref(group);
+
+	age_group_files();
+
+	group = osync_group_new(&error);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(g_file_test("configs/group/syncgroup.snapshot", G_FILE_TEST_IS_REGULAR), NULL);
+	osync_group_unref(group);
+
+	/* Loaded from the snapshot */
+	group = osync_group_new(&error);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(!strcmp(osync_group_get_name(group), "test"), NULL);
+	fail_unless(osync_group_num_members(group) == 2, NULL);
+	fail_unless(!strcmp(osync_member_get_pluginname(osync_group_nth_member(group, 0)), "file-sync"), NULL);
+	fail_unless(!strcmp(osync_member_get_pluginname(osync_group_nth_member(group, 1)), "file-sync"), NULL);
+
+	/* Saving drops the snapshot */
+	osync_group_set_last_synchronization(group, (time_t)1000);
+	fail_unless(osync_group_save(group, &error), NULL);
+	fail_unless(!g_file_test("configs/group/syncgroup.snapshot", G_FILE_TEST_EXISTS), NULL);
+	osync_group_unref(group);
+
+	age_group_files();
+
+	group = osync_group_new(&error);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	osync_group_unref(group);
+
+	group = osync_group_new(&error);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless((int)osync_group_get_last_synchronization(group) == 1000, NULL);
+	fail_unless(osync_group_num_members(group) == 2, NULL);
+	osync_group_unref(group);
+
+	/* Changes to a member configuration outdate the snapshot */
+	fail_unless(g_file_set_contents("configs/group/2/syncmember.conf",
+		"<?xml version=\"1.0\"?>\n<syncmember version=\"1.0\"><pluginname>mock-sync</pluginname></syncmember>\n",
+		-1, NULL), NULL);
+
+	group = osync_group_new(&error);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(!strcmp(osync_member_get_pluginname(osync_group_find_member(group, 2)), "mock-sync"), NULL);
+	osync_group_unref(group);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
 Suite *group_suite(void)
 {
   Suite *s = suite_create("Group");
 
   create_case(s, "group_last_sync", group_last_sync);
+  create_case(s, "group_load_snapshot", group_load_snapshot);
 
   return s;
 }
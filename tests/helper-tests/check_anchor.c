@@ -0,0 +1,143 @@
+#include "support.h"
+
+#include <opensync/opensync.h>
+#include <opensync/opensync-helper.h>
+
+START_TEST (anchor_legacy)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+
+	char *anchorpath = g_strdup_printf("%s%canchor.db", testbed, G_DIR_SEPARATOR);
+
+	fail_unless(osync_anchor_retrieve(anchorpath, "key") == NULL, NULL);
+	fail_unless(!osync_anchor_compare(anchorpath, "key", "anchor"), NULL);
+
+	fail_unless(osync_anchor_update_full(anchorpath, "key", "anchor", &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(osync_anchor_compare(anchorpath, "key", "anchor"), NULL);
+	fail_unless(!osync_anchor_compare(anchorpath, "key", "other"), NULL);
+
+	char *anchor = osync_anchor_retrieve(anchorpath, "key");
+	fail_unless(!strcmp(anchor, "anchor"), NULL);
+	g_free(anchor);
+
+	osync_anchor_update(anchorpath, "key", "other");
+	fail_unless(osync_anchor_compare(anchorpath, "key", "other"), NULL);
+
+	g_free(anchorpath);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (anchor_store)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+
+	char *anchorpath = g_strdup_printf("%s%canchor.db", testbed, G_DIR_SEPARATOR);
+	OSyncAnchorStore *store = osync_anchor_store_new(anchorpath, &error);
+	fail_unless(store != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_anchor_store_ref(store) == store, NULL);
+	osync_anchor_store_unref(store);
+
+	fail_unless(osync_anchor_store_retrieve(store, "contact", &error) == NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Not saved yet, but visible to the store */
+	osync_anchor_store_update(store, "contact", "1");
+	osync_anchor_store_update(store, "event", "2");
+	osync_anchor_store_update(store, "contact", "3");
+	fail_unless(osync_anchor_store_compare(store, "contact", "3", &error), NULL);
+	fail_unless(osync_anchor_retrieve(anchorpath, "contact") == NULL, NULL);
+
+	fail_unless(osync_anchor_store_save(store, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(osync_anchor_compare(anchorpath, "contact", "3"), NULL);
+	fail_unless(osync_anchor_compare(anchorpath, "event", "2"), NULL);
+
+	/* Unsaved updates get discarded with the last unref */
+	osync_anchor_store_update(store, "event", "4");
+	osync_anchor_store_update(store, "note", "5");
+	osync_anchor_store_unref(store);
+
+	store = osync_anchor_store_new(anchorpath, &error);
+	fail_unless(store != NULL, NULL);
+
+	char *anchor = osync_anchor_store_retrieve(store, "event", &error);
+	fail_unless(!strcmp(anchor, "2"), NULL);
+	g_free(anchor);
+	fail_unless(osync_anchor_store_retrieve(store, "note", &error) == NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(!osync_anchor_store_compare(store, "note", "4", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_anchor_store_unref(store);
+
+	g_free(anchorpath);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (anchor_store_hashtable)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+
+	char *hashpath = g_strdup_printf("%s%chashtable.db", testbed, G_DIR_SEPARATOR);
+	OSyncHashTable *table = osync_hashtable_new(hashpath, "contact", &error);
+	fail_unless(table != NULL, NULL);
+	fail_unless(osync_hashtable_load(table, &error), NULL);
+
+	OSyncAnchorStore *store = osync_anchor_store_new_from_hashtable(table, &error);
+	fail_unless(store != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* The store keeps the hashtable database open */
+	osync_hashtable_unref(table);
+
+	osync_anchor_store_update(store, "contact", "anchor");
+	fail_unless(osync_anchor_store_save(store, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_anchor_store_unref(store);
+
+	fail_unless(osync_anchor_compare(hashpath, "contact", "anchor"), NULL);
+
+	g_free(hashpath);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+Suite *env_suite(void)
+{
+	Suite *s = suite_create("Anchor");
+
+	create_case(s, "anchor_legacy", anchor_legacy);
+	create_case(s, "anchor_store", anchor_store);
+	create_case(s, "anchor_store_hashtable", anchor_store_hashtable);
+
+	return s;
+}
+
+int main(void)
+{
+	int nf;
+
+	check_env();
+
+	Suite *s = env_suite();
+
+	SRunner *sr;
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
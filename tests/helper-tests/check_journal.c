@@ -0,0 +1,246 @@
+#include "support.h"
+
+#include <opensync/opensync.h>
+#include <opensync/opensync-helper.h>
+
+static osync_bool list_contains(OSyncList *uids, const char *uid)
+{
+	OSyncList *u;
+	for (u = uids; u; u = u->next)
+		if (!strcmp(u->data, uid))
+			return TRUE;
+	return FALSE;
+}
+
+START_TEST (journal_new)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+	osync_bool rescan = FALSE;
+
+	OSyncJournal *journal = osync_journal_new(testbed, &error);
+	fail_unless(!error, NULL);
+	fail_unless(journal != NULL, NULL);
+
+	/* Nothing is known about the directory yet */
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+
+	/* Not committed, so the rescan is requested again */
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+
+	osync_journal_commit(journal);
+
+	if (osync_journal_is_watching(journal)) {
+		fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+		fail_unless(rescan == FALSE, NULL);
+	}
+
+	fail_unless(osync_journal_ref(journal) == journal, NULL);
+	osync_journal_unref(journal);
+	osync_journal_unref(journal);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (journal_dirty)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+	osync_bool rescan = FALSE;
+	OSyncList *uids = NULL;
+
+	char *root = g_strdup_printf("%s%cdata", testbed, G_DIR_SEPARATOR);
+	fail_unless(!g_mkdir(root, 0700), NULL);
+
+	OSyncJournal *journal = osync_journal_new(root, &error);
+	fail_unless(journal != NULL, NULL);
+
+	if (!osync_journal_is_watching(journal)) {
+		osync_journal_unref(journal);
+		g_free(root);
+		destroy_testbed(testbed);
+		return;
+	}
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+	osync_journal_commit(journal);
+
+	osync_testing_system_abort("echo foo > data/file1");
+	osync_testing_system_abort("mkdir data/subdir");
+	osync_testing_system_abort("echo bar > data/subdir/file2");
+
+	uids = osync_journal_get_dirty(journal, &rescan);
+	fail_unless(rescan == FALSE, NULL);
+	fail_unless(osync_list_length(uids) == 2, NULL);
+	fail_unless(list_contains(uids, "file1"), NULL);
+	fail_unless(list_contains(uids, "subdir/file2"), NULL);
+	osync_list_free(uids);
+
+	/* Handed out, but not committed yet */
+	osync_testing_system_abort("rm data/file1");
+
+	uids = osync_journal_get_dirty(journal, &rescan);
+	fail_unless(rescan == FALSE, NULL);
+	fail_unless(osync_list_length(uids) == 2, NULL);
+	osync_list_free(uids);
+
+	osync_journal_commit(journal);
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == FALSE, NULL);
+
+	/* Files below a moved directory are unknown */
+	osync_testing_system_abort("mv data/subdir subdir");
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+	osync_journal_commit(journal);
+
+	osync_testing_system_abort("echo foo > data/file3");
+	osync_journal_unref(journal);
+
+	/* A journal only living in memory knows nothing after a restart */
+	journal = osync_journal_new(root, &error);
+	fail_unless(journal != NULL, NULL);
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+
+	osync_journal_unref(journal);
+
+	g_free(root);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (journal_reopen)
+{
+	OSyncError *error = NULL;
+	char *testbed = setup_testbed(NULL);
+	osync_bool rescan = FALSE;
+	OSyncList *uids = NULL;
+
+	char *root = g_strdup_printf("%s%cdata", testbed, G_DIR_SEPARATOR);
+	fail_unless(!g_mkdir(root, 0700), NULL);
+
+	char *hashpath = g_strdup_printf("%s%chashtable.db", testbed, G_DIR_SEPARATOR);
+	OSyncHashTable *table = osync_hashtable_new(hashpath, "contact", &error);
+	fail_unless(table != NULL, NULL);
+	fail_unless(osync_hashtable_load(table, &error), NULL);
+
+	OSyncJournal *journal = osync_journal_new_from_hashtable(root, table, &error);
+	fail_unless(journal != NULL, NULL);
+	fail_unless(!error, NULL);
+
+	if (!osync_journal_is_watching(journal)) {
+		osync_journal_unref(journal);
+		osync_hashtable_unref(table);
+		g_free(hashpath);
+		g_free(root);
+		destroy_testbed(testbed);
+		return;
+	}
+
+	/* Nothing got stored yet */
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+	osync_journal_commit(journal);
+
+	osync_testing_system_abort("echo foo > data/file1");
+	osync_testing_system_abort("echo bar > data/file2");
+
+	uids = osync_journal_get_dirty(journal, &rescan);
+	fail_unless(rescan == FALSE, NULL);
+	fail_unless(osync_list_length(uids) == 2, NULL);
+	osync_list_free(uids);
+
+	/* Not committed, and the changes are older than the stored journal */
+	sleep(2);
+	osync_journal_unref(journal);
+
+	journal = osync_journal_new_from_hashtable(root, table, &error);
+	fail_unless(journal != NULL, NULL);
+
+	uids = osync_journal_get_dirty(journal, &rescan);
+	fail_unless(rescan == FALSE, NULL);
+	fail_unless(osync_list_length(uids) == 2, NULL);
+	fail_unless(list_contains(uids, "file1"), NULL);
+	fail_unless(list_contains(uids, "file2"), NULL);
+	osync_list_free(uids);
+
+	osync_journal_commit(journal);
+	osync_journal_unref(journal);
+
+	/* Changed while nobody watched */
+	osync_testing_system_abort("echo more >> data/file1");
+
+	journal = osync_journal_new_from_hashtable(root, table, &error);
+	fail_unless(journal != NULL, NULL);
+
+	uids = osync_journal_get_dirty(journal, &rescan);
+	fail_unless(rescan == FALSE, NULL);
+	fail_unless(osync_list_length(uids) == 1, NULL);
+	fail_unless(list_contains(uids, "file1"), NULL);
+	osync_list_free(uids);
+
+	osync_journal_commit(journal);
+	osync_journal_unref(journal);
+
+	/* A file deleted while nobody watched only shows up in the directory */
+	osync_testing_system_abort("rm data/file2");
+
+	journal = osync_journal_new_from_hashtable(root, table, &error);
+	fail_unless(journal != NULL, NULL);
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+	osync_journal_unref(journal);
+
+	/* The rescan didn't get committed, so it is requested again */
+	journal = osync_journal_new_from_hashtable(root, table, &error);
+	fail_unless(journal != NULL, NULL);
+
+	fail_unless(osync_journal_get_dirty(journal, &rescan) == NULL, NULL);
+	fail_unless(rescan == TRUE, NULL);
+	osync_journal_unref(journal);
+
+	osync_hashtable_unref(table);
+	g_free(hashpath);
+	g_free(root);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+Suite *env_suite(void)
+{
+	Suite *s = suite_create("Journal");
+
+	create_case(s, "journal_new", journal_new);
+	create_case(s, "journal_dirty", journal_dirty);
+	create_case(s, "journal_reopen", journal_reopen);
+
+	return s;
+}
+
+int main(void)
+{
+	int nf;
+
+	check_env();
+
+	Suite *s = env_suite();
+
+	SRunner *sr;
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2242,6 +2242,207 @@ START_TEST (ipc_timeout)
 END_TEST
 
 
+#define CHANGE_WINDOW 2
+#define NUM_CHANGES 20
+
+int num_changes_sent = 0;
+int num_changes_received = 0;
+
+static void _change_handler(OSyncMessage *message, void *user_data)
+{
+	fail_unless(osync_message_get_command(message) == OSYNC_MESSAGE_NEW_CHANGE, NULL);
+	num_changes_received++;
+
+	/* The sender never gets ahead of us by more than the window */
+	fail_unless(g_atomic_int_get(&num_changes_sent) <= num_changes_received + CHANGE_WINDOW, NULL);
+}
+
+static gpointer _change_sender(gpointer data)
+{
+	OSyncQueue *queue = data;
+	OSyncError *error = NULL;
+	int i;
+
+	for (i = 0; i < NUM_CHANGES; i++) {
+		OSyncMessage *message = osync_message_new(OSYNC_MESSAGE_NEW_CHANGE, 0, &error);
+		osync_assert(message != NULL);
+		osync_message_write_int(message, i);
+
+		osync_assert(osync_queue_send_message(queue, NULL, message, &error));
+		osync_message_unref(message);
+
+		g_atomic_int_inc(&num_changes_sent);
+	}
+
+	return NULL;
+}
+
+START_TEST (ipc_change_window)
+{	
+	char *testbed = setup_testbed(NULL);
+	
+	OSyncError *error = NULL;
+	OSyncQueue *read1 = NULL;
+	OSyncQueue *write1 = NULL;
+	OSyncQueue *read2 = NULL;
+	OSyncQueue *write2 = NULL;
+	
+	/* read1/write1 carry the changes, read2/write2 the credits */
+	osync_assert(osync_queue_new_pipes(&read1, &write1, &error));
+	osync_assert(osync_queue_new_pipes(&read2, &write2, &error));
+	osync_assert(error == NULL);
+		
+	fail_unless(osync_queue_connect(read1, OSYNC_QUEUE_RECEIVER, &error), NULL);
+	fail_unless(osync_queue_connect(write1, OSYNC_QUEUE_SENDER, &error), NULL);
+	fail_unless(osync_queue_connect(read2, OSYNC_QUEUE_RECEIVER, &error), NULL);
+	fail_unless(osync_queue_connect(write2, OSYNC_QUEUE_SENDER, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_queue_set_message_handler(read1, _change_handler, NULL);
+	osync_queue_set_credit_target(read2, write1);
+
+	fail_unless(osync_queue_set_change_window(read1, write2, CHANGE_WINDOW, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	GThread *sender = g_thread_create(_change_sender, write1, TRUE, NULL);
+	fail_unless(sender != NULL, NULL);
+
+	while (num_changes_received < NUM_CHANGES) {
+		osync_queue_dispatch(read1, &error);
+		g_usleep(1000);
+	}
+
+	g_thread_join(sender);
+	fail_unless(num_changes_sent == NUM_CHANGES, NULL);
+
+	osync_assert(osync_queue_disconnect(read1, &error));
+	osync_assert(osync_queue_disconnect(write1, &error));
+	osync_assert(osync_queue_disconnect(read2, &error));
+	osync_assert(osync_queue_disconnect(write2, &error));
+	osync_assert(error == NULL);
+	
+	osync_queue_free(read1);
+	osync_queue_free(write1);
+	osync_queue_free(read2);
+	osync_queue_free(write2);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+static int num_cancelled_replies = 0;
+
+static void _cancelled_reply_handler(OSyncMessage *message, void *user_data)
+{
+	fail_unless(osync_message_get_cmd(message) == OSYNC_MESSAGE_ERRORREPLY, NULL);
+	num_cancelled_replies++;
+}
+
+START_TEST (ipc_cancel)
+{	
+	char *testbed = setup_testbed(NULL);
+	
+	OSyncError *error = NULL;
+	OSyncQueue *read1 = NULL;
+	OSyncQueue *write1 = NULL;
+	OSyncQueue *read2 = NULL;
+	OSyncQueue *write2 = NULL;
+	OSyncMessage *message = NULL;
+	int cancelled = 0;
+	int i;
+	
+	/* read1/write1 carry the requests, read2/write2 the replies */
+	osync_assert(osync_queue_new_pipes(&read1, &write1, &error));
+	osync_assert(osync_queue_new_pipes(&read2, &write2, &error));
+	osync_assert(error == NULL);
+		
+	fail_unless(osync_queue_connect(read1, OSYNC_QUEUE_RECEIVER, &error), NULL);
+	fail_unless(osync_queue_connect(write1, OSYNC_QUEUE_SENDER, &error), NULL);
+	fail_unless(osync_queue_connect(read2, OSYNC_QUEUE_RECEIVER, &error), NULL);
+	fail_unless(osync_queue_connect(write2, OSYNC_QUEUE_SENDER, &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_queue_set_cancel_flag(read1, &cancelled);
+
+	/* A request which never gets answered */
+	message = osync_message_new(OSYNC_MESSAGE_GET_CHANGES, 0, &error);
+	fail_unless(message != NULL, NULL);
+	osync_message_set_handler(message, _cancelled_reply_handler, NULL);
+	fail_unless(osync_queue_send_message_with_timeout(write1, read2, message, 60, &error), NULL);
+	osync_message_unref(message);
+
+	/* The flag gets set by the reading thread, nobody dispatches read1 */
+	message = osync_message_new(OSYNC_MESSAGE_CANCEL, 0, &error);
+	fail_unless(message != NULL, NULL);
+	osync_message_write_int(message, TRUE);
+	fail_unless(osync_queue_send_message(write1, NULL, message, &error), NULL);
+	osync_message_unref(message);
+
+	for (i = 0; i < 1000 && !g_atomic_int_get(&cancelled); i++)
+		g_usleep(1000);
+	fail_unless(cancelled == TRUE, NULL);
+
+	osync_error_set(&error, OSYNC_ERROR_TIMEOUT, "aborted");
+	fail_unless(osync_queue_fail_pending(read2, error) == 1, NULL);
+	fail_unless(num_cancelled_replies == 1, NULL);
+	fail_unless(osync_queue_fail_pending(read2, error) == 0, NULL);
+	osync_error_unref(&error);
+
+	osync_queue_set_cancel_flag(read1, NULL);
+
+	osync_assert(osync_queue_disconnect(read1, &error));
+	osync_assert(osync_queue_disconnect(write1, &error));
+	osync_assert(osync_queue_disconnect(read2, &error));
+	osync_assert(osync_queue_disconnect(write2, &error));
+	osync_assert(error == NULL);
+	
+	osync_queue_free(read1);
+	osync_queue_free(write1);
+	osync_queue_free(read2);
+	osync_queue_free(write2);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (ipc_message_recycle)
+{
+	OSyncError *error = NULL;
+	char *data = NULL;
+	char *str = NULL;
+	unsigned int size = 0;
+	int i, value = 0;
+
+	/* Messages get their buffers from the recycled ones of freed messages.
+	 * These must come back empty and with the requested capacity. */
+	for (i = 0; i < 64; i++) {
+		OSyncMessage *message = osync_message_new(OSYNC_MESSAGE_NOOP, (i % 4) * 1024, &error);
+		fail_unless(message != NULL, NULL);
+		fail_unless(error == NULL, NULL);
+		fail_unless(osync_message_get_message_size(message) == 0, NULL);
+
+		/* Fill the requested size directly, like the queue does */
+		osync_message_get_buffer(message, &data, &size);
+		fail_unless(size == 0, NULL);
+		memset(data, 'x', (i % 4) * 1024);
+		osync_message_set_message_size(message, (i % 4) * 1024);
+		osync_message_set_message_size(message, 0);
+
+		osync_message_write_int(message, i);
+		osync_message_write_string(message, "recycled");
+
+		osync_message_read_int(message, &value);
+		fail_unless(value == i, NULL);
+		osync_message_read_string(message, &str);
+		fail_unless(!strcmp(str, "recycled"), NULL);
+		g_free(str);
+
+		osync_message_unref(message);
+	}
+}
+END_TEST
+
+
 Suite *ipc_suite(void)
 {
 	Suite *s = suite_create("IPC");
@@ -2271,6 +2472,9 @@ Suite *ipc_suite(void)
 	create_case(s, "ipc_callback_break_pipes", ipc_callback_break_pipes);
 
 	create_case(s, "ipc_timeout", ipc_timeout);
+	create_case(s, "ipc_change_window", ipc_change_window);
+	create_case(s, "ipc_cancel", ipc_cancel);
+	create_case(s, "ipc_message_recycle", ipc_message_recycle);
 	
 	return s;
 }
@@ -127,12 +127,83 @@ START_TEST (merger_demerge)
 }
 END_TEST
 
+START_TEST (merger_merge_demerge_result)
+{
+	char *testbed = setup_testbed("merger");
+
+	char *buffer;
+	unsigned int size;
+	OSyncError *error = NULL;
+	OSyncXMLFormat *xmlformat, *xmlformat_entire;
+	OSyncXMLField *field;
+	OSyncCapabilities *capabilities;
+
+	fail_unless(osync_file_read("contact.xml", &buffer, &size, &error), NULL);
+	xmlformat = osync_xmlformat_parse(buffer, size, &error);
+	fail_unless(xmlformat != NULL, NULL);
+	g_free(buffer);
+	osync_xmlformat_sort(xmlformat);
+	
+	fail_unless(osync_file_read("contact-full.xml", &buffer, &size, &error), NULL);
+	xmlformat_entire = osync_xmlformat_parse(buffer, size, &error);
+	fail_unless(xmlformat_entire != NULL, NULL);
+	g_free(buffer);
+	osync_xmlformat_sort(xmlformat_entire);
+	
+	fail_unless(osync_file_read("capabilities.xml", &buffer, &size, &error), NULL);
+	capabilities = osync_capabilities_parse(buffer, size, &error);
+	fail_unless(capabilities != NULL, NULL);
+	g_free(buffer);
+	osync_capabilities_sort(capabilities);
+
+	OSyncMerger *merger = osync_merger_new(capabilities, &error);
+	fail_unless(merger != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Fields and keys which aren't in the capabilities come from the entire xmlformat */
+	osync_merger_merge(merger, xmlformat, xmlformat_entire);
+	fail_unless(osync_xmlformat_is_sorted(xmlformat), NULL);
+
+	field = osync_xmlformat_get_first_field(xmlformat);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Aim"), NULL);
+	field = osync_xmlfield_get_next(field);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Icq"), NULL);
+	field = osync_xmlfield_get_next(field);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Name"), NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_nth_key_value(field, 0), "JohnFull123"), NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_key_value(field, "LastName"), "Doe"), NULL);
+	field = osync_xmlfield_get_next(field);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Telephone"), NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_key_value(field, "Content"), "123"), NULL);
+	fail_unless(osync_xmlfield_get_next(field) == NULL, NULL);
+
+	/* And they are removed again */
+	osync_merger_demerge(merger, xmlformat);
+
+	field = osync_xmlformat_get_first_field(xmlformat);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Name"), NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_key_value(field, "LastName"), "Doe"), NULL);
+	field = osync_xmlfield_get_next(field);
+	fail_unless(!strcmp(osync_xmlfield_get_name(field), "Telephone"), NULL);
+	fail_unless(osync_xmlfield_get_next(field) == NULL, NULL);
+
+	osync_merger_unref(merger);
+	
+	osync_capabilities_unref(capabilities);
+	osync_xmlformat_unref(xmlformat);
+	osync_xmlformat_unref(xmlformat_entire);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
 Suite *filter_suite(void)
 {
 	Suite *s = suite_create("Merger");
 	create_case(s, "merger_new", merger_new);
 	create_case(s, "merger_merge", merger_merge);
 	create_case(s, "merger_demerge", merger_demerge);
+	create_case(s, "merger_merge_demerge_result", merger_merge_demerge_result);
 	return s;
 }
 
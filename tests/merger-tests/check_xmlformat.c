@@ -124,6 +124,54 @@ START_TEST (xmlformat_search_field)
 }
 END_TEST
 
+START_TEST (xmlformat_search_field_range)
+{
+	OSyncError *error = NULL;
+	unsigned int count = 0;
+
+	OSyncXMLFormat *xmlformat = osync_xmlformat_new("contact", &error);
+	fail_unless(xmlformat != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_xmlfield_new(xmlformat, "Telephone", &error) != NULL, NULL);
+	fail_unless(osync_xmlfield_new(xmlformat, "EMail", &error) != NULL, NULL);
+	fail_unless(osync_xmlfield_new(xmlformat, "Telephone", &error) != NULL, NULL);
+	osync_xmlformat_sort(xmlformat);
+
+	OSyncXMLField *xmlfield = osync_xmlformat_search_field_range(xmlformat, "Telephone", &count, &error);
+	fail_unless(xmlfield != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(count == 2, NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_name(xmlfield), "Telephone"), NULL);
+	fail_unless(!strcmp(osync_xmlfield_get_name(osync_xmlfield_get_next(xmlfield)), "Telephone"), NULL);
+
+	fail_unless(osync_xmlformat_search_field_range(xmlformat, "Name", &count, &error) == NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(count == 0, NULL);
+
+	/* Changes of the xmlfields must not leave a stale search index behind */
+	osync_xmlfield_delete(xmlfield);
+
+	xmlfield = osync_xmlformat_search_field_range(xmlformat, "Telephone", &count, &error);
+	fail_unless(xmlfield != NULL, NULL);
+	fail_unless(count == 1, NULL);
+
+	fail_unless(osync_xmlfield_new(xmlformat, "Name", &error) != NULL, NULL);
+	osync_xmlformat_sort(xmlformat);
+
+	xmlfield = osync_xmlformat_search_field_range(xmlformat, "Name", &count, &error);
+	fail_unless(xmlfield != NULL, NULL);
+	fail_unless(count == 1, NULL);
+
+	OSyncXMLFieldList *xmlfieldlist = osync_xmlformat_search_field(xmlformat, "EMail", &error, NULL);
+	fail_unless(xmlfieldlist != NULL, NULL);
+	fail_unless(osync_xmlfieldlist_get_length(xmlfieldlist) == 1, NULL);
+	osync_xmlfieldlist_free(xmlfieldlist);
+
+	osync_xmlformat_unref(xmlformat);
+}
+END_TEST
+
 START_TEST (xmlformat_compare_test)
 {
 	char *testbed = setup_testbed("xmlformats");
@@ -298,6 +346,101 @@ START_TEST (xmlformat_compare_ignore_fields)
 }
 END_TEST
 
+START_TEST (xmlformat_compare_points_table)
+{
+	char *testbed = setup_testbed("xmlformats");
+
+	char *buffer1;
+	char *buffer2;
+	unsigned int size1;
+	unsigned int size2;
+	OSyncError *error = NULL;
+
+	fail_unless(osync_file_read( "contact3_unique.xml", &buffer1, &size1, &error), NULL);
+
+	OSyncXMLFormat *xmlformat1 = osync_xmlformat_parse(buffer1, size1, &error);
+	fail_unless(xmlformat1 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	fail_unless(osync_file_read( "contact1.xml", &buffer2, &size2, &error), NULL);
+	
+	OSyncXMLFormat *xmlformat2 = osync_xmlformat_parse(buffer2, size2, &error);
+	fail_unless(xmlformat2 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	g_free(buffer1);
+	g_free(buffer2);
+
+	char* keys_content[] =  {"Content", NULL};
+	char* keys_name[] = {"FirstName", "LastName", NULL};
+	OSyncXMLPoints points[] = {
+		{"EMail",               10,     keys_content},
+		{"Name",                90,     keys_name},
+		{"Revision",            -1,     keys_content},
+		{"Telephone",           10,     keys_content},
+		{"Uid",                 -1,     keys_content},
+		{NULL}
+	};
+
+	/* One compiled table serves any number of compares and gives the same results */
+	OSyncXMLPointsTable *table = xmlformat_points_table_new(points);
+	fail_unless(table != NULL, NULL);
+
+	fail_unless(xmlformat_compare_table(xmlformat1, xmlformat1, table, 0, 100) == OSYNC_CONV_DATA_SAME, NULL);
+	fail_unless(xmlformat_compare_table(xmlformat1, xmlformat2, table, 0, 100) == xmlformat_compare(xmlformat1, xmlformat2, points, 0, 100), NULL);
+	fail_unless(xmlformat_compare_table(xmlformat2, xmlformat1, table, 0, 100) == xmlformat_compare(xmlformat2, xmlformat1, points, 0, 100), NULL);
+	fail_unless(xmlformat_compare_table(xmlformat2, xmlformat2, table, 0, 100) == OSYNC_CONV_DATA_SAME, NULL);
+
+	xmlformat_points_table_free(table);
+
+	osync_xmlformat_unref(xmlformat1);
+	osync_xmlformat_unref(xmlformat2);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+
+START_TEST (xmlformat_compare_similar_keys)
+{
+	OSyncError *error = NULL;
+
+	const char *base = "<?xml version=\"1.0\"?><contact><Name><Additional>A</Additional><FirstName>John</FirstName><LastName>Doe</LastName></Name></contact>";
+	const char *other_additional = "<?xml version=\"1.0\"?><contact><Name><Additional>B</Additional><FirstName>John</FirstName><LastName>Doe</LastName></Name></contact>";
+	const char *other_lastname = "<?xml version=\"1.0\"?><contact><Name><Additional>A</Additional><FirstName>John</FirstName><LastName>Smith</LastName></Name></contact>";
+
+	OSyncXMLFormat *xmlformat1 = osync_xmlformat_parse(base, strlen(base), &error);
+	fail_unless(xmlformat1 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	OSyncXMLFormat *xmlformat2 = osync_xmlformat_parse(other_additional, strlen(other_additional), &error);
+	fail_unless(xmlformat2 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	OSyncXMLFormat *xmlformat3 = osync_xmlformat_parse(other_lastname, strlen(other_lastname), &error);
+	fail_unless(xmlformat3 != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	char* keys_name[] = {"FirstName", "LastName", NULL};
+	OSyncXMLPoints points[] = {
+		{"Name",                90,     keys_name},
+		{NULL}
+	};
+
+	/* Fields which only differ outside of their keys are similar */
+	fail_unless(xmlformat_compare(xmlformat1, xmlformat2, points, 0, 90) == OSYNC_CONV_DATA_SIMILAR, NULL);
+	fail_unless(xmlformat_compare(xmlformat2, xmlformat1, points, 0, 90) == OSYNC_CONV_DATA_SIMILAR, NULL);
+
+	/* The second key counts as much as the first one */
+	fail_unless(xmlformat_compare(xmlformat1, xmlformat3, points, 0, 90) == OSYNC_CONV_DATA_MISMATCH, NULL);
+	fail_unless(xmlformat_compare(xmlformat3, xmlformat1, points, 0, 90) == OSYNC_CONV_DATA_MISMATCH, NULL);
+
+	osync_xmlformat_unref(xmlformat1);
+	osync_xmlformat_unref(xmlformat2);
+	osync_xmlformat_unref(xmlformat3);
+}
+END_TEST
+
 
 START_TEST (xmlformat_event_schema)
 {
@@ -441,9 +584,12 @@ Suite *xmlformat_suite(void)
 	create_case(s, "xmlformat_sort", xmlformat_sort);
 	create_case(s, "xmlformat_is_sorted", xmlformat_is_sorted);
 	create_case(s, "xmlformat_search_field", xmlformat_search_field);
+	create_case(s, "xmlformat_search_field_range", xmlformat_search_field_range);
 	create_case(s, "xmlformat_compare_test", xmlformat_compare_test);
 	create_case(s, "xmlformat_compare_field2null", xmlformat_compare_field2null);
 	create_case(s, "xmlformat_compare_ignore_fields", xmlformat_compare_ignore_fields);
+	create_case(s, "xmlformat_compare_points_table", xmlformat_compare_points_table);
+	create_case(s, "xmlformat_compare_similar_keys", xmlformat_compare_similar_keys);
 	create_case(s, "xmlformat_event_schema", xmlformat_event_schema);
 
 	// xmlformat schema
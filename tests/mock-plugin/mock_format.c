@@ -24,6 +24,7 @@
 #include <opensync/opensync-serializer.h>
 #include <opensync/opensync-format.h>
 #include <glib.h>
+#include "opensync/format/opensync_filter_internals.h"
 #include "mock_format.h"
 
 
@@ -151,6 +152,7 @@ static osync_bool copy_file(const char *input, unsigned int inpsize, char **outp
 	}
 	
 	outfile->path = g_strdup(inpfile->path);
+	outfile->last_mod = inpfile->last_mod;
 	
 	*output = (char *)outfile;
 	*outpsize = sizeof(OSyncFileFormat);
@@ -197,6 +199,7 @@ static osync_bool marshal_file(const char *input, unsigned int inpsize, OSyncMes
 	
 	osync_message_write_string(message, file->path);
 	osync_message_write_buffer(message, file->data, file->size);
+	osync_message_write_long_long_int(message, file->last_mod);
 	
 	osync_trace(TRACE_EXIT, "%s", __func__);
 	return TRUE;
@@ -206,11 +209,14 @@ static osync_bool demarshal_file(OSyncMessage *message, char **output, unsigned
 {
 	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p, %p)", __func__, message, output, outpsize, error);
 	
+	long long int last_mod = 0;
 	OSyncFileFormat *file = osync_try_malloc0(sizeof(OSyncFileFormat), error);
 	osync_assert(file);
 	
 	osync_message_read_string(message, &(file->path));
 	osync_message_read_buffer(message, (void *)&(file->data), (int *)&(file->size));
+	osync_message_read_long_long_int(message, &last_mod);
+	file->last_mod = last_mod;
 	
 	*output = (char *)file;
 	*outpsize = sizeof(OSyncFileFormat);
@@ -219,6 +225,19 @@ static osync_bool demarshal_file(OSyncMessage *message, char **output, unsigned
 	return TRUE;
 }
 
+/* Matches the file whose uid is given as config */
+static osync_bool filter_uid(OSyncData *data, const char *config)
+{
+	char *buffer = NULL;
+	unsigned int size = 0;
+	OSyncFileFormat *file = NULL;
+
+	osync_data_get_data(data, &buffer, &size);
+	file = (OSyncFileFormat *)buffer;
+
+	return (config && file && file->path && !strcmp(file->path, config));
+}
+
 static void _format_set_functions(OSyncObjFormat *format)
 {
 	osync_objformat_set_compare_func(format, compare_file);
@@ -290,6 +309,11 @@ osync_bool get_conversion_info(OSyncFormatEnv *env, OSyncError **error)
 	osync_format_env_register_converter(env, conv);
 	osync_converter_unref(conv);
 
+	OSyncCustomFilter *filter = osync_custom_filter_new("mockobjtype1", "mockformat1", "mockformat1_uid", filter_uid, error);
+	osync_assert(filter);
+
+	osync_format_env_register_filter(env, filter);
+	osync_custom_filter_unref(filter);
 
 	return TRUE;
 }
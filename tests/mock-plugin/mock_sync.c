@@ -81,12 +81,10 @@ static void mock_connect(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
 	osync_assert(dir);
 	dir->committed_all = TRUE;
 
-	char *anchorpath = g_strdup_printf("%s/anchor.db", osync_plugin_info_get_configdir(info));
 	char *path_field = g_strdup_printf("path_%s", osync_objtype_sink_get_name(sink));
-	if (!osync_anchor_compare(anchorpath, path_field, dir->path))
+	if (!osync_anchor_store_compare(dir->anchors, path_field, dir->path, NULL))
 		osync_objtype_sink_set_slowsync(sink, TRUE);
 
-	g_free(anchorpath);
 	g_free(path_field);
 	
 	osync_assert(g_file_test(dir->path, G_FILE_TEST_IS_DIR));
@@ -235,22 +233,107 @@ static osync_bool mock_write(void *data, OSyncPluginInfo *info, OSyncContext *ct
  *            start with a slash. See note above.
  *
  */
+/* Reports a regular file of the directory, unless the hashtable knows it unmodified */
+static void mock_report_file(MockDir *directory, const char *relative_filename, OSyncContext *ctx, OSyncPluginInfo *info)
+{
+	OSyncError *error = NULL;
+
+	OSyncObjTypeSink *sink = osync_plugin_info_get_sink(info);
+	osync_assert(sink);
+
+	char *filename = g_build_filename(directory->path, relative_filename, NULL);
+
+	struct stat buf;
+	stat(filename, &buf);
+	char *hash = mock_generate_hash(&buf);
+	
+	/* Report normal files */
+	OSyncChange *change = osync_change_new(&error);
+	osync_assert(change);
+	
+	osync_change_set_uid(change, relative_filename);
+
+	osync_change_set_hash(change, hash);
+	g_free(hash);
+
+	OSyncChangeType type = osync_hashtable_get_changetype(directory->hashtable, change);
+	
+	osync_change_set_changetype(change, type);
+	osync_hashtable_update_change(directory->hashtable, change);
+
+	if (type == OSYNC_CHANGE_TYPE_UNMODIFIED) {
+		g_free(filename);
+		osync_change_unref(change);
+		return;
+	}
+
+	OSyncFileFormat *file = osync_try_malloc0(sizeof(OSyncFileFormat), &error);
+	osync_assert(file);
+
+	file->path = g_strdup(relative_filename);
+	file->last_mod = buf.st_mtime;
+	
+	OSyncData *odata = NULL;
+
+	if (!mock_get_error(info->memberid, "ONLY_INFO")) {
+		osync_assert(osync_file_read(filename, &(file->data), &(file->size), &error));
+
+		if (mock_get_error(info->memberid, "SLOW_REPORT"))
+			sleep(1);
+		
+		odata = osync_data_new((char *)file, sizeof(OSyncFileFormat), directory->objformat, &error);
+		osync_assert(odata);
+
+
+		osync_change_set_data(change, odata);
+
+	}
+	
+	osync_data_set_objtype(odata, osync_objtype_sink_get_name(sink));
+	osync_data_unref(odata);
+
+	osync_context_report_change(ctx, change);
+
+	osync_change_unref(change);
+	g_free(filename);
+}
+
+static void mock_report_deleted(MockDir *directory, const char *uid, OSyncContext *ctx, OSyncPluginInfo *info)
+{
+	OSyncError *error = NULL;
+
+	OSyncObjTypeSink *sink = osync_plugin_info_get_sink(info);
+	osync_assert(sink);
+
+	OSyncChange *change = osync_change_new(&error);
+	osync_assert(change);
+
+	osync_change_set_uid(change, uid);
+	osync_change_set_changetype(change, OSYNC_CHANGE_TYPE_DELETED);
+	
+	OSyncData *odata = osync_data_new(NULL, 0, directory->objformat, &error);
+	osync_assert(odata);
+	
+	osync_data_set_objtype(odata, osync_objtype_sink_get_name(sink));
+	osync_change_set_data(change, odata);
+	osync_data_unref(odata);
+	
+	osync_context_report_change(ctx, change);
+	
+	osync_hashtable_update_change(directory->hashtable, change);
+
+	osync_change_unref(change);
+}
+
 static void mock_report_dir(MockDir *directory, const char *subdir, OSyncContext *ctx, OSyncPluginInfo *info)
 {
 	GError *gerror = NULL;
 	const char *de = NULL;
 	char *path = NULL;
 	GDir *dir = NULL;
-	OSyncError *error = NULL;
 
 	osync_trace(TRACE_ENTRY, "%s(%p, %s, %p)", __func__, directory, subdir, ctx);
 	
-	OSyncObjTypeSink *sink = osync_plugin_info_get_sink(info);
-	osync_assert(sink);
-
-	OSyncFormatEnv *formatenv = osync_plugin_info_get_format_env(info);
-	osync_assert(formatenv);
-
 	path = g_build_filename(directory->path, subdir, NULL);
 	osync_trace(TRACE_INTERNAL, "path %s", path);
 	
@@ -267,70 +350,44 @@ static void mock_report_dir(MockDir *directory, const char *subdir, OSyncContext
 			
 		osync_trace(TRACE_INTERNAL, "path2 %s %s", filename, relative_filename);
 		
-		if (g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
-			
-			struct stat buf;
-			stat(filename, &buf);
-			char *hash = mock_generate_hash(&buf);
-			
-			/* Report normal files */
-			OSyncChange *change = osync_change_new(&error);
-			osync_assert(change);
-			
-			osync_change_set_uid(change, relative_filename);
+		if (g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+			mock_report_file(directory, relative_filename, ctx, info);
 
-			osync_change_set_hash(change, hash);
-			g_free(hash);
+		g_free(filename);
+		g_free(relative_filename);
 
-			OSyncChangeType type = osync_hashtable_get_changetype(directory->hashtable, change);
-			
-			osync_change_set_changetype(change, type);
-			osync_hashtable_update_change(directory->hashtable, change);
-
-			if (type == OSYNC_CHANGE_TYPE_UNMODIFIED) {
-				g_free(filename);
-				g_free(relative_filename);
-				osync_change_unref(change);
-				continue;
-			}
+	}
 
-			OSyncFileFormat *file = osync_try_malloc0(sizeof(OSyncFileFormat), &error);
-			osync_assert(file);
+	g_dir_close(dir);
 
-			file->path = g_strdup(relative_filename);
-			
-			OSyncData *odata = NULL;
+	g_free(path);
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
 
-			if (!mock_get_error(info->memberid, "ONLY_INFO")) {
-				osync_assert(osync_file_read(filename, &(file->data), &(file->size), &error));
+/* Reports the files the journal saw changing. Only the files directly in
+ * the directory are synchronized, like mock_report_dir() does. */
+static void mock_report_journal(MockDir *directory, OSyncList *uids, OSyncContext *ctx, OSyncPluginInfo *info)
+{
+	OSyncList *u;
 
-				if (mock_get_error(info->memberid, "SLOW_REPORT"))
-					sleep(1);
-				
-				odata = osync_data_new((char *)file, sizeof(OSyncFileFormat), directory->objformat, &error);
-				osync_assert(odata);
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, directory, uids, ctx);
 
+	for (u = uids; u; u = u->next) {
+		const char *uid = u->data;
 
-				osync_change_set_data(change, odata);
+		if (strchr(uid, G_DIR_SEPARATOR))
+			continue;
 
-			}
-			
-			osync_data_set_objtype(odata, osync_objtype_sink_get_name(sink));
-			osync_data_unref(odata);
-	
-			osync_context_report_change(ctx, change);
+		char *filename = g_build_filename(directory->path, uid, NULL);
 
-			osync_change_unref(change);
-		}
+		if (g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+			mock_report_file(directory, uid, ctx, info);
+		else if (!g_file_test(filename, G_FILE_TEST_EXISTS) && osync_hashtable_get_hash(directory->hashtable, uid))
+			mock_report_deleted(directory, uid, ctx, info);
 
 		g_free(filename);
-		g_free(relative_filename);
-
 	}
 
-	g_dir_close(dir);
-
-	g_free(path);
 	osync_trace(TRACE_EXIT, "%s", __func__);
 }
 
@@ -357,6 +414,10 @@ static void mock_get_changes(void *data, OSyncPluginInfo *info, OSyncContext *ct
 
 	if (mock_get_error(info->memberid, "GET_CHANGES_TIMEOUT2"))
 		sleep(8);
+
+	/* Hang without ever looking at the context, like a stuck device would */
+	if (mock_get_error(info->memberid, "GET_CHANGES_HANG"))
+		sleep(60);
 		
 	if (osync_objtype_sink_get_slowsync(sink)) {
 		osync_trace(TRACE_INTERNAL, "Slow sync requested");
@@ -365,31 +426,21 @@ static void mock_get_changes(void *data, OSyncPluginInfo *info, OSyncContext *ct
 	
 	osync_trace(TRACE_INTERNAL, "get_changes for %s", osync_objtype_sink_get_name(sink));
 
-	mock_report_dir(dir, NULL, ctx, info);
-	
-	OSyncList *u, *uids = osync_hashtable_get_deleted(dir->hashtable);
-	for (u = uids; u; u = u->next) {
-		OSyncChange *change = osync_change_new(&error);
-		osync_assert(change);
+	osync_bool rescan = FALSE;
+	OSyncList *u, *uids = osync_journal_get_dirty(dir->journal, &rescan);
 
-		const char *uid = u->data;
-		
-		osync_change_set_uid(change, uid);
-		osync_change_set_changetype(change, OSYNC_CHANGE_TYPE_DELETED);
-		
-		OSyncData *odata = osync_data_new(NULL, 0, dir->objformat, &error);
-		osync_assert(odata);
-		
-		osync_data_set_objtype(odata, osync_objtype_sink_get_name(sink));
-		osync_change_set_data(change, odata);
-		osync_data_unref(odata);
-		
-		osync_context_report_change(ctx, change);
-		
-		osync_hashtable_update_change(dir->hashtable, change);
-	
-		osync_change_unref(change);
+	if (rescan || osync_objtype_sink_get_slowsync(sink)) {
+		mock_report_dir(dir, NULL, ctx, info);
+
+		OSyncList *deleted = osync_hashtable_get_deleted(dir->hashtable);
+		for (u = deleted; u; u = u->next)
+			mock_report_deleted(dir, u->data, ctx, info);
+		osync_list_free(deleted);
+	} else {
+		mock_report_journal(dir, uids, ctx, info);
 	}
+
+	osync_list_free(uids);
 	
 	osync_context_report_success(ctx);
 	osync_trace(TRACE_EXIT, "%s", __func__);
@@ -515,13 +566,13 @@ static void mock_sync_done(void *data, OSyncPluginInfo *info, OSyncContext *ctx)
 	if (mock_get_error(info->memberid, "SYNC_DONE_TIMEOUT"))
 		return;
 	
-	char *anchorpath = g_strdup_printf("%s/anchor.db", osync_plugin_info_get_configdir(info));
 	char *path_field = g_strdup_printf("path_%s", osync_objtype_sink_get_name(sink));
-	osync_anchor_update(anchorpath, path_field, dir->path);
-	g_free(anchorpath);
+	osync_anchor_store_update(dir->anchors, path_field, dir->path);
 	g_free(path_field);
 
 	osync_assert(osync_hashtable_save(dir->hashtable, NULL));
+	osync_assert(osync_anchor_store_save(dir->anchors, NULL));
+	osync_journal_commit(dir->journal);
 	
 	osync_context_report_success(ctx);
 	
@@ -598,6 +649,14 @@ static void *mock_initialize(OSyncPlugin *plugin, OSyncPluginInfo *info, OSyncEr
 
 		osync_assert(osync_hashtable_load(dir->hashtable, error));
 
+		/* The anchors are kept next to the hashtable */
+		dir->anchors = osync_anchor_store_new_from_hashtable(dir->hashtable, error);
+		osync_assert(dir->anchors);
+
+		/* The journal tells which files changed since the last sync */
+		dir->journal = osync_journal_new_from_hashtable(dir->path, dir->hashtable, error);
+		osync_assert(dir->journal);
+
 
 		/*
 		const char *objformat = osync_objformat_get_name(dir->objformat); 
@@ -695,6 +754,8 @@ static void mock_finalize(void *data)
 
 		osync_plugin_resource_unref(dir->res);
 		osync_objformat_unref(dir->objformat);
+		osync_journal_unref(dir->journal);
+		osync_anchor_store_unref(dir->anchors);
 		osync_hashtable_unref(dir->hashtable);
 
 		env->directories = g_list_remove(env->directories, dir);
@@ -65,6 +65,8 @@ typedef struct MockDir {
 	GDir *dir;
 	const char *path;
 	OSyncHashTable *hashtable;
+	OSyncAnchorStore *anchors;
+	OSyncJournal *journal;
 	mock_env *env;
 	osync_bool committed_all;
 } MockDir;
@@ -16,6 +16,7 @@ static void reset_env(void)
 	g_unsetenv("GET_CHANGES_ERROR");
 	g_unsetenv("GET_CHANGES_TIMEOUT");
 	g_unsetenv("GET_CHANGES_TIMEOUT2");
+	g_unsetenv("GET_CHANGES_HANG");
 	g_unsetenv("COMMIT_ERROR");
 	g_unsetenv("COMMIT_TIMEOUT");
 	g_unsetenv("SYNC_DONE_ERROR");
@@ -5,11 +5,21 @@
 #include "opensync/group/opensync_group_internals.h"
 #include "opensync/engine/opensync_engine_internals.h"
 
+#include <utime.h>
+
 static osync_bool dummy_filter_hook(OSyncData *data, const char *config)
 {
 	return TRUE;
 }
 
+static int num_deny_hook_calls = 0;
+
+static osync_bool deny_filter_hook(OSyncData *data, const char *config)
+{
+	num_deny_hook_calls++;
+	return (config && !strcmp(config, "deny"));
+}
+
 START_TEST (filter_setup)
 {
 	OSyncError *error = NULL;
@@ -120,6 +130,10 @@ START_TEST (filter_sync_deny_all)
 	fail_unless(osync_testing_file_exists("data1/testdata"), NULL);
 	fail_unless(osync_testing_file_exists("data2/testdata2"), NULL);
 
+	/* Nothing got through */
+	fail_unless(!osync_testing_file_exists("data1/testdata2"), NULL);
+	fail_unless(!osync_testing_file_exists("data2/testdata"), NULL);
+
 	g_free(formatdir);
 	g_free(plugindir);
 	
@@ -145,7 +159,7 @@ START_TEST (filter_sync_custom)
 	fail_unless(group != NULL, NULL);
 	mark_point();
 	
-	OSyncCustomFilter *custom_filter = osync_custom_filter_new("mockobjtype1", "mockformat1", "mockformat1_custom_filter", dummy_filter_hook, &error);
+	OSyncCustomFilter *custom_filter = osync_custom_filter_new("mockobjtype1", "mockformat1", "mockformat1_custom_filter", deny_filter_hook, &error);
 	fail_unless(custom_filter != NULL, NULL);
 
 	OSyncFilter *filter = osync_filter_new_custom(custom_filter, NULL, OSYNC_FILTER_DENY, &error);
@@ -154,7 +168,60 @@ START_TEST (filter_sync_custom)
 
 	osync_group_add_filter(group, filter);
 
+	/* The custom filter doesn't match, so the changes pass */
 	osync_filter_set_config(filter, "test");
+	num_deny_hook_calls = 0;
+	
+	mark_point();
+  	OSyncEngine *engine = osync_engine_new(group, &error);
+  	mark_point();
+  	fail_unless(engine != NULL, NULL);
+
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	osync_engine_set_schemadir(engine, testbed);
+
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	synchronize_once(engine, NULL);
+	osync_engine_finalize(engine, &error);
+
+	fail_unless(osync_testing_diff("data1", "data2"), NULL);
+	fail_unless(num_deny_hook_calls == 2, NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (filter_sync_custom_deny)
+{
+	char *testbed = setup_testbed("filter_sync_custom");
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	char *plugindir = g_strdup_printf("%s/plugins",  testbed);
+	
+	OSyncError *error = NULL;
+
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	osync_group_load(group, "configs/group", &error);
+	fail_unless(error == NULL, osync_error_print(&error));
+	fail_unless(group != NULL, NULL);
+	mark_point();
+	
+	OSyncCustomFilter *custom_filter = osync_custom_filter_new("mockobjtype1", "mockformat1", "mockformat1_custom_filter", deny_filter_hook, &error);
+	fail_unless(custom_filter != NULL, NULL);
+
+	OSyncFilter *filter = osync_filter_new_custom(custom_filter, "deny", OSYNC_FILTER_DENY, &error);
+	fail_unless(filter != NULL, NULL);
+	fail_unless(!strcmp(osync_filter_get_objtype(filter), "mockobjtype1"), NULL);
+
+	osync_group_add_filter(group, filter);
+	num_deny_hook_calls = 0;
 	
 	mark_point();
   	OSyncEngine *engine = osync_engine_new(group, &error);
@@ -168,9 +235,90 @@ START_TEST (filter_sync_custom)
 	fail_unless(osync_engine_initialize(engine, &error), NULL);
 	synchronize_once(engine, NULL);
 	osync_engine_finalize(engine, &error);
+	osync_engine_unref(engine);
+
+	/* The filter got evaluated on both changes and denied them */
+	fail_unless(num_deny_hook_calls == 2, NULL);
+	fail_unless(osync_testing_file_exists("data1/testdata"), NULL);
+	fail_unless(osync_testing_file_exists("data2/testdata2"), NULL);
+	fail_unless(!osync_testing_file_exists("data1/testdata2"), NULL);
+	fail_unless(!osync_testing_file_exists("data2/testdata"), NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (filter_sync_custom_delete)
+{
+	char *testbed = setup_testbed("filter_sync_custom");
+	char *formatdir = g_strdup_printf("%s/formats",  testbed);
+	char *plugindir = g_strdup_printf("%s/plugins",  testbed);
+	
+	OSyncError *error = NULL;
+
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	osync_group_load(group, "configs/group", &error);
+	fail_unless(error == NULL, osync_error_print(&error));
+	fail_unless(group != NULL, NULL);
+	mark_point();
+	
+	OSyncCustomFilter *custom_filter = osync_custom_filter_new("mockobjtype1", "mockformat1", "mockformat1_custom_filter", deny_filter_hook, &error);
+	fail_unless(custom_filter != NULL, NULL);
+
+	OSyncFilter *filter = osync_filter_new_custom(custom_filter, "test", OSYNC_FILTER_DENY, &error);
+	fail_unless(filter != NULL, NULL);
+
+	osync_group_add_filter(group, filter);
+	
+	mark_point();
+  	OSyncEngine *engine = osync_engine_new(group, &error);
+  	mark_point();
+  	fail_unless(engine != NULL, NULL);
+
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	osync_engine_set_schemadir(engine, testbed);
+
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+
+	/* Both entries pass and get mapped */
+	fail_unless(synchronize_once(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(osync_testing_diff("data1", "data2"), NULL);
 
+	/* A new entry gets denied and never mapped */
+	osync_testing_system_abort("cp data2/testdata2 data2/testdata3");
+	osync_filter_set_config(filter, "deny");
+	num_deny_hook_calls = 0;
+
+	fail_unless(synchronize_once(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(num_deny_hook_calls == 1, NULL);
+	fail_unless(!osync_testing_file_exists("data1/testdata3"), NULL);
+
+	/* The deletion of the mapped entry passes, the one of the denied entry
+	   gets dropped instead of being written to the other member */
+	fail_unless(!osync_testing_file_remove("data2/testdata"), NULL);
+	fail_unless(!osync_testing_file_remove("data2/testdata3"), NULL);
+	num_deny_hook_calls = 0;
+
+	fail_unless(synchronize_once(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(num_deny_hook_calls == 0, NULL);
+	fail_unless(!osync_testing_file_exists("data1/testdata"), NULL);
+	fail_unless(osync_testing_file_exists("data1/testdata2"), NULL);
 	fail_unless(osync_testing_diff("data1", "data2"), NULL);
 
+	osync_engine_finalize(engine, &error);
+	osync_engine_unref(engine);
+
 	g_free(formatdir);
 	g_free(plugindir);
 	
@@ -193,10 +341,6 @@ START_TEST (filter_save_and_load)
 	fail_unless(group != NULL, NULL);
 	mark_point();
 	
-	/* TODO filter member handling 
-	OSyncMember *leftmember = osync_group_nth_member(group, 0);
-	OSyncMember *rightmember = osync_group_nth_member(group, 1);
-	*/
 	OSyncCustomFilter *custom_filter = osync_custom_filter_new("mockobjtype3", "mockformat3", "mockformat1_custom_filter", dummy_filter_hook, &error);
 	fail_unless(custom_filter != NULL, NULL);
 
@@ -212,6 +356,9 @@ START_TEST (filter_save_and_load)
 	osync_group_add_filter(group, filter1);
 	osync_group_add_filter(group, filter2);
 	osync_group_add_filter(group, filter3);
+	osync_filter_unref(filter1);
+	osync_filter_unref(filter2);
+	osync_filter_unref(filter3);
 
 	fail_unless(osync_group_num_filters(group) == 3, NULL);
 	fail_unless(osync_group_nth_filter(group, 0) == filter1, NULL);
@@ -219,55 +366,82 @@ START_TEST (filter_save_and_load)
 	fail_unless(osync_group_nth_filter(group, 2) == filter3, NULL);
 	
 	mark_point();
-	osync_group_save(group, NULL);
+	fail_unless(osync_group_save(group, &error), NULL);
+	osync_group_unref(group);
 	mark_point();
 
-	osync_group_load(group, "configs/group", NULL);
-	fail_unless(group != NULL, NULL);
-	mark_point();
+	/* Loaded into a fresh group, the filters come from syncgroup.conf */
+	group = osync_group_new(&error);
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* Loading again doesn't duplicate the filters */
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
 
 	fail_unless(osync_group_num_filters(group) == 3, NULL);
 	filter1 = osync_group_nth_filter(group, 0);
 	fail_unless(filter1 != NULL, NULL);
-	/* filter aren't member specific anymore. */
-	//fail_unless(filter1->sourcememberid == 1, NULL);
-	//fail_unless(filter1->destmemberid == 2, NULL);
 	fail_unless(!strcmp(osync_filter_get_objtype(filter1), "mockobjtype1"), NULL);
-	/* cross objtype syncing isn't supported anymore with 0.30 API */
-	//fail_unless(!strcmp(filter1->destobjtype, "2"), NULL);
-	//fail_unless(!strcmp(filter1->detectobjtype, "3"), NULL);
-	fail_unless(filter1->action == OSYNC_FILTER_DENY, NULL);
+	fail_unless(osync_filter_get_action(filter1) == OSYNC_FILTER_DENY, NULL);
+	fail_unless(osync_filter_get_custom_filter_name(filter1) == NULL, NULL);
+	fail_unless(osync_filter_get_config(filter1) == NULL, NULL);
 	
-	filter1 = osync_group_nth_filter(group, 1);
-	fail_unless(filter1 != NULL, NULL);
-	/* filter aren't member specific anymore. */
-	//fail_unless(filter1->sourcememberid == 2, NULL);
-	//fail_unless(filter1->destmemberid == 1, NULL);
-	/* cross objtype syncing isn't supported anymore with 0.30 API */
-	fail_unless(!strcmp(osync_filter_get_objtype(filter1), "mockobjtype2"), NULL);
-	/* cross objtype syncing isn't supported anymore with 0.30 API */
-	//fail_unless(!strcmp(filter1->destobjtype, "5"), NULL);
-	//fail_unless(!strcmp(filter1->detectobjtype, "6"), NULL);
-	fail_unless(filter1->action == OSYNC_FILTER_ALLOW, NULL);
-
-	filter1 = osync_group_nth_filter(group, 2);
-	fail_unless(filter1 != NULL, NULL);
+	filter2 = osync_group_nth_filter(group, 1);
+	fail_unless(filter2 != NULL, NULL);
+	fail_unless(!strcmp(osync_filter_get_objtype(filter2), "mockobjtype2"), NULL);
+	fail_unless(osync_filter_get_action(filter2) == OSYNC_FILTER_ALLOW, NULL);
+	fail_unless(osync_filter_get_custom_filter_name(filter2) == NULL, NULL);
+
+	filter3 = osync_group_nth_filter(group, 2);
+	fail_unless(filter3 != NULL, NULL);
+	fail_unless(!strcmp(osync_filter_get_objtype(filter3), "mockobjtype3"), NULL);
+	fail_unless(osync_filter_get_action(filter3) == OSYNC_FILTER_IGNORE, NULL);
+	fail_unless(!strcmp(osync_filter_get_custom_filter_name(filter3), "mockformat1_custom_filter"), NULL);
+	fail_unless(!strcmp(osync_filter_get_config(filter3), "test"), NULL);
+
+	/* The custom filter only gets bound against a format environment */
+	fail_unless(filter3->custom_filter == NULL, NULL);
+
+	OSyncFormatEnv *formatenv = osync_format_env_new(&error);
+	fail_unless(formatenv != NULL, NULL);
 
-	/* filter aren't member specific anymore. */
-	//fail_unless(filter1->sourcememberid == 1, NULL);
-	//fail_unless(filter1->destmemberid == 2, NULL);
-	/* cross objtype syncing isn't supported anymore with 0.30 API */
+	fail_if(osync_filter_bind_custom_filter(filter3, formatenv, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
 
-	// FIXME - custom filter handling for objtype
-	///fail_unless(!strcmp(osync_filter_get_objtype(filter1), "mockobjtype3"), NULL);
+	osync_format_env_register_filter(formatenv, custom_filter);
+	fail_unless(osync_filter_bind_custom_filter(filter3, formatenv, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(filter3->custom_filter == custom_filter, NULL);
+	fail_unless(filter3->custom_filter->hook != NULL, NULL);
+	fail_unless(!strcmp(osync_filter_get_custom_filter_name(filter3), "mockformat1_custom_filter"), NULL);
+
+	osync_format_env_free(formatenv);
+	osync_custom_filter_unref(custom_filter);
+	osync_group_unref(group);
+
+	/* The filters survive the group snapshot as well */
+	struct utimbuf times;
+	times.actime = times.modtime = time(NULL) - 3600;
+	fail_unless(utime("configs/group/syncgroup.conf", &times) == 0, NULL);
+	fail_unless(utime("configs/group/1/syncmember.conf", &times) == 0, NULL);
+	fail_unless(utime("configs/group/2/syncmember.conf", &times) == 0, NULL);
 
-	/* cross objtype syncing isn't supported anymore with 0.30 API */
-	//fail_unless(!strcmp(filter1->destobjtype, "8"), NULL);
-	//fail_unless(!strcmp(filter1->detectobjtype, "9"), NULL);
-	fail_unless(filter1->custom_filter != NULL, NULL);
-	fail_unless(filter1->custom_filter->hook != NULL, NULL);
-	fail_unless(!strcmp(osync_filter_get_config(filter1), "test"), NULL);
+	group = osync_group_new(&error);
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	osync_group_unref(group);
+	fail_unless(g_file_test("configs/group/syncgroup.snapshot", G_FILE_TEST_IS_REGULAR), NULL);
 
+	group = osync_group_new(&error);
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(osync_group_num_filters(group) == 3, NULL);
+	filter3 = osync_group_nth_filter(group, 2);
+	fail_unless(osync_filter_get_action(filter3) == OSYNC_FILTER_IGNORE, NULL);
+	fail_unless(!strcmp(osync_filter_get_custom_filter_name(filter3), "mockformat1_custom_filter"), NULL);
+	fail_unless(!strcmp(osync_filter_get_config(filter3), "test"), NULL);
 	osync_group_unref(group);
 
 	destroy_testbed(testbed);
@@ -454,6 +628,8 @@ Suite *filter_suite(void)
 	create_case(s, "filter_setup", filter_setup);
 	create_case(s, "filter_sync_deny_all", filter_sync_deny_all);
 	create_case(s, "filter_sync_custom", filter_sync_custom);
+	create_case(s, "filter_sync_custom_deny", filter_sync_custom_deny);
+	create_case(s, "filter_sync_custom_delete", filter_sync_custom_delete);
 	create_case(s, "filter_save_and_load", filter_save_and_load);
 	//create_case(s, "filter_sync_vcard_only", filter_sync_vcard_only); // TODO, see testcase description
 	create_case(s, "filter_destobjtype_delete", filter_destobjtype_delete);
@@ -411,6 +411,394 @@ START_TEST (sync_easy_conflict)
 }
 END_TEST
 
+START_TEST (sync_easy_conflict_policy)
+{
+	char *testbed = setup_testbed("sync");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	osync_testing_system_abort("cp testdata data1/testdata");
+	osync_testing_system_abort("cp testdata comp_data");
+	osync_testing_system_abort("cp new_data1 data2/testdata");
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* The engine solves the conflict itself, member 1 wins */
+	osync_group_set_conflict_resolution(group, OSYNC_CONFLICT_RESOLUTION_DUPLICATE, 0);
+	osync_group_set_objtype_conflict_resolution(group, "mockobjtype1", OSYNC_CONFLICT_RESOLUTION_SELECT, 1);
+	
+	OSyncConflictResolution res = OSYNC_CONFLICT_RESOLUTION_UNKNOWN;
+	int winner = 0;
+	osync_group_get_objtype_conflict_resolution(group, "mockobjtype1", &res, &winner);
+	fail_unless(res == OSYNC_CONFLICT_RESOLUTION_SELECT, NULL);
+	fail_unless(winner == 1, NULL);
+	osync_group_get_objtype_conflict_resolution(group, "mockobjtype2", &res, &winner);
+	fail_unless(res == OSYNC_CONFLICT_RESOLUTION_DUPLICATE, NULL);
+	
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_group_unref(group);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_first, GINT_TO_POINTER(2));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_engine_unref(engine);
+	
+	fail_unless(num_client_errors == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+
+	fail_unless(num_change_read == 2, NULL);
+	fail_unless(num_change_written == 1, NULL);
+	fail_unless(num_change_error == 0, NULL);
+
+	/* The conflict never reached the callback */
+	fail_unless(num_mapping_solved == 1, NULL);
+	fail_unless(num_mapping_errors == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+
+	fail_unless(!system("test \"x$(diff -x \".*\" data1 data2)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data2/testdata comp_data)\" = \"x\""), NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (sync_easy_conflict_policy_duplicate)
+{
+	char *testbed = setup_testbed("sync");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	osync_testing_system_abort("cp testdata data1/testdata");
+	osync_testing_system_abort("cp new_data1 data2/testdata");
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_group_set_objtype_conflict_resolution(group, "mockobjtype1", OSYNC_CONFLICT_RESOLUTION_DUPLICATE, 0);
+	
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_group_unref(group);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_first, GINT_TO_POINTER(2));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_engine_unref(engine);
+	
+	fail_unless(num_client_errors == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+
+	fail_unless(num_change_read == 2, NULL);
+	fail_unless(num_change_written == 3, NULL);
+	fail_unless(num_change_error == 0, NULL);
+
+	fail_unless(num_mapping_solved == 1, NULL);
+	fail_unless(num_mapping_errors == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+
+	fail_unless(!system("test \"x$(diff -x \".*\" data1 data2)\" = \"x\""), NULL);
+	
+	char *path = g_strdup_printf("%s/configs/group/archive.db", testbed);
+	OSyncMappingTable *maptable = mappingtable_load(path, "mockobjtype1", 2);
+	g_free(path);
+	check_mapping(maptable, 1, -1, 2, "testdata");
+	check_mapping(maptable, 1, -1, 2, "testdata-dupe");
+	check_mapping(maptable, 2, -1, 2, "testdata");
+	check_mapping(maptable, 2, -1, 2, "testdata-dupe");
+	osync_mapping_table_close(maptable);
+	osync_mapping_table_unref(maptable);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (sync_easy_conflict_policy_ignore)
+{
+	char *testbed = setup_testbed("sync");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	osync_testing_system_abort("cp testdata data1/testdata");
+	osync_testing_system_abort("cp new_data1 data2/testdata");
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_group_set_objtype_conflict_resolution(group, "mockobjtype1", OSYNC_CONFLICT_RESOLUTION_IGNORE, 0);
+	
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_group_unref(group);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_first, GINT_TO_POINTER(2));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_engine_unref(engine);
+	
+	fail_unless(num_client_errors == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+
+	fail_unless(num_change_read == 2, NULL);
+	fail_unless(num_change_written == 0, NULL);
+	fail_unless(num_change_error == 0, NULL);
+
+	fail_unless(num_mapping_solved == 1, NULL);
+	fail_unless(num_mapping_errors == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+
+	/* Both members keep their own version */
+	fail_unless(system("test \"x$(diff -x \".*\" data1 data2)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data1/testdata testdata)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data2/testdata new_data1)\" = \"x\""), NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (sync_easy_conflict_policy_newer)
+{
+	char *testbed = setup_testbed("sync");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	osync_testing_system_abort("cp testdata data1/testdata");
+	osync_testing_system_abort("touch -d \"1 day ago\" data1/testdata");
+	osync_testing_system_abort("cp new_data1 data2/testdata");
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+
+	/* The younger change of member 2 wins */
+	osync_group_set_objtype_conflict_resolution(group, "mockobjtype1", OSYNC_CONFLICT_RESOLUTION_NEWER, 0);
+	
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_group_unref(group);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	
+	osync_engine_set_conflict_callback(engine, conflict_handler_choose_first, GINT_TO_POINTER(2));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_engine_unref(engine);
+	
+	fail_unless(num_client_errors == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+
+	fail_unless(num_change_read == 2, NULL);
+	fail_unless(num_change_written == 1, NULL);
+	fail_unless(num_change_error == 0, NULL);
+
+	fail_unless(num_mapping_solved == 1, NULL);
+	fail_unless(num_mapping_errors == 0, NULL);
+	fail_unless(num_mapping_conflicts == 0, NULL);
+
+	fail_unless(!system("test \"x$(diff -x \".*\" data1 data2)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data1/testdata new_data1)\" = \"x\""), NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
+static OSyncMappingEngine *bulk_conflicts[2];
+
+/* Collects both conflicts and solves them in a single step */
+static void conflict_handler_bulk(OSyncEngine *engine, OSyncMappingEngine *mapping, void *user_data)
+{
+	OSyncError *error = NULL;
+	osync_trace(TRACE_ENTRY, "%s(%p, %p, %p)", __func__, engine, mapping, user_data);
+	
+	fail_unless(num_mapping_conflicts < 2, NULL);
+	fail_unless(num_engine_end_conflicts == 0, NULL);
+	bulk_conflicts[num_mapping_conflicts++] = mapping;
+
+	if (num_mapping_conflicts == 2) {
+		fail_unless(osync_engine_mapping_resolve_bulk(engine, bulk_conflicts, 2, OSYNC_CONFLICT_RESOLUTION_SELECT, GPOINTER_TO_INT(user_data), &error), NULL);
+		fail_unless(error == NULL, NULL);
+	}
+	
+	osync_trace(TRACE_EXIT, "%s", __func__);
+}
+
+START_TEST (sync_easy_conflict_resolve_bulk)
+{
+	char *testbed = setup_testbed("sync");
+	char *formatdir = g_strdup_printf("%s/formats", testbed);
+	char *plugindir = g_strdup_printf("%s/plugins", testbed);
+	
+	osync_testing_system_abort("cp testdata data1/testdata");
+	osync_testing_system_abort("cp testdata data1/testdata2");
+	osync_testing_system_abort("cp new_data1 data2/testdata");
+	osync_testing_system_abort("cp new_data2 data2/testdata2");
+	
+	OSyncError *error = NULL;
+	OSyncGroup *group = osync_group_new(&error);
+	fail_unless(group != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_group_set_schemadir(group, testbed);
+	fail_unless(osync_group_load(group, "configs/group", &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	OSyncEngine *engine = osync_engine_new(group, &error);
+	fail_unless(engine != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_group_unref(group);
+
+	osync_engine_set_schemadir(engine, testbed);
+	osync_engine_set_plugindir(engine, plugindir);
+	osync_engine_set_formatdir(engine, formatdir);
+	
+	/* Member 2 wins both conflicts */
+	osync_engine_set_conflict_callback(engine, conflict_handler_bulk, GINT_TO_POINTER(2));
+	osync_engine_set_changestatus_callback(engine, entry_status, GINT_TO_POINTER(1));
+	osync_engine_set_mappingstatus_callback(engine, mapping_status, GINT_TO_POINTER(1));
+	osync_engine_set_enginestatus_callback(engine, engine_status, GINT_TO_POINTER(1));
+	osync_engine_set_memberstatus_callback(engine, member_status, GINT_TO_POINTER(1));
+	
+	fail_unless(osync_engine_initialize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_synchronize_and_block(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	fail_unless(osync_engine_finalize(engine, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	
+	osync_engine_unref(engine);
+	
+	fail_unless(num_client_errors == 0, NULL);
+	fail_unless(num_engine_errors == 0, NULL);
+	fail_unless(num_engine_successful == 1, NULL);
+	fail_unless(num_engine_end_conflicts == 1, NULL);
+
+	fail_unless(num_change_read == 4, NULL);
+	fail_unless(num_change_written == 2, NULL);
+	fail_unless(num_change_error == 0, NULL);
+
+	fail_unless(num_mapping_solved == 2, NULL);
+	fail_unless(num_mapping_errors == 0, NULL);
+	fail_unless(num_mapping_conflicts == 2, NULL);
+
+	fail_unless(!system("test \"x$(diff -x \".*\" data1 data2)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data1/testdata new_data1)\" = \"x\""), NULL);
+	fail_unless(!system("test \"x$(diff -x \".*\" data1/testdata2 new_data2)\" = \"x\""), NULL);
+
+	g_free(formatdir);
+	g_free(plugindir);
+	
+	destroy_testbed(testbed);
+}
+END_TEST
+
 START_TEST (sync_easy_new_mapping)
 {
 	char *testbed = setup_testbed("sync");
@@ -3205,6 +3593,11 @@ Suite *env_suite(void)
 	create_case(s, "sync_easy_new", sync_easy_new);
 	create_case(s, "sync_easy_new_del", sync_easy_new_del);
 	create_case(s, "sync_easy_conflict", sync_easy_conflict);
+	create_case(s, "sync_easy_conflict_policy", sync_easy_conflict_policy);
+	create_case(s, "sync_easy_conflict_policy_duplicate", sync_easy_conflict_policy_duplicate);
+	create_case(s, "sync_easy_conflict_policy_ignore", sync_easy_conflict_policy_ignore);
+	create_case(s, "sync_easy_conflict_policy_newer", sync_easy_conflict_policy_newer);
+	create_case(s, "sync_easy_conflict_resolve_bulk", sync_easy_conflict_resolve_bulk);
 	create_case(s, "sync_easy_new_mapping", sync_easy_new_mapping);
 	create_case(s, "sync_easy_conflict_duplicate", sync_easy_conflict_duplicate);
 	create_case(s, "sync_easy_conflict_abort", sync_easy_conflict_abort);
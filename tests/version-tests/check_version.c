@@ -79,12 +79,116 @@ START_TEST (version_load_from_descriptions)
 }
 END_TEST
 
+static OSyncVersion *_version_pattern_new(const char *plugin, const char *priority, const char *modelversion, const char *identifier)
+{
+	OSyncError *error = NULL;
+	OSyncVersion *pattern = osync_version_new(&error);
+	fail_unless(pattern != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	osync_version_set_plugin(pattern, plugin);
+	osync_version_set_priority(pattern, priority);
+	osync_version_set_vendor(pattern, "");
+	osync_version_set_modelversion(pattern, modelversion);
+	osync_version_set_firmwareversion(pattern, "");
+	osync_version_set_softwareversion(pattern, "");
+	osync_version_set_hardwareversion(pattern, "");
+	osync_version_set_identifier(pattern, identifier);
+	return pattern;
+}
+
+START_TEST (version_db_find)
+{
+	char *testbed = setup_testbed("merger");
+
+	OSyncError *error = NULL;
+	OSyncVersionDB *db = osync_version_db_new(&error);
+	fail_unless(db != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	OSyncVersion *pattern = _version_pattern_new("Sync[A-Z]", "10", "", "generic");
+	fail_unless(osync_version_db_add(db, pattern, &error), NULL);
+	osync_version_unref(pattern);
+
+	pattern = _version_pattern_new("Sync[A-Z]", "100", "76[0-9]0", "nokia-76x0");
+	fail_unless(osync_version_db_add(db, pattern, &error), NULL);
+	osync_version_unref(pattern);
+
+	pattern = _version_pattern_new("Sync[A-Z]", "100", "7650", "nokia-7650");
+	fail_unless(osync_version_db_add(db, pattern, &error), NULL);
+	osync_version_unref(pattern);
+
+	pattern = _version_pattern_new("Sync[", "1000", "", "broken");
+	fail_unless(!osync_version_db_add(db, pattern, &error), NULL);
+	fail_unless(error != NULL, NULL);
+	osync_error_unref(&error);
+	osync_version_unref(pattern);
+
+	OSyncVersion *version = osync_version_new(&error);
+	fail_unless(version != NULL, NULL);
+	osync_version_set_plugin(version, "SyncML");
+	osync_version_set_vendor(version, "Nokia");
+	osync_version_set_modelversion(version, "7650");
+
+	/* Highest priority wins, the first one added on equal priority */
+	OSyncVersion *winner = osync_version_db_find(db, version, &error);
+	fail_unless(winner != NULL, NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(!strcmp(osync_version_get_identifier(winner), "nokia-76x0"), NULL);
+	osync_version_unref(winner);
+
+	osync_version_set_modelversion(version, "6230");
+	winner = osync_version_db_find(db, version, &error);
+	fail_unless(winner != NULL, NULL);
+	fail_unless(!strcmp(osync_version_get_identifier(winner), "generic"), NULL);
+	osync_version_unref(winner);
+
+	osync_version_set_plugin(version, "IrMC");
+	fail_unless(osync_version_db_find(db, version, &error) == NULL, NULL);
+	fail_unless(error == NULL, NULL);
+
+	osync_version_unref(version);
+	osync_version_db_unref(db);
+
+	destroy_testbed(testbed);
+}
+END_TEST
+
+START_TEST (version_db_load)
+{
+	char *testbed = setup_testbed("merger");
+	char *descriptiondir = g_strdup_printf("%s/descriptions", testbed);
+	char *cachefile = g_strdup_printf("%s/cache/descriptions.cache", testbed);
+	fail_unless(g_mkdir(descriptiondir, 0700) == 0, NULL);
+
+	OSyncError *error = NULL;
+	OSyncVersionDB *db = osync_version_db_new(&error);
+	fail_unless(db != NULL, NULL);
+	fail_unless(osync_version_db_load(db, descriptiondir, testbed, cachefile, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	fail_unless(g_file_test(cachefile, G_FILE_TEST_IS_REGULAR), NULL);
+	osync_version_db_unref(db);
+
+	/* Second load is served from the cache */
+	db = osync_version_db_new(&error);
+	fail_unless(db != NULL, NULL);
+	fail_unless(osync_version_db_load(db, descriptiondir, testbed, cachefile, &error), NULL);
+	fail_unless(error == NULL, NULL);
+	osync_version_db_unref(db);
+
+	g_free(descriptiondir);
+	g_free(cachefile);
+	destroy_testbed(testbed);
+}
+END_TEST
+
 Suite *version_suite(void)
 {
 	Suite *s = suite_create("Version");
 	create_case(s, "version_new", version_new);
 	create_case(s, "version_matches", version_matches);
 	create_case(s, "version_load_from_descriptions", version_load_from_descriptions);
+	create_case(s, "version_db_find", version_db_find);
+	create_case(s, "version_db_load", version_db_load);
 	return s;
 }
 
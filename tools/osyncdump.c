@@ -19,15 +19,23 @@ static void usage (char *name, int ecode)
   fprintf (stderr, "[--hash <objtype> <memberid>] \tDump hash table for member id\n");
   fprintf (stderr, "[--configdir] \tSet a different configdir then ~./opensync\n");
   fprintf (stderr, "[--reset] \tReset the database for this group\n");
+  fprintf (stderr, "[--recompact] \tRewrite the archive of this group in the compact encoding\n");
   exit(ecode);
 }
 
 typedef enum  {
   DUMPMAPS = 1,
   DUMPHASH = 2,
-  RESET = 4
+  RESET = 4,
+  RECOMPACT = 8
 } ToolAction;
 
+static osync_bool print_change(long long int id, const char *uid, long long int mappingid, long long int memberid, void *userdata, OSyncError **error)
+{
+  printf("ID: %lli UID: %s MEMBER: %lli MAPPINGID: %lli\n", id, uid, memberid, mappingid);
+  return TRUE;
+}
+
 static void dump_map_objtype(OSyncGroupEnv *env, const char *objtype, const char *groupname)
 {
   OSyncError *error = NULL;
@@ -35,42 +43,14 @@ static void dump_map_objtype(OSyncGroupEnv *env, const char *objtype, const char
 	
   char *path = g_strdup_printf("%s/archive.db", osync_group_get_configdir(group));
   OSyncArchive *archive = osync_archive_new(path, &error);
-  OSyncList *ids = NULL;
-  OSyncList *uids = NULL;
-  OSyncList *mappingids = NULL;
-  OSyncList *memberids = NULL;
-  OSyncList *d , *u, *m, *i;
 
   if (!archive)
     goto error;
   g_free(path);
 	
-  if (!osync_archive_load_changes(archive, objtype, &ids, &uids, &mappingids, &memberids, &error))
+  if (!osync_archive_foreach_change(archive, objtype, print_change, NULL, &error))
     goto error;
 	
-  d = ids;
-  u = uids;
-  m = mappingids;
-  i = memberids;
-	
-  for (; u; u = u->next) {
-    long long int id = (long long int)GPOINTER_TO_INT(d->data);
-    char *uid = u->data;
-    long long int memberid = (long long int)GPOINTER_TO_INT(i->data);
-    long long int mappingid = (long long int)GPOINTER_TO_INT(m->data);
-		
-    printf("ID: %lli UID: %s MEMBER: %lli MAPPINGID: %lli\n", id, uid, memberid, mappingid);
-		
-    m = m->next;
-    d = d->next;
-    i = i->next;
-  }
-	
-  osync_list_free(ids);
-  osync_list_free(uids);
-  osync_list_free(mappingids);
-  osync_list_free(memberids);
-	
   osync_archive_unref(archive);
   return;
 
@@ -160,6 +140,45 @@ static void reset(OSyncGroupEnv *osync, char *groupname)
   osync_group_reset(group, NULL);
 }
 
+static void recompact(OSyncGroupEnv *env, const char *groupname)
+{
+  OSyncError *error = NULL;
+  OSyncGroup *group = osync_group_env_find_group(env, groupname);
+  OSyncArchive *archive = NULL;
+  char *path = NULL;
+
+  if (!group) {
+    printf("Unable to find group with name \"%s\"\n", groupname);
+    return;
+  }
+
+  /* Nobody must synchronize while the archive gets rewritten */
+  if (osync_group_lock(group) == OSYNC_LOCKED) {
+    printf("Group \"%s\" is in use, try again after the synchronization finished\n", groupname);
+    return;
+  }
+
+  path = g_strdup_printf("%s/archive.db", osync_group_get_configdir(group));
+  archive = osync_archive_new(path, &error);
+  g_free(path);
+  if (!archive)
+    goto error;
+
+  if (!osync_archive_recompact(archive, &error))
+    goto error_free_archive;
+
+  osync_archive_unref(archive);
+  osync_group_unlock(group);
+  return;
+
+ error_free_archive:
+  osync_archive_unref(archive);
+ error:
+  osync_group_unlock(group);
+  printf("ERROR: %s", osync_error_print(&error));
+  osync_error_unref(&error);
+}
+
 int main (int argc, char *argv[])
 {
   int i;
@@ -192,6 +211,8 @@ int main (int argc, char *argv[])
         usage (argv[0], 1);
     } else if (!strcmp (arg, "--reset")) {
       action = RESET;
+    } else if (!strcmp (arg, "--recompact")) {
+      action = RECOMPACT;
     } else if (!strcmp (arg, "--help")) {
       usage (argv[0], 0);
     } else if (!strcmp (arg, "--configdir")) {
@@ -228,6 +249,9 @@ int main (int argc, char *argv[])
   case RESET:
     reset(env, groupname);
     break;
+  case RECOMPACT:
+    recompact(env, groupname);
+    break;
   }
 	
   return 0;
@@ -4,7 +4,9 @@
 	}
 
 	static void anchor_update(const char *anchordb, const char *key, const char *new_anchor) {
-		osync_anchor_update(anchordb, key, new_anchor);
+		Error *err = NULL;
+		osync_anchor_update_full(anchordb, key, new_anchor, &err);
+		raise_exception_on_error(err);
 	}
 
 	static char *anchor_retrieve(const char *anchordb, const char *key) {